@@ -0,0 +1,190 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "akonadicontrol/ondemandagents.h"
+#include "changerecorderjournal_p.h"
+#include "private/standarddirs_p.h"
+#include "shared/aktest.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QTest>
+
+using namespace Akonadi;
+
+class OnDemandAgentsTest : public QObject
+{
+    Q_OBJECT
+
+    static QString journalFile(const QString &identifier)
+    {
+        return StandardDirs::agentConfigFile(identifier, StandardDirs::WriteOnly) + QStringLiteral("_changes.dat");
+    }
+
+    static QQueue<Protocol::ChangeNotificationPtr> changes(int count)
+    {
+        QQueue<Protocol::ChangeNotificationPtr> changes;
+        for (int i = 0; i < count; ++i) {
+            auto ntf = Protocol::ItemChangeNotificationPtr::create();
+            ntf->setOperation(Protocol::ItemChangeNotification::Add);
+            ntf->setSessionId("session");
+            ntf->setResource("akonadi_test_resource_0");
+            ntf->setParentCollection(1);
+            Protocol::FetchItemsResponse item;
+            item.setId(i + 1);
+            item.setRemoteId(QString::number(i + 1));
+            item.setMimeType(QStringLiteral("message/rfc822"));
+            ntf->setItems({item});
+            changes.enqueue(ntf);
+        }
+        return changes;
+    }
+
+private Q_SLOTS:
+    void testHasPendingChanges_data()
+    {
+        QTest::addColumn<int>("changes");
+        QTest::addColumn<int>("replayed");
+        QTest::addColumn<bool>("expectedPending");
+
+        QTest::newRow("no changes") << 0 << 0 << false;
+        QTest::newRow("changes") << 3 << 0 << true;
+        QTest::newRow("some replayed") << 3 << 2 << true;
+        QTest::newRow("all replayed") << 3 << 3 << false;
+    }
+
+    void testHasPendingChanges()
+    {
+        QFETCH(int, changes);
+        QFETCH(int, replayed);
+        QFETCH(bool, expectedPending);
+
+        const QString identifier = QStringLiteral("akonadi_ondemand_resource_0");
+        QFile::remove(journalFile(identifier));
+        QVERIFY(!OnDemandAgents::hasPendingChanges(identifier));
+
+        QFile file(journalFile(identifier));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        ChangeRecorderJournalWriter::saveTo(OnDemandAgentsTest::changes(changes), &file);
+        file.close();
+
+        if (replayed > 0) {
+            // What ChangeRecorder does when it dequeues changes
+            QVERIFY(file.open(QIODevice::ReadWrite));
+            file.seek(8);
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_4_6);
+            stream << static_cast<quint64>(replayed);
+            file.close();
+        }
+
+        QCOMPARE(OnDemandAgents::hasPendingChanges(identifier), expectedPending);
+        QFile::remove(journalFile(identifier));
+    }
+
+    void testActivateForCall()
+    {
+        QStringList started;
+        OnDemandAgents agents([&started](const QString &identifier) {
+            started.push_back(identifier);
+            return true;
+        });
+        const QString identifier = QStringLiteral("akonadi_ondemand_resource_0");
+        agents.add(identifier, OnDemandAgents::State::Stopped);
+
+        // Unknown agents and running agents take the calls directly
+        QStringList calls;
+        QVERIFY(!agents.activateForCall(QStringLiteral("akonadi_other_resource_0"), [&calls]() {
+            calls.push_back(QStringLiteral("other"));
+        }));
+
+        // Calls to a stopped agent start it, and wait for it to be up
+        QVERIFY(agents.activateForCall(identifier, [&calls]() {
+            calls.push_back(QStringLiteral("first"));
+        }));
+        QCOMPARE(started, QStringList{identifier});
+        QCOMPARE(agents.state(identifier), OnDemandAgents::State::Starting);
+        QVERIFY(agents.activateForCall(identifier, [&calls]() {
+            calls.push_back(QStringLiteral("second"));
+        }));
+        QCOMPARE(started, QStringList{identifier});
+        QVERIFY(calls.isEmpty());
+
+        // They are replayed in order once it is up
+        agents.started(identifier);
+        QCOMPARE(agents.state(identifier), OnDemandAgents::State::Running);
+        QCOMPARE(calls, (QStringList{QStringLiteral("first"), QStringLiteral("second")}));
+
+        calls.clear();
+        QVERIFY(!agents.activateForCall(identifier, [&calls]() {
+            calls.push_back(QStringLiteral("third"));
+        }));
+        agents.started(identifier);
+        QVERIFY(calls.isEmpty());
+    }
+
+    void testActivateWhileStopping()
+    {
+        int startCount = 0;
+        OnDemandAgents agents([&startCount](const QString &) {
+            ++startCount;
+            return true;
+        });
+        const QString identifier = QStringLiteral("akonadi_ondemand_resource_0");
+        agents.add(identifier, OnDemandAgents::State::Running);
+        QCOMPARE(agents.runningInstances(), QStringList{identifier});
+
+        agents.stopping(identifier);
+        QVERIFY(agents.runningInstances().isEmpty());
+
+        // Needed again while it shuts down: started again once it's down
+        bool called = false;
+        QVERIFY(agents.activateForCall(identifier, [&called]() {
+            called = true;
+        }));
+        QVERIFY(agents.activate(identifier));
+        QCOMPARE(startCount, 0);
+
+        agents.stopped(identifier);
+        QCOMPARE(startCount, 1);
+        QCOMPARE(agents.state(identifier), OnDemandAgents::State::Starting);
+        QVERIFY(!called);
+        agents.started(identifier);
+        QVERIFY(called);
+
+        // Not needed while it shuts down: it stays down
+        agents.stopping(identifier);
+        agents.stopped(identifier);
+        QCOMPARE(startCount, 1);
+        QCOMPARE(agents.state(identifier), OnDemandAgents::State::Stopped);
+    }
+
+    void testFailedStart()
+    {
+        OnDemandAgents agents([](const QString &) {
+            return false;
+        });
+        const QString identifier = QStringLiteral("akonadi_ondemand_resource_0");
+        agents.add(identifier, OnDemandAgents::State::Stopped);
+
+        // The call is made right away, and fails as for any agent that is not running
+        bool called = false;
+        QVERIFY(!agents.activateForCall(identifier, [&called]() {
+            called = true;
+        }));
+        QCOMPARE(agents.state(identifier), OnDemandAgents::State::Stopped);
+
+        // The server still has to wait for it, and asks again later
+        QVERIFY(agents.activate(identifier));
+        QVERIFY(!agents.activate(QStringLiteral("akonadi_other_resource_0")));
+        agents.started(identifier);
+        QVERIFY(!called);
+    }
+};
+
+AKTEST_MAIN(OnDemandAgentsTest)
+
+#include "ondemandagentstest.moc"
@@ -104,6 +104,62 @@ private Q_SLOTS:
         QVERIFY(rec->isEmpty());
     }
 
+    void testBatchReplay()
+    {
+        auto rec = std::make_unique<ChangeRecorder>();
+        rec->setConfig(settings);
+        rec->setAllMonitored();
+        rec->itemFetchScope().setCacheOnly(true);
+        rec->setReplayBatchSize(10);
+        QCOMPARE(rec->replayBatchSize(), 10);
+
+        // Batches are only replayed when nobody listens to the single-item signal
+        QSignalSpy itemsChangedSpy(rec.get(), &Monitor::itemsChanged);
+        QVERIFY(itemsChangedSpy.isValid());
+        QSignalSpy readySpy(rec.get(), &Monitor::monitorReady);
+        QVERIFY(readySpy.wait());
+
+        QSignalSpy changesSpy(rec.get(), &ChangeRecorder::changesAdded);
+        QVERIFY(changesSpy.isValid());
+        for (const Item::Id id : {1, 2, 3, 1}) {
+            triggerChange(id);
+        }
+        QTRY_COMPARE(changesSpy.count(), 4);
+
+        const auto replayNextBatch = [&rec, &itemsChangedSpy]() {
+            itemsChangedSpy.clear();
+            rec->replayNext();
+            if (itemsChangedSpy.isEmpty()) {
+                QVERIFY(itemsChangedSpy.wait());
+            }
+            QCOMPARE(itemsChangedSpy.count(), 1);
+        };
+        const auto replayedIds = [&itemsChangedSpy]() {
+            QList<Item::Id> ids;
+            const auto items = itemsChangedSpy.at(0).at(0).value<Akonadi::Item::List>();
+            for (const auto &item : items) {
+                ids.push_back(item.id());
+            }
+            return ids;
+        };
+
+        // The repeated change of item 1 starts a new batch
+        replayNextBatch();
+        QCOMPARE(replayedIds(), (QList<Item::Id>{1, 2, 3}));
+        rec->changeProcessed();
+        QVERIFY(!rec->isEmpty());
+
+        replayNextBatch();
+        QCOMPARE(replayedIds(), QList<Item::Id>{1});
+        rec->changeProcessed();
+        QVERIFY(rec->isEmpty());
+
+        // The processed batch is not replayed again after a restart
+        rec = createChangeRecorder();
+        QVERIFY(rec);
+        QVERIFY(rec->isEmpty());
+    }
+
 private:
     void triggerChange(Akonadi::Item::Id uid)
     {
@@ -151,6 +151,50 @@ private Q_SLOTS:
         QTRY_COMPARE(spy.count(), 2);
         QVERIFY(cache.isCached(QList<Item::Id>() << 1 << 2 << 3 << 4));
     }
+
+    void testListCache_maxCost()
+    {
+        ItemFetchScope scope;
+
+        EntityListCache<Item, ItemFetchJob, ItemFetchScope> cache(1);
+        QSignalSpy spy(&cache, &EntityCacheBase::dataAvailable);
+        QVERIFY(spy.isValid());
+
+        cache.request(QList<Item::Id>() << 1 << 2, scope);
+        QTRY_COMPARE(spy.count(), 1);
+        QVERIFY(cache.isCached(QList<Item::Id>() << 1 << 2));
+        QVERIFY(cache.totalCost() > 0);
+
+        // Only room for about one more item, the least recently used one goes first
+        cache.setMaxCost(cache.totalCost());
+        QCOMPARE(cache.retrieve(QList<Item::Id>() << 1).size(), 1);
+        cache.ensureCached(QList<Item::Id>() << 3, scope);
+        QVERIFY(cache.isCached(QList<Item::Id>() << 1));
+        QVERIFY(!cache.isNotRequested(QList<Item::Id>() << 1));
+        QVERIFY(cache.isNotRequested(QList<Item::Id>() << 2));
+        QTRY_COMPARE(spy.count(), 2);
+        QVERIFY(cache.isCached(QList<Item::Id>() << 3));
+    }
+
+    void testSharedItemListCache()
+    {
+        ItemFetchScope scope;
+        scope.fetchFullPayload(true);
+
+        ItemListCache *cache1 = SharedItemListCache::acquire(scope);
+        ItemListCache *cache2 = SharedItemListCache::acquire(scope);
+        QCOMPARE(cache1, cache2);
+        QVERIFY(cache1->maxCost() > 0);
+
+        ItemFetchScope otherScope;
+        otherScope.fetchAllAttributes(true);
+        ItemListCache *cache3 = SharedItemListCache::acquire(otherScope);
+        QVERIFY(cache3 != cache1);
+
+        SharedItemListCache::release(cache3);
+        SharedItemListCache::release(cache2);
+        SharedItemListCache::release(cache1);
+    }
 };
 
 QTEST_AKONADIMAIN(EntityCacheTest)
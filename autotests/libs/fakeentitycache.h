@@ -168,6 +168,18 @@ public:
         return itemCache;
     }
 
+    // Each monitor gets its own item cache, fetching through the monitor's fake session
+    Akonadi::ItemListCache *acquireSharedItemListCache(const Akonadi::ItemFetchScope &scope) override
+    {
+        Q_UNUSED(scope)
+        return nullptr;
+    }
+
+    void releaseSharedItemListCache(Akonadi::ItemListCache *cache) override
+    {
+        Q_UNUSED(cache)
+    }
+
 private:
     FakeItemCache *itemCache = nullptr;
     FakeCollectionCache *collectionCache = nullptr;
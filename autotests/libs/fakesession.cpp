@@ -43,7 +43,7 @@ public:
     /* reimp */
     void reconnect() override
     {
-        if (m_mode == FakeSession::EndJobsImmediately) {
+        if (m_mode != FakeSession::EndJobsManually) {
             return;
         }
 
@@ -64,6 +64,10 @@ public:
         // the started jobs are completed.
         if (m_mode == FakeSession::EndJobsImmediately) {
             endJob(job);
+        } else if (m_mode == FakeSession::EndJobsQueued) {
+            QTimer::singleShot(0ms, job, [this, job]() {
+                endJob(job);
+            });
         } else {
             SessionPrivate::addJob(job);
         }
@@ -19,6 +19,8 @@ public:
     enum Mode {
         EndJobsImmediately,
         EndJobsManually,
+        /// Like EndJobsImmediately, but the jobs finish once the event loop runs, so their results are delivered
+        EndJobsQueued,
     };
 
     explicit FakeSession(const QByteArray &sessionId = QByteArray(), Mode mode = EndJobsImmediately, QObject *parent = nullptr);
@@ -7,6 +7,7 @@
 #include "itemtest.h"
 #include "collection.h"
 #include "item.h"
+#include "item_p.h"
 #include "testattribute.h"
 
 #include <QTest>
@@ -136,4 +137,62 @@ void ItemTest::testDetach()
     QVERIFY(attr != origAttr);
 }
 
+void ItemTest::testCompactProperties()
+{
+    Item item(1);
+    QVERIFY(item.flags().isEmpty());
+    QVERIFY(item.remoteRevision().isEmpty());
+    QVERIFY(item.virtualReferences().isEmpty());
+    QVERIFY(item.gid().isEmpty());
+    QVERIFY(item.tags().isEmpty());
+    item.clearTag(Tag(1));
+    QVERIFY(!item.hasTag(Tag(1)));
+
+    item.setFlags({"\\SEEN", "\\FLAGGED"});
+    item.setFlag("\\SEEN");
+    item.setFlag("$TODO");
+    item.clearFlag("\\FLAGGED");
+    QCOMPARE(item.flags(), (Item::Flags{"\\SEEN", "$TODO"}));
+    QVERIFY(item.hasFlag("$TODO"));
+    QVERIFY(!item.hasFlag("\\FLAGGED"));
+
+    item.setCachedPayloadParts({"RFC822", "HEAD"});
+    QCOMPARE(item.cachedPayloadParts(), (QSet<QByteArray>{"HEAD", "RFC822"}));
+
+    item.setRemoteRevision(QStringLiteral("rev1"));
+    item.setVirtualReferences({Collection(5)});
+    item.setGid(QStringLiteral("gid1"));
+    item.setTag(Tag(1));
+    item.setTag(Tag(2));
+    item.clearTag(Tag(1));
+    QCOMPARE(item.tags(), Tag::List{Tag(2)});
+    QVERIFY(item.hasTag(Tag(2)));
+
+    // Copies share nothing mutable with the original once detached
+    Item copy = item;
+    copy.setRemoteRevision(QStringLiteral("rev2"));
+    copy.clearFlags();
+    copy.setGid(QString());
+    copy.clearTags();
+    QCOMPARE(item.remoteRevision(), QStringLiteral("rev1"));
+    QCOMPARE(copy.remoteRevision(), QStringLiteral("rev2"));
+    QCOMPARE(copy.virtualReferences(), Collection::List{Collection(5)});
+    QCOMPARE(item.flags().size(), 2);
+    QVERIFY(copy.flags().isEmpty());
+    QCOMPARE(item.gid(), QStringLiteral("gid1"));
+    QVERIFY(copy.gid().isEmpty());
+    QCOMPARE(item.tags(), Tag::List{Tag(2)});
+    QVERIFY(copy.tags().isEmpty());
+}
+
+void ItemTest::testMemoryFootprint()
+{
+    // Items fetched with the default fetch scope don't allocate the ItemPrivateExtra
+    qInfo() << "Bytes per Item without payload:" << sizeof(Item) + sizeof(ItemPrivate) << "- with rarely used properties:" << sizeof(ItemPrivateExtra)
+            << "more";
+
+    ItemPrivate d(1);
+    QVERIFY(!d.extra());
+}
+
 #include "moc_itemtest.cpp"
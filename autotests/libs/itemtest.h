@@ -19,4 +19,6 @@ private Q_SLOTS:
     void testComparison_data();
     void testComparison();
     void testDetach();
+    void testCompactProperties();
+    void testMemoryFootprint();
 };
@@ -11,9 +11,12 @@
 #include "fakesession.h"
 #include "inspectablechangerecorder.h"
 #include "inspectablemonitor.h"
+#include "itemfetchjob.h"
 #include <QSignalSpy>
 #include <QTest>
 
+#include <memory>
+
 using namespace Akonadi;
 
 class MonitorNotificationTest : public QObject
@@ -37,6 +40,7 @@ private Q_SLOTS:
     void testSingleMessage();
     void testFillPipeline();
     void testMonitor();
+    void testItemBurst();
 
     void testSingleMessage_data();
     void testFillPipeline_data();
@@ -302,5 +306,54 @@ void MonitorNotificationTest::testMonitor_impl(MonitorImpl *monitor, FakeCollect
     QCOMPARE(monitor->pendingNotifications().size(), 0);
 }
 
+void MonitorNotificationTest::testItemBurst()
+{
+    // The item fetch jobs finish with no items, so the items are taken from the notifications
+    FakeSession session("MonitorNotificationTest burst session", FakeSession::EndJobsQueued);
+    int itemFetches = 0;
+    connect(&session, &FakeSession::jobAdded, this, [&itemFetches](Akonadi::Job *job) {
+        if (qobject_cast<ItemFetchJob *>(job)) {
+            ++itemFetches;
+        }
+    });
+
+    auto collectionCache = new FakeCollectionCache(m_fakeSession);
+    FakeItemCache itemCache(m_fakeSession);
+    auto monitor = std::make_unique<InspectableMonitor>(new FakeMonitorDependenciesFactory(&itemCache, collectionCache));
+    monitor->setSession(&session);
+    ItemFetchScope scope;
+    scope.fetchFullPayload(true);
+    monitor->setItemFetchScope(scope);
+
+    // Workaround for the QTimer::singleShot() in fake monitors to happen
+    QTest::qWait(10);
+
+    qRegisterMetaType<Akonadi::Item>();
+    QSignalSpy itemAddedSpy(monitor.get(), &Monitor::itemAdded);
+
+    constexpr int burstSize = 20;
+    for (int id = 1; id <= burstSize; ++id) {
+        Protocol::FetchItemsResponse item(id);
+        item.setMimeType(QStringLiteral("application/octet-stream"));
+        auto msg = Protocol::ItemChangeNotificationPtr::create();
+        msg->setOperation(Protocol::ItemChangeNotification::Add);
+        msg->setParentCollection(1);
+        msg->setItems({item});
+        msg->addMetadata("FETCH_ITEM");
+        monitor->notificationConnection()->emitNotify(msg);
+    }
+
+    // The whole burst is emitted in the order it was received...
+    QTRY_COMPARE(itemAddedSpy.size(), burstSize);
+    for (int i = 0; i < burstSize; ++i) {
+        QCOMPARE(itemAddedSpy.at(i).at(0).value<Akonadi::Item>().id(), qint64(i + 1));
+    }
+    QVERIFY(monitor->pipeline().isEmpty());
+    QVERIFY(monitor->pendingNotifications().isEmpty());
+
+    // ...after fetching the items together instead of one by one
+    QCOMPARE(itemFetches, 1);
+}
+
 QTEST_MAIN(MonitorNotificationTest)
 #include "monitornotificationtest.moc"
@@ -317,6 +317,20 @@ private Q_SLOTS:
             QCOMPARE(attr->serialized(), expectedAttr->serialized());
         }
     }
+
+    void testItemFlagsAndPartsParsing()
+    {
+        Protocol::FetchItemsResponse response;
+        response.setId(1);
+        response.setMimeType(QStringLiteral("application/octet-stream"));
+        response.setFlags({"\\SEEN", "$TODO", "\\SEEN"});
+        response.setCachedParts({"PLD:RFC822", "PLD:HEAD", "PLD:RFC822"});
+
+        ProtocolHelperValuePool pool;
+        const Item item = ProtocolHelper::parseItemFetchResult(response, nullptr, &pool);
+        QCOMPARE(item.flags(), (Item::Flags{"\\SEEN", "$TODO"}));
+        QCOMPARE(item.cachedPayloadParts(), (QSet<QByteArray>{"PLD:RFC822", "PLD:HEAD"}));
+    }
 };
 
 QTEST_MAIN(ProtocolHelperTest)
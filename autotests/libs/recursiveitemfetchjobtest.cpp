@@ -0,0 +1,224 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "collection.h"
+#include "collectiondeletejob.h"
+#include "control.h"
+#include "itemcreatejob.h"
+#include "itemdeletejob.h"
+#include "qtest_akonadi.h"
+#include "recursiveitemfetchjob.h"
+
+#include <QObject>
+#include <QSignalSpy>
+
+#include <utility>
+
+using namespace Akonadi;
+
+class RecursiveItemFetchJobTest : public QObject
+{
+    Q_OBJECT
+
+    // res1/foo has 15 items, res1/foo/bar and res1/foo/bar/bla get some more
+    static constexpr int itemCount = 20;
+
+    static Collection collection(const QString &path)
+    {
+        return Collection(AkonadiTest::collectionIdFromPath(path));
+    }
+
+    static QSet<Item::Id> ids(const Item::List &items)
+    {
+        QSet<Item::Id> ids;
+        for (const Item &item : items) {
+            ids.insert(item.id());
+        }
+        return ids;
+    }
+
+    static Item::List receivedItems(const QSignalSpy &spy)
+    {
+        Item::List items;
+        for (const auto &arguments : spy) {
+            items += arguments.at(0).value<Item::List>();
+        }
+        return items;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+        Control::start();
+
+        const QList<QPair<QString, int>> newItems = {{QStringLiteral("res1/foo/bar"), 3}, {QStringLiteral("res1/foo/bar/bla"), 2}};
+        for (const auto &[path, count] : newItems) {
+            const Collection col = collection(path);
+            QVERIFY(col.isValid());
+            for (int i = 0; i < count; ++i) {
+                Item item;
+                item.setMimeType(QStringLiteral("application/octet-stream"));
+                auto job = new ItemCreateJob(item, col, this);
+                AKVERIFYEXEC(job);
+            }
+        }
+    }
+
+    void testFetch()
+    {
+        auto job = new RecursiveItemFetchJob(collection(QStringLiteral("res1/foo")), QStringList(), this);
+        QSignalSpy spy(job, &RecursiveItemFetchJob::itemsReceived);
+        AKVERIFYEXEC(job);
+
+        QCOMPARE(job->items().size(), itemCount);
+        QCOMPARE(ids(job->items()).size(), itemCount);
+        QCOMPARE(ids(receivedItems(spy)), ids(job->items()));
+    }
+
+    void testStreaming_data()
+    {
+        QTest::addColumn<int>("batchSize");
+        QTest::addColumn<int>("parallelFetches");
+
+        QTest::newRow("single page") << 100 << 0;
+        QTest::newRow("pages") << 4 << 0;
+        QTest::newRow("pages, one at a time") << 4 << 1;
+        QTest::newRow("pages, two at a time") << 4 << 2;
+    }
+
+    void testStreaming()
+    {
+        QFETCH(int, batchSize);
+        QFETCH(int, parallelFetches);
+
+        auto job = new RecursiveItemFetchJob(collection(QStringLiteral("res1/foo")), QStringList(), this);
+        job->setStreamingBatchSize(batchSize);
+        job->setMaximumParallelFetches(parallelFetches);
+        QSignalSpy spy(job, &RecursiveItemFetchJob::itemsReceived);
+        AKVERIFYEXEC(job);
+
+        // Items are only streamed, each one exactly once
+        QVERIFY(job->items().isEmpty());
+        const Item::List items = receivedItems(spy);
+        QCOMPARE(items.size(), itemCount);
+        QCOMPARE(ids(items).size(), itemCount);
+
+        QList<Collection::Id> collections;
+        for (const auto &arguments : std::as_const(spy)) {
+            const auto page = arguments.at(0).value<Item::List>();
+            QVERIFY(page.size() <= batchSize);
+            for (const Item &item : page) {
+                QCOMPARE(item.parentCollection().id(), page.first().parentCollection().id());
+            }
+            if (collections.isEmpty() || collections.last() != page.first().parentCollection().id()) {
+                collections.push_back(page.first().parentCollection().id());
+            }
+        }
+        if (parallelFetches == 1) {
+            // All pages of a collection are fetched before the next collection
+            QCOMPARE(QSet<Collection::Id>(collections.cbegin(), collections.cend()).size(), collections.size());
+        }
+    }
+
+    void testSuspendResume()
+    {
+        auto job = new RecursiveItemFetchJob(collection(QStringLiteral("res1/foo")), QStringList(), this);
+        job->setStreamingBatchSize(4);
+        job->setMaximumParallelFetches(1);
+        // Still checked once it has finished
+        job->setAutoDelete(false);
+        QSignalSpy spy(job, &RecursiveItemFetchJob::itemsReceived);
+        QSignalSpy resultSpy(job, &KJob::result);
+        connect(job, &RecursiveItemFetchJob::itemsReceived, this, [job]() {
+            if (!job->isSuspended()) {
+                job->suspend();
+            }
+        });
+        job->start();
+
+        // Nothing is delivered, nor fetched, while the job is suspended
+        QTRY_COMPARE(spy.size(), 1);
+        QVERIFY(job->isSuspended());
+        QTest::qWait(200);
+        QCOMPARE(spy.size(), 1);
+        QCOMPARE(resultSpy.size(), 0);
+
+        // Resuming delivers one more page, which suspends the job again
+        QVERIFY(job->resume());
+        QTRY_COMPARE(spy.size(), 2);
+        QVERIFY(job->isSuspended());
+
+        disconnect(job, &RecursiveItemFetchJob::itemsReceived, this, nullptr);
+        QVERIFY(job->resume());
+        QTRY_COMPARE(resultSpy.size(), 1);
+        QCOMPARE(job->error(), 0);
+        QCOMPARE(ids(receivedItems(spy)).size(), itemCount);
+    }
+
+    void testCollectionError()
+    {
+        auto job = new RecursiveItemFetchJob(Collection(INT_MAX), QStringList(), this);
+        QVERIFY(!job->exec());
+        QVERIFY(job->error());
+        QVERIFY(!job->errorText().isEmpty());
+    }
+
+    // Changes the item count, must come after the tests which compare it
+    void testPagingWhileItemsChange()
+    {
+        auto fetchAll = new RecursiveItemFetchJob(collection(QStringLiteral("res1/foo")), QStringList(), this);
+        AKVERIFYEXEC(fetchAll);
+        const QSet<Item::Id> allIds = ids(fetchAll->items());
+
+        auto job = new RecursiveItemFetchJob(collection(QStringLiteral("res1/foo")), QStringList(), this);
+        job->setStreamingBatchSize(4);
+        job->setMaximumParallelFetches(1);
+        QSignalSpy spy(job, &RecursiveItemFetchJob::itemsReceived);
+        // Removing an item that was already received must not shift the following pages
+        bool deletedItem = false;
+        connect(job, &RecursiveItemFetchJob::itemsReceived, this, [this, &deletedItem](const Item::List &items) {
+            if (!std::exchange(deletedItem, true)) {
+                auto deleteJob = new ItemDeleteJob(items.first(), this);
+                QVERIFY(deleteJob->exec());
+            }
+        });
+        AKVERIFYEXEC(job);
+
+        QVERIFY(deletedItem);
+        const Item::List items = receivedItems(spy);
+        QCOMPARE(items.size(), allIds.size());
+        QCOMPARE(ids(items), allIds);
+    }
+
+    // Must be the last test, it deletes res1/foo/bla
+    void testItemFetchError()
+    {
+        const Collection deleted = collection(QStringLiteral("res1/foo/bla"));
+        QVERIFY(deleted.isValid());
+
+        auto job = new RecursiveItemFetchJob(collection(QStringLiteral("res1/foo")), QStringList(), this);
+        job->setStreamingBatchSize(100);
+        job->setMaximumParallelFetches(1);
+        // res1/foo is fetched first, the collection is gone by the time its items are fetched
+        bool deletedCollection = false;
+        connect(job, &RecursiveItemFetchJob::itemsReceived, this, [this, deleted, &deletedCollection]() {
+            if (!std::exchange(deletedCollection, true)) {
+                auto deleteJob = new CollectionDeleteJob(deleted, this);
+                QVERIFY(deleteJob->exec());
+            }
+        });
+
+        QVERIFY(!job->exec());
+        QVERIFY(deletedCollection);
+        QVERIFY(job->error());
+        QVERIFY(!job->errorText().isEmpty());
+    }
+};
+
+QTEST_AKONADIMAIN(RecursiveItemFetchJobTest)
+
+#include "recursiveitemfetchjobtest.moc"
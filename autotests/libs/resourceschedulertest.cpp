@@ -358,4 +358,68 @@ void ResourceSchedulerTest::testPriorities()
     QVERIFY(scheduler.isEmpty());
 }
 
+void ResourceSchedulerTest::testLanes()
+{
+    ResourceScheduler scheduler;
+    scheduler.setLaneEnabled(ResourceScheduler::FetchLane, true);
+    scheduler.setLaneEnabled(ResourceScheduler::ChangeReplayLane, true);
+    scheduler.setOnline(true);
+    qRegisterMetaType<Akonadi::Collection>("Akonadi::Collection");
+    qRegisterMetaType<Akonadi::Item>("Akonadi::Item");
+    QSignalSpy changeReplaySpy(&scheduler, SIGNAL(executeChangeReplay()));
+    QSignalSpy syncSpy(&scheduler, SIGNAL(executeCollectionSync(Akonadi::Collection)));
+    QSignalSpy fetchSpy(&scheduler, SIGNAL(executeItemFetch(Akonadi::Item, QSet<QByteArray>)));
+    QSignalSpy attributesSyncSpy(&scheduler, SIGNAL(executeCollectionAttributesSync(Akonadi::Collection)));
+    QVERIFY(changeReplaySpy.isValid());
+    QVERIFY(syncSpy.isValid());
+    QVERIFY(fetchSpy.isValid());
+    QVERIFY(attributesSyncSpy.isValid());
+
+    // A sync, a fetch and a change replay all start right away
+    scheduler.scheduleSync(Akonadi::Collection(42));
+    scheduler.scheduleItemFetch(Akonadi::Item(42), QSet<QByteArray>(), {}, 1);
+    scheduler.scheduleItemFetch(Akonadi::Item(43), QSet<QByteArray>(), {}, 2);
+    scheduler.scheduleChangeReplay();
+    scheduler.scheduleAttributesSync(Akonadi::Collection(42));
+
+    QTest::qWait(1);
+    QCOMPARE(syncSpy.count(), 1);
+    QCOMPARE(fetchSpy.count(), 1);
+    QCOMPARE(changeReplaySpy.count(), 1);
+    QCOMPARE(attributesSyncSpy.count(), 0);
+    QCOMPARE(scheduler.currentTask(ResourceScheduler::DefaultLane).type, ResourceScheduler::SyncCollection);
+    QCOMPARE(scheduler.currentTask(ResourceScheduler::FetchLane).type, ResourceScheduler::FetchItem);
+    QCOMPARE(scheduler.currentTask(ResourceScheduler::ChangeReplayLane).type, ResourceScheduler::ChangeReplay);
+    // Ambiguous without an explicit lane
+    QCOMPARE(scheduler.activeLane(), ResourceScheduler::DefaultLane);
+    QVERIFY(scheduler.dumpToString().contains(QLatin1StringView("fetch lane current task")));
+
+    // Completing the fetch only advances the fetch lane
+    scheduler.itemFetchDone(QString());
+    QTest::qWait(1);
+    QCOMPARE(fetchSpy.count(), 2);
+    QCOMPARE(syncSpy.count(), 1);
+    QCOMPARE(attributesSyncSpy.count(), 0);
+
+    {
+        const ResourceScheduler::LaneScope scope(&scheduler, ResourceScheduler::FetchLane);
+        QCOMPARE(scheduler.currentTask().type, ResourceScheduler::FetchItem);
+        scheduler.taskDone();
+    }
+    scheduler.taskDone(ResourceScheduler::ChangeReplayLane);
+    QTest::qWait(1);
+    QCOMPARE(scheduler.currentTask(ResourceScheduler::FetchLane).type, ResourceScheduler::Invalid);
+    QCOMPARE(scheduler.currentTask(ResourceScheduler::ChangeReplayLane).type, ResourceScheduler::Invalid);
+    QCOMPARE(attributesSyncSpy.count(), 0);
+
+    // Only the default lane is busy, so it is the active one
+    QCOMPARE(scheduler.activeLane(), ResourceScheduler::DefaultLane);
+    scheduler.taskDone();
+    QTest::qWait(1);
+    QCOMPARE(attributesSyncSpy.count(), 1);
+    scheduler.taskDone();
+    QTest::qWait(1);
+    QVERIFY(scheduler.isEmpty());
+}
+
 #include "moc_resourceschedulertest.cpp"
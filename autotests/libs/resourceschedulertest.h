@@ -26,6 +26,7 @@ private Q_SLOTS:
     void testCompression();
     void testSyncCompletion();
     void testPriorities();
+    void testLanes();
 
 private:
     int mCustomCallCount;
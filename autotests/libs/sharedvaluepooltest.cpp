@@ -15,6 +15,38 @@
 
 using namespace Akonadi;
 
+namespace
+{
+// The pool as it was before it learned to switch to hashing, as a baseline for the benchmarks
+template<typename T>
+class LinearValuePool
+{
+public:
+    T sharedValue(const T &value)
+    {
+        auto it = std::find(m_pool.constBegin(), m_pool.constEnd(), value);
+        if (it != m_pool.constEnd()) {
+            return *it;
+        }
+        m_pool.push_back(value);
+        return value;
+    }
+
+private:
+    QList<T> m_pool;
+};
+
+QList<QByteArray> flagNames(int size)
+{
+    QList<QByteArray> flags;
+    flags.reserve(size);
+    for (int i = 0; i < size; ++i) {
+        flags.push_back("$CustomKeyword" + QByteArray::number(i));
+    }
+    return flags;
+}
+}
+
 class SharedValuePoolTest : public QObject
 {
     Q_OBJECT
@@ -46,6 +78,80 @@ private Q_SLOTS:
         }
     }
 
+    void testSharing_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::newRow("below threshold") << 10;
+        QTest::newRow("above threshold") << 500;
+    }
+
+    void testSharing()
+    {
+        QFETCH(int, size);
+        const QList<QByteArray> data = flagNames(size);
+        Internal::SharedValuePool<QByteArray, QList> pool;
+
+        for (const QByteArray &b : data) {
+            QCOMPARE(pool.sharedValue(b).constData(), b.constData());
+        }
+        QCOMPARE(pool.size(), size);
+
+        // Equal values with their own data resolve to the instance stored first
+        for (const QByteArray &b : data) {
+            const QByteArray copy(b.constData(), b.size());
+            QCOMPARE(pool.sharedValue(copy).constData(), b.constData());
+        }
+        QCOMPARE(pool.size(), size);
+    }
+
+    void benchmarkFlagPool_data()
+    {
+        QTest::addColumn<int>("size");
+        QTest::addColumn<bool>("adaptive");
+        for (int size : {10, 100, 500}) {
+            QTest::addRow("linear %d", size) << size << false;
+            QTest::addRow("adaptive %d", size) << size << true;
+        }
+    }
+
+    void benchmarkFlagPool()
+    {
+        QFETCH(int, size);
+        QFETCH(bool, adaptive);
+        const QList<QByteArray> data = flagNames(size);
+
+        if (adaptive) {
+            Internal::SharedValuePool<QByteArray, QList> pool;
+            for (const QByteArray &b : data) {
+                pool.sharedValue(b);
+            }
+            QBENCHMARK {
+                for (const QByteArray &b : data) {
+                    pool.sharedValue(b);
+                }
+            }
+        } else {
+            LinearValuePool<QByteArray> pool;
+            for (const QByteArray &b : data) {
+                pool.sharedValue(b);
+            }
+            QBENCHMARK {
+                for (const QByteArray &b : data) {
+                    pool.sharedValue(b);
+                }
+            }
+        }
+    }
+
+    void testConcurrentPool()
+    {
+        Internal::ConcurrentSharedValuePool<QByteArray, QList> pool;
+        const QByteArray seen("\\SEEN");
+        QCOMPARE(pool.sharedValue(seen).constData(), seen.constData());
+        QCOMPARE(pool.sharedValue(QByteArray("\\SEEN")).constData(), seen.constData());
+        QCOMPARE(pool.size(), 1);
+    }
+
     /*void testQSet_data()
     {
       QTest::addColumn<int>( "size" );
@@ -25,6 +25,8 @@ enum class TestEnumClass : qint64 {
     Value3 = 3
 };
 
+using Encoding = Akonadi::Protocol::DataStream::Encoding;
+
 class DataStreamTest : public QObject
 {
     Q_OBJECT
@@ -48,27 +50,33 @@ private:
     {
         QFETCH(T, input);
 
-        QByteArray data;
-        {
-            QBuffer buffer(&data);
-            buffer.open(QIODevice::WriteOnly);
-            Akonadi::Protocol::DataStream stream(&buffer);
+        for (const auto encoding : {Encoding::Legacy, Encoding::Compact}) {
+            QByteArray data;
+            {
+                QBuffer buffer(&data);
+                buffer.open(QIODevice::WriteOnly);
+                Akonadi::Protocol::DataStream stream(&buffer, encoding);
 
-            stream << input;
-            stream.flush();
-        }
+                stream << input;
+                stream.flush();
+            }
 
-        T output;
-        {
-            QBuffer buffer(&data);
-            buffer.open(QIODevice::ReadOnly);
-            Akonadi::Protocol::DataStream stream(&buffer);
+            T output;
+            {
+                QBuffer buffer(&data);
+                buffer.open(QIODevice::ReadOnly);
+                Akonadi::Protocol::DataStream stream(&buffer, encoding);
 
-            stream >> output;
-            buffer.close();
-        }
+                if (encoding == Encoding::Compact) {
+                    QVERIFY(Akonadi::Protocol::DataStream::hasMessage(&buffer, encoding));
+                }
+                stream.beginMessage();
+                stream >> output;
+                buffer.close();
+            }
 
-        QCOMPARE(input, output);
+            QCOMPARE(input, output);
+        }
     }
 
 private Q_SLOTS:
@@ -241,6 +249,63 @@ private Q_SLOTS:
     {
         testTypeStreaming<QHash<QString, qint32>>();
     }
+
+    void testCompactFraming()
+    {
+        const QString text = QStringLiteral("Subject: Hello World");
+
+        QByteArray legacy;
+        {
+            QBuffer buffer(&legacy);
+            buffer.open(QIODevice::WriteOnly);
+            Akonadi::Protocol::DataStream stream(&buffer);
+            stream << qint64(42) << text;
+            stream.flush();
+        }
+
+        QByteArray compact;
+        {
+            QBuffer buffer(&compact);
+            buffer.open(QIODevice::WriteOnly);
+            Akonadi::Protocol::DataStream stream(&buffer, Encoding::Compact);
+            stream << qint64(42) << text;
+            stream.flush();
+            stream << qint64(-1);
+            stream.flush();
+        }
+        // 4B frame + 1B tag + 1B length + UTF-8, followed by a second 5B frame
+        QCOMPARE(compact.size(), 4 + 1 + 1 + text.size() + 5);
+        QVERIFY(compact.size() < legacy.size());
+
+        // Incomplete frames are not reported as available
+        QBuffer buffer;
+        buffer.open(QIODevice::ReadWrite);
+        buffer.write(compact.left(10));
+        buffer.seek(0);
+        QVERIFY(!Akonadi::Protocol::DataStream::hasMessage(&buffer, Encoding::Compact));
+        const auto pos = buffer.pos();
+        buffer.seek(buffer.size());
+        buffer.write(compact.mid(10));
+        buffer.seek(pos);
+        QVERIFY(Akonadi::Protocol::DataStream::hasMessage(&buffer, Encoding::Compact));
+
+        Akonadi::Protocol::DataStream stream(&buffer, Encoding::Compact);
+        stream.beginMessage();
+        qint64 tag = 0;
+        QString outText;
+        stream >> tag >> outText;
+        QCOMPARE(tag, qint64(42));
+        QCOMPARE(outText, text);
+
+        // Reading past the end of the frame fails instead of blocking
+        QVERIFY_THROWS_EXCEPTION(Akonadi::ProtocolException, stream >> tag);
+
+        QVERIFY(Akonadi::Protocol::DataStream::hasMessage(&buffer, Encoding::Compact));
+        stream.beginMessage();
+        stream >> tag;
+        QCOMPARE(tag, qint64(-1));
+        QVERIFY(!Akonadi::Protocol::DataStream::hasMessage(&buffer, Encoding::Compact));
+    }
 };
 
 QTEST_GUILESS_MAIN(DataStreamTest)
@@ -38,6 +38,11 @@ private Q_SLOTS:
     void testPartCreateTrxCommit();
     void testPartUpdateTrxCommit();
     void testPartDeleteTrxCommit();
+
+    void testBlobStore();
+    void testBlobAdoptTrxCommit();
+
+    void testPackedStore();
 };
 
 void ExternalPartStorageTest::testResolveAbsolutePath_data()
@@ -299,6 +304,105 @@ void ExternalPartStorageTest::testPartDeleteTrxCommit()
     QVERIFY(!QFile::exists(filePath));
 }
 
+void ExternalPartStorageTest::testBlobStore()
+{
+    QByteArray blobName;
+    QVERIFY(ExternalPartStorage::self()->storeBlob("blobdata", blobName));
+    QCOMPARE(blobName, ExternalPartStorage::nameForBlob("blobdata"));
+    QVERIFY(ExternalPartStorage::isBlobName(blobName));
+    QVERIFY(!ExternalPartStorage::isBlobName(ExternalPartStorage::nameForPartId(8)));
+    const QString blobPath = ExternalPartStorage::resolveAbsolutePath(blobName);
+    QVERIFY(QFile::exists(blobPath));
+
+    // Identical data is stored only once
+    QByteArray otherBlobName;
+    QVERIFY(ExternalPartStorage::self()->storeBlob("blobdata", otherBlobName));
+    QCOMPARE(otherBlobName, blobName);
+
+    // Blobs are not removed when released by a part
+    QVERIFY(ExternalPartStorage::self()->releasePartFile(blobPath));
+    QVERIFY(QFile::exists(blobPath));
+
+    QFile f(blobPath);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll(), QByteArray("blobdata"));
+    f.close();
+    QVERIFY(f.remove());
+
+    // A blob collected in the meantime is written again, not recreated empty
+    QVERIFY(ExternalPartStorage::self()->storeBlob("blobdata", otherBlobName));
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll(), QByteArray("blobdata"));
+    f.close();
+    QVERIFY(f.remove());
+}
+
+void ExternalPartStorageTest::testBlobAdoptTrxCommit()
+{
+    QByteArray filename;
+    QVERIFY(ExternalPartStorage::self()->createPartFile("adopted", 9, filename));
+    const QString filePath = ExternalPartStorage::resolveAbsolutePath(filename);
+    QVERIFY(QFile::exists(filePath));
+
+    ExternalPartStorageTransaction trx;
+    QByteArray blobName;
+    QVERIFY(ExternalPartStorage::self()->adoptPartFile(filename, blobName));
+    QCOMPARE(blobName, ExternalPartStorage::nameForBlob("adopted"));
+    const QString blobPath = ExternalPartStorage::resolveAbsolutePath(blobName);
+    QVERIFY(QFile::exists(blobPath));
+    QVERIFY(QFile::exists(filePath));
+    QVERIFY(trx.commit());
+    QVERIFY(!QFile::exists(filePath));
+
+    QFile f(blobPath);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll(), QByteArray("adopted"));
+    f.close();
+    QVERIFY(f.remove());
+}
+
+void ExternalPartStorageTest::testPackedStore()
+{
+    QByteArray first;
+    QByteArray second;
+    {
+        ExternalPartStorageTransaction trx;
+        QVERIFY(ExternalPartStorage::self()->storePacked("first", first));
+        QVERIFY(ExternalPartStorage::self()->storePacked("second payload", second));
+        QVERIFY(trx.commit());
+    }
+    QVERIFY(ExternalPartStorage::isPackedName(first));
+    QVERIFY(!ExternalPartStorage::isPackedName(ExternalPartStorage::nameForPartId(10)));
+
+    qint64 firstPack = -1;
+    qint64 secondPack = -1;
+    qint64 offset = -1;
+    qint64 length = -1;
+    QVERIFY(ExternalPartStorage::parsePackedName(first, &firstPack));
+    QVERIFY(ExternalPartStorage::parsePackedName(second, &secondPack, &offset, &length));
+    QCOMPARE(secondPack, firstPack);
+    QCOMPARE(secondPack, ExternalPartStorage::self()->activePackId());
+    QCOMPARE(length, qint64(14));
+    QCOMPARE(second, ExternalPartStorage::packedName(secondPack, offset, length));
+    QVERIFY(!ExternalPartStorage::parsePackedName("1.pack:12", &secondPack));
+
+    bool ok = false;
+    QCOMPARE(ExternalPartStorage::readPartFile(first, &ok), QByteArray("first"));
+    QVERIFY(ok);
+    QCOMPARE(ExternalPartStorage::readPartFile(second, &ok), QByteArray("second payload"));
+    QVERIFY(ok);
+    ExternalPartStorage::readPartFile(ExternalPartStorage::packedName(firstPack, offset, length + 1), &ok);
+    QVERIFY(!ok);
+
+    // All payloads resolve to the pack, which is kept when they are released
+    bool exists = false;
+    const QString packPath = ExternalPartStorage::resolveAbsolutePath(second, &exists);
+    QVERIFY(exists);
+    QCOMPARE(packPath, ExternalPartStorage::packPath(secondPack));
+    QVERIFY(ExternalPartStorage::self()->releasePartFile(packPath));
+    QVERIFY(QFile::exists(packPath));
+}
+
 AKTEST_MAIN(ExternalPartStorageTest)
 
 #include "externalpartstoragetest.moc"
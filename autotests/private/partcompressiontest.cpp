@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "private/partcompression_p.h"
+#include "shared/aktest.h"
+
+#include <QFile>
+#include <QObject>
+
+using namespace Akonadi;
+
+class PartCompressionTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        if (!PartCompression::isAvailable()) {
+            QSKIP("Akonadi was built without Zstandard support");
+        }
+    }
+
+    void testCompression_data()
+    {
+        QTest::addColumn<QByteArray>("data");
+
+        QTest::newRow("empty") << QByteArray("");
+        QTest::newRow("short") << QByteArray("Hello world");
+        QTest::newRow("repetitive") << QByteArray("From: Alice <alice@example.com>\r\n").repeated(100);
+    }
+
+    void testCompression()
+    {
+        QFETCH(QByteArray, data);
+
+        const QByteArray compressed = PartCompression::compress(data);
+        QVERIFY(!compressed.isEmpty());
+        bool ok = false;
+        QCOMPARE(PartCompression::decompress(compressed, &ok), data);
+        QVERIFY(ok);
+    }
+
+    void testCorruptedData()
+    {
+        bool ok = true;
+        QVERIFY(PartCompression::decompress(QByteArray("Not a zstd frame"), &ok).isEmpty());
+        QVERIFY(!ok);
+    }
+
+    void testDictionary()
+    {
+        QList<QByteArray> samples;
+        for (int i = 0; i < 500; ++i) {
+            samples.push_back(QStringLiteral("BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Contact %1\r\nEMAIL:contact%1@example.com\r\nUID:%2\r\nEND:VCARD\r\n")
+                                  .arg(i)
+                                  .arg(i * 7919)
+                                  .toUtf8());
+        }
+
+        const quint32 dictionaryId = PartCompression::trainDictionary(samples);
+        QVERIFY(dictionaryId != 0);
+        QVERIFY(QFile::exists(PartCompression::dictionaryPath(dictionaryId)));
+
+        const QByteArray data = "BEGIN:VCARD\r\nVERSION:3.0\r\nFN:Someone Else\r\nEMAIL:someone@example.com\r\nUID:42\r\nEND:VCARD\r\n";
+        const QByteArray compressed = PartCompression::compress(data, dictionaryId);
+        QVERIFY(!compressed.isEmpty());
+        QVERIFY(compressed.size() < PartCompression::compress(data).size());
+
+        // The dictionary is looked up from the ID recorded in the frame
+        bool ok = false;
+        QCOMPARE(PartCompression::decompress(compressed, &ok), data);
+        QVERIFY(ok);
+
+        QVERIFY(QFile::remove(PartCompression::dictionaryPath(dictionaryId)));
+    }
+};
+
+AKTEST_MAIN(PartCompressionTest)
+
+#include "partcompressiontest.moc"
@@ -370,12 +370,14 @@ void ProtocolTest::testPartMetaData()
     in.setSize(42);
     in.setVersion(1);
     in.setStorageType(PartMetaData::External);
+    in.setCompression(PartMetaData::Zstd);
 
     const PartMetaData out = serializeAndDeserialize(in);
     QCOMPARE(out.name(), QByteArray("PLD:HEAD"));
     QCOMPARE(out.size(), 42);
     QCOMPARE(out.version(), 1);
     QCOMPARE(out.storageType(), PartMetaData::External);
+    QCOMPARE(out.compression(), PartMetaData::Zstd);
     QCOMPARE(out, in);
     const bool notEquals = (in != out);
     QVERIFY(!notEquals);
@@ -432,11 +434,17 @@ void ProtocolTest::testLoginCommand()
     QVERIFY(!in.isResponse());
     QVERIFY(in.isValid());
     in.setSessionId("MySession-123-notifications");
+    QCOMPARE(in.encoding(), LoginCommand::LegacyEncoding);
+    in.setEncoding(LoginCommand::CompactEncoding);
+    QVERIFY(!in.acceptCompressedParts());
+    in.setAcceptCompressedParts(true);
 
     const auto out = serializeAndDeserialize(LoginCommandPtr::create(in));
     QVERIFY(out->isValid());
     QVERIFY(!out->isResponse());
     QCOMPARE(out->sessionId(), QByteArray("MySession-123-notifications"));
+    QCOMPARE(out->encoding(), LoginCommand::CompactEncoding);
+    QVERIFY(out->acceptCompressedParts());
     QCOMPARE(*out, in);
     const bool notEquals = (*out != in);
     QVERIFY(!notEquals);
@@ -0,0 +1,172 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "binarytracer.h"
+#include "shared/aktest.h"
+
+#include "private/protocol_p.h"
+
+#include <QFile>
+#include <QObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <thread>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+class BinaryTracerTest : public QObject
+{
+    Q_OBJECT
+
+    static QList<BinaryTrace::Event> readTrace(const QString &fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return {};
+        }
+        BinaryTrace::Header header;
+        if (!BinaryTrace::readHeader(&file, &header)) {
+            return {};
+        }
+        QList<BinaryTrace::Event> events;
+        char buffer[BinaryTrace::EventSize];
+        while (file.read(buffer, sizeof(buffer)) == sizeof(buffer)) {
+            events.push_back(BinaryTrace::decodeEvent(buffer));
+        }
+        return events;
+    }
+
+private Q_SLOTS:
+    void testEventEncoding()
+    {
+        BinaryTrace::Event event;
+        event.timestamp = 1234567890123;
+        event.tag = -42;
+        event.connection = 7;
+        event.duration = 1500;
+        event.count = 100;
+        event.command = Protocol::Command::FetchItems;
+        event.flags = BinaryTrace::Failed;
+
+        char buffer[BinaryTrace::EventSize];
+        BinaryTrace::encodeEvent(event, buffer);
+        const auto decoded = BinaryTrace::decodeEvent(buffer);
+        QCOMPARE(decoded.timestamp, event.timestamp);
+        QCOMPARE(decoded.tag, event.tag);
+        QCOMPARE(decoded.connection, event.connection);
+        QCOMPARE(decoded.duration, event.duration);
+        QCOMPARE(decoded.count, event.count);
+        QCOMPARE(decoded.command, event.command);
+        QCOMPARE(decoded.flags, event.flags);
+    }
+
+    void testBufferDropsWhenFull()
+    {
+        auto buffer = std::make_unique<TraceEventBuffer>();
+        for (quint32 i = 0; i < TraceEventBuffer::Capacity + 10; ++i) {
+            BinaryTrace::Event event;
+            event.tag = i;
+            buffer->push(event);
+        }
+        QCOMPARE(buffer->takeDropped(), 10U);
+
+        qint64 expectedTag = 0;
+        buffer->drain([&expectedTag](const BinaryTrace::Event &event) {
+            QCOMPARE(event.tag, expectedTag++);
+        });
+        QCOMPARE(expectedTag, qint64(TraceEventBuffer::Capacity));
+        QCOMPARE(buffer->takeDropped(), 0U);
+    }
+
+    void testRecordFromThreads()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("akonadiserver.trace"));
+
+        auto tracer = AkThread::create<BinaryTracer>(fileName, 0);
+        tracer->waitForInitialized();
+
+        const auto record = [&tracer](quint32 connection) {
+            for (int i = 0; i < 100; ++i) {
+                tracer->recordCommand(connection, i, Protocol::Command::FetchItems, BinaryTracer::Clock::now(), 1, false);
+            }
+        };
+        std::thread thread1(record, 1);
+        std::thread thread2(record, 2);
+        thread1.join();
+        thread2.join();
+        tracer->recordCommand(3, 1, Protocol::Command::Logout, BinaryTracer::Clock::now(), 0, true);
+        // Flushes the remaining events
+        tracer.reset();
+
+        const auto events = readTrace(fileName);
+        QCOMPARE(events.size(), 201);
+        for (quint32 connection : {1, 2}) {
+            qint64 expectedTag = 0;
+            for (const auto &event : events) {
+                if (event.connection == connection) {
+                    QCOMPARE(event.tag, expectedTag++);
+                    QCOMPARE(event.command, quint16(Protocol::Command::FetchItems));
+                    QCOMPARE(event.count, 1U);
+                }
+            }
+            QCOMPARE(expectedTag, qint64(100));
+        }
+        QCOMPARE(events.last().connection, 3U);
+        QCOMPARE(events.last().flags, quint16(BinaryTrace::Failed));
+    }
+
+    void testRotation()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("akonadiserver.trace"));
+
+        // Room for the header and two events
+        auto tracer = AkThread::create<BinaryTracer>(fileName, BinaryTrace::HeaderSize + 2 * BinaryTrace::EventSize);
+        tracer->waitForInitialized();
+        for (int i = 0; i < 2; ++i) {
+            tracer->recordCommand(1, i, Protocol::Command::Hello, BinaryTracer::Clock::now(), 0, false);
+        }
+        QMetaObject::invokeMethod(tracer.get(), &BinaryTracer::flush, Qt::BlockingQueuedConnection);
+        tracer->recordCommand(1, 2, Protocol::Command::Hello, BinaryTracer::Clock::now(), 0, false);
+        tracer.reset();
+
+        QCOMPARE(readTrace(fileName + QStringLiteral(".1")).size(), 2);
+        const auto events = readTrace(fileName);
+        QCOMPARE(events.size(), 1);
+        QCOMPARE(events.first().tag, qint64(2));
+    }
+
+    void testRotationOnStart()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("akonadiserver.trace"));
+
+        auto tracer = AkThread::create<BinaryTracer>(fileName, 0);
+        tracer->waitForInitialized();
+        tracer->recordCommand(1, 1, Protocol::Command::Hello, BinaryTracer::Clock::now(), 0, false);
+        tracer.reset();
+
+        // The trace of the previous run is kept
+        tracer = AkThread::create<BinaryTracer>(fileName, 0);
+        tracer->waitForInitialized();
+        tracer->recordCommand(1, 2, Protocol::Command::Hello, BinaryTracer::Clock::now(), 0, false);
+        tracer.reset();
+
+        const auto oldEvents = readTrace(fileName + QStringLiteral(".1"));
+        QCOMPARE(oldEvents.size(), 1);
+        QCOMPARE(oldEvents.first().tag, qint64(1));
+        const auto events = readTrace(fileName);
+        QCOMPARE(events.size(), 1);
+        QCOMPARE(events.first().tag, qint64(2));
+    }
+};
+
+AKTEST_MAIN(BinaryTracerTest)
+
+#include "binarytracertest.moc"
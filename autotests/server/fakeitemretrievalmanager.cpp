@@ -16,8 +16,18 @@ FakeItemRetrievalManager::FakeItemRetrievalManager()
     qRegisterMetaType<ItemRetrievalResult>();
 }
 
+void FakeItemRetrievalManager::setPassThrough(bool passThrough)
+{
+    mPassThrough = passThrough;
+}
+
 void FakeItemRetrievalManager::requestItemDelivery(ItemRetrievalRequest request)
 {
+    if (mPassThrough) {
+        ItemRetrievalManager::requestItemDelivery(std::move(request));
+        return;
+    }
+
     QMetaObject::invokeMethod(
         this,
         [this, r = std::move(request)] {
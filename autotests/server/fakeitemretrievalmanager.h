@@ -8,6 +8,8 @@
 
 #include "storage/itemretrievalmanager.h"
 
+#include <atomic>
+
 namespace Akonadi
 {
 namespace Server
@@ -19,6 +21,15 @@ public:
     explicit FakeItemRetrievalManager();
 
     void requestItemDelivery(ItemRetrievalRequest request) override;
+
+    /**
+     * Lets the real ItemRetrievalManager process the requests, rather than
+     * completing them immediately.
+     */
+    void setPassThrough(bool passThrough);
+
+private:
+    std::atomic_bool mPassThrough = false;
 };
 
 } // namespace Server
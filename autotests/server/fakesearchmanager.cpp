@@ -42,11 +42,27 @@ void FakeSearchManager::updateSearchAsync(const Collection &collection)
 
 QList<Akonadi::AbstractSearchPlugin *> FakeSearchManager::searchPlugins() const
 {
-    return QList<Akonadi::AbstractSearchPlugin *>();
+    return mFakePlugins;
+}
+
+void FakeSearchManager::setSearchPlugins(const QList<AbstractSearchPlugin *> &plugins)
+{
+    mFakePlugins = plugins;
 }
 
 void FakeSearchManager::scheduleSearchUpdate()
 {
 }
 
+void FakeSearchManager::scheduleSearchUpdate(const QSet<qint64> &changedItems, const QSet<qint64> &changedCollections)
+{
+    Q_UNUSED(changedItems)
+    Q_UNUSED(changedCollections)
+}
+
+void FakeSearchManager::scheduleIndexUpdate(const QSet<qint64> &items)
+{
+    Q_UNUSED(items)
+}
+
 #include "moc_fakesearchmanager.cpp"
@@ -32,7 +32,15 @@ public:
     void updateSearchAsync(const Collection &collection) override;
     QList<AbstractSearchPlugin *> searchPlugins() const override;
 
+    /// Sets the plugins returned by searchPlugins(), they are not owned by the search manager
+    void setSearchPlugins(const QList<AbstractSearchPlugin *> &plugins);
+
     void scheduleSearchUpdate() override;
+    void scheduleSearchUpdate(const QSet<qint64> &changedItems, const QSet<qint64> &changedCollections) override;
+    void scheduleIndexUpdate(const QSet<qint64> &items) override;
+
+private:
+    QList<AbstractSearchPlugin *> mFakePlugins;
 };
 
 } // namespace Server
@@ -4,11 +4,14 @@
     SPDX-License-Identifier: LGPL-2.0-or-later
 */
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QObject>
 #include <QTest>
 #include <QTimer>
 
+#include <atomic>
+
 #include "commandcontext.h"
 #include "storage/datastore.h"
 #include "storage/itemretrievaljob.h"
@@ -16,6 +19,8 @@
 #include "storage/itemretrievalrequest.h"
 #include "storage/itemretriever.h"
 
+#include "private/dbus_p.h"
+
 #include "dbinitializer.h"
 #include "fakeakonadiserver.h"
 
@@ -23,6 +28,9 @@
 
 using namespace Akonadi::Server;
 using namespace std::chrono_literals;
+
+Q_DECLARE_METATYPE(Akonadi::Server::ResourceManager::ActivationResult)
+
 struct JobResult {
     qint64 pimItemId;
     QByteArray partname;
@@ -131,6 +139,142 @@ private:
     QMultiHash<qint64, JobResult> mJobResults;
 };
 
+/// Records the requests it receives and completes the jobs only once opened
+class GatedItemRetrievalJobFactory : public AbstractItemRetrievalJobFactory
+{
+    class Job : public AbstractItemRetrievalJob
+    {
+    public:
+        Job(ItemRetrievalRequest req, GatedItemRetrievalJobFactory &factory, QObject *parent)
+            : AbstractItemRetrievalJob(std::move(req), parent)
+            , mFactory(factory)
+        {
+        }
+
+        void start() override
+        {
+            QMutexLocker lock(&mFactory.mMutex);
+            if (mFactory.mOpen) {
+                complete();
+            } else {
+                mFactory.mBlockedJobs.push_back(this);
+            }
+        }
+
+        void kill() override
+        {
+            Q_ASSERT(false);
+        }
+
+        void complete()
+        {
+            QMetaObject::invokeMethod(
+                this,
+                [this]() {
+                    Q_EMIT requestCompleted(this);
+                },
+                Qt::QueuedConnection);
+        }
+
+    private:
+        GatedItemRetrievalJobFactory &mFactory;
+    };
+
+public:
+    AbstractItemRetrievalJob *retrievalJob(ItemRetrievalRequest request, QObject *parent) override
+    {
+        QMutexLocker lock(&mMutex);
+        mRequestedIds.push_back(request.ids);
+        return new Job(std::move(request), *this, parent);
+    }
+
+    void open()
+    {
+        QMutexLocker lock(&mMutex);
+        mOpen = true;
+        for (auto *job : std::as_const(mBlockedJobs)) {
+            job->complete();
+        }
+        mBlockedJobs.clear();
+    }
+
+    QList<QList<qint64>> requestedIds() const
+    {
+        QMutexLocker lock(&mMutex);
+        return mRequestedIds;
+    }
+
+private:
+    mutable QMutex mMutex;
+    bool mOpen = false;
+    QList<Job *> mBlockedJobs;
+    QList<QList<qint64>> mRequestedIds;
+};
+
+/// Emulates the Akonadi control for resources that are started on demand
+class OnDemandItemRetrievalManager : public ItemRetrievalManager
+{
+    Q_OBJECT
+public:
+    OnDemandItemRetrievalManager(std::unique_ptr<AbstractItemRetrievalJobFactory> factory,
+                                 ResourceManager::ActivationResult result,
+                                 std::chrono::milliseconds activationTimeout)
+        : ItemRetrievalManager(std::move(factory))
+        , mResult(result)
+    {
+        mResourceActivationTimeout = activationTimeout;
+    }
+
+    void enableActivation()
+    {
+        // init() reads it from the configuration
+        QMetaObject::invokeMethod(
+            this,
+            [this]() {
+                mActivateResources = true;
+            },
+            Qt::BlockingQueuedConnection);
+    }
+
+    void resourceStarted(const QString &id)
+    {
+        QMetaObject::invokeMethod(this,
+                                  "serviceOwnerChanged",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(QString, Akonadi::DBus::agentServiceName(id, Akonadi::DBus::Resource)),
+                                  Q_ARG(QString, QString()),
+                                  Q_ARG(QString, QStringLiteral(":1.42")));
+    }
+
+    int activationCount() const
+    {
+        return mActivationCount;
+    }
+
+protected:
+    void activateResource(const QString &id) override
+    {
+        ++mActivationCount;
+        QTimer::singleShot(0, this, [this, id]() {
+            resourceActivationFinished(id, mResult);
+        });
+    }
+
+private:
+    const ResourceManager::ActivationResult mResult;
+    std::atomic_int mActivationCount = 0;
+};
+
+static ItemRetrievalRequest retrievalRequest(QList<qint64> ids, qint64 collectionId, const QByteArrayList &parts)
+{
+    ItemRetrievalRequest req;
+    req.ids = std::move(ids);
+    req.resourceId = QStringLiteral("testresource");
+    req.collectionId = collectionId;
+    req.parts = parts;
+    return req;
+}
+
 using RequestedParts = QList<QByteArray /* FQ name */>;
 
 class ClientThread : public QThread
@@ -340,6 +484,129 @@ private Q_SLOTS:
             }
         }
     }
+
+    void testCoalescing()
+    {
+        auto factory = new GatedItemRetrievalJobFactory;
+        auto mgr = AkThread::create<ItemRetrievalManager>(std::unique_ptr<AbstractItemRetrievalJobFactory>(factory));
+        QTest::qWait(100);
+
+        QMutex finishedMutex;
+        QList<ItemRetrievalResult> finished;
+        connect(mgr.get(), &ItemRetrievalManager::requestFinished, this, [&](const ItemRetrievalResult &result) {
+            QMutexLocker lock(&finishedMutex);
+            finished.push_back(result);
+        });
+        const auto finishedCount = [&]() {
+            QMutexLocker lock(&finishedMutex);
+            return finished.size();
+        };
+
+        // The resource is busy with the first request...
+        mgr->requestItemDelivery(retrievalRequest({1}, 1, {"RFC822"}));
+        QTRY_COMPARE(factory->requestedIds().size(), 1);
+
+        // ... while more requests queue up
+        const auto second = retrievalRequest({2}, 1, {"RFC822"});
+        const auto third = retrievalRequest({3, 2}, 1, {"RFC822"});
+        mgr->requestItemDelivery(second);
+        mgr->requestItemDelivery(retrievalRequest({4}, 2, {"RFC822"}));
+        mgr->requestItemDelivery(third);
+        mgr->requestItemDelivery(retrievalRequest({5}, 1, {"HEAD"}));
+
+        factory->open();
+        QTRY_COMPARE(finishedCount(), 5);
+
+        // Requests for the same collection and parts are retrieved together
+        const QList<QList<qint64>> expectedJobs{{1}, {2, 3}, {4}, {5}};
+        QCOMPARE(factory->requestedIds(), expectedJobs);
+
+        // ... but finished individually
+        QMutexLocker lock(&finishedMutex);
+        const auto secondResult = std::find_if(finished.cbegin(), finished.cend(), [&second](const ItemRetrievalResult &result) {
+            return result.request.id == second.id;
+        });
+        QVERIFY(secondResult != finished.cend());
+        QCOMPARE(secondResult->request.ids, QList<qint64>{2});
+        QVERIFY(!secondResult->errorMsg.has_value());
+        const auto thirdResult = std::find_if(finished.cbegin(), finished.cend(), [&third](const ItemRetrievalResult &result) {
+            return result.request.id == third.id;
+        });
+        QVERIFY(thirdResult != finished.cend());
+        QCOMPARE(thirdResult->request.ids, (QList<qint64>{3, 2}));
+    }
+
+    void testWaitForResourceActivation()
+    {
+        auto factory = new GatedItemRetrievalJobFactory;
+        factory->open();
+        auto mgr = AkThread::create<OnDemandItemRetrievalManager>(std::unique_ptr<AbstractItemRetrievalJobFactory>(factory),
+                                                                  ResourceManager::ActivationResult::OnDemand,
+                                                                  std::chrono::milliseconds(30s));
+        mgr->enableActivation();
+
+        QList<ItemRetrievalResult> finished;
+        connect(mgr.get(), &ItemRetrievalManager::requestFinished, this, [&finished](const ItemRetrievalResult &result) {
+            finished.push_back(result);
+        });
+
+        // Requests wait for the resource to start, it's asked only once
+        mgr->requestItemDelivery(retrievalRequest({1}, 1, {"RFC822"}));
+        QTRY_COMPARE(mgr->activationCount(), 1);
+        mgr->requestItemDelivery(retrievalRequest({2}, 2, {"RFC822"}));
+        QTest::qWait(200);
+        QCOMPARE(mgr->activationCount(), 1);
+        QVERIFY(factory->requestedIds().isEmpty());
+        QVERIFY(finished.isEmpty());
+
+        // They are retrieved once it's up
+        mgr->resourceStarted(QStringLiteral("testresource"));
+        QTRY_COMPARE(finished.size(), 2);
+        QCOMPARE(factory->requestedIds(), (QList<QList<qint64>>{{1}, {2}}));
+        QVERIFY(!finished.at(0).errorMsg.has_value());
+        QVERIFY(!finished.at(1).errorMsg.has_value());
+
+        // A running resource isn't started again
+        mgr->requestItemDelivery(retrievalRequest({3}, 1, {"RFC822"}));
+        QTRY_COMPARE(finished.size(), 3);
+        QCOMPARE(mgr->activationCount(), 1);
+    }
+
+    void testResourceActivationTimeout_data()
+    {
+        QTest::addColumn<ResourceManager::ActivationResult>("activationResult");
+        QTest::addColumn<bool>("expectWait");
+
+        QTest::newRow("started on demand") << ResourceManager::ActivationResult::OnDemand << true;
+        QTest::newRow("not started on demand") << ResourceManager::ActivationResult::NotOnDemand << false;
+        QTest::newRow("control not available") << ResourceManager::ActivationResult::Failed << false;
+    }
+
+    void testResourceActivationTimeout()
+    {
+        QFETCH(ResourceManager::ActivationResult, activationResult);
+        QFETCH(bool, expectWait);
+
+        constexpr auto timeout = 500ms;
+        auto factory = new GatedItemRetrievalJobFactory;
+        factory->open();
+        auto mgr = AkThread::create<OnDemandItemRetrievalManager>(std::unique_ptr<AbstractItemRetrievalJobFactory>(factory), activationResult, timeout);
+        mgr->enableActivation();
+
+        // The retrieval is attempted once there is no point in waiting any longer, and fails if
+        // the resource is really not there
+        QElapsedTimer timer;
+        timer.start();
+        mgr->requestItemDelivery(retrievalRequest({1}, 1, {"RFC822"}));
+        QTRY_COMPARE(factory->requestedIds().size(), 1);
+        QCOMPARE(mgr->activationCount(), 1);
+        const auto elapsed = std::chrono::milliseconds(timer.elapsed());
+        if (expectWait) {
+            QVERIFY(elapsed >= timeout);
+        } else {
+            QVERIFY(elapsed < timeout);
+        }
+    }
 };
 
 AKTEST_FAKESERVER_MAIN(ItemRetrieverTest)
@@ -0,0 +1,159 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "entities.h"
+#include "search/localsearchplugin.h"
+
+#include "dbinitializer.h"
+#include "fakeakonadiserver.h"
+
+#include "aktest.h"
+
+using namespace Akonadi::Server;
+
+namespace
+{
+const QByteArray mail1 =
+    "From: Alice <alice@example.com>\r\n"
+    "To: Bob <bob@example.com>\r\n"
+    "Subject: =?UTF-8?Q?Quarterly_r=C3=A9sum=C3=A9?=\r\n"
+    "Date: Mon, 2 Mar 2026 10:00:00 +0000\r\n"
+    "Content-Type: multipart/mixed; boundary=\"XYZ\"\r\n"
+    "\r\n"
+    "--XYZ\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "Content-Transfer-Encoding: quoted-printable\r\n"
+    "\r\n"
+    "The numbers look gr=\r\neat this quarter.\r\n"
+    "--XYZ\r\n"
+    "Content-Type: application/pdf; name=\"report.pdf\"\r\n"
+    "Content-Transfer-Encoding: base64\r\n"
+    "\r\n"
+    "JVBERi0xLjQK\r\n"
+    "--XYZ--\r\n";
+
+const QByteArray mail2 =
+    "From: Carol <carol@example.com>\r\n"
+    "To: Alice <alice@example.com>\r\n"
+    "Subject: Lunch\r\n"
+    "Date: Fri, 6 Mar 2026 12:00:00 +0000\r\n"
+    "\r\n"
+    "<html><body>Pizza <b>tomorrow</b>?</body></html>\r\n";
+
+const QByteArray contact =
+    "BEGIN:VCARD\r\n"
+    "VERSION:3.0\r\n"
+    "FN:Dave Example\r\n"
+    "NICKNAME:davey\r\n"
+    "EMAIL:dave@example.com\r\n"
+    "UID:abc-123\r\n"
+    "END:VCARD\r\n";
+
+QString term(const char *key, const QString &value, int cond = 5 /* CondContains */, bool negated = false)
+{
+    return QStringLiteral(R"({"key": "%1", "value": "%2", "cond": %3, "negated": %4})")
+        .arg(QLatin1StringView(key), value, QString::number(cond), negated ? QStringLiteral("true") : QStringLiteral("false"));
+}
+
+QString compound(int rel, const QStringList &subTerms)
+{
+    return QStringLiteral(R"({"rel": %1, "negated": false, "subTerms": [%2]})").arg(rel).arg(subTerms.join(QLatin1Char(',')));
+}
+} // namespace
+
+class LocalSearchPluginTest : public QObject
+{
+    Q_OBJECT
+
+    FakeAkonadiServer mAkonadi;
+    QTemporaryDir mIndexDir;
+
+public:
+    LocalSearchPluginTest()
+    {
+        mAkonadi.setPopulateDb(false);
+        mAkonadi.init();
+    }
+
+private Q_SLOTS:
+    void testSearch()
+    {
+        DbInitializer dbInitializer;
+        dbInitializer.createResource("testresource");
+        const Collection col1 = dbInitializer.createCollection("col1");
+        const Collection col2 = dbInitializer.createCollection("col2");
+
+        const auto createItem = [&](const char *name, const Collection &col, const char *mimeType, const QByteArray &payload) {
+            PimItem item = dbInitializer.createItem(name, col);
+            item.setMimeType(MimeType::retrieveByNameOrCreate(QLatin1StringView(mimeType)));
+            item.setSize(payload.size());
+            item.update();
+            dbInitializer.createPart(item.id(), "PLD:RFC822", payload);
+            return item.id();
+        };
+        const qint64 mail1Id = createItem("mail1", col1, "message/rfc822", mail1);
+        const qint64 mail2Id = createItem("mail2", col2, "message/rfc822", mail2);
+
+        LocalSearchPlugin plugin(mIndexDir.filePath(QStringLiteral("index.db")));
+        QVERIFY(plugin.isValid());
+
+        // Initial indexing picks up existing items
+        while (plugin.indexNextBatch()) { }
+
+        const QList<qint64> allCollections{col1.id(), col2.id()};
+        const QStringList mailMimeTypes{QStringLiteral("message/rfc822")};
+
+        QCOMPARE(plugin.search(term("subject", QStringLiteral("resume")), allCollections, mailMimeTypes), QSet<qint64>{mail1Id});
+        QCOMPARE(plugin.search(term("from", QStringLiteral("carol")), allCollections, mailMimeTypes), QSet<qint64>{mail2Id});
+        QCOMPARE(plugin.search(term("to", QStringLiteral("alice")), allCollections, mailMimeTypes), QSet<qint64>{mail2Id});
+        QCOMPARE(plugin.search(term("body", QStringLiteral("great")), allCollections, mailMimeTypes), QSet<qint64>{mail1Id});
+        QCOMPARE(plugin.search(term("body", QStringLiteral("tomor")), allCollections, mailMimeTypes), QSet<qint64>{mail2Id});
+        QCOMPARE(plugin.search(term("body", QStringLiteral("html")), allCollections, mailMimeTypes), QSet<qint64>{});
+        QCOMPARE(plugin.search(term("message", QStringLiteral("alice")), allCollections, mailMimeTypes), (QSet<qint64>{mail1Id, mail2Id}));
+        QCOMPARE(plugin.search(term("attachment", QStringLiteral("true"), 0), allCollections, mailMimeTypes), QSet<qint64>{mail1Id});
+        QCOMPARE(plugin.search(term("onlydate", QStringLiteral("2026-03-05"), 1 /* CondGreaterThan */), allCollections, mailMimeTypes),
+                 QSet<qint64>{mail2Id});
+
+        // Collection and mime type restrictions
+        QCOMPARE(plugin.search(term("message", QStringLiteral("alice")), {col1.id()}, mailMimeTypes), QSet<qint64>{mail1Id});
+        QCOMPARE(plugin.search(term("message", QStringLiteral("alice")), allCollections, {QStringLiteral("text/directory")}), QSet<qint64>{});
+
+        // Compound and negated terms
+        QCOMPARE(plugin.search(compound(0, {term("to", QStringLiteral("alice")), term("subject", QStringLiteral("lunch"))}), allCollections, mailMimeTypes),
+                 QSet<qint64>{mail2Id});
+        QCOMPARE(plugin.search(compound(1, {term("from", QStringLiteral("alice")), term("from", QStringLiteral("carol"))}), allCollections, mailMimeTypes),
+                 (QSet<qint64>{mail1Id, mail2Id}));
+        QCOMPARE(plugin.search(term("from", QStringLiteral("alice"), 5, true), allCollections, mailMimeTypes), QSet<qint64>{mail2Id});
+
+        // Unsupported terms don't match anything
+        QCOMPARE(plugin.search(term("messagestatus", QStringLiteral("\\\\SEEN")), allCollections, mailMimeTypes), QSet<qint64>{});
+
+        // Changes are indexed once scheduled
+        const qint64 contactId = createItem("contact", col1, "text/directory", contact);
+        const QStringList contactMimeTypes{QStringLiteral("text/directory")};
+        QCOMPARE(plugin.search(term("nickname", QStringLiteral("davey")), allCollections, contactMimeTypes), QSet<qint64>{});
+        plugin.scheduleUpdate({contactId});
+        plugin.indexPendingChanges();
+        QCOMPARE(plugin.search(term("nickname", QStringLiteral("davey")), allCollections, contactMimeTypes), QSet<qint64>{contactId});
+        QCOMPARE(plugin.search(term("email", QStringLiteral("dave@example.com"), 0), allCollections, contactMimeTypes), QSet<qint64>{contactId});
+        QCOMPARE(plugin.search(term("name", QStringLiteral("example")), allCollections, contactMimeTypes), QSet<qint64>{contactId});
+
+        // Removed items are dropped from the index
+        QVERIFY(Part::remove(Part::pimItemIdColumn(), mail1Id));
+        QVERIFY(PimItem::remove(mail1Id));
+        plugin.scheduleUpdate({mail1Id});
+        plugin.indexPendingChanges();
+        QCOMPARE(plugin.search(term("message", QStringLiteral("alice")), allCollections, mailMimeTypes), QSet<qint64>{mail2Id});
+    }
+};
+
+AKTEST_FAKESERVER_MAIN(LocalSearchPluginTest)
+
+#include "localsearchplugintest.moc"
@@ -11,8 +11,13 @@
 #include "notificationmanager.h"
 #include "notificationsubscriber.h"
 
+#include "private/standarddirs_p.h"
+
+#include <QDir>
 #include <QObject>
+#include <QSemaphore>
 #include <QTest>
+#include <QThreadPool>
 
 using namespace Akonadi;
 using namespace Akonadi::Server;
@@ -31,11 +36,83 @@ public:
     using NotificationSubscriber::registerSubscriber;
 };
 
+/// Records the item notifications it is sent
+class RecordingNotificationSubscriber : public TestableNotificationSubscriber
+{
+public:
+    using TestableNotificationSubscriber::TestableNotificationSubscriber;
+
+    QList<qint64> items;
+
+protected:
+    void writeNotification(const Protocol::ChangeNotificationPtr &notification) override
+    {
+        if (notification->type() == Protocol::Command::ItemChangeNotification) {
+            items.push_back(static_cast<const Protocol::ItemChangeNotification &>(*notification).items().at(0).id());
+        }
+    }
+};
+
 class NotificationManagerTest : public QObject
 {
     Q_OBJECT
 
+    static constexpr QByteArrayView resource = "akonadi_test_resource_0";
+
+    static std::unique_ptr<NotificationManager> createHoldingManager()
+    {
+        std::unique_ptr<NotificationManager> manager(new NotificationManager(AkThread::NoThread));
+        QMetaObject::invokeMethod(manager.get(), "init", Qt::DirectConnection);
+        manager->enableHoldingNotifications();
+        return manager;
+    }
+
+    static Protocol::ChangeNotificationPtr itemAdded(qint64 id)
+    {
+        auto ntf = Protocol::ItemChangeNotificationPtr::create();
+        ntf->setOperation(Protocol::ItemChangeNotification::Add);
+        ntf->setSessionId("session1");
+        ntf->setResource(resource.toByteArray());
+        ntf->setParentCollection(1);
+        Protocol::FetchItemsResponse item;
+        item.setId(id);
+        ntf->setItems({item});
+        return ntf;
+    }
+
+    /// Adds a subscriber in the session of the resource, like its change recorder
+    static RecordingNotificationSubscriber *addSubscriber(NotificationManager &manager)
+    {
+        // Deleted by the manager
+        auto subscriber = new RecordingNotificationSubscriber(&manager);
+        Protocol::CreateSubscriptionCommand createCmd;
+        createCmd.setSession(resource.toByteArray());
+        subscriber->registerSubscriber(createCmd);
+        manager.mSubscribers.push_back(subscriber);
+        return subscriber;
+    }
+
+    static void monitorResource(RecordingNotificationSubscriber *subscriber)
+    {
+        Protocol::ModifySubscriptionCommand modifyCmd;
+        modifyCmd.setStartMonitoringResources({resource.toByteArray()});
+        subscriber->modifySubscription(modifyCmd);
+    }
+
+    static void emitNotifications(NotificationManager &manager, const Protocol::ChangeNotificationList &notifications)
+    {
+        manager.slotNotify(notifications);
+        // Emitted right away, the tests decide when the held notifications are released
+        manager.mTimer->stop();
+        manager.emitPendingNotifications();
+    }
+
 private Q_SLOTS:
+    void cleanup()
+    {
+        QDir(StandardDirs::saveDir("data", QStringLiteral("held_notifications"))).removeRecursively();
+    }
+
     void testAggregatedFetchScope()
     {
         NotificationManager manager(AkThread::NoThread);
@@ -140,6 +217,94 @@ private Q_SLOTS:
         QVERIFY(!manager.itemFetchScope()->fetchTags());
         QVERIFY(!manager.itemFetchScope()->fetchVirtualReferences());
     }
+
+    void testHeldNotificationsOrder()
+    {
+        auto manager = createHoldingManager();
+
+        // Nobody records the changes of the resource yet
+        emitNotifications(*manager, {itemAdded(1), itemAdded(2)});
+        QCOMPARE(manager->mHeldNotifications.value(resource.toByteArray()).size(), 2);
+
+        // Held notifications are sent before new ones once the change recorder subscribed
+        auto recorder = addSubscriber(*manager);
+        monitorResource(recorder);
+        emitNotifications(*manager, {itemAdded(3)});
+        QTRY_COMPARE(recorder->items, (QList<qint64>{1, 2, 3}));
+        QVERIFY(manager->mHeldNotifications.isEmpty());
+
+        // Nothing is held anymore while it is subscribed
+        emitNotifications(*manager, {itemAdded(4)});
+        QTRY_COMPARE(recorder->items, (QList<qint64>{1, 2, 3, 4}));
+        QVERIFY(manager->mHeldNotifications.isEmpty());
+    }
+
+    void testHeldNotificationsSkipped()
+    {
+        auto manager = createHoldingManager();
+
+        // Not the change recorder yet, but gets everything else
+        auto subscriber = addSubscriber(*manager);
+        Protocol::ModifySubscriptionCommand modifyCmd;
+        modifyCmd.setAllMonitored(true);
+        subscriber->modifySubscription(modifyCmd);
+
+        // It becomes the change recorder before the notification is sent to it
+        QSemaphore blocked;
+        manager->mNotifyThreadPool->setMaxThreadCount(1);
+        manager->mNotifyThreadPool->start([&blocked]() {
+            blocked.acquire();
+        });
+        emitNotifications(*manager, {itemAdded(1)});
+        monitorResource(subscriber);
+        blocked.release();
+        manager->mNotifyThreadPool->waitForDone();
+        QCoreApplication::processEvents();
+        QVERIFY(subscriber->items.isEmpty());
+
+        // It only gets it once, with the held notifications
+        manager->releaseHeldNotifications();
+        QTRY_COMPARE(subscriber->items, QList<qint64>{1});
+        QCoreApplication::processEvents();
+        QCOMPARE(subscriber->items, QList<qint64>{1});
+    }
+
+    void testHeldNotificationsPersisted()
+    {
+        {
+            auto manager = createHoldingManager();
+            emitNotifications(*manager, {itemAdded(1)});
+            emitNotifications(*manager, {itemAdded(2)});
+        }
+
+        // The notifications held by the previous run are sent once the change recorder subscribes
+        auto manager = createHoldingManager();
+        QCOMPARE(manager->mHeldNotifications.value(resource.toByteArray()).size(), 2);
+        auto recorder = addSubscriber(*manager);
+        monitorResource(recorder);
+        emitNotifications(*manager, {itemAdded(3)});
+        QTRY_COMPARE(recorder->items, (QList<qint64>{1, 2, 3}));
+
+        // And not again after the next restart
+        manager.reset();
+        manager = createHoldingManager();
+        QVERIFY(manager->mHeldNotifications.isEmpty());
+    }
+
+    void testForgetResource()
+    {
+        auto manager = createHoldingManager();
+        emitNotifications(*manager, {itemAdded(1)});
+        manager->mInactiveResources.insert(resource.toByteArray());
+
+        manager->forgetResource(QString::fromLatin1(resource));
+        QVERIFY(manager->mHeldNotifications.isEmpty());
+        QVERIFY(manager->mInactiveResources.isEmpty());
+
+        manager.reset();
+        manager = createHoldingManager();
+        QVERIFY(manager->mHeldNotifications.isEmpty());
+    }
 };
 
 AKTEST_MAIN(NotificationManagerTest)
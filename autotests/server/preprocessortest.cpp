@@ -0,0 +1,257 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QObject>
+
+#include "dbinitializer.h"
+#include "entities.h"
+#include "fakeakonadiserver.h"
+#include "preprocessormanager.h"
+#include "private/dbus_p.h"
+#include "shared/aktest.h"
+#include "storage/datastore.h"
+#include "storage/transaction.h"
+
+#include <QDBusConnection>
+#include <QDBusContext>
+#include <QDBusMetaType>
+#include <QScopeGuard>
+#include <QTest>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+namespace
+{
+const QString preprocessorId = QStringLiteral("akonadi_fake_preprocessor_0");
+
+/// The D-Bus interface of a fake preprocessor
+class FakePreprocessor : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Akonadi.Preprocessor")
+
+public:
+    /// A @p batchSize of 0 makes it behave like a preprocessor that doesn't know about batches
+    explicit FakePreprocessor(int batchSize)
+        : mBatchSize(batchSize)
+    {
+    }
+
+    QList<qlonglong> items;
+    QList<QList<qlonglong>> batches;
+
+Q_SIGNALS:
+    void itemProcessed(qlonglong id);
+    void itemsProcessed(const QList<qlonglong> &ids, const QList<int> &results);
+
+public Q_SLOTS:
+    void beginProcessItem(qlonglong id, qlonglong collectionId, const QString &mimeType)
+    {
+        Q_UNUSED(collectionId)
+        Q_UNUSED(mimeType)
+        items.push_back(id);
+    }
+
+    void beginProcessItems(const QList<qlonglong> &ids)
+    {
+        batches.push_back(ids);
+    }
+
+    int maximumBatchSize()
+    {
+        if (mBatchSize == 0) {
+            sendErrorReply(QDBusError::UnknownMethod, QStringLiteral("No such method 'maximumBatchSize'"));
+        }
+        return mBatchSize;
+    }
+
+private:
+    const int mBatchSize;
+};
+
+} // namespace
+
+class PreprocessorTest : public QObject
+{
+    Q_OBJECT
+
+    FakeAkonadiServer mAkonadi;
+    std::unique_ptr<DbInitializer> mDbInitializer;
+    Collection mCollection;
+    int mItemCount = 0;
+
+public:
+    PreprocessorTest()
+    {
+        mAkonadi.setPopulateDb(false);
+        mAkonadi.init();
+
+        mDbInitializer = std::make_unique<DbInitializer>();
+        mDbInitializer->createResource("testresource");
+        mCollection = mDbInitializer->createCollection("col1");
+    }
+
+    QList<qlonglong> createItems(int count)
+    {
+        QList<qlonglong> ids;
+        for (int i = 0; i < count; ++i) {
+            const QByteArray name = "item" + QByteArray::number(mItemCount++);
+            ids.push_back(mDbInitializer->createItem(name.constData(), mCollection).id());
+        }
+        return ids;
+    }
+
+    /// Passes @p ids to the preprocessors in a single transaction, like a client creating several items does
+    static void handleItems(PreprocessorManager &manager, const QList<qlonglong> &ids)
+    {
+        Transaction transaction(DataStore::self(), QStringLiteral("PREPROCESSORTEST"));
+        for (const qlonglong id : ids) {
+            manager.beginHandleItem(PimItem::retrieveById(id), DataStore::self());
+        }
+        QVERIFY(transaction.commit());
+    }
+
+    static bool registerPreprocessor(FakePreprocessor &preprocessor)
+    {
+        auto bus = QDBusConnection::sessionBus();
+        qDBusRegisterMetaType<QList<qlonglong>>();
+        qDBusRegisterMetaType<QList<int>>();
+        return bus.registerObject(QStringLiteral("/Preprocessor"), &preprocessor, QDBusConnection::ExportAllSlots | QDBusConnection::ExportAllSignals)
+            && bus.registerService(DBus::agentServiceName(preprocessorId, DBus::Preprocessor));
+    }
+
+    static void unregisterPreprocessor()
+    {
+        auto bus = QDBusConnection::sessionBus();
+        bus.unregisterService(DBus::agentServiceName(preprocessorId, DBus::Preprocessor));
+        bus.unregisterObject(QStringLiteral("/Preprocessor"));
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        if (!QDBusConnection::sessionBus().isConnected()) {
+            QSKIP("No D-Bus session bus");
+        }
+    }
+
+    void testBatches()
+    {
+        FakePreprocessor preprocessor(2);
+        QVERIFY(registerPreprocessor(preprocessor));
+        const auto unregister = qScopeGuard(&PreprocessorTest::unregisterPreprocessor);
+
+        PreprocessorManager manager(mAkonadi.tracer());
+        manager.setBatchWindow(0);
+        manager.registerInstance(preprocessorId);
+        PreprocessorInstance *instance = manager.lockedFindInstance(preprocessorId);
+        QVERIFY(instance);
+        QTRY_COMPARE(instance->maximumBatchSize(), 2);
+
+        const auto ids = createItems(3);
+        handleItems(manager, ids);
+        QTRY_COMPARE(preprocessor.batches.size(), 1);
+        QCOMPARE(preprocessor.batches[0], ids.mid(0, 2));
+        QVERIFY(instance->isBusy());
+
+        // The next batch is only started once the current one is done
+        Q_EMIT preprocessor.itemsProcessed(ids.mid(0, 2), {0, 1});
+        QTRY_COMPARE(preprocessor.batches.size(), 2);
+        QCOMPARE(preprocessor.batches[1], ids.mid(2));
+
+        Q_EMIT preprocessor.itemsProcessed(ids.mid(2), {0});
+        QTRY_VERIFY(!instance->isBusy());
+        QVERIFY(instance->itemQueue()->empty());
+        QVERIFY(preprocessor.items.isEmpty());
+    }
+
+    void testLegacyPreprocessor()
+    {
+        FakePreprocessor preprocessor(0);
+        QVERIFY(registerPreprocessor(preprocessor));
+        const auto unregister = qScopeGuard(&PreprocessorTest::unregisterPreprocessor);
+
+        PreprocessorManager manager(mAkonadi.tracer());
+        manager.setBatchWindow(0);
+        manager.registerInstance(preprocessorId);
+        PreprocessorInstance *instance = manager.lockedFindInstance(preprocessorId);
+        QVERIFY(instance);
+
+        // Items are passed one by one
+        const auto ids = createItems(2);
+        handleItems(manager, ids);
+        QTRY_COMPARE(preprocessor.items, ids.mid(0, 1));
+        Q_EMIT preprocessor.itemProcessed(ids[0]);
+        QTRY_COMPARE(preprocessor.items, ids);
+        Q_EMIT preprocessor.itemProcessed(ids[1]);
+        QTRY_VERIFY(!instance->isBusy());
+
+        QCOMPARE(instance->maximumBatchSize(), 1);
+        QVERIFY(preprocessor.batches.isEmpty());
+    }
+
+    void testMismatchedBatch()
+    {
+        FakePreprocessor preprocessor(2);
+        QVERIFY(registerPreprocessor(preprocessor));
+        const auto unregister = qScopeGuard(&PreprocessorTest::unregisterPreprocessor);
+
+        PreprocessorManager manager(mAkonadi.tracer());
+        manager.setBatchWindow(0);
+        manager.registerInstance(preprocessorId);
+        PreprocessorInstance *instance = manager.lockedFindInstance(preprocessorId);
+        QVERIFY(instance);
+        QTRY_COMPARE(instance->maximumBatchSize(), 2);
+
+        // Reports without a batch in progress are ignored
+        Q_EMIT preprocessor.itemsProcessed({1}, {0});
+        QTest::qWait(100);
+        QVERIFY(!instance->isBusy());
+
+        const auto ids = createItems(3);
+        handleItems(manager, ids);
+        QTRY_COMPARE(preprocessor.batches.size(), 1);
+
+        // The current batch is done, whatever IDs the preprocessor reports
+        Q_EMIT preprocessor.itemsProcessed({ids[1]}, {0});
+        QTRY_COMPARE(preprocessor.batches.size(), 2);
+        QCOMPARE(preprocessor.batches[1], ids.mid(2));
+        QCOMPARE(instance->itemQueue()->size(), std::size_t(1));
+    }
+
+    void testStuckBatch()
+    {
+        FakePreprocessor preprocessor(2);
+        QVERIFY(registerPreprocessor(preprocessor));
+        const auto unregister = qScopeGuard(&PreprocessorTest::unregisterPreprocessor);
+
+        PreprocessorManager manager(mAkonadi.tracer());
+        manager.setBatchWindow(0);
+        manager.registerInstance(preprocessorId);
+        PreprocessorInstance *instance = manager.lockedFindInstance(preprocessorId);
+        QVERIFY(instance);
+        QTRY_COMPARE(instance->maximumBatchSize(), 2);
+
+        handleItems(manager, createItems(2));
+        QTRY_COMPARE(preprocessor.batches.size(), 1);
+        QCOMPARE(instance->currentBatchSize(), std::size_t(2));
+
+        // Longer than a single item may take, but not longer than two
+        instance->mItemProcessingStartDateTime = QDateTime::currentDateTime().addSecs(-200);
+        manager.heartbeat();
+        QCOMPARE(manager.lockedFindInstance(preprocessorId), instance);
+
+        // Longer than two items may take: it's fired
+        instance->mItemProcessingStartDateTime = QDateTime::currentDateTime().addSecs(-500);
+        manager.heartbeat();
+        QVERIFY(!manager.lockedFindInstance(preprocessorId));
+    }
+};
+
+AKTEST_FAKESERVER_MAIN(PreprocessorTest)
+
+#include "preprocessortest.moc"
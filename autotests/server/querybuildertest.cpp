@@ -137,6 +137,40 @@ void QueryBuilderTest::testQueryBuilder_data()
                                        << QList<QVariant>{values.cbegin(), values.cend()};
     }
 
+    {
+        QueryBuilder qb(QStringLiteral("table"));
+        qb.setDatabaseType(DbType::PostgreSQL);
+        qb.addColumn(QStringLiteral("col1"));
+        qb.addValueCondition(QStringLiteral("col1"), Query::In, QList<qint64>{1, 2, 3});
+        qb.addValueCondition(QStringLiteral("col2"), Query::NotIn, QList<qint64>{4});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("where in QList PSQL")
+            << mBuilders.size()
+            << QStringLiteral("SELECT col1 FROM table WHERE ( col1 = ANY( CAST( :0 AS BIGINT[] ) ) AND col2 <> ALL( CAST( :1 AS BIGINT[] ) ) )")
+            << QList<QVariant>{QStringLiteral("{1,2,3}"), QStringLiteral("{4}")};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"));
+        qb.setDatabaseType(DbType::Sqlite);
+        qb.addColumn(QStringLiteral("col1"));
+        qb.addValueCondition(QStringLiteral("col1"), Query::In, QList<qint64>{1, 2, 3});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("where in QList SQLite") << mBuilders.size()
+                                               << QStringLiteral("SELECT col1 FROM table WHERE ( col1 IN ( SELECT value FROM json_each( :0 ) ) )")
+                                               << QList<QVariant>{QStringLiteral("[1,2,3]")};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"));
+        qb.setDatabaseType(DbType::MySQL);
+        qb.addColumn(QStringLiteral("col1"));
+        qb.addValueCondition(QStringLiteral("col1"), Query::In, QList<qint64>{1, 2, 3});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("where in QList MySQL") << mBuilders.size() << QStringLiteral("SELECT col1 FROM table WHERE ( col1 IN ( :0, :1, :2, :3 ) )")
+                                              << QList<QVariant>{1, 2, 3, 3};
+    }
+
     {
         QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Select);
         qb.setDatabaseType(DbType::MySQL);
@@ -228,6 +262,81 @@ void QueryBuilderTest::testQueryBuilder_data()
                                                   << QVariantList{QStringLiteral("bla"), 1, QStringLiteral("ble"), 2, QStringLiteral("blo"), 3});
     }
 
+    {
+        QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Insert);
+        qb.setDatabaseType(DbType::MySQL);
+        qb.setColumnValues(QStringLiteral("col1"), QList<qint64>{1, 2});
+        qb.setColumnValues(QStringLiteral("col2"), QList<qint64>{3, 4});
+        qb.setConflictHandling(QueryBuilder::IgnoreOnConflict);
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("insert ignore MySQL") << mBuilders.size() << QStringLiteral("INSERT IGNORE INTO table (col1, col2) VALUES (:0, :1), (:2, :3)")
+                                             << QList<QVariant>{1, 3, 2, 4};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Insert);
+        qb.setDatabaseType(DbType::Sqlite);
+        qb.setColumnValues(QStringLiteral("col1"), QList<qint64>{1, 2});
+        qb.setColumnValues(QStringLiteral("col2"), QList<qint64>{3, 4});
+        qb.setConflictHandling(QueryBuilder::IgnoreOnConflict);
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("insert ignore SQLite") << mBuilders.size()
+                                              << QStringLiteral("INSERT OR IGNORE INTO table (col1, col2) VALUES (:0, :1), (:2, :3)")
+                                              << QList<QVariant>{1, 3, 2, 4};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Insert);
+        qb.setDatabaseType(DbType::PostgreSQL);
+        qb.setColumnValues(QStringLiteral("col1"), QList<qint64>{1, 2});
+        qb.setColumnValues(QStringLiteral("col2"), QList<qint64>{3, 4});
+        qb.setConflictHandling(QueryBuilder::IgnoreOnConflict, {QStringLiteral("col1")});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("insert ignore PSQL")
+            << mBuilders.size()
+            << QStringLiteral("INSERT INTO table (col1, col2) VALUES (:0, :1), (:2, :3) ON CONFLICT (col1) DO NOTHING RETURNING id")
+            << QList<QVariant>{1, 3, 2, 4};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Insert);
+        qb.setDatabaseType(DbType::MySQL);
+        qb.setColumnValue(QStringLiteral("col1"), 1);
+        qb.setColumnValue(QStringLiteral("col2"), QStringLiteral("bla"));
+        qb.setConflictHandling(QueryBuilder::UpdateOnConflict, {QStringLiteral("col1")});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("upsert MySQL") << mBuilders.size()
+                                      << QStringLiteral("INSERT INTO table (col1, col2) VALUES (:0, :1) ON DUPLICATE KEY UPDATE col2 = VALUES(col2)")
+                                      << QList<QVariant>{1, QStringLiteral("bla")};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Insert);
+        qb.setDatabaseType(DbType::Sqlite);
+        qb.setColumnValue(QStringLiteral("col1"), 1);
+        qb.setColumnValue(QStringLiteral("col2"), QStringLiteral("bla"));
+        qb.setColumnValue(QStringLiteral("col3"), 2);
+        qb.setConflictHandling(QueryBuilder::UpdateOnConflict, {QStringLiteral("col1")}, {QStringLiteral("col3")});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("upsert SQLite")
+            << mBuilders.size()
+            << QStringLiteral("INSERT INTO table (col1, col2, col3) VALUES (:0, :1, :2) ON CONFLICT (col1) DO UPDATE SET col3 = EXCLUDED.col3")
+            << QList<QVariant>{1, QStringLiteral("bla"), 2};
+    }
+
+    {
+        QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Insert);
+        qb.setDatabaseType(DbType::PostgreSQL);
+        qb.setColumnValue(QStringLiteral("col1"), 1);
+        qb.setColumnValue(QStringLiteral("col2"), QStringLiteral("bla"));
+        qb.setConflictHandling(QueryBuilder::UpdateOnConflict, {QStringLiteral("col1")});
+        mBuilders.push_back(std::move(qb));
+        QTest::newRow("upsert PSQL")
+            << mBuilders.size()
+            << QStringLiteral("INSERT INTO table (col1, col2) VALUES (:0, :1) ON CONFLICT (col1) DO UPDATE SET col2 = EXCLUDED.col2 RETURNING id")
+            << QList<QVariant>{1, QStringLiteral("bla")};
+    }
+
     // test GROUP BY foo
     {
         QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Select);
@@ -456,6 +565,58 @@ void QueryBuilderTest::testQueryBuilder()
     QCOMPARE(mBuilders[qbId].mBindValues, bindValues);
 }
 
+void QueryBuilderTest::testStatementReuse()
+{
+    QueryBuilder qb(QStringLiteral("table"), QueryBuilder::Update);
+    qb.setColumnValue(QStringLiteral("col1"), QStringLiteral("foo"));
+    qb.setColumnValue(QStringLiteral("col2"), 1);
+    qb.addValueCondition(QStringLiteral("id"), Query::Equals, 42);
+    QVERIFY(qb.exec());
+    const QString statement = qb.mStatement;
+    QCOMPARE(statement, QStringLiteral("UPDATE table SET col1 = :0, col2 = :1 WHERE ( id = :2 )"));
+    QCOMPARE(qb.mBindValues, (QList<QVariant>{QStringLiteral("foo"), 1, 42}));
+
+    // Re-executing without changes must not rebind anything
+    QVERIFY(qb.exec());
+    QCOMPARE(qb.mBindValues, (QList<QVariant>{QStringLiteral("foo"), 1, 42}));
+
+    // Changing the value of an existing column keeps the compiled statement
+    qb.setColumnValue(QStringLiteral("col2"), 2);
+    QCOMPARE(qb.mStatement, statement);
+    QVERIFY(qb.exec());
+    QCOMPARE(qb.mStatement, statement);
+    QCOMPARE(qb.mBindValues, (QList<QVariant>{QStringLiteral("foo"), 2, 42}));
+
+    // Changing the shape recompiles the statement
+    qb.addValueCondition(QStringLiteral("col3"), Query::Equals, 3);
+    QVERIFY(qb.mStatement.isEmpty());
+    QVERIFY(qb.exec());
+    QCOMPARE(qb.mStatement, QStringLiteral("UPDATE table SET col1 = :0, col2 = :1 WHERE ( id = :2 AND col3 = :3 )"));
+    QCOMPARE(qb.mBindValues, (QList<QVariant>{QStringLiteral("foo"), 2, 42, 3}));
+}
+
+void QueryBuilderTest::testIdListBuckets()
+{
+    // Lists of different lengths within the same bucket must produce the same statement on MySQL
+    QString statement;
+    for (qint64 count = 5; count <= 8; ++count) {
+        QList<qint64> ids;
+        for (qint64 id = 0; id < count; ++id) {
+            ids.push_back(id);
+        }
+        QueryBuilder qb(QStringLiteral("table"));
+        qb.setDatabaseType(DbType::MySQL);
+        qb.addColumn(QStringLiteral("col1"));
+        qb.addValueCondition(QStringLiteral("col1"), Query::In, ids);
+        QVERIFY(qb.exec());
+        QCOMPARE(qb.mBindValues.size(), 8);
+        if (statement.isEmpty()) {
+            statement = qb.mStatement;
+        }
+        QCOMPARE(qb.mStatement, statement);
+    }
+}
+
 void QueryBuilderTest::benchQueryBuilder()
 {
     const QString table1 = QStringLiteral("Table1");
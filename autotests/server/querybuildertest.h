@@ -24,6 +24,8 @@ class QueryBuilderTest : public QObject
 private Q_SLOTS:
     void testQueryBuilder_data();
     void testQueryBuilder();
+    void testStatementReuse();
+    void testIdListBuckets();
     void benchQueryBuilder();
 
 private:
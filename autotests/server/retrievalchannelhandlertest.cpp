@@ -0,0 +1,335 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QObject>
+
+#include "aklocalserver.h"
+#include "entities.h"
+#include "fakeakonadiserver.h"
+#include "fakeconnection.h"
+#include "fakeitemretrievalmanager.h"
+#include "private/datastream_p_p.h"
+#include "private/dbus_p.h"
+#include "private/protocol_exception_p.h"
+#include "resourceinterface.h"
+#include "shared/aktest.h"
+#include "storage/itemretrievaljob.h"
+
+#include <QDBusConnection>
+#include <QDBusMetaType>
+#include <QLocalSocket>
+#include <QScopeGuard>
+#include <QTest>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+namespace
+{
+const QString resourceId = QStringLiteral("akonadi_fake_resource_0");
+
+/// The retrieval channel of a fake resource: a second connection to the server,
+/// driven synchronously by the test
+class ResourceChannel
+{
+public:
+    explicit ResourceChannel(FakeAkonadiServer &akonadi)
+        : mAkonadi(akonadi)
+    {
+    }
+
+    ~ResourceChannel()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        const QString socketFile = FakeAkonadiServer::basePath() + QStringLiteral("/channel.socket");
+        QLocalServer::removeServer(socketFile);
+        QObject::connect(&mServer, &AkLocalServer::newConnection, &mServer, [this](quintptr socketDescriptor) {
+            mConnection = AkThread::create<FakeConnection>(socketDescriptor, mAkonadi);
+        });
+        if (!mServer.listen(socketFile)) {
+            return false;
+        }
+        mSocket.connectToServer(socketFile);
+        if (!mSocket.waitForConnected() || !QTest::qWaitFor([this]() {
+                return mConnection != nullptr;
+            })) {
+            return false;
+        }
+
+        qint64 tag = -1;
+        const auto hello = readCommand(&tag);
+        if (!hello || hello->type() != Protocol::Command::Hello) {
+            return false;
+        }
+        writeCommand(1, Protocol::LoginCommandPtr::create("resource-channel"));
+        const auto login = readCommand(&tag);
+        if (!login || login->type() != Protocol::Command::Login || Protocol::cmdCast<Protocol::Response>(login).isError()) {
+            return false;
+        }
+        writeCommand(2, Protocol::OpenRetrievalChannelCommandPtr::create(resourceId));
+        const auto open = readCommand(&tag);
+        return open && open->type() == Protocol::Command::OpenRetrievalChannel && !Protocol::cmdCast<Protocol::Response>(open).isError();
+    }
+
+    /// Closes the socket, the server side of the connection stays around
+    void disconnectFromServer()
+    {
+        mSocket.disconnectFromServer();
+    }
+
+    /// Closes the channel and deletes the server side of the connection
+    void close()
+    {
+        mSocket.disconnectFromServer();
+        mConnection.reset();
+        mServer.close();
+    }
+
+    Connection *connection() const
+    {
+        return mConnection.get();
+    }
+
+    Protocol::CommandPtr readCommand(qint64 *tag)
+    {
+        try {
+            while (mSocket.bytesAvailable() < static_cast<qint64>(sizeof(qint64))) {
+                Protocol::DataStream::waitForData(&mSocket, 5000);
+            }
+            Protocol::DataStream stream(&mSocket);
+            stream >> *tag;
+            return Protocol::deserialize(&mSocket);
+        } catch (const ProtocolException &e) {
+            qWarning() << "Failed to read from the retrieval channel:" << e.what();
+            return {};
+        }
+    }
+
+    void writeCommand(qint64 tag, const Protocol::CommandPtr &cmd)
+    {
+        Protocol::DataStream stream(&mSocket);
+        stream << tag;
+        Protocol::serialize(stream, cmd);
+        stream.flush();
+        mSocket.waitForBytesWritten();
+    }
+
+private:
+    FakeAkonadiServer &mAkonadi;
+    AkLocalServer mServer;
+    QLocalSocket mSocket;
+    std::unique_ptr<FakeConnection> mConnection;
+};
+
+/// The D-Bus interface of a fake resource
+class FakeResourceInterface : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Akonadi.Resource")
+
+public:
+    QList<qint64> requestedItems;
+
+public Q_SLOTS:
+    void requestItemDelivery(const QList<qint64> &uids, const QByteArrayList &parts)
+    {
+        Q_UNUSED(parts)
+        requestedItems += uids;
+    }
+};
+
+ItemRetrievalRequest retrievalRequest()
+{
+    ItemRetrievalRequest request;
+    request.ids = {1, 2};
+    request.resourceId = resourceId;
+    request.parts = {"PLD:RFC822"};
+    return request;
+}
+
+} // namespace
+
+class RetrievalChannelHandlerTest : public QObject
+{
+    Q_OBJECT
+
+    FakeAkonadiServer mAkonadi;
+
+public:
+    RetrievalChannelHandlerTest()
+    {
+        mAkonadi.init();
+    }
+
+    template<typename T>
+    Protocol::ResponsePtr createError(const QString &error)
+    {
+        auto resp = T::create();
+        resp->setError(1, error);
+        return resp;
+    }
+
+private Q_SLOTS:
+    void testOpenChannel_data()
+    {
+        QTest::addColumn<TestScenario::List>("scenarios");
+
+        TestScenario::List scenarios;
+        scenarios << FakeAkonadiServer::loginScenario()
+                  << TestScenario::create(5, TestScenario::ClientCmd, Protocol::OpenRetrievalChannelCommandPtr::create(QStringLiteral("akonadi_fake_resource_0")))
+                  << TestScenario::create(5, TestScenario::ServerCmd, Protocol::OpenRetrievalChannelResponsePtr::create());
+        QTest::newRow("valid resource") << scenarios;
+
+        scenarios.clear();
+        scenarios << FakeAkonadiServer::loginScenario()
+                  << TestScenario::create(5, TestScenario::ClientCmd, Protocol::OpenRetrievalChannelCommandPtr::create(QStringLiteral("akonadi_no_such_resource")))
+                  << TestScenario::create(5,
+                                          TestScenario::ServerCmd,
+                                          createError<Protocol::OpenRetrievalChannelResponsePtr>(
+                                              QStringLiteral("akonadi_no_such_resource is not a valid resource identifier")));
+        QTest::newRow("invalid resource") << scenarios;
+
+        scenarios.clear();
+        scenarios << FakeAkonadiServer::loginScenario()
+                  << TestScenario::create(5, TestScenario::ClientCmd, Protocol::RetrieveItemsCommandPtr::create(QList<qint64>{1}, QByteArrayList{"RFC822"}))
+                  << TestScenario::create(
+                         5,
+                         TestScenario::ServerCmd,
+                         createError<Protocol::RetrieveItemsResponsePtr>(QStringLiteral("RetrieveItems can only be sent by the server")));
+        QTest::newRow("retrieval request from client") << scenarios;
+    }
+
+    void testOpenChannel()
+    {
+        QFETCH(TestScenario::List, scenarios);
+
+        mAkonadi.setScenarios(scenarios);
+        mAkonadi.runTest();
+    }
+
+    void testRetrieval_data()
+    {
+        QTest::addColumn<QString>("error");
+
+        QTest::newRow("success") << QString();
+        QTest::newRow("failure") << QStringLiteral("Item not found on the server");
+    }
+
+    void testRetrieval()
+    {
+        QFETCH(QString, error);
+
+        ResourceChannel channel(mAkonadi);
+        QVERIFY(channel.open());
+
+        auto &manager = static_cast<FakeItemRetrievalManager &>(mAkonadi.itemRetrievalManager());
+        manager.setPassThrough(true);
+        const auto resetManager = qScopeGuard([&manager]() {
+            manager.setPassThrough(false);
+        });
+        QList<ItemRetrievalResult> results;
+        connect(&manager, &ItemRetrievalManager::requestFinished, this, [&results](const ItemRetrievalResult &result) {
+            results.push_back(result);
+        });
+
+        const auto request = retrievalRequest();
+        manager.requestItemDelivery(request);
+
+        qint64 tag = -1;
+        const auto cmd = channel.readCommand(&tag);
+        QVERIFY(cmd);
+        QCOMPARE(cmd->type(), Protocol::Command::RetrieveItems);
+        QVERIFY(!cmd->isResponse());
+        QCOMPARE(Protocol::cmdCast<Protocol::RetrieveItemsCommand>(cmd).items(), request.ids);
+        QCOMPARE(Protocol::cmdCast<Protocol::RetrieveItemsCommand>(cmd).parts(), request.parts);
+
+        auto response = Protocol::RetrieveItemsResponsePtr::create();
+        if (!error.isEmpty()) {
+            response->setError(1, error);
+        }
+        channel.writeCommand(tag, response);
+
+        QTRY_COMPARE(results.size(), 1);
+        QCOMPARE(results[0].request.ids, request.ids);
+        QCOMPARE(results[0].errorMsg.has_value(), !error.isEmpty());
+        if (!error.isEmpty()) {
+            QVERIFY(results[0].errorMsg->contains(error));
+        }
+    }
+
+    void testDisconnectDuringRetrieval()
+    {
+        ResourceChannel channel(mAkonadi);
+        QVERIFY(channel.open());
+
+        auto &manager = static_cast<FakeItemRetrievalManager &>(mAkonadi.itemRetrievalManager());
+        manager.setPassThrough(true);
+        const auto resetManager = qScopeGuard([&manager]() {
+            manager.setPassThrough(false);
+        });
+        QList<ItemRetrievalResult> results;
+        connect(&manager, &ItemRetrievalManager::requestFinished, this, [&results](const ItemRetrievalResult &result) {
+            results.push_back(result);
+        });
+
+        manager.requestItemDelivery(retrievalRequest());
+        qint64 tag = -1;
+        QVERIFY(channel.readCommand(&tag));
+
+        // The resource goes away without answering
+        channel.disconnectFromServer();
+
+        QTRY_COMPARE(results.size(), 1);
+        QVERIFY(results[0].errorMsg.has_value());
+    }
+
+    void testDBusFallback()
+    {
+        auto bus = QDBusConnection::sessionBus();
+        if (!bus.isConnected()) {
+            QSKIP("No D-Bus session bus");
+        }
+        qDBusRegisterMetaType<QList<qint64>>();
+        qDBusRegisterMetaType<QByteArrayList>();
+
+        FakeResourceInterface resource;
+        const QString serviceName = DBus::agentServiceName(resourceId, DBus::Resource);
+        QVERIFY(bus.registerObject(QStringLiteral("/"), &resource, QDBusConnection::ExportAllSlots));
+        QVERIFY(bus.registerService(serviceName));
+        const auto unregister = qScopeGuard([&bus, &serviceName]() {
+            bus.unregisterService(serviceName);
+            bus.unregisterObject(QStringLiteral("/"));
+        });
+        org::freedesktop::Akonadi::Resource iface(serviceName, QStringLiteral("/"), bus);
+        QVERIFY(iface.isValid());
+
+        ResourceChannel channel(mAkonadi);
+        QVERIFY(channel.open());
+
+        // The channel goes away after the job has been created, but before it starts
+        auto job = new ItemRetrievalJob(retrievalRequest(), nullptr);
+        job->setChannel(channel.connection());
+        job->setInterface(&iface);
+        std::optional<std::optional<QString>> errorMsg;
+        connect(job, &AbstractItemRetrievalJob::requestCompleted, this, [&errorMsg](AbstractItemRetrievalJob *job) {
+            errorMsg = job->result().errorMsg;
+        });
+        channel.close();
+        job->start();
+
+        QTRY_VERIFY(errorMsg.has_value());
+        QVERIFY(!errorMsg->has_value());
+        QCOMPARE(resource.requestedItems, retrievalRequest().ids);
+    }
+};
+
+AKTEST_FAKESERVER_MAIN(RetrievalChannelHandlerTest)
+
+#include "retrievalchannelhandlertest.moc"
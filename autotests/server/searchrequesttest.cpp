@@ -0,0 +1,256 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QObject>
+
+#include "abstractsearchplugin.h"
+#include "dbinitializer.h"
+#include "entities.h"
+#include "fakeakonadiserver.h"
+#include "fakeconnection.h"
+#include "fakesearchmanager.h"
+#include "private/dbus_p.h"
+#include "search/searchrequest.h"
+#include "search/searchtaskmanager.h"
+#include "shared/aktest.h"
+
+#include <QDBusConnection>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QScopeGuard>
+#include <QSemaphore>
+#include <QTest>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+using namespace std::chrono_literals;
+
+namespace
+{
+const QString resourceId = QStringLiteral("akonadi_fake_search_resource_0");
+
+class FakeSearchPlugin : public AbstractSearchPlugin
+{
+public:
+    explicit FakeSearchPlugin(std::function<QSet<qint64>()> search)
+        : mSearch(std::move(search))
+    {
+    }
+
+    QSet<qint64> search(const QString &query, const QList<qint64> &collections, const QStringList &mimeTypes) override
+    {
+        Q_UNUSED(query)
+        Q_UNUSED(collections)
+        Q_UNUSED(mimeTypes)
+        return mSearch();
+    }
+
+private:
+    std::function<QSet<qint64>()> mSearch;
+};
+
+/// The parts of the AgentManager interface of akonadi_control that SearchTaskManager uses
+class FakeAgentManager : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Akonadi.AgentManager")
+
+public Q_SLOTS:
+    bool agentInstanceOnline(const QString &identifier)
+    {
+        Q_UNUSED(identifier)
+        return true;
+    }
+
+    int agentInstanceStatus(const QString &identifier)
+    {
+        Q_UNUSED(identifier)
+        return 0; // Idle
+    }
+};
+
+/// The search interface of a resource
+class FakeSearchAgent : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Akonadi.Agent.Search")
+
+public:
+    QList<qlonglong> collections;
+    QByteArray searchId;
+    std::atomic_int searches = 0;
+
+public Q_SLOTS:
+    void search(const QByteArray &searchId, const QString &query, qlonglong collection)
+    {
+        Q_UNUSED(query)
+        this->searchId = searchId;
+        collections.push_back(collection);
+        ++searches;
+    }
+};
+
+} // namespace
+
+class SearchRequestTest : public QObject
+{
+    Q_OBJECT
+
+    FakeAkonadiServer mAkonadi;
+    std::unique_ptr<DbInitializer> mDbInitializer;
+    Collection mCollection;
+
+public:
+    SearchRequestTest()
+    {
+        mAkonadi.setPopulateDb(false);
+        mAkonadi.init();
+
+        mDbInitializer = std::make_unique<DbInitializer>();
+        mDbInitializer->createResource(resourceId.toLatin1().constData());
+        mCollection = mDbInitializer->createCollection("col1");
+    }
+
+    FakeSearchManager &searchManager()
+    {
+        return static_cast<FakeSearchManager &>(mAkonadi.searchManager());
+    }
+
+private Q_SLOTS:
+    void cleanup()
+    {
+        searchManager().setSearchPlugins({});
+    }
+
+    void testPluginsInParallel()
+    {
+        // The second plugin only returns once the results of the first one have been emitted
+        QSemaphore emitted;
+        FakeSearchPlugin fast([]() {
+            return QSet<qint64>{1, 2};
+        });
+        FakeSearchPlugin slow([&emitted]() {
+            return emitted.tryAcquire(1, 5000) ? QSet<qint64>{3} : QSet<qint64>{};
+        });
+        searchManager().setSearchPlugins({&fast, &slow});
+
+        SearchRequest request("searchrequesttest", searchManager(), mAkonadi.agentSearchManager());
+        request.setCollections({mCollection.id()});
+        request.setStoreResults(true);
+        QList<QSet<qint64>> results;
+        connect(&request, &SearchRequest::resultsAvailable, this, [&](const QSet<qint64> &ids) {
+            results.push_back(ids);
+            emitted.release();
+        });
+        request.exec();
+
+        QCOMPARE(results, (QList<QSet<qint64>>{{1, 2}, {3}}));
+        QCOMPARE(request.results(), (QSet<qint64>{1, 2, 3}));
+    }
+
+    void testPluginTimeout()
+    {
+        QSemaphore hanging;
+        FakeSearchPlugin hangingPlugin([&hanging]() {
+            hanging.acquire();
+            return QSet<qint64>{1};
+        });
+        FakeSearchPlugin plugin([]() {
+            return QSet<qint64>{2};
+        });
+        const auto release = qScopeGuard([this, &hanging]() {
+            // The plugin must not be destroyed while it is still running
+            hanging.release();
+            searchManager().searchPool()->waitForDone();
+        });
+        searchManager().setSearchPlugins({&hangingPlugin, &plugin});
+
+        SearchRequest request("searchrequesttest", searchManager(), mAkonadi.agentSearchManager());
+        request.setCollections({mCollection.id()});
+        request.setStoreResults(true);
+        request.setPluginTimeout(200ms);
+        QElapsedTimer timer;
+        timer.start();
+        request.exec();
+
+        // The results of the hanging plugin are dropped
+        QVERIFY(timer.elapsed() < 5000);
+        QCOMPARE(request.results(), QSet<qint64>{2});
+    }
+
+    void testPluginsAndAgents()
+    {
+        auto bus = QDBusConnection::sessionBus();
+        if (!bus.isConnected()) {
+            QSKIP("No D-Bus session bus");
+        }
+
+        FakeAgentManager agentManager;
+        FakeSearchAgent agent;
+        const auto unregister = qScopeGuard([&bus]() {
+            bus.unregisterService(DBus::agentServiceName(resourceId, DBus::Agent));
+            bus.unregisterObject(QStringLiteral("/Search"));
+            bus.unregisterService(DBus::serviceName(DBus::Control));
+            bus.unregisterObject(QStringLiteral("/AgentManager"));
+        });
+        if (!bus.registerObject(QStringLiteral("/AgentManager"), &agentManager, QDBusConnection::ExportAllSlots)
+            || !bus.registerService(DBus::serviceName(DBus::Control))) {
+            QSKIP("Failed to register the fake AgentManager");
+        }
+        QVERIFY(bus.registerObject(QStringLiteral("/Search"), &agent, QDBusConnection::ExportAllSlots));
+        QVERIFY(bus.registerService(DBus::agentServiceName(resourceId, DBus::Agent)));
+
+        SearchTaskManager &agentSearchManager = mAkonadi.agentSearchManager();
+        agentSearchManager.registerInstance(resourceId);
+        const auto unregisterInstance = qScopeGuard([&agentSearchManager]() {
+            agentSearchManager.unregisterInstance(resourceId);
+        });
+
+        // The plugin only returns once the agent has been asked
+        FakeSearchPlugin plugin([&agent]() {
+            const QDeadlineTimer deadline(5s);
+            while (agent.searches == 0 && !deadline.hasExpired()) {
+                QThread::msleep(10);
+            }
+            return QSet<qint64>{1};
+        });
+        searchManager().setSearchPlugins({&plugin});
+
+        // The agent is called over D-Bus, so the search must not block the event loop
+        SearchRequest request("searchrequesttest", searchManager(), agentSearchManager);
+        request.setCollections({mCollection.id()});
+        request.setRemoteSearch(true);
+        request.setStoreResults(true);
+        std::unique_ptr<QThread> thread(QThread::create([&request]() {
+            request.exec();
+        }));
+        thread->start();
+        const auto join = qScopeGuard([&thread]() {
+            thread->wait();
+        });
+
+        QTRY_COMPARE(agent.collections, QList<qlonglong>{mCollection.id()});
+        QCOMPARE(agent.searchId, QByteArray("searchrequesttest"));
+
+        auto connection = AkThread::create<FakeConnection>(mAkonadi);
+        CommandContext context;
+        context.setResource(Resource::retrieveByName(resourceId));
+        connection->setContext(context);
+        agentSearchManager.pushResults(agent.searchId, {2}, connection.get());
+
+        QTRY_VERIFY(thread->isFinished());
+        QCOMPARE(request.results(), (QSet<qint64>{1, 2}));
+    }
+};
+
+AKTEST_FAKESERVER_MAIN(SearchRequestTest)
+
+#include "searchrequesttest.moc"
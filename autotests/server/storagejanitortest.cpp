@@ -0,0 +1,133 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <QObject>
+
+#include "aktest.h"
+#include "dbinitializer.h"
+#include "entities.h"
+#include "fakeakonadiserver.h"
+#include "storagejanitor.h"
+
+#include <QTest>
+
+#include <algorithm>
+#include <limits>
+
+using namespace Akonadi::Server;
+
+class StorageJanitorTest : public QObject
+{
+    Q_OBJECT
+
+    using Chunks = QList<std::pair<qint64, qint64>>;
+
+    /// Looks for missing external parts, and stops as if the server was quitting once a given ID was checked
+    class InterruptedJanitor : public StorageJanitor
+    {
+    public:
+        explicit InterruptedJanitor(qint64 interruptAfter = std::numeric_limits<qint64>::max())
+            : StorageJanitor(DbConfig::configuredDatabase())
+            , mInterruptAfter(interruptAfter)
+        {
+        }
+
+        void findMissingExternalParts(int chunkSize)
+        {
+            m_chunkSize = chunkSize;
+            OnlineTask task = *std::find_if(m_onlineTasks.cbegin(), m_onlineTasks.cend(), [](const OnlineTask &task) {
+                return task.key == missingExternalPartsKey();
+            });
+            task.func = static_cast<void (StorageJanitor::*)(DataStore *, qint64, qint64)>(&InterruptedJanitor::findMissingExternalPartsInChunk);
+            runOnlineTask(task);
+        }
+
+        qint64 checkpoint()
+        {
+            return loadCheckpoint(missingExternalPartsKey());
+        }
+
+        void resetCheckpoint()
+        {
+            saveCheckpoint(missingExternalPartsKey(), 0);
+        }
+
+        Chunks chunks;
+
+    private:
+        static QString missingExternalPartsKey()
+        {
+            return QStringLiteral("MissingExternalParts");
+        }
+
+        void findMissingExternalPartsInChunk(DataStore *store, qint64 fromId, qint64 toId)
+        {
+            chunks.push_back({fromId, toId});
+            findMissingExternalPartsInRange(store, fromId, toId);
+            if (toId >= mInterruptAfter) {
+                m_quitting = true;
+            }
+        }
+
+        const qint64 mInterruptAfter;
+    };
+
+    FakeAkonadiServer mAkonadi;
+
+public:
+    StorageJanitorTest()
+    {
+        mAkonadi.setPopulateDb(false);
+        mAkonadi.init();
+    }
+
+private Q_SLOTS:
+    void testResumeInterruptedCheck()
+    {
+        DbInitializer initializer;
+        initializer.createResource("testresource");
+        const Collection col = initializer.createCollection("col1");
+        Part::List parts;
+        for (int i = 0; i < 3; ++i) {
+            const PimItem item = initializer.createItem(QByteArray("item" + QByteArray::number(i)).constData(), col);
+            Part part = initializer.createPart(item.id(), "PLD:DATA", "missing_external_part_" + QByteArray::number(i));
+            part.setStorage(Part::External);
+            QVERIFY(part.update());
+            parts.push_back(part);
+        }
+        const int chunkSize = parts[1].id();
+
+        // Interrupted after the chunk with the first two parts
+        {
+            InterruptedJanitor janitor(parts[1].id());
+            janitor.resetCheckpoint();
+            janitor.findMissingExternalParts(chunkSize);
+            QCOMPARE(janitor.chunks, (Chunks{{1, chunkSize}}));
+            QCOMPARE(janitor.checkpoint(), parts[1].id());
+        }
+        for (const Part &part : {parts[0], parts[1]}) {
+            const Part cleared = Part::retrieveById(part.id());
+            QCOMPARE(cleared.storage(), Part::Internal);
+            QVERIFY(cleared.data().isEmpty());
+        }
+        QCOMPARE(Part::retrieveById(parts[2].id()).storage(), Part::External);
+        QCOMPARE(Part::retrieveById(parts[2].id()).data(), parts[2].data());
+
+        // The next run continues after the checkpoint, and starts over once it is done
+        {
+            InterruptedJanitor janitor;
+            janitor.findMissingExternalParts(chunkSize);
+            QCOMPARE(janitor.chunks, (Chunks{{chunkSize + 1, 2 * chunkSize}}));
+            QCOMPARE(janitor.checkpoint(), 0);
+        }
+        QCOMPARE(Part::retrieveById(parts[2].id()).storage(), Part::Internal);
+        QVERIFY(Part::retrieveById(parts[2].id()).data().isEmpty());
+    }
+};
+
+AKTEST_MAIN(StorageJanitorTest)
+
+#include "storagejanitortest.moc"
@@ -224,6 +224,30 @@ void AgentBase::ObserverV3::itemsUnlinked(const Akonadi::Item::List &items, cons
     }
 }
 
+void AgentBase::ObserverV4::itemsAdded(const Akonadi::Item::List &items, const Collection &collection)
+{
+    Q_UNUSED(items)
+    Q_UNUSED(collection)
+
+    if (sAgentBase) {
+        // not implementation, let's disconnect the signal to enable optimizations in Monitor
+        QObject::disconnect(sAgentBase->changeRecorder(), &Monitor::itemsAdded, sAgentBase->d_ptr.get(), &AgentBasePrivate::itemsAdded);
+        sAgentBase->d_ptr->changeProcessed();
+    }
+}
+
+void AgentBase::ObserverV4::itemsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &partIdentifiers)
+{
+    Q_UNUSED(items)
+    Q_UNUSED(partIdentifiers)
+
+    if (sAgentBase) {
+        // not implementation, let's disconnect the signal to enable optimizations in Monitor
+        QObject::disconnect(sAgentBase->changeRecorder(), &Monitor::itemsChanged, sAgentBase->d_ptr.get(), &AgentBasePrivate::itemsChanged);
+        sAgentBase->d_ptr->changeProcessed();
+    }
+}
+
 AgentBase::TagObserver::TagObserver() = default;
 
 AgentBase::TagObserver::~TagObserver() = default;
@@ -546,6 +570,36 @@ void AgentBasePrivate::itemsUnlinked(const Akonadi::Item::List &items, const Ako
     }
 }
 
+void AgentBasePrivate::itemsAdded(const Akonadi::Item::List &items, const Akonadi::Collection &collection)
+{
+    if (!mObserver) {
+        changeProcessed();
+        return;
+    }
+
+    auto observer4 = dynamic_cast<AgentBase::ObserverV4 *>(mObserver);
+    if (observer4) {
+        observer4->itemsAdded(items, collection);
+    } else {
+        Q_ASSERT_X(false, Q_FUNC_INFO, "Batch slots must never be called when ObserverV4 is not available");
+    }
+}
+
+void AgentBasePrivate::itemsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &partIdentifiers)
+{
+    if (!mObserver) {
+        changeProcessed();
+        return;
+    }
+
+    auto observer4 = dynamic_cast<AgentBase::ObserverV4 *>(mObserver);
+    if (observer4) {
+        observer4->itemsChanged(items, partIdentifiers);
+    } else {
+        Q_ASSERT_X(false, Q_FUNC_INFO, "Batch slots must never be called when ObserverV4 is not available");
+    }
+}
+
 void AgentBasePrivate::tagAdded(const Akonadi::Tag &tag)
 {
     if (auto tagObserver = dynamic_cast<AgentBase::TagObserver *>(mObserver); tagObserver) {
@@ -907,6 +961,21 @@ void AgentBase::setNeedsNetwork(bool needsNetwork)
     });
 }
 
+void AgentBase::setReplayBatchSize(int size)
+{
+    Q_D(AgentBase);
+    d->mReplayBatchSize = qMax(1, size);
+    if (dynamic_cast<AgentBase::ObserverV4 *>(d->mObserver)) {
+        d->mChangeRecorder->setReplayBatchSize(d->mReplayBatchSize);
+    }
+}
+
+int AgentBase::replayBatchSize() const
+{
+    Q_D(const AgentBase);
+    return d->mReplayBatchSize;
+}
+
 void AgentBase::setOnline(bool state)
 {
     Q_D(AgentBase);
@@ -1100,6 +1169,7 @@ void AgentBase::registerObserver(Observer *observer)
     d->mObserver = observer;
 
     const bool hasObserverV3 = (dynamic_cast<AgentBase::ObserverV3 *>(d->mObserver) != nullptr);
+    const bool hasObserverV4 = (dynamic_cast<AgentBase::ObserverV4 *>(d->mObserver) != nullptr);
     const bool hasTagObserver = (dynamic_cast<AgentBase::TagObserver *>(d->mObserver) != nullptr);
 
     disconnect(d->mChangeRecorder, &Monitor::tagAdded, d, &AgentBasePrivate::tagAdded);
@@ -1115,6 +1185,10 @@ void AgentBase::registerObserver(Observer *observer)
     disconnect(d->mChangeRecorder, &Monitor::itemRemoved, d, &AgentBasePrivate::itemRemoved);
     disconnect(d->mChangeRecorder, &Monitor::itemLinked, d, &AgentBasePrivate::itemLinked);
     disconnect(d->mChangeRecorder, &Monitor::itemUnlinked, d, &AgentBasePrivate::itemUnlinked);
+    disconnect(d->mChangeRecorder, &Monitor::itemsAdded, d, &AgentBasePrivate::itemsAdded);
+    disconnect(d->mChangeRecorder, &Monitor::itemsChanged, d, &AgentBasePrivate::itemsChanged);
+    disconnect(d->mChangeRecorder, &Monitor::itemAdded, d, &AgentBasePrivate::itemAdded);
+    disconnect(d->mChangeRecorder, &Monitor::itemChanged, d, &AgentBasePrivate::itemChanged);
 
     if (hasTagObserver) {
         connect(d->mChangeRecorder, &Monitor::tagAdded, d, &AgentBasePrivate::tagAdded);
@@ -1141,6 +1215,17 @@ void AgentBase::registerObserver(Observer *observer)
         connect(d->mChangeRecorder, &Monitor::itemLinked, d, &AgentBasePrivate::itemLinked);
         connect(d->mChangeRecorder, &Monitor::itemUnlinked, d, &AgentBasePrivate::itemUnlinked);
     }
+
+    if (hasObserverV4) {
+        connect(d->mChangeRecorder, &Monitor::itemsAdded, d, &AgentBasePrivate::itemsAdded);
+        connect(d->mChangeRecorder, &Monitor::itemsChanged, d, &AgentBasePrivate::itemsChanged);
+        d->mChangeRecorder->setReplayBatchSize(d->mReplayBatchSize);
+    } else {
+        // V3 and older - don't connect these if we have V4
+        connect(d->mChangeRecorder, &Monitor::itemAdded, d, &AgentBasePrivate::itemAdded);
+        connect(d->mChangeRecorder, &Monitor::itemChanged, d, &AgentBasePrivate::itemChanged);
+        d->mChangeRecorder->setReplayBatchSize(1);
+    }
 }
 
 QString AgentBase::identifier() const
@@ -348,6 +348,40 @@ public:
         virtual void itemsUnlinked(const Akonadi::Item::List &items, const Akonadi::Collection &collection);
     };
 
+    /**
+     * BC extension of ObserverV3 with support for batch replay of item additions and changes
+     *
+     * Recorded additions of items to the same collection and recorded changes of the same
+     * parts of different items are replayed in batches of up to replayBatchSize() items.
+     * A single call to changeProcessed() (or ResourceBase::changesCommitted()) marks the
+     * whole batch as processed.
+     *
+     * @warning When using ObserverV4, you will never get notifications about item
+     * additions and changes via Observer::itemAdded() and Observer::itemChanged(), even
+     * when you don't reimplement itemsAdded() and itemsChanged()!
+     *
+     * @since 6.4
+     */
+    class AKONADIAGENTBASE_EXPORT ObserverV4 : public ObserverV3 // krazy:exclude=dpointer
+    {
+    public:
+        /**
+         * Reimplement to handle batch notifications about items addition.
+         *
+         * @param items List of added items
+         * @param collection Collection to which the items have been added
+         */
+        virtual void itemsAdded(const Akonadi::Item::List &items, const Akonadi::Collection &collection);
+
+        /**
+         * Reimplement to handle batch notifications about items changes.
+         *
+         * @param items List of changed items
+         * @param partIdentifiers The identifiers of the item parts that have been changed in all @p items
+         */
+        virtual void itemsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &partIdentifiers);
+    };
+
     class AKONADIAGENTBASE_EXPORT TagObserver
     {
     public:
@@ -728,6 +762,24 @@ protected:
      */
     void setNeedsNetwork(bool needsNetwork);
 
+    /**
+     * Sets the maximum number of items replayed in a single ObserverV4::itemsAdded()
+     * or ObserverV4::itemsChanged() call. Has no effect unless the registered observer
+     * is an ObserverV4.
+     *
+     * @param size the maximum number of items in a batch, defaults to 500
+     * @see ChangeRecorder::setReplayBatchSize()
+     * @since 6.4
+     */
+    void setReplayBatchSize(int size);
+
+    /**
+     * Returns the maximum number of items replayed in a single batch.
+     * @see setReplayBatchSize()
+     * @since 6.4
+     */
+    [[nodiscard]] int replayBatchSize() const;
+
     /**
      * Sets whether the agent shall be online or not.
      */
@@ -98,6 +98,7 @@ public:
     org::freedesktop::Akonadi::Tracer *mTracer = nullptr;
 
     AgentBase::Observer *mObserver = nullptr;
+    int mReplayBatchSize = 500;
     QDBusInterface *mPowerInterface = nullptr;
 
     QTimer *mTemporaryOfflineTimer = nullptr;
@@ -121,6 +122,8 @@ public Q_SLOTS:
     virtual void itemsRemoved(const Akonadi::Item::List &items);
     virtual void itemsLinked(const Akonadi::Item::List &items, const Akonadi::Collection &collection);
     virtual void itemsUnlinked(const Akonadi::Item::List &items, const Akonadi::Collection &collection);
+    virtual void itemsAdded(const Akonadi::Item::List &items, const Akonadi::Collection &collection);
+    virtual void itemsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &partIdentifiers);
 
     virtual void collectionAdded(const Akonadi::Collection &collection, const Akonadi::Collection &parent);
     virtual void collectionChanged(const Akonadi::Collection &collection);
@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "itemretrievalchannel_p.h"
+#include "akonadiagentbase_debug.h"
+#include "connection_p.h"
+
+#include "private/protocol_p.h"
+
+using namespace Akonadi;
+
+ItemRetrievalChannel::ItemRetrievalChannel(const QString &resourceId, QObject *parent)
+    : QObject(parent)
+    , mResourceId(resourceId)
+    , mCommandBuffer(this, "handleCommands")
+{
+    mConnection = new Connection(Connection::CommandConnection, mResourceId.toUtf8() + "-RetrievalChannel", &mCommandBuffer, this);
+    connect(mConnection, &Connection::socketDisconnected, this, [this]() {
+        mOpen = false;
+    });
+    mConnection->reconnect();
+}
+
+ItemRetrievalChannel::~ItemRetrievalChannel() = default;
+
+bool ItemRetrievalChannel::isOpen() const
+{
+    return mOpen;
+}
+
+void ItemRetrievalChannel::reconnect()
+{
+    mConnection->reconnect();
+}
+
+void ItemRetrievalChannel::sendReply(qint64 tag, const QString &errorMsg)
+{
+    auto response = Protocol::RetrieveItemsResponsePtr::create();
+    if (!errorMsg.isEmpty()) {
+        response->setError(1, errorMsg);
+    }
+    mConnection->sendCommand(tag, response);
+}
+
+void ItemRetrievalChannel::handleCommands()
+{
+    CommandBufferLocker lock(&mCommandBuffer);
+    CommandBufferNotifyBlocker notify(&mCommandBuffer);
+    while (!mCommandBuffer.isEmpty()) {
+        const auto command = mCommandBuffer.dequeue();
+        lock.unlock();
+        const auto &cmd = command.command;
+
+        if (cmd->isResponse()) {
+            const auto &response = Protocol::cmdCast<Protocol::Response>(cmd);
+            switch (cmd->type()) {
+            case Protocol::Command::Hello:
+                // Older servers don't know the retrieval channel, keep using D-Bus with them
+                if (response.isError() || Protocol::cmdCast<Protocol::HelloResponse>(cmd).protocolVersion() != Protocol::version()) {
+                    qCDebug(AKONADIAGENTBASE_LOG) << "Server does not support item retrieval channels";
+                    mConnection->closeConnection();
+                    break;
+                }
+                mConnection->sendCommand(++mLastTag,
+                                         Protocol::LoginCommandPtr::create(mResourceId.toUtf8() + "-RetrievalChannel", Protocol::LoginCommand::CompactEncoding));
+                break;
+            case Protocol::Command::Login:
+                if (response.isError()) {
+                    qCWarning(AKONADIAGENTBASE_LOG) << "Unable to log in the item retrieval channel:" << response.errorMessage();
+                    mConnection->closeConnection();
+                    break;
+                }
+                mConnection->sendCommand(++mLastTag, Protocol::OpenRetrievalChannelCommandPtr::create(mResourceId));
+                break;
+            case Protocol::Command::OpenRetrievalChannel:
+                if (response.isError()) {
+                    qCWarning(AKONADIAGENTBASE_LOG) << "Unable to open item retrieval channel:" << response.errorMessage();
+                    mConnection->closeConnection();
+                    break;
+                }
+                qCDebug(AKONADIAGENTBASE_LOG) << "Item retrieval channel for" << mResourceId << "is open";
+                mOpen = true;
+                break;
+            default:
+                qCWarning(AKONADIAGENTBASE_LOG) << "Received an unexpected response on item retrieval channel:" << Protocol::debugString(cmd);
+                break;
+            }
+        } else if (cmd->type() == Protocol::Command::RetrieveItems) {
+            const auto &request = Protocol::cmdCast<Protocol::RetrieveItemsCommand>(cmd);
+            Q_EMIT itemsRequested(command.tag, request.items(), request.parts());
+        } else {
+            qCWarning(AKONADIAGENTBASE_LOG) << "Received an unexpected command on item retrieval channel:" << Protocol::debugString(cmd);
+        }
+
+        lock.relock();
+    }
+}
+
+#include "moc_itemretrievalchannel_p.cpp"
@@ -0,0 +1,71 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "commandbuffer_p.h"
+
+#include <QByteArrayList>
+#include <QObject>
+
+namespace Akonadi
+{
+class Connection;
+
+/// @cond PRIVATE
+
+/**
+ * @internal
+ *
+ * A dedicated connection to the Akonadi server over which the server sends
+ * item retrieval requests to the resource, instead of calling
+ * requestItemDelivery() over D-Bus.
+ *
+ * Each request is answered with sendReply() once the requested parts have
+ * been stored, using the tag the request was received with. As long as the
+ * channel is not open, the server keeps using D-Bus.
+ */
+class ItemRetrievalChannel : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ItemRetrievalChannel(const QString &resourceId, QObject *parent = nullptr);
+    ~ItemRetrievalChannel() override;
+
+    /**
+     * Returns whether the server accepted this connection as retrieval channel.
+     */
+    [[nodiscard]] bool isOpen() const;
+
+    /**
+     * Answers the retrieval request received with @p tag. An empty @p errorMsg
+     * indicates success.
+     */
+    void sendReply(qint64 tag, const QString &errorMsg);
+
+public Q_SLOTS:
+    /**
+     * (Re)connects to the server, e.g. after it has been restarted.
+     */
+    void reconnect();
+
+Q_SIGNALS:
+    void itemsRequested(qint64 tag, const QList<qint64> &uids, const QByteArrayList &parts);
+
+private Q_SLOTS:
+    void handleCommands();
+
+private:
+    const QString mResourceId;
+    CommandBuffer mCommandBuffer;
+    Connection *mConnection = nullptr;
+    qint64 mLastTag = 0;
+    bool mOpen = false;
+};
+
+/// @endcond
+
+} // namespace Akonadi
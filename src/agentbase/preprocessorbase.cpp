@@ -8,6 +8,7 @@
 
 #include "preprocessorbase.h"
 
+#include "akonadiagentbase_debug.h"
 #include "preprocessorbase_p.h"
 
 using namespace Akonadi;
@@ -33,6 +34,47 @@ void PreprocessorBase::finishProcessing(ProcessingResult result)
     Q_EMIT d->itemProcessed(d->mDelayedProcessingItemId);
 }
 
+void PreprocessorBase::finishProcessing(const QList<ProcessingResult> &results)
+{
+    Q_D(PreprocessorBase);
+
+    Q_ASSERT_X(!results.contains(ProcessingDelayed), "PreprocessorBase::finishProcessing", "You should never pass ProcessingDelayed to this function");
+    Q_ASSERT_X(d->mInDelayedBatchProcessing, "PreprocessorBase::finishProcessing", "finishProcessing() called while not in delayed batch processing mode");
+
+    d->mInDelayedBatchProcessing = false;
+    d->finishBatch(results);
+}
+
+QList<PreprocessorBase::ProcessingResult> PreprocessorBase::processItems(const Item::List &items)
+{
+    QList<ProcessingResult> results;
+    results.reserve(items.size());
+    for (const Item &item : items) {
+        ProcessingResult result = processItem(item);
+        if (result == ProcessingDelayed) {
+            qCWarning(AKONADIAGENTBASE_LOG) << "PreprocessorBase: processItem() returned ProcessingDelayed for item" << item.id()
+                                            << "while processing a batch, reimplement processItems() to process batches asynchronously";
+            result = ProcessingFailed;
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+void PreprocessorBase::setMaximumBatchSize(int size)
+{
+    Q_D(PreprocessorBase);
+
+    d->mMaximumBatchSize = qMax(1, size);
+}
+
+int PreprocessorBase::maximumBatchSize() const
+{
+    Q_D(const PreprocessorBase);
+
+    return d->mMaximumBatchSize;
+}
+
 void PreprocessorBase::setFetchScope(const ItemFetchScope &fetchScope)
 {
     Q_D(PreprocessorBase);
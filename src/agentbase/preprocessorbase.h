@@ -33,6 +33,9 @@ class PreprocessorBasePrivate;
  * is visible in the Akonadi storage system.
  *
  * The method all the preprocessors must implement is processItem().
+ * Preprocessors that can handle several items at once more efficiently
+ * (for example spam filters that train or query in bulk) should also
+ * reimplement processItems() and raise the setMaximumBatchSize().
  *
  * @author Szymon Stefanek <s.stefanek@gmail.com>
  * @since 4.4
@@ -99,6 +102,26 @@ public:
      */
     virtual ProcessingResult processItem(const Item &item) = 0;
 
+    /**
+     * Processes several newly created @p items at once.
+     *
+     * This is only called when the maximumBatchSize() is larger than 1. Items
+     * that were removed before they could be fetched are not passed in, the
+     * server will consider them failed.
+     *
+     * The method should return the result for each of the @p items, in the same
+     * order. If processing is implemented asynchronously it should return an
+     * empty list and call finishProcessing(const QList<ProcessingResult> &)
+     * once done.
+     *
+     * The default implementation calls processItem() for each item, which must
+     * not return ProcessingDelayed in that case.
+     *
+     * @param items the items to process
+     * @since 6.4
+     */
+    virtual QList<ProcessingResult> processItems(const Item::List &items);
+
     /**
      * This method must be called if processing is implemented asynchronously.
      * @param result the processing result
@@ -112,6 +135,37 @@ public:
      */
     void finishProcessing(ProcessingResult result);
 
+    /**
+     * This method must be called if processItems() was implemented asynchronously.
+     * @param results the processing result of each of the items passed to processItems(),
+     *                in the same order
+     *
+     * Valid values in @p results are the same as for finishProcessing(ProcessingResult).
+     *
+     * @since 6.4
+     */
+    void finishProcessing(const QList<ProcessingResult> &results);
+
+    /**
+     * Sets the maximum number of items the server passes to processItems()
+     * at once. The server may pass fewer items, depending on how many arrived
+     * and on its own configuration.
+     *
+     * The default is 1, which means that only processItem() is used.
+     *
+     * @param size The maximum number of items per batch.
+     * @since 6.4
+     */
+    void setMaximumBatchSize(int size);
+
+    /**
+     * Returns the maximum number of items the server passes to processItems() at once.
+     *
+     * @see setMaximumBatchSize()
+     * @since 6.4
+     */
+    [[nodiscard]] int maximumBatchSize() const;
+
     /**
      * Sets the item fetch scope.
      *
@@ -9,6 +9,7 @@
 #include "preprocessoradaptor.h"
 #include "servermanager.h"
 #include <QDBusConnection>
+#include <QHash>
 
 #include "akonadiagentbase_debug.h"
 #include "itemfetchjob.h"
@@ -44,6 +45,83 @@ void PreprocessorBasePrivate::beginProcessItem(qlonglong itemId, qlonglong colle
     connect(fetchJob, &ItemFetchJob::result, this, &PreprocessorBasePrivate::itemFetched);
 }
 
+void PreprocessorBasePrivate::beginProcessItems(const QList<qlonglong> &itemIds)
+{
+    qCDebug(AKONADIAGENTBASE_LOG) << "PreprocessorBase: about to process" << itemIds.size() << "items";
+
+    mBatchItemIds = itemIds;
+    mBatchProcessedItemIds.clear();
+
+    Item::List items;
+    items.reserve(itemIds.size());
+    for (qlonglong itemId : itemIds) {
+        items.push_back(Item(itemId));
+    }
+
+    auto fetchJob = new ItemFetchJob(items, this);
+    fetchJob->setFetchScope(mFetchScope);
+    connect(fetchJob, &ItemFetchJob::result, this, &PreprocessorBasePrivate::itemsFetched);
+}
+
+int PreprocessorBasePrivate::maximumBatchSize() const
+{
+    return mMaximumBatchSize;
+}
+
+void PreprocessorBasePrivate::itemsFetched(KJob *job)
+{
+    Q_Q(PreprocessorBase);
+
+    if (job->error()) {
+        qCWarning(AKONADIAGENTBASE_LOG) << "PreprocessorBase: failed to fetch items for processing:" << job->errorString();
+        finishBatch({});
+        return;
+    }
+
+    const Item::List items = qobject_cast<ItemFetchJob *>(job)->items();
+    if (items.isEmpty()) {
+        finishBatch({});
+        return;
+    }
+
+    for (const Item &item : items) {
+        mBatchProcessedItemIds.push_back(item.id());
+    }
+
+    const QList<PreprocessorBase::ProcessingResult> results = q->processItems(items);
+    if (results.isEmpty()) {
+        qCDebug(AKONADIAGENTBASE_LOG) << "PreprocessorBase: batch processing delayed";
+        mInDelayedBatchProcessing = true;
+        return;
+    }
+
+    finishBatch(results);
+}
+
+void PreprocessorBasePrivate::finishBatch(const QList<PreprocessorBase::ProcessingResult> &results)
+{
+    if (results.size() != mBatchProcessedItemIds.size()) {
+        qCWarning(AKONADIAGENTBASE_LOG) << "PreprocessorBase: got" << results.size() << "results for" << mBatchProcessedItemIds.size() << "processed items";
+    }
+
+    // Items that could not be fetched or have no result are reported as failed
+    QHash<qlonglong, int> processed;
+    for (qsizetype i = 0; i < qMin(results.size(), mBatchProcessedItemIds.size()); ++i) {
+        processed.insert(mBatchProcessedItemIds.at(i), results.at(i));
+    }
+    QList<int> batchResults;
+    batchResults.reserve(mBatchItemIds.size());
+    for (qlonglong itemId : std::as_const(mBatchItemIds)) {
+        batchResults.push_back(processed.value(itemId, PreprocessorBase::ProcessingFailed));
+    }
+
+    const QList<qlonglong> itemIds = std::exchange(mBatchItemIds, {});
+    mBatchProcessedItemIds.clear();
+
+    qCDebug(AKONADIAGENTBASE_LOG) << "PreprocessorBase: batch of" << itemIds.size() << "items processed, emitting signal";
+    Q_EMIT itemsProcessed(itemIds, batchResults);
+}
+
 void PreprocessorBasePrivate::itemFetched(KJob *job)
 {
     Q_Q(PreprocessorBase);
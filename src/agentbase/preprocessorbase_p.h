@@ -25,16 +25,27 @@ public:
     void delayedInit() override;
 
     void beginProcessItem(qlonglong itemId, qlonglong collectionId, const QString &mimeType);
+    void beginProcessItems(const QList<qlonglong> &itemIds);
+    int maximumBatchSize() const;
+
+    void finishBatch(const QList<PreprocessorBase::ProcessingResult> &results);
 
 Q_SIGNALS:
     void itemProcessed(qlonglong id);
+    void itemsProcessed(const QList<qlonglong> &ids, const QList<int> &results);
 
 private Q_SLOTS:
     void itemFetched(KJob *job);
+    void itemsFetched(KJob *job);
 
 public:
     bool mInDelayedProcessing = false;
     qlonglong mDelayedProcessingItemId = 0;
+    bool mInDelayedBatchProcessing = false;
+    int mMaximumBatchSize = 1;
+    // The batch requested by the server and the part of it passed to processItems()
+    QList<qlonglong> mBatchItemIds;
+    QList<qlonglong> mBatchProcessedItemIds;
     ItemFetchScope mFetchScope;
 
     Q_DECLARE_PUBLIC(PreprocessorBase)
@@ -11,6 +11,7 @@
 #include "akonadifull-version.h"
 #include "collectiondeletejob.h"
 #include "collectionsync_p.h"
+#include "itemretrievalchannel_p.h"
 #include "resourceadaptor.h"
 #include "resourcescheduler_p.h"
 #include "tagsync.h"
@@ -39,6 +40,7 @@
 #include "akonadiagentbase_debug.h"
 
 #include "shared/akranges.h"
+#include <algorithm>
 #include <cstdlib>
 #include <iterator>
 
@@ -107,6 +109,8 @@ public:
 
     void changeProcessed() override
     {
+        const ResourceScheduler::LaneScope scope(scheduler, changeReplayLane());
+
         if (m_recursiveMover) {
             m_recursiveMover->changeProcessed();
             QTimer::singleShot(0s, m_recursiveMover.data(), &RecursiveMover::replayNext);
@@ -135,6 +139,36 @@ public:
     void slotAttributeRetrievalCollectionFetchDone(KJob *job);
 
     void slotItemSyncDone(KJob *job);
+    void slotItemsRetrievalDone(KJob *job, ResourceScheduler::Lane lane);
+
+    ResourceScheduler::Lane fetchLane() const
+    {
+        return scheduler->laneForTaskType(ResourceScheduler::FetchItems);
+    }
+
+    ResourceScheduler::Lane changeReplayLane() const
+    {
+        return scheduler->laneForTaskType(ResourceScheduler::ChangeReplay);
+    }
+
+    ResourceScheduler::Lane itemsRetrievalLane(const Item::List &items) const
+    {
+        const ResourceScheduler::Lane lane = fetchLane();
+        if (lane == ResourceScheduler::DefaultLane || scheduler->hasLaneScope() || scheduler->currentTask(lane).type != ResourceScheduler::FetchItems) {
+            return scheduler->activeLane();
+        }
+        if (scheduler->currentTask(ResourceScheduler::DefaultLane).type != ResourceScheduler::SyncCollection) {
+            return lane;
+        }
+
+        // Both a collection sync and an item retrieval are in progress, the items
+        // belong to the retrieval if it requested all of them
+        const Item::List requested = scheduler->currentTask(lane).items;
+        const bool requestedItems = !items.isEmpty() && std::all_of(items.cbegin(), items.cend(), [&requested](const Item &item) {
+            return requested.contains(item);
+        });
+        return requestedItems ? lane : ResourceScheduler::DefaultLane;
+    }
 
     void slotPercent(KJob *job, quint64 percent);
     void slotDelayedEmitProgress();
@@ -157,11 +191,14 @@ public:
 
     void slotTagSyncDone(KJob *job);
 
+    void slotItemsRequested(qint64 tag, const QList<qint64> &uids, const QByteArrayList &parts);
+
     void slotSessionReconnected()
     {
         Q_Q(ResourceBase);
 
         new ResourceSelectJob(q->identifier());
+        mRetrievalChannel->reconnect();
     }
 
     void createItemSyncInstanceIfMissing()
@@ -228,6 +265,26 @@ protected Q_SLOTS:
         AgentBasePrivate::itemChanged(item, partIdentifiers);
     }
 
+    void itemsAdded(const Akonadi::Item::List &items, const Akonadi::Collection &collection) override
+    {
+        if (collection.remoteId().isEmpty()) {
+            changeProcessed();
+            return;
+        }
+        AgentBasePrivate::itemsAdded(items, collection);
+    }
+
+    void itemsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &partIdentifiers) override
+    {
+        const Item::List validItems = filterValidItems(items);
+        if (validItems.isEmpty()) {
+            changeProcessed();
+            return;
+        }
+
+        AgentBasePrivate::itemsChanged(validItems, partIdentifiers);
+    }
+
     void itemsFlagsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &addedFlags, const QSet<QByteArray> &removedFlags) override
     {
         if (addedFlags.isEmpty() && removedFlags.isEmpty()) {
@@ -346,7 +403,7 @@ protected Q_SLOTS:
             if (source.resource() == q_ptr->identifier()) { // moved away from us
                 AgentBasePrivate::collectionRemoved(collection);
             } else if (destination.resource() == q_ptr->identifier()) { // moved to us
-                scheduler->taskDone(); // stop change replay for now
+                scheduler->taskDone(changeReplayLane()); // stop change replay for now
                 auto mover = new RecursiveMover(this);
                 mover->setCollection(collection, destination);
                 scheduler->scheduleMoveReplay(collection, mover);
@@ -420,6 +477,7 @@ public:
     Collection currentCollection;
 
     ResourceScheduler *scheduler = nullptr;
+    ItemRetrievalChannel *mRetrievalChannel = nullptr;
     ItemSync *mItemSyncer = nullptr;
     ItemSync::TransactionMode mItemTransactionMode;
     ItemSync::MergeMode mItemMergeMode;
@@ -471,11 +529,13 @@ ResourceBase::ResourceBase(const QString &id)
     connect(d->scheduler, &ResourceScheduler::executeRecursiveMoveReplay, d, &ResourceBasePrivate::slotRecursiveMoveReplay);
     connect(d->scheduler, &ResourceScheduler::fullSyncComplete, this, &ResourceBase::synchronized);
     connect(d->scheduler, &ResourceScheduler::collectionTreeSyncComplete, this, &ResourceBase::collectionTreeSynchronized);
-    connect(d->mChangeRecorder, &ChangeRecorder::nothingToReplay, d->scheduler, &ResourceScheduler::taskDone);
+    connect(d->mChangeRecorder, &ChangeRecorder::nothingToReplay, d->scheduler, [d]() {
+        d->scheduler->taskDone(d->changeReplayLane());
+    });
     connect(d->mChangeRecorder, &Monitor::collectionRemoved, d->scheduler, &ResourceScheduler::collectionRemoved);
     connect(this, &ResourceBase::abortRequested, d, &ResourceBasePrivate::slotAbortRequested);
-    connect(this, &ResourceBase::synchronized, d->scheduler, &ResourceScheduler::taskDone);
-    connect(this, &ResourceBase::collectionTreeSynchronized, d->scheduler, &ResourceScheduler::taskDone);
+    connect(this, &ResourceBase::synchronized, d->scheduler, qOverload<>(&ResourceScheduler::taskDone));
+    connect(this, &ResourceBase::collectionTreeSynchronized, d->scheduler, qOverload<>(&ResourceScheduler::taskDone));
     connect(this, &AgentBase::agentNameChanged, this, &ResourceBase::nameChanged);
     connect(&d->mProgressEmissionCompressor, &QTimer::timeout, d, &ResourceBasePrivate::slotDelayedEmitProgress);
 
@@ -487,6 +547,10 @@ ResourceBase::ResourceBase(const QString &id)
     new ResourceSelectJob(identifier());
 
     connect(d->mChangeRecorder->session(), &Session::reconnected, d, &ResourceBasePrivate::slotSessionReconnected);
+
+    // Receive item retrieval requests over a dedicated connection rather than D-Bus
+    d->mRetrievalChannel = new ItemRetrievalChannel(identifier(), d);
+    connect(d->mRetrievalChannel, &ItemRetrievalChannel::itemsRequested, d, &ResourceBasePrivate::slotItemsRequested);
 }
 
 ResourceBase::~ResourceBase() = default;
@@ -575,6 +639,7 @@ void ResourceBasePrivate::slotAbortRequested()
 void ResourceBase::itemRetrieved(const Item &item)
 {
     Q_D(ResourceBase);
+    const ResourceScheduler::LaneScope scope(d->scheduler, d->fetchLane());
     Q_ASSERT(d->scheduler->currentTask().type == ResourceScheduler::FetchItem);
     if (!item.isValid()) {
         d->scheduler->itemFetchDone(i18nc("@info", "Invalid item retrieved"));
@@ -598,6 +663,7 @@ void ResourceBase::itemRetrieved(const Item &item)
 void ResourceBasePrivate::slotDeliveryDone(KJob *job)
 {
     Q_Q(ResourceBase);
+    const ResourceScheduler::LaneScope scope(scheduler, fetchLane());
     Q_ASSERT(scheduler->currentTask().type == ResourceScheduler::FetchItem);
     if (job->error()) {
         Q_EMIT q->error(i18nc("@info", "Error while creating item: %1", job->errorString()));
@@ -672,7 +738,7 @@ void ResourceBasePrivate::slotInvalidateCache(const Akonadi::Collection &collect
 {
     Q_Q(ResourceBase);
     auto job = new InvalidateCacheJob(collection, q);
-    connect(job, &KJob::result, scheduler, &ResourceScheduler::taskDone);
+    connect(job, &KJob::result, scheduler, qOverload<>(&ResourceScheduler::taskDone));
 }
 
 void ResourceBase::changeCommitted(const Item &item)
@@ -752,6 +818,25 @@ void ResourceBase::requestItemDelivery(const QList<qint64> &uids, const QByteArr
     d->scheduler->scheduleItemsFetch(items, partSet, message());
 }
 
+void ResourceBasePrivate::slotItemsRequested(qint64 tag, const QList<qint64> &uids, const QByteArrayList &parts)
+{
+    Q_Q(ResourceBase);
+    if (!q->isOnline()) {
+        const QString errorMsg = i18nc("@info", "Cannot fetch item in offline mode.");
+        mRetrievalChannel->sendReply(tag, errorMsg);
+        Q_EMIT q->error(errorMsg);
+        return;
+    }
+
+    const auto items = uids | Views::transform([](const auto uid) {
+                           return Item{uid};
+                       })
+        | Actions::toQVector;
+
+    const QSet<QByteArray> partSet = QSet<QByteArray>(parts.begin(), parts.end());
+    scheduler->scheduleItemsFetch(items, partSet, mRetrievalChannel, tag);
+}
+
 void ResourceBase::collectionsRetrieved(const Collection::List &collections)
 {
     Q_D(ResourceBase);
@@ -1021,6 +1106,7 @@ void ResourceBasePrivate::slotPrepareItemRetrieval(const Item &item)
 void ResourceBasePrivate::slotPrepareItemRetrievalResult(KJob *job)
 {
     Q_Q(ResourceBase);
+    const ResourceScheduler::LaneScope scope(scheduler, fetchLane());
     Q_ASSERT_X(scheduler->currentTask().type == ResourceScheduler::FetchItem,
                "ResourceBasePrivate::slotPrepareItemRetrievalResult()",
                "Preparing item retrieval although no item retrieval is in progress");
@@ -1063,6 +1149,7 @@ void ResourceBasePrivate::slotPrepareItemsRetrieval(const QList<Item> &items)
 void ResourceBasePrivate::slotPrepareItemsRetrievalResult(KJob *job)
 {
     Q_Q(ResourceBase);
+    const ResourceScheduler::LaneScope scope(scheduler, fetchLane());
     Q_ASSERT_X(scheduler->currentTask().type == ResourceScheduler::FetchItems,
                "ResourceBasePrivate::slotPrepareItemsRetrievalResult()",
                "Preparing items retrieval although no items retrieval is in progress");
@@ -1096,6 +1183,7 @@ void ResourceBasePrivate::slotRecursiveMoveReplay(RecursiveMover *mover)
 void ResourceBasePrivate::slotRecursiveMoveReplayResult(KJob *job)
 {
     Q_Q(ResourceBase);
+    const ResourceScheduler::LaneScope scope(scheduler, changeReplayLane());
     m_recursiveMover = nullptr;
 
     if (job->error()) {
@@ -1113,6 +1201,7 @@ void ResourceBase::itemsRetrievalDone()
     if (d->mItemSyncer) {
         d->mItemSyncer->deliveryDone();
     } else {
+        const ResourceScheduler::LaneScope scope(d->scheduler, d->itemsRetrievalLane({}));
         if (d->scheduler->currentTask().type == ResourceScheduler::FetchItems) {
             d->scheduler->currentTask().sendDBusReplies(QString());
         }
@@ -1173,7 +1262,9 @@ void ResourceBase::synchronizeTags()
 void ResourceBase::cancelTask()
 {
     Q_D(ResourceBase);
-    if (d->mCurrentCollectionFetchJob) {
+    const ResourceScheduler::Lane lane = d->scheduler->activeLane();
+    const ResourceScheduler::LaneScope scope(d->scheduler, lane);
+    if (lane == ResourceScheduler::DefaultLane && d->mCurrentCollectionFetchJob) {
         d->mCurrentCollectionFetchJob->kill();
         d->mCurrentCollectionFetchJob = nullptr;
     }
@@ -1214,13 +1305,27 @@ void ResourceBase::cancelTask(const QString &msg)
     Q_EMIT error(msg);
 }
 
+void ResourceBase::cancelItemsRetrieval(const QString &error)
+{
+    Q_D(ResourceBase);
+    const ResourceScheduler::LaneScope scope(d->scheduler, d->fetchLane());
+    cancelTask(error);
+}
+
+void ResourceBase::setConcurrentTasks(ConcurrentTasks tasks)
+{
+    Q_D(ResourceBase);
+    d->scheduler->setLaneEnabled(ResourceScheduler::FetchLane, tasks.testFlag(ConcurrentItemFetch));
+    d->scheduler->setLaneEnabled(ResourceScheduler::ChangeReplayLane, tasks.testFlag(ConcurrentChangeReplay));
+}
+
 void ResourceBase::deferTask()
 {
     Q_D(ResourceBase);
     qCDebug(AKONADIAGENTBASE_LOG) << "Deferring task" << d->scheduler->currentTask();
     // Deferring a CollectionSync is just not implemented.
     // We'd need to d->mItemSyncer->rollback() but also to NOT call taskDone in slotItemSyncDone() here...
-    Q_ASSERT(!d->mItemSyncer);
+    Q_ASSERT(!d->mItemSyncer || d->scheduler->activeLane() != ResourceScheduler::DefaultLane);
     d->scheduler->deferTask();
 }
 
@@ -1320,9 +1425,13 @@ void ResourceBase::setItemStreamingEnabled(bool enable)
 void ResourceBase::itemsRetrieved(const Item::List &items)
 {
     Q_D(ResourceBase);
+    const ResourceScheduler::Lane lane = d->itemsRetrievalLane(items);
+    const ResourceScheduler::LaneScope scope(d->scheduler, lane);
     if (d->scheduler->currentTask().type == ResourceScheduler::FetchItems) {
         auto trx = new TransactionSequence(this);
-        connect(trx, &KJob::result, d, &ResourceBasePrivate::slotItemSyncDone);
+        connect(trx, &KJob::result, d, [d, lane](KJob *job) {
+            d->slotItemsRetrievalDone(job, lane);
+        });
         for (const Item &item : items) {
             Q_ASSERT(item.parentCollection().isValid());
             if (item.isValid()) { // NOLINT(bugprone-branch-clone)
@@ -1366,6 +1475,19 @@ void ResourceBasePrivate::slotItemSyncDone(KJob *job)
     scheduler->taskDone();
 }
 
+void ResourceBasePrivate::slotItemsRetrievalDone(KJob *job, ResourceScheduler::Lane lane)
+{
+    Q_Q(ResourceBase);
+    const QString errorString = (job->error() && job->error() != Job::UserCanceled) ? job->errorString() : QString();
+    if (!errorString.isEmpty()) {
+        Q_EMIT q->error(errorString);
+    }
+    if (scheduler->currentTask(lane).type == ResourceScheduler::FetchItems) {
+        scheduler->currentTask(lane).sendDBusReplies(errorString);
+    }
+    scheduler->taskDone(lane);
+}
+
 void ResourceBasePrivate::slotDelayedEmitProgress()
 {
     Q_Q(ResourceBase);
@@ -1459,7 +1581,8 @@ bool ResourceBase::retrieveItems(const Akonadi::Item::List &items, const QSet<QB
 
     const qint64 id = d->scheduler->currentTask().serial;
     for (const auto &item : items) {
-        d->scheduler->scheduleItemFetch(item, parts, d->scheduler->currentTask().dbusMsgs, id);
+        const auto &currentTask = d->scheduler->currentTask();
+        d->scheduler->scheduleItemFetch(item, parts, currentTask.dbusMsgs, id, currentTask.retrievalChannel, currentTask.retrievalRequests);
     }
     taskDone();
     return true;
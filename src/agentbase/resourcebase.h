@@ -705,6 +705,56 @@ protected:
      */
     void setHierarchicalRemoteIdentifiersEnabled(bool enable);
 
+    /**
+     * Describes the kinds of tasks a resource can run while another task,
+     * e.g. a collection synchronization, is in progress.
+     *
+     * @see setConcurrentTasks()
+     * @since 6.4
+     */
+    enum ConcurrentTask {
+        NoConcurrentTasks = 0x0, ///< All tasks are executed one after another (the default)
+        ConcurrentItemFetch = 0x1, ///< Item retrieval requests (retrieveItems()) run without waiting for other tasks
+        ConcurrentChangeReplay = 0x2, ///< Local changes are replayed without waiting for other tasks
+    };
+    Q_DECLARE_FLAGS(ConcurrentTasks, ConcurrentTask)
+
+    /**
+     * Declares which tasks are safe to run concurrently with other tasks.
+     *
+     * Each kind of task gets its own lane in the scheduler, which executes one task
+     * of that kind at a time. All other tasks still run one after another. Within a
+     * lane, tasks keep their usual priorities.
+     *
+     * The resource must be able to serve the tasks independently, e.g. by using a
+     * separate connection to the backend for each of them. Tasks running concurrently
+     * must be completed through their dedicated methods: itemsRetrieved(),
+     * cancelItemsRetrieval() or the changeCommitted() family of methods. cancelTask(),
+     * deferTask() and taskDone() only refer to a concurrent task when called from
+     * within the retrieveItems() or change replay callback itself, otherwise they
+     * refer to the task that is not running concurrently.
+     *
+     * This should be called in the resource constructor as needed.
+     *
+     * @param tasks the tasks that may run concurrently
+     * @since 6.4
+     */
+    void setConcurrentTasks(ConcurrentTasks tasks);
+
+    /**
+     * Stops the execution of the current item retrieval request and reports
+     * @p error to the requester.
+     *
+     * This is equivalent to cancelTask(const QString &) for resources that do not
+     * enable ConcurrentItemFetch, but always refers to the item retrieval request even
+     * if another task is running at the same time.
+     *
+     * @param error the error message to be emitted
+     * @see setConcurrentTasks()
+     * @since 6.4
+     */
+    void cancelItemsRetrieval(const QString &error);
+
     friend class ResourceScheduler;
     friend class ::ResourceState;
 
@@ -819,6 +869,8 @@ private:
 
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(Akonadi::ResourceBase::ConcurrentTasks)
+
 #ifndef AKONADI_RESOURCE_MAIN
 /**
  * Convenience Macro for the most common main() function for Akonadi resources.
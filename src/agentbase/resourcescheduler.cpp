@@ -6,6 +6,7 @@
 
 #include "resourcescheduler_p.h"
 
+#include "itemretrievalchannel_p.h"
 #include "recursivemover_p.h"
 #include <QDBusConnection>
 
@@ -16,6 +17,8 @@
 #include <QDBusInterface>
 #include <QTimer>
 
+#include <algorithm>
+
 using namespace Akonadi;
 using namespace std::chrono_literals;
 qint64 ResourceScheduler::Task::latestSerial = 0;
@@ -33,7 +36,7 @@ void ResourceScheduler::scheduleFullSync()
     Task t;
     t.type = SyncAll;
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -46,7 +49,7 @@ void ResourceScheduler::scheduleCollectionTreeSync()
     Task t;
     t.type = SyncCollectionTree;
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -59,7 +62,7 @@ void ResourceScheduler::scheduleTagSync()
     Task t;
     t.type = SyncTags;
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -73,7 +76,7 @@ void ResourceScheduler::scheduleSync(const Collection &col)
     t.type = SyncCollection;
     t.collection = col;
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -88,7 +91,7 @@ void ResourceScheduler::scheduleAttributesSync(const Collection &collection)
     t.collection = collection;
 
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -96,7 +99,12 @@ void ResourceScheduler::scheduleAttributesSync(const Collection &collection)
     scheduleNext();
 }
 
-void ResourceScheduler::scheduleItemFetch(const Akonadi::Item &item, const QSet<QByteArray> &parts, const QList<QDBusMessage> &msgs, qint64 parentId)
+void ResourceScheduler::scheduleItemFetch(const Akonadi::Item &item,
+                                          const QSet<QByteArray> &parts,
+                                          const QList<QDBusMessage> &msgs,
+                                          qint64 parentId,
+                                          ItemRetrievalChannel *retrievalChannel,
+                                          const QList<qint64> &retrievalRequests)
 
 {
     Task t;
@@ -104,6 +112,8 @@ void ResourceScheduler::scheduleItemFetch(const Akonadi::Item &item, const QSet<
     t.items << item;
     t.itemParts = parts;
     t.dbusMsgs = msgs;
+    t.retrievalChannel = retrievalChannel;
+    t.retrievalRequests = retrievalRequests;
     t.argument = parentId;
 
     TaskList &queue = queueForTaskType(t.type);
@@ -114,28 +124,38 @@ void ResourceScheduler::scheduleItemFetch(const Akonadi::Item &item, const QSet<
 }
 
 void ResourceScheduler::scheduleItemsFetch(const Item::List &items, const QSet<QByteArray> &parts, const QDBusMessage &msg)
+{
+    itemsFetchTask(items, parts).dbusMsgs << msg;
+}
+
+void ResourceScheduler::scheduleItemsFetch(const Item::List &items, const QSet<QByteArray> &parts, ItemRetrievalChannel *channel, qint64 tag)
+{
+    Task &task = itemsFetchTask(items, parts);
+    task.retrievalChannel = channel;
+    task.retrievalRequests << tag;
+}
+
+ResourceScheduler::Task &ResourceScheduler::itemsFetchTask(const Item::List &items, const QSet<QByteArray> &parts)
 {
     Task t;
     t.type = FetchItems;
     t.items = items;
     t.itemParts = parts;
 
-    // if the current task does already fetch the requested item, break here but
-    // keep the dbus message, so we can send the reply later on
-    if (mCurrentTask == t) {
-        mCurrentTask.dbusMsgs << msg;
-        return;
+    // if the current task does already fetch the requested item, return it so that
+    // the caller can add its reply target, we will send the reply later on
+    Task &current = mCurrentTask[laneForTaskType(t.type)];
+    if (current == t) {
+        return current;
     }
 
     // If this task is already in the queue, merge with it.
     TaskList &queue = queueForTaskType(t.type);
     const int idx = queue.indexOf(t);
     if (idx != -1) {
-        queue[idx].dbusMsgs << msg;
-        return;
+        return queue[idx];
     }
 
-    t.dbusMsgs << msg;
     queue << t;
 
     QStringList ids;
@@ -144,7 +164,8 @@ void ResourceScheduler::scheduleItemsFetch(const Item::List &items, const QSet<Q
         ids.push_back(QString::number(item.id()));
     }
     signalTaskToTracker(t, "FetchItems", ids.join(QLatin1StringView(", ")));
-    scheduleNext();
+    scheduleNext(); // queued, the caller still gets to add its reply target
+    return queue.last();
 }
 
 void ResourceScheduler::scheduleResourceCollectionDeletion()
@@ -152,7 +173,7 @@ void ResourceScheduler::scheduleResourceCollectionDeletion()
     Task t;
     t.type = DeleteResourceCollection;
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -166,7 +187,7 @@ void ResourceScheduler::scheduleCacheInvalidation(const Collection &collection)
     t.type = InvalideCacheForCollection;
     t.collection = collection;
     TaskList &queue = queueForTaskType(t.type);
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
     queue << t;
@@ -196,7 +217,7 @@ void ResourceScheduler::scheduleMoveReplay(const Collection &movedCollection, Re
     t.argument = QVariant::fromValue(mover);
     TaskList &queue = queueForTaskType(t.type);
 
-    if (queue.contains(t) || mCurrentTask == t) {
+    if (queue.contains(t) || isCurrentTask(t)) {
         return;
     }
 
@@ -262,45 +283,118 @@ void Akonadi::ResourceScheduler::scheduleCustomTask(QObject *receiver,
     scheduleNext();
 }
 
-void ResourceScheduler::taskDone()
+void ResourceScheduler::setLaneEnabled(Lane lane, bool enabled)
 {
-    if (isEmpty()) {
-        Q_EMIT status(AgentBase::Idle, i18nc("@info:status Application ready for work", "Ready"));
+    if (lane == DefaultLane || mLaneEnabled[lane] == enabled) {
+        return;
     }
+    // Tasks already running in the lane are completed there, only the routing
+    // of new tasks changes.
+    mLaneEnabled[lane] = enabled;
+    scheduleNext();
+}
+
+ResourceScheduler::Lane ResourceScheduler::laneForTaskType(TaskType type) const
+{
+    switch (type) {
+    case FetchItem:
+    case FetchItems:
+        return mLaneEnabled[FetchLane] ? FetchLane : DefaultLane;
+    case ChangeReplay:
+    case RecursiveMoveReplay:
+        return mLaneEnabled[ChangeReplayLane] ? ChangeReplayLane : DefaultLane;
+    default:
+        return DefaultLane;
+    }
+}
+
+ResourceScheduler::Lane ResourceScheduler::activeLane() const
+{
+    if (mActiveLane >= 0) {
+        return static_cast<Lane>(mActiveLane);
+    }
+
+    int busyLane = -1;
+    for (int lane = 0; lane < NLaneCount; ++lane) {
+        if (mCurrentTask[lane].type != Invalid) {
+            if (busyLane != -1) {
+                // ambiguous, completions of tasks in other lanes are routed explicitly
+                return DefaultLane;
+            }
+            busyLane = lane;
+        }
+    }
+    return busyLane == -1 ? DefaultLane : static_cast<Lane>(busyLane);
+}
+
+bool ResourceScheduler::isCurrentTask(const Task &task) const
+{
+    return std::any_of(std::begin(mCurrentTask), std::end(mCurrentTask), [&task](const Task &current) {
+        return current == task;
+    });
+}
+
+bool ResourceScheduler::hasIdleLane() const
+{
+    for (int lane = 0; lane < NLaneCount; ++lane) {
+        if (mLaneEnabled[lane] && mCurrentTask[lane].type == Invalid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ResourceScheduler::taskDone()
+{
+    taskDone(activeLane());
+}
+
+void ResourceScheduler::taskDone(Lane lane)
+{
+    Task &current = mCurrentTask[lane];
 
     if (s_resourcetracker) {
-        const QList<QVariant> argumentList = {QString::number(mCurrentTask.serial), QString()};
+        const QList<QVariant> argumentList = {QString::number(current.serial), QString()};
         s_resourcetracker->asyncCallWithArgumentList(QStringLiteral("jobEnded"), argumentList);
     }
 
-    mCurrentTask = Task();
-    mCurrentTasksQueue = -1;
+    current = Task();
+    mCurrentTasksQueue[lane] = -1;
+
+    if (isEmpty() && std::none_of(std::begin(mCurrentTask), std::end(mCurrentTask), [](const Task &task) {
+            return task.type != Invalid;
+        })) {
+        Q_EMIT status(AgentBase::Idle, i18nc("@info:status Application ready for work", "Ready"));
+    }
+
     scheduleNext();
 }
 
 void ResourceScheduler::itemFetchDone(const QString &msg)
 {
-    Q_ASSERT(mCurrentTask.type == FetchItem);
+    const Lane lane = laneForTaskType(FetchItem);
+    Task &current = mCurrentTask[lane];
+    Q_ASSERT(current.type == FetchItem);
 
-    TaskList &queue = queueForTaskType(mCurrentTask.type);
+    TaskList &queue = queueForTaskType(current.type);
 
-    const qint64 parentId = mCurrentTask.argument.toLongLong();
+    const qint64 parentId = current.argument.toLongLong();
     // msg is empty, there was no error
     if (msg.isEmpty() && !queue.isEmpty()) {
         Task &nextTask = queue[0];
         // If the next task is FetchItem too...
-        if (nextTask.type != mCurrentTask.type || nextTask.argument.toLongLong() != parentId) {
+        if (nextTask.type != current.type || nextTask.argument.toLongLong() != parentId) {
             // If the next task is not FetchItem or the next FetchItem task has
             // different parentId then this was the last task in the series, so
             // send the DBus replies.
-            mCurrentTask.sendDBusReplies(msg);
+            current.sendDBusReplies(msg);
         }
     } else {
         // msg was not empty, there was an error.
         // remove all subsequent FetchItem tasks with the same parentId
         auto iter = queue.begin();
         while (iter != queue.end()) {
-            if (iter->type != mCurrentTask.type || iter->argument.toLongLong() == parentId) {
+            if (iter->type != current.type || iter->argument.toLongLong() == parentId) {
                 iter = queue.erase(iter);
                 continue;
             } else {
@@ -309,29 +403,34 @@ void ResourceScheduler::itemFetchDone(const QString &msg)
         }
 
         // ... and send DBus reply with the error message
-        mCurrentTask.sendDBusReplies(msg);
+        current.sendDBusReplies(msg);
     }
 
-    taskDone();
+    taskDone(lane);
 }
 
 void ResourceScheduler::deferTask()
 {
-    if (mCurrentTask.type == Invalid) {
+    deferTask(activeLane());
+}
+
+void ResourceScheduler::deferTask(Lane lane)
+{
+    if (mCurrentTask[lane].type == Invalid) {
         return;
     }
 
     if (s_resourcetracker) {
-        const QList<QVariant> argumentList = {QString::number(mCurrentTask.serial), QString()};
+        const QList<QVariant> argumentList = {QString::number(mCurrentTask[lane].serial), QString()};
         s_resourcetracker->asyncCallWithArgumentList(QStringLiteral("jobEnded"), argumentList);
     }
 
-    Task t = mCurrentTask;
-    mCurrentTask = Task();
+    Task t = mCurrentTask[lane];
+    mCurrentTask[lane] = Task();
 
-    Q_ASSERT(mCurrentTasksQueue >= 0 && mCurrentTasksQueue < NQueueCount);
-    mTaskList[mCurrentTasksQueue].prepend(t);
-    mCurrentTasksQueue = -1;
+    Q_ASSERT(mCurrentTasksQueue[lane] >= 0 && mCurrentTasksQueue[lane] < NQueueCount);
+    mTaskList[mCurrentTasksQueue[lane]].prepend(t);
+    mCurrentTasksQueue[lane] = -1;
 
     signalTaskToTracker(t, "DeferedTask");
 
@@ -350,7 +449,7 @@ bool ResourceScheduler::isEmpty()
 
 void ResourceScheduler::scheduleNext()
 {
-    if (mCurrentTask.type != Invalid || isEmpty() || !mOnline) {
+    if (!hasIdleLane() || isEmpty() || !mOnline) {
         return;
     }
     QTimer::singleShot(0s, this, &ResourceScheduler::executeNext);
@@ -358,24 +457,44 @@ void ResourceScheduler::scheduleNext()
 
 void ResourceScheduler::executeNext()
 {
-    if (mCurrentTask.type != Invalid || isEmpty()) {
-        return;
-    }
+    // Interactive lanes first, so that a sync started in the same round does not delay them
+    for (const Lane lane : {FetchLane, ChangeReplayLane, DefaultLane}) {
+        if (!mLaneEnabled[lane] || mCurrentTask[lane].type != Invalid) {
+            continue;
+        }
 
-    for (int i = 0; i < NQueueCount; ++i) {
-        if (!mTaskList[i].isEmpty()) {
-            mCurrentTask = mTaskList[i].takeFirst();
-            mCurrentTasksQueue = i;
-            break;
+        // Take the first task of the highest-priority queue that belongs to this lane. With
+        // only the DefaultLane enabled, this is simply the head of the first non-empty queue.
+        for (int i = 0; i < NQueueCount && mCurrentTask[lane].type == Invalid; ++i) {
+            TaskList &queue = mTaskList[i];
+            const auto it = std::find_if(queue.begin(), queue.end(), [this, lane](const Task &task) {
+                return laneForTaskType(task.type) == lane;
+            });
+            if (it != queue.end()) {
+                mCurrentTask[lane] = *it;
+                mCurrentTasksQueue[lane] = i;
+                queue.erase(it);
+            }
+        }
+
+        if (mCurrentTask[lane].type != Invalid) {
+            executeTask(lane);
         }
     }
+}
+
+void ResourceScheduler::executeTask(Lane lane)
+{
+    const LaneScope scope(this, lane);
+    // copy, the task may be completed synchronously by the receivers of the signals below
+    const Task task = mCurrentTask[lane];
 
     if (s_resourcetracker) {
-        const QList<QVariant> argumentList = {QString::number(mCurrentTask.serial)};
+        const QList<QVariant> argumentList = {QString::number(task.serial)};
         s_resourcetracker->asyncCallWithArgumentList(QStringLiteral("jobStarted"), argumentList);
     }
 
-    switch (mCurrentTask.type) {
+    switch (task.type) {
     case SyncAll:
         Q_EMIT executeFullSync();
         break;
@@ -383,31 +502,31 @@ void ResourceScheduler::executeNext()
         Q_EMIT executeCollectionTreeSync();
         break;
     case SyncCollection:
-        Q_EMIT executeCollectionSync(mCurrentTask.collection);
+        Q_EMIT executeCollectionSync(task.collection);
         break;
     case SyncCollectionAttributes:
-        Q_EMIT executeCollectionAttributesSync(mCurrentTask.collection);
+        Q_EMIT executeCollectionAttributesSync(task.collection);
         break;
     case SyncTags:
         Q_EMIT executeTagSync();
         break;
     case FetchItem:
-        Q_EMIT executeItemFetch(mCurrentTask.items.at(0), mCurrentTask.itemParts);
+        Q_EMIT executeItemFetch(task.items.at(0), task.itemParts);
         break;
     case FetchItems:
-        Q_EMIT executeItemsFetch(mCurrentTask.items, mCurrentTask.itemParts);
+        Q_EMIT executeItemsFetch(task.items, task.itemParts);
         break;
     case DeleteResourceCollection:
         Q_EMIT executeResourceCollectionDeletion();
         break;
     case InvalideCacheForCollection:
-        Q_EMIT executeCacheInvalidation(mCurrentTask.collection);
+        Q_EMIT executeCacheInvalidation(task.collection);
         break;
     case ChangeReplay:
         Q_EMIT executeChangeReplay();
         break;
     case RecursiveMoveReplay:
-        Q_EMIT executeRecursiveMoveReplay(mCurrentTask.argument.value<RecursiveMover *>());
+        Q_EMIT executeRecursiveMoveReplay(task.argument.value<RecursiveMover *>());
         break;
     case SyncAllDone:
         Q_EMIT fullSyncComplete();
@@ -416,27 +535,27 @@ void ResourceScheduler::executeNext()
         Q_EMIT collectionTreeSyncComplete();
         break;
     case Custom: {
-        const QByteArray methodSig = mCurrentTask.methodName + QByteArray("(QVariant)");
-        const bool hasSlotWithVariant = mCurrentTask.receiver->metaObject()->indexOfMethod(methodSig.constData()) != -1;
+        const QByteArray methodSig = task.methodName + QByteArray("(QVariant)");
+        const bool hasSlotWithVariant = task.receiver->metaObject()->indexOfMethod(methodSig.constData()) != -1;
         bool success = false;
         if (hasSlotWithVariant) {
-            success = QMetaObject::invokeMethod(mCurrentTask.receiver, mCurrentTask.methodName.constData(), Q_ARG(QVariant, mCurrentTask.argument));
-            Q_ASSERT_X(success || !mCurrentTask.argument.isValid(),
+            success = QMetaObject::invokeMethod(task.receiver, task.methodName.constData(), Q_ARG(QVariant, task.argument));
+            Q_ASSERT_X(success || !task.argument.isValid(),
                        "ResourceScheduler::executeNext",
                        "Valid argument was provided but the method wasn't found");
         }
         if (!success) {
-            success = QMetaObject::invokeMethod(mCurrentTask.receiver, mCurrentTask.methodName.constData());
+            success = QMetaObject::invokeMethod(task.receiver, task.methodName.constData());
         }
 
         if (!success) {
-            qCCritical(AKONADIAGENTBASE_LOG) << "Could not invoke slot" << mCurrentTask.methodName << "on" << mCurrentTask.receiver << "with argument"
-                                             << mCurrentTask.argument;
+            qCCritical(AKONADIAGENTBASE_LOG) << "Could not invoke slot" << task.methodName << "on" << task.receiver << "with argument"
+                                             << task.argument;
         }
         break;
     }
     default: {
-        qCCritical(AKONADIAGENTBASE_LOG) << "Unhandled task type" << mCurrentTask.type;
+        qCCritical(AKONADIAGENTBASE_LOG) << "Unhandled task type" << task.type;
         dump();
         Q_ASSERT(false);
     }
@@ -445,12 +564,22 @@ void ResourceScheduler::executeNext()
 
 ResourceScheduler::Task ResourceScheduler::currentTask() const
 {
-    return mCurrentTask;
+    return mCurrentTask[activeLane()];
 }
 
 ResourceScheduler::Task &ResourceScheduler::currentTask()
 {
-    return mCurrentTask;
+    return mCurrentTask[activeLane()];
+}
+
+ResourceScheduler::Task ResourceScheduler::currentTask(Lane lane) const
+{
+    return mCurrentTask[lane];
+}
+
+ResourceScheduler::Task &ResourceScheduler::currentTask(Lane lane)
+{
+    return mCurrentTask[lane];
 }
 
 void ResourceScheduler::setOnline(bool state)
@@ -462,11 +591,13 @@ void ResourceScheduler::setOnline(bool state)
     if (mOnline) {
         scheduleNext();
     } else {
-        if (mCurrentTask.type != Invalid) {
-            // abort running task
-            queueForTaskType(mCurrentTask.type).prepend(mCurrentTask);
-            mCurrentTask = Task();
-            mCurrentTasksQueue = -1;
+        // abort running tasks
+        for (int lane = 0; lane < NLaneCount; ++lane) {
+            if (mCurrentTask[lane].type != Invalid) {
+                queueForTaskType(mCurrentTask[lane].type).prepend(mCurrentTask[lane]);
+                mCurrentTask[lane] = Task();
+                mCurrentTasksQueue[lane] = -1;
+            }
         }
         // abort pending synchronous tasks, might take longer until the resource goes online again
         TaskList &itemFetchQueue = queueForTaskType(FetchItem);
@@ -487,7 +618,7 @@ void ResourceScheduler::setOnline(bool state)
                 lastTask = (*it);
                 it = itemFetchQueue.erase(it);
                 if (s_resourcetracker) {
-                    const QList<QVariant> argumentList = {QString::number(mCurrentTask.serial), i18nc("@info", "Job canceled.")};
+                    const QList<QVariant> argumentList = {QString::number(lastTask.serial), i18nc("@info", "Job canceled.")};
                     s_resourcetracker->asyncCallWithArgumentList(QStringLiteral("jobEnded"), argumentList);
                 }
             } else {
@@ -554,6 +685,12 @@ void ResourceScheduler::Task::sendDBusReplies(const QString &errorMsg)
         }
         QDBusConnection::sessionBus().send(reply);
     }
+
+    if (retrievalChannel) {
+        for (const qint64 tag : std::as_const(retrievalRequests)) {
+            retrievalChannel->sendReply(tag, errorMsg);
+        }
+    }
 }
 
 ResourceScheduler::QueueType ResourceScheduler::queueTypeForTaskType(TaskType type)
@@ -587,7 +724,21 @@ QString ResourceScheduler::dumpToString() const
     QString ret;
     QTextStream str(&ret);
     str << "ResourceScheduler: " << (mOnline ? "Online" : "Offline") << '\n';
-    str << " current task: " << mCurrentTask << '\n';
+    str << " current task: " << mCurrentTask[DefaultLane] << '\n';
+    static const char *const laneNames[NLaneCount] = {"default", "fetch", "change replay"};
+    for (int lane = DefaultLane + 1; lane < NLaneCount; ++lane) {
+        if (!mLaneEnabled[lane]) {
+            continue;
+        }
+        str << " " << laneNames[lane] << " lane current task: " << mCurrentTask[lane] << '\n';
+        for (int i = 0; i < NQueueCount; ++i) {
+            for (const Task &task : mTaskList[i]) {
+                if (laneForTaskType(task.type) == lane) {
+                    str << "  queued (queue " << i << "): " << task << '\n';
+                }
+            }
+        }
+    }
     for (int i = 0; i < NQueueCount; ++i) {
         const TaskList &queue = mTaskList[i];
         if (queue.isEmpty()) {
@@ -611,8 +762,10 @@ void ResourceScheduler::clear()
         TaskList &queue = mTaskList[i];
         queue.clear();
     }
-    mCurrentTask = Task();
-    mCurrentTasksQueue = -1;
+    for (int lane = 0; lane < NLaneCount; ++lane) {
+        mCurrentTask[lane] = Task();
+        mCurrentTasksQueue[lane] = -1;
+    }
 }
 
 void Akonadi::ResourceScheduler::cancelQueues()
@@ -13,9 +13,11 @@
 
 #include <QDBusMessage>
 #include <QObject>
+#include <QPointer>
 
 namespace Akonadi
 {
+class ItemRetrievalChannel;
 class RecursiveMover;
 
 /// @cond PRIVATE
@@ -51,6 +53,21 @@ public:
         Custom
     };
 
+    /**
+      Tasks are executed in lanes. Each lane runs at most one task at a time,
+      so tasks in different lanes may run concurrently.
+
+      Everything runs in the DefaultLane unless the resource declared that
+      a task type is safe to run alongside other tasks, see
+      ResourceBase::setConcurrentTasks().
+    */
+    enum Lane {
+        DefaultLane, // synchronization and everything else
+        FetchLane, // interactive item retrieval
+        ChangeReplayLane, // replaying local changes
+        NLaneCount
+    };
+
     class Task
     {
         static qint64 latestSerial;
@@ -67,6 +84,9 @@ public:
         QList<Item> items;
         QSet<QByteArray> itemParts;
         QList<QDBusMessage> dbusMsgs;
+        // Tags of the requests received over the retrieval channel
+        QList<qint64> retrievalRequests;
+        QPointer<ItemRetrievalChannel> retrievalChannel;
         QObject *receiver = nullptr;
         QByteArray methodName;
         QVariant argument;
@@ -80,8 +100,61 @@ public:
         }
     };
 
+    /**
+      Makes the active lane explicit while in scope, see activeLane().
+    */
+    class LaneScope
+    {
+    public:
+        LaneScope(ResourceScheduler *scheduler, Lane lane)
+            : mScheduler(scheduler)
+            , mPreviousLane(scheduler->mActiveLane)
+        {
+            mScheduler->mActiveLane = lane;
+        }
+        ~LaneScope()
+        {
+            mScheduler->mActiveLane = mPreviousLane;
+        }
+
+    private:
+        Q_DISABLE_COPY_MOVE(LaneScope)
+        ResourceScheduler *const mScheduler;
+        const int mPreviousLane;
+    };
+
     explicit ResourceScheduler(QObject *parent = nullptr);
 
+    /**
+      Enables or disables concurrent execution of the tasks of @p lane.
+      Disabled lanes run their tasks in the DefaultLane. All lanes but the
+      DefaultLane are disabled by default.
+    */
+    void setLaneEnabled(Lane lane, bool enabled);
+
+    /**
+      Returns the lane tasks of type @p type are executed in.
+    */
+    [[nodiscard]] Lane laneForTaskType(TaskType type) const;
+
+    /**
+      Returns the lane that the task-related methods without an explicit lane
+      argument (currentTask(), taskDone(), deferTask()) operate on.
+
+      This is the lane whose task is being started or whose completion is being
+      handled in a LaneScope, otherwise the only lane with a running task. When
+      several lanes are busy outside of a LaneScope, the DefaultLane is assumed.
+    */
+    [[nodiscard]] Lane activeLane() const;
+
+    /**
+      Returns whether the active lane was set explicitly by a LaneScope.
+    */
+    [[nodiscard]] bool hasLaneScope() const
+    {
+        return mActiveLane >= 0;
+    }
+
     /**
       Schedules a full synchronization.
     */
@@ -121,8 +194,15 @@ public:
       @param msg The associated D-Bus message.
       @param parentId ID of the original ItemsFetch task that this task was created from.
                       We can use this ID to group the tasks together
+      @param retrievalChannel The channel the @p retrievalRequests were received from.
+      @param retrievalRequests The associated item retrieval channel requests.
     */
-    void scheduleItemFetch(const Item &item, const QSet<QByteArray> &parts, const QList<QDBusMessage> &msgs, const qint64 parentId);
+    void scheduleItemFetch(const Item &item,
+                           const QSet<QByteArray> &parts,
+                           const QList<QDBusMessage> &msgs,
+                           const qint64 parentId,
+                           ItemRetrievalChannel *retrievalChannel = nullptr,
+                           const QList<qint64> &retrievalRequests = {});
 
     /**
       Schedules batch-fetching of PIM items.
@@ -132,6 +212,15 @@ public:
     */
     void scheduleItemsFetch(const Item::List &item, const QSet<QByteArray> &parts, const QDBusMessage &msg);
 
+    /**
+      Schedules batch-fetching of PIM items requested over the item retrieval channel.
+      @param items The items to fetch.
+      @param parts List of names of the parts of the item to fetch.
+      @param channel The channel the request was received from.
+      @param tag The tag of the request, used to answer it.
+    */
+    void scheduleItemsFetch(const Item::List &items, const QSet<QByteArray> &parts, ItemRetrievalChannel *channel, qint64 tag);
+
     /**
       Schedules deletion of the resource collection.
       This method is used to implement the ResourceBase::clearCache() functionality.
@@ -178,6 +267,13 @@ public:
 
     Task &currentTask();
 
+    /**
+      Returns the task running in @p lane.
+    */
+    [[nodiscard]] Task currentTask(Lane lane) const;
+
+    Task &currentTask(Lane lane);
+
     /**
       Sets the online state.
     */
@@ -217,6 +313,11 @@ public Q_SLOTS:
     */
     void taskDone();
 
+    /**
+      The task running in @p lane has been finished
+    */
+    void taskDone(Akonadi::ResourceScheduler::Lane lane);
+
     /**
       Like taskDone(), but special case for ItemFetch task
     */
@@ -227,6 +328,11 @@ public Q_SLOTS:
     */
     void deferTask();
 
+    /**
+      The task running in @p lane can't be finished now and will be rescheduled later
+    */
+    void deferTask(Akonadi::ResourceScheduler::Lane lane);
+
     /**
       Remove tasks that affect @p collection.
     */
@@ -255,6 +361,10 @@ private Q_SLOTS:
 
 private:
     void signalTaskToTracker(const Task &task, const QByteArray &taskType, const QString &debugString = QString());
+    bool isCurrentTask(const Task &task) const;
+    Task &itemsFetchTask(const Item::List &items, const QSet<QByteArray> &parts);
+    bool hasIdleLane() const;
+    void executeTask(Lane lane);
 
     // We have a number of task queues, by order of priority.
     // * PrependTaskQueue is for deferring the current task
@@ -282,8 +392,10 @@ private:
 
     TaskList mTaskList[NQueueCount];
 
-    Task mCurrentTask;
-    int mCurrentTasksQueue = -1; // queue mCurrentTask came from
+    Task mCurrentTask[NLaneCount];
+    int mCurrentTasksQueue[NLaneCount] = {-1, -1, -1}; // queue mCurrentTask came from
+    bool mLaneEnabled[NLaneCount] = {true, false, false};
+    int mActiveLane = -1; // set by LaneScope
     bool mOnline = false;
 };
 
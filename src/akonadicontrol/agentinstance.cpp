@@ -8,6 +8,11 @@
 #include "akonadicontrol_debug.h"
 
 #include "agentmanager.h"
+#include "agenttype.h"
+
+#include "private/standarddirs_p.h"
+
+#include <QSettings>
 
 AgentInstance::AgentInstance(AgentManager &manager)
     : mManager(manager)
@@ -25,6 +30,15 @@ void AgentInstance::quit()
     }
 }
 
+void AgentInstance::restoreState(const AgentType &agentInfo)
+{
+    setAgentType(agentInfo.identifier);
+
+    const QSettings settings(Akonadi::StandardDirs::agentConfigFile(mIdentifier, Akonadi::StandardDirs::ReadOnly), QSettings::IniFormat);
+    mResourceName = settings.value(QStringLiteral("Agent/Name")).toString();
+    mOnline = settings.value(QStringLiteral("Agent/DesiredOnlineState"), true).toBool();
+}
+
 void AgentInstance::cleanup()
 {
     if (mAgentControlInterface && mAgentControlInterface->isValid()) {
@@ -46,6 +60,8 @@ bool AgentInstance::obtainAgentInterface()
         return false;
     }
 
+    markActive();
+
     mSearchInterface = findInterface<org::freedesktop::Akonadi::Agent::Search>(Akonadi::DBus::Agent, "/Search");
 
     connect(mAgentStatusInterface.get(),
@@ -83,6 +99,7 @@ bool AgentInstance::obtainPreprocessorInterface()
 
 void AgentInstance::statusChanged(int status, const QString &statusMsg)
 {
+    markActive();
     if (mStatus == status && mStatusMessage == statusMsg) {
         return;
     }
@@ -108,6 +125,7 @@ void AgentInstance::statusMessageChanged(const QString &msg)
 
 void AgentInstance::percentChanged(int percent)
 {
+    markActive();
     if (mPercent == percent) {
         return;
     }
@@ -18,6 +18,7 @@
 #include <QSharedPointer>
 #include <QString>
 
+#include <chrono>
 #include <memory>
 
 class AgentManager;
@@ -81,6 +82,25 @@ public:
         return mResourceName;
     }
 
+    /**
+     * Returns when the agent last reported any activity.
+     */
+    [[nodiscard]] std::chrono::steady_clock::time_point lastActivity() const
+    {
+        return mLastActivity;
+    }
+
+    void markActive()
+    {
+        mLastActivity = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * Initializes the name and online state of an agent that isn't running
+     * from the configuration it saved when it was last running.
+     */
+    void restoreState(const AgentType &agentInfo);
+
     virtual bool start(const AgentType &agentInfo) = 0;
     virtual void quit();
     virtual void cleanup();
@@ -173,4 +193,5 @@ private:
     int mPercent = 0;
     bool mOnline = false;
     bool mPendingQuit = false;
+    std::chrono::steady_clock::time_point mLastActivity = std::chrono::steady_clock::now();
 };
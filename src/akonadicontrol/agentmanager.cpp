@@ -31,11 +31,14 @@
 #include <QDir>
 #include <QScopedPointer>
 #include <QSettings>
+#include <QTimer>
 
 using Akonadi::ProcessControl;
 using namespace std::chrono_literals;
 
 static const bool enableAgentServerDefault = false;
+static const bool enableOnDemandActivationDefault = false;
+static const int onDemandIdleTimeoutDefault = 10; // minutes
 
 // Here lie the once mighty resources, now deprecated and voided. They battled
 // valiantly against crashes and segfaults, and now, they can finally enjoy
@@ -99,6 +102,9 @@ public:
 
 AgentManager::AgentManager(bool verbose, QObject *parent)
     : QObject(parent)
+    , mOnDemandAgents([this](const QString &identifier) {
+        return startOnDemandInstance(identifier);
+    })
     , mAgentServer(nullptr)
     , mVerbose(verbose)
 {
@@ -114,6 +120,14 @@ AgentManager::AgentManager(bool verbose, QObject *parent)
 
     const QSettings settings(Akonadi::StandardDirs::agentsConfigFile(Akonadi::StandardDirs::ReadOnly), QSettings::IniFormat);
     mAgentServerEnabled = settings.value(QStringLiteral("AgentServer/Enabled"), enableAgentServerDefault).toBool();
+    mOnDemandActivation = settings.value(QStringLiteral("OnDemandActivation/Enabled"), enableOnDemandActivationDefault).toBool();
+    mIdleTimeout = std::chrono::minutes(settings.value(QStringLiteral("OnDemandActivation/IdleTimeout"), onDemandIdleTimeoutDefault).toInt());
+
+    if (mOnDemandActivation && mIdleTimeout.count() > 0) {
+        mIdleTimer = new QTimer(this);
+        connect(mIdleTimer, &QTimer::timeout, this, &AgentManager::stopIdleAgents);
+        mIdleTimer->start(1min);
+    }
 
     QStringList serviceArgs;
     if (Akonadi::Instance::hasIdentifier()) {
@@ -287,6 +301,9 @@ QString AgentManager::createAgentInstance(const QString &identifier)
     }
 
     mAgentInstances.insert(instanceIdentifier, instance);
+    if (isStartedOnDemand(agentInfo)) {
+        mOnDemandAgents.add(instanceIdentifier, OnDemandAgents::State::Running);
+    }
     registerAgentAtServer(instanceIdentifier, agentInfo);
     save();
 
@@ -308,6 +325,7 @@ void AgentManager::removeAgentInstance(const QString &identifier)
     }
 
     mAgentInstances.remove(identifier);
+    mOnDemandAgents.remove(identifier);
 
     save();
 
@@ -387,6 +405,12 @@ QString AgentManager::agentInstanceProgressMessage(const QString &identifier) co
 
 void AgentManager::agentInstanceConfigure(const QString &identifier, qlonglong windowId)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier, windowId]() {
+        agentInstanceConfigure(identifier, windowId);
+    })) {
+        return;
+    }
+
     if (!checkAgentInterfaces(identifier, QStringLiteral("agentInstanceConfigure"))) {
         return;
     }
@@ -405,6 +429,12 @@ bool AgentManager::agentInstanceOnline(const QString &identifier)
 
 void AgentManager::setAgentInstanceOnline(const QString &identifier, bool state)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier, state]() {
+        setAgentInstanceOnline(identifier, state);
+    })) {
+        return;
+    }
+
     if (!checkAgentInterfaces(identifier, QStringLiteral("setAgentInstanceOnline"))) {
         return;
     }
@@ -414,6 +444,12 @@ void AgentManager::setAgentInstanceOnline(const QString &identifier, bool state)
 
 void AgentManager::setAgentInstanceActivities(const QString &identifier, const QStringList &activities)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier, activities]() {
+        setAgentInstanceActivities(identifier, activities);
+    })) {
+        return;
+    }
+
     if (!checkAgentInterfaces(identifier, QStringLiteral("setAgentInstanceActivities"))) {
         return;
     }
@@ -435,6 +471,12 @@ QStringList AgentManager::agentInstanceActivities(const QString &identifier)
 
 void AgentManager::setAgentInstanceActivitiesEnabled(const QString &identifier, bool enabled)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier, enabled]() {
+        setAgentInstanceActivitiesEnabled(identifier, enabled);
+    })) {
+        return;
+    }
+
     if (!checkAgentInterfaces(identifier, QStringLiteral("setAgentInstanceActivitiesEnabled"))) {
         return;
     }
@@ -457,6 +499,12 @@ bool AgentManager::agentInstanceActivitiesEnabled(const QString &identifier)
 // resource specific methods //
 void AgentManager::setAgentInstanceName(const QString &identifier, const QString &name)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier, name]() {
+        setAgentInstanceName(identifier, name);
+    })) {
+        return;
+    }
+
     if (!checkResourceInterface(identifier, QStringLiteral("setAgentInstanceName"))) {
         return;
     }
@@ -484,6 +532,12 @@ QString AgentManager::agentInstanceName(const QString &identifier) const
 
 void AgentManager::agentInstanceSynchronize(const QString &identifier)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier]() {
+        agentInstanceSynchronize(identifier);
+    })) {
+        return;
+    }
+
     if (!checkResourceInterface(identifier, QStringLiteral("agentInstanceSynchronize"))) {
         return;
     }
@@ -493,6 +547,12 @@ void AgentManager::agentInstanceSynchronize(const QString &identifier)
 
 void AgentManager::agentInstanceSynchronizeCollectionTree(const QString &identifier)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier]() {
+        agentInstanceSynchronizeCollectionTree(identifier);
+    })) {
+        return;
+    }
+
     if (!checkResourceInterface(identifier, QStringLiteral("agentInstanceSynchronizeCollectionTree"))) {
         return;
     }
@@ -507,6 +567,12 @@ void AgentManager::agentInstanceSynchronizeCollection(const QString &identifier,
 
 void AgentManager::agentInstanceSynchronizeCollection(const QString &identifier, qint64 collection, bool recursive)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier, collection, recursive]() {
+        agentInstanceSynchronizeCollection(identifier, collection, recursive);
+    })) {
+        return;
+    }
+
     if (!checkResourceInterface(identifier, QStringLiteral("agentInstanceSynchronizeCollection"))) {
         return;
     }
@@ -516,6 +582,12 @@ void AgentManager::agentInstanceSynchronizeCollection(const QString &identifier,
 
 void AgentManager::agentInstanceSynchronizeTags(const QString &identifier)
 {
+    if (mOnDemandAgents.activateForCall(identifier, [this, identifier]() {
+        agentInstanceSynchronizeTags(identifier);
+    })) {
+        return;
+    }
+
     if (!checkResourceInterface(identifier, QStringLiteral("agentInstanceSynchronizeTags"))) {
         return;
     }
@@ -529,6 +601,11 @@ void AgentManager::restartAgentInstance(const QString &identifier)
         return;
     }
 
+    if (mOnDemandAgents.contains(identifier) && mOnDemandAgents.state(identifier) != OnDemandAgents::State::Running) {
+        mOnDemandAgents.activate(identifier);
+        return;
+    }
+
     mAgentInstances.value(identifier)->restartWhenIdle();
 }
 
@@ -666,8 +743,18 @@ void AgentManager::load()
 
         const AgentInstance::Ptr instance = createAgentInstance(type);
         instance->setIdentifier(instanceIdentifier);
-        if (instance->start(type)) {
+        if (isStartedOnDemand(type) && !OnDemandAgents::hasPendingChanges(instanceIdentifier)) {
+            // The server starts it once it needs it, see activateAgentInstance()
+            qCDebug(AKONADICONTROL_LOG) << "Agent instance" << instanceIdentifier << "will be started on demand";
+            instance->restoreState(type);
             mAgentInstances.insert(instanceIdentifier, instance);
+            mOnDemandAgents.add(instanceIdentifier, OnDemandAgents::State::Stopped);
+        } else if (instance->start(type)) {
+            mAgentInstances.insert(instanceIdentifier, instance);
+            if (isStartedOnDemand(type)) {
+                // Not really needed, but it has changes to replay
+                mOnDemandAgents.add(instanceIdentifier, OnDemandAgents::State::Starting);
+            }
         }
 
         file.endGroup();
@@ -731,7 +818,9 @@ void AgentManager::serviceOwnerChanged(const QString &name, const QString &oldOw
     case Akonadi::DBus::Agent: {
         // An agent service went up or down
         if (newOwner.isEmpty()) {
-            return; // It went down: we don't care here.
+            // It went down: we only care about agents we stopped because they were idle
+            mOnDemandAgents.stopped(service->identifier);
+            return;
         }
 
         if (!mAgentInstances.contains(service->identifier)) {
@@ -751,6 +840,11 @@ void AgentManager::serviceOwnerChanged(const QString &name, const QString &oldOw
             Q_EMIT agentInstanceAdded(service->identifier);
         }
 
+        // Resources register the Resource service first, but don't rely on it
+        if (!isResource || instance->hasResourceInterface()) {
+            mOnDemandAgents.started(service->identifier);
+        }
+
         break;
     }
     case Akonadi::DBus::Resource: {
@@ -773,6 +867,10 @@ void AgentManager::serviceOwnerChanged(const QString &name, const QString &oldOw
             Q_EMIT agentInstanceAdded(service->identifier);
         }
 
+        if (instance->hasAgentInterface()) {
+            mOnDemandAgents.started(service->identifier);
+        }
+
         break;
     }
     case Akonadi::DBus::Preprocessor: {
@@ -940,6 +1038,52 @@ void AgentManager::registerAgentAtServer(const QString &agentIdentifier, const A
     }
 }
 
+bool AgentManager::isStartedOnDemand(const AgentType &type) const
+{
+    // Agents that have to watch all changes or are expected to be always there keep running.
+    // Agents in the AgentServer are not supported, as it restarts all its agents.
+    return mOnDemandActivation && type.launchMethod != AgentType::Server && type.capabilities.contains(AgentType::CapabilityResource)
+        && !type.capabilities.contains(AgentType::CapabilityUnique) && !type.capabilities.contains(AgentType::CapabilityAutostart)
+        && !type.capabilities.contains(AgentType::CapabilityPreprocessor) && !type.capabilities.contains(AgentType::CapabilitySearch);
+}
+
+bool AgentManager::activateAgentInstance(const QString &identifier)
+{
+    return mOnDemandAgents.activate(identifier);
+}
+
+bool AgentManager::startOnDemandInstance(const QString &identifier)
+{
+    const AgentInstance::Ptr instance = mAgentInstances.value(identifier);
+    if (!instance || !instance->start(mAgents.value(instance->agentType()))) {
+        return false;
+    }
+
+    instance->markActive();
+    return true;
+}
+
+void AgentManager::stopIdleAgents()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const QStringList running = mOnDemandAgents.runningInstances();
+    for (const QString &identifier : running) {
+        const AgentInstance::Ptr instance = mAgentInstances.value(identifier);
+        if (!instance || !instance->hasAgentInterface() || instance->status() != 0 /* Idle */ || now - instance->lastActivity() < mIdleTimeout) {
+            continue;
+        }
+
+        // Offline resources keep their changes until they can replay them
+        if (OnDemandAgents::hasPendingChanges(identifier)) {
+            continue;
+        }
+
+        qCInfo(AKONADICONTROL_LOG) << "Stopping idle agent instance" << identifier;
+        mOnDemandAgents.stopping(identifier);
+        instance->quit();
+    }
+}
+
 void AgentManager::addSearch(const QString &query, const QString &queryLanguage, qint64 resultCollectionId)
 {
     qCDebug(AKONADICONTROL_LOG) << "AgentManager::addSearch" << query << queryLanguage << resultCollectionId;
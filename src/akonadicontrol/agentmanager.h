@@ -10,10 +10,14 @@
 #include <QHash>
 #include <QStringList>
 
+#include <chrono>
+
 #include "agentinstance.h"
 #include "agenttype.h"
+#include "ondemandagents.h"
 
 class QDir;
+class QTimer;
 
 namespace Akonadi
 {
@@ -219,6 +223,15 @@ public:
     void setAgentInstanceActivitiesEnabled(const QString &identifier, bool enabled);
     [[nodiscard]] bool agentInstanceActivitiesEnabled(const QString &identifier);
 
+    /**
+     * Starts the agent instance @p identifier if it is started on demand and
+     * is not running. This is called by the server when it needs the agent.
+     *
+     * @return true if the agent is started on demand, even if it is running
+     *         already or could not be started, false otherwise.
+     */
+    bool activateAgentInstance(const QString &identifier);
+
 Q_SIGNALS:
     /**
      * This signal is emitted whenever a new agent type was installed on the system.
@@ -310,6 +323,7 @@ private Q_SLOTS:
     void updatePluginInfos();
     void serviceOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner);
     void agentExeChanged(const QString &fileName);
+    void stopIdleAgents();
 
 private:
     /**
@@ -349,6 +363,13 @@ private:
     void continueStartup();
     void registerAgentAtServer(const QString &agentIdentifier, const AgentType &type);
 
+    /**
+     * Returns whether instances of @p type are only started when they are needed.
+     */
+    [[nodiscard]] bool isStartedOnDemand(const AgentType &type) const;
+
+    bool startOnDemandInstance(const QString &identifier);
+
 private:
     /**
      * The map which stores the .desktop file
@@ -365,6 +386,15 @@ private:
      */
     QHash<QString, AgentInstance::Ptr> mAgentInstances;
 
+    /**
+     * The instances that are started on demand.
+     */
+    OnDemandAgents mOnDemandAgents;
+
+    QTimer *mIdleTimer = nullptr;
+    std::chrono::minutes mIdleTimeout;
+    bool mOnDemandActivation = false;
+
     std::unique_ptr<Akonadi::ProcessControl> mAgentServer;
     std::unique_ptr<Akonadi::ProcessControl> mStorageController;
     bool mAgentServerEnabled = false;
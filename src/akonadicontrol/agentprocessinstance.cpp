@@ -38,6 +38,7 @@ bool AgentProcessInstance::start(const AgentType &agentInfo)
         return false;
     }
 
+    mQuitting = false;
     mController = std::make_unique<Akonadi::ProcessControl>();
     connect(mController.get(), &ProcessControl::unableToStart, this, &AgentProcessInstance::failedToStart);
 
@@ -55,24 +56,37 @@ bool AgentProcessInstance::start(const AgentType &agentInfo)
 
 void AgentProcessInstance::quit()
 {
+    // Agents started on demand are not started at all until they are needed
+    if (!mController) {
+        return;
+    }
+    mQuitting = true;
     mController->setCrashPolicy(Akonadi::ProcessControl::StopOnCrash);
     AgentInstance::quit();
 }
 
 void AgentProcessInstance::cleanup()
 {
+    if (!mController) {
+        return;
+    }
     mController->setCrashPolicy(Akonadi::ProcessControl::StopOnCrash);
     AgentInstance::cleanup();
 }
 
 void AgentProcessInstance::restartWhenIdle()
 {
+    if (!mController) {
+        return;
+    }
     if (mController->isRunning()) {
         if (status() != 1) {
             mController->restartOnceWhenFinished();
             quit();
+            mQuitting = false; // it's coming back
         }
     } else {
+        mQuitting = false;
         mController->start();
     }
 }
@@ -84,6 +98,10 @@ void Akonadi::AgentProcessInstance::configure(qlonglong windowId)
 
 void AgentProcessInstance::failedToStart()
 {
+    // The agent exited because we asked it to
+    if (mQuitting) {
+        return;
+    }
     statusChanged(2 /*Broken*/, QStringLiteral("Unable to start."));
 }
 
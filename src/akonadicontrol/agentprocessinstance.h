@@ -32,6 +32,7 @@ private Q_SLOTS:
 
 private:
     std::unique_ptr<Akonadi::ProcessControl> mController;
+    bool mQuitting = false;
 };
 
 }
@@ -0,0 +1,162 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "ondemandagents.h"
+#include "akonadicontrol_debug.h"
+
+#include "private/standarddirs_p.h"
+
+#include <QDataStream>
+#include <QFile>
+
+OnDemandAgents::OnDemandAgents(StartFunction start)
+    : mStart(std::move(start))
+{
+}
+
+void OnDemandAgents::add(const QString &identifier, State state)
+{
+    mStates.insert(identifier, state);
+}
+
+void OnDemandAgents::remove(const QString &identifier)
+{
+    mStates.remove(identifier);
+    mPendingCalls.remove(identifier);
+}
+
+bool OnDemandAgents::contains(const QString &identifier) const
+{
+    return mStates.contains(identifier);
+}
+
+OnDemandAgents::State OnDemandAgents::state(const QString &identifier) const
+{
+    Q_ASSERT(mStates.contains(identifier));
+    return mStates.value(identifier);
+}
+
+QStringList OnDemandAgents::runningInstances() const
+{
+    QStringList instances;
+    for (auto it = mStates.cbegin(), end = mStates.cend(); it != end; ++it) {
+        if (*it == State::Running) {
+            instances.push_back(it.key());
+        }
+    }
+    return instances;
+}
+
+bool OnDemandAgents::activate(const QString &identifier)
+{
+    const auto state = mStates.constFind(identifier);
+    if (state == mStates.cend()) {
+        return false;
+    }
+
+    switch (*state) {
+    case State::Starting:
+    case State::Running:
+        break;
+    case State::Stopping:
+        // Started again once it's down, see stopped()
+        mPendingCalls[identifier];
+        break;
+    case State::Stopped:
+        // The caller tries again later if it failed
+        start(identifier);
+        break;
+    }
+    return true;
+}
+
+bool OnDemandAgents::activateForCall(const QString &identifier, std::function<void()> call)
+{
+    const auto state = mStates.constFind(identifier);
+    if (state == mStates.cend() || *state == State::Running) {
+        return false;
+    }
+
+    if (*state == State::Stopped && !start(identifier)) {
+        return false;
+    }
+
+    mPendingCalls[identifier].push_back(std::move(call));
+    return true;
+}
+
+void OnDemandAgents::started(const QString &identifier)
+{
+    const auto state = mStates.find(identifier);
+    if (state == mStates.end() || *state != State::Starting) {
+        return;
+    }
+
+    *state = State::Running;
+    const auto calls = mPendingCalls.take(identifier);
+    for (const auto &call : calls) {
+        call();
+    }
+}
+
+void OnDemandAgents::stopping(const QString &identifier)
+{
+    const auto state = mStates.find(identifier);
+    if (state != mStates.end() && *state == State::Running) {
+        *state = State::Stopping;
+    }
+}
+
+void OnDemandAgents::stopped(const QString &identifier)
+{
+    const auto state = mStates.find(identifier);
+    if (state == mStates.end() || *state != State::Stopping) {
+        return;
+    }
+
+    qCInfo(AKONADICONTROL_LOG) << "Idle agent instance" << identifier << "stopped";
+    *state = State::Stopped;
+    if (mPendingCalls.contains(identifier)) {
+        // It was needed again while it was shutting down
+        start(identifier);
+    }
+}
+
+bool OnDemandAgents::start(const QString &identifier)
+{
+    qCInfo(AKONADICONTROL_LOG) << "Starting agent instance" << identifier << "on demand";
+    if (!mStart(identifier)) {
+        qCWarning(AKONADICONTROL_LOG) << "Failed to start agent instance" << identifier << "on demand";
+        mPendingCalls.remove(identifier);
+        return false;
+    }
+
+    mStates.insert(identifier, State::Starting);
+    return true;
+}
+
+bool OnDemandAgents::hasPendingChanges(const QString &identifier)
+{
+    // See ChangeRecorderJournalWriter: the journal starts with the number of changes and the
+    // number of changes that have already been replayed.
+    QFile file(Akonadi::StandardDirs::agentConfigFile(identifier) + QStringLiteral("_changes.dat"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    quint64 countAndVersion = 0;
+    quint64 startOffset = 0;
+    stream >> countAndVersion >> startOffset;
+    if (stream.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    const quint64 count = countAndVersion & Q_UINT64_C(0xFFFFFFFF);
+    const bool hasStartOffset = (countAndVersion >> 32) != 0;
+    return count > (hasStartOffset ? startOffset : 0);
+}
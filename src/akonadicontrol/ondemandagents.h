@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include <functional>
+
+/**
+ * Keeps track of the agent instances that are only started when they are
+ * needed, and of the calls made to them while they are not running.
+ */
+class OnDemandAgents
+{
+public:
+    enum class State {
+        Starting, ///< Started, calls wait until its interfaces are up
+        Running,
+        Stopping, ///< Stopped because it was idle, calls wait until it can be started again
+        Stopped,
+    };
+
+    /**
+     * Starts the agent instance with the given identifier, returns false if it failed.
+     */
+    using StartFunction = std::function<bool(const QString &identifier)>;
+
+    explicit OnDemandAgents(StartFunction start);
+
+    void add(const QString &identifier, State state);
+    void remove(const QString &identifier);
+
+    [[nodiscard]] bool contains(const QString &identifier) const;
+    [[nodiscard]] State state(const QString &identifier) const;
+
+    /**
+     * Returns the identifiers of the instances in the Running state.
+     */
+    [[nodiscard]] QStringList runningInstances() const;
+
+    /**
+     * Starts the agent instance @p identifier if it is stopped. If it is
+     * being stopped, it is started again once it is down.
+     *
+     * @return whether @p identifier is started on demand, whether or not it
+     *         could be started.
+     */
+    bool activate(const QString &identifier);
+
+    /**
+     * If the agent instance @p identifier is not running because it is started
+     * on demand, starts it and runs @p call once it is up, see started().
+     * Returns false if the agent is running or could not be started, in that
+     * case @p call is not used.
+     */
+    bool activateForCall(const QString &identifier, std::function<void()> call);
+
+    /**
+     * Called once the interfaces of @p identifier are up. Runs the calls
+     * that were waiting for it.
+     */
+    void started(const QString &identifier);
+
+    /**
+     * Marks the running instance @p identifier as being stopped.
+     */
+    void stopping(const QString &identifier);
+
+    /**
+     * Called once the instance @p identifier is down. Starts it again if it
+     * was needed while it was being stopped.
+     */
+    void stopped(const QString &identifier);
+
+    /**
+     * Returns whether the agent has recorded changes it has not replayed yet.
+     */
+    static bool hasPendingChanges(const QString &identifier);
+
+private:
+    bool start(const QString &identifier);
+
+    StartFunction mStart;
+    QHash<QString, State> mStates;
+    /// Calls to be made once the agent instance is up, an entry is kept for
+    /// instances that have to be started again once they are down
+    QHash<QString, QList<std::function<void()>>> mPendingCalls;
+};
@@ -6,7 +6,10 @@
 
 #include <QCoreApplication>
 #include <QDBusConnection>
+#include <QDateTime>
+#include <QDebug>
 #include <QDir>
+#include <QFile>
 #include <QPluginLoader>
 #include <QSettings>
 #include <QString>
@@ -22,6 +25,7 @@
 #include "controlmanagerinterface.h"
 #include "janitorinterface.h"
 
+#include "private/binarytrace_p.h"
 #include "private/dbus_p.h"
 #include "private/instance_p.h"
 #include "private/protocol_p.h"
@@ -205,6 +209,45 @@ static void runJanitor(const QString &operation)
     qApp->exec();
 }
 
+static bool printTrace(const QString &fileName)
+{
+    QString traceFile = fileName;
+    if (traceFile.isEmpty()) {
+        const QSettings settings(Akonadi::StandardDirs::serverConfigFile(), QSettings::IniFormat);
+        traceFile = settings.value(QStringLiteral("Debug/BinaryTraceFile"), Akonadi::StandardDirs::saveDir("data") + QLatin1StringView("/akonadiserver.trace"))
+                        .toString();
+    }
+
+    QFile file(traceFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Failed to open trace file " << traceFile.toStdString() << ": " << file.errorString().toStdString() << std::endl;
+        return false;
+    }
+    Akonadi::BinaryTrace::Header header;
+    if (!Akonadi::BinaryTrace::readHeader(&file, &header)) {
+        std::cerr << traceFile.toStdString() << " is not a supported Akonadi trace file" << std::endl;
+        return false;
+    }
+
+    const QDateTime startTime = QDateTime::fromMSecsSinceEpoch(header.startTime);
+    char buffer[Akonadi::BinaryTrace::EventSize];
+    while (file.read(buffer, sizeof(buffer)) == sizeof(buffer)) {
+        const auto event = Akonadi::BinaryTrace::decodeEvent(buffer);
+        const QDateTime time = startTime.addMSecs(qint64(event.timestamp / 1000));
+        std::cout << time.toString(Qt::ISODateWithMs).toStdString() << ' ';
+        if (event.flags & Akonadi::BinaryTrace::Dropped) {
+            std::cout << event.count << " events dropped" << std::endl;
+            continue;
+        }
+
+        QString command;
+        QDebug(&command) << static_cast<Akonadi::Protocol::Command::Type>(event.command);
+        std::cout << "connection " << event.connection << " tag " << event.tag << ' ' << command.trimmed().toStdString() << ' ' << event.duration / 1000.0
+                  << " ms, " << event.count << " responses" << ((event.flags & Akonadi::BinaryTrace::Failed) ? ", failed" : "") << std::endl;
+    }
+    return true;
+}
+
 static void waitForShutdown()
 {
     do {
@@ -227,7 +270,9 @@ int main(int argc, char **argv)
              "  vacuum         Vacuum internal storage (WARNING: needs a lot of time and disk\n"
              "                 space!)\n"
              "  fsck           Check (and attempt to fix) consistency of the internal storage\n"
-             "                 (can take some time)"));
+             "                 (can take some time, use --online to not block the server\n"
+             "                 meanwhile)\n"
+             "  trace [file]   Prints the binary trace of the Akonadi server"));
 
     KAboutData aboutData(QStringLiteral("akonadictl"),
                          QStringLiteral("akonadictl"),
@@ -237,15 +282,17 @@ int main(int argc, char **argv)
     KAboutData::setApplicationData(aboutData);
 
     app.addCommandLineOptions({u"wait"_s, i18n("Wait for server shutdown to complete.")});
+    app.addCommandLineOptions({u"online"_s, i18n("Check the storage in small steps while the server is in use, resuming an interrupted check.")});
     app.addPositionalCommandLineOption(QStringLiteral("command"),
                                        i18n("Command to execute"),
-                                       QStringLiteral("start|stop|restart|status|vacuum|fsck|instances"));
+                                       QStringLiteral("start|stop|restart|status|vacuum|fsck|instances|trace"));
 
     app.parseCommandLine();
 
     const auto &cmdArgs = app.commandLineArguments();
     const QStringList commands = cmdArgs.positionalArguments();
-    if (commands.size() != 1) {
+    const bool isTrace = !commands.isEmpty() && commands[0] == QLatin1StringView("trace");
+    if (commands.size() != 1 && !(isTrace && commands.size() == 2)) {
         app.printUsage();
         return -1;
     }
@@ -279,9 +326,13 @@ int main(int argc, char **argv)
     } else if (command == QLatin1StringView("vacuum")) {
         runJanitor(QStringLiteral("vacuum"));
     } else if (command == QLatin1StringView("fsck")) {
-        runJanitor(QStringLiteral("check"));
+        runJanitor(cmdArgs.isSet(u"online"_s) ? QStringLiteral("checkOnline") : QStringLiteral("check"));
     } else if (command == QLatin1StringView("instances")) {
         listInstances();
+    } else if (isTrace) {
+        if (!printTrace(commands.value(1))) {
+            return 6;
+        }
     } else {
         app.printUsage();
         return -1;
@@ -61,3 +61,13 @@ TagListCache *ChangeNotificationDependenciesFactory::createTagListCache(int maxC
 {
     return new TagListCache(maxCapacity, session);
 }
+
+ItemListCache *ChangeNotificationDependenciesFactory::acquireSharedItemListCache(const ItemFetchScope &scope)
+{
+    return SharedItemListCache::acquire(scope);
+}
+
+void ChangeNotificationDependenciesFactory::releaseSharedItemListCache(ItemListCache *cache)
+{
+    SharedItemListCache::release(cache);
+}
@@ -34,6 +34,9 @@ public:
     virtual Akonadi::ItemListCache *createItemListCache(int maxCapacity, Session *session);
     virtual Akonadi::TagListCache *createTagListCache(int maxCapacity, Session *session);
 
+    virtual Akonadi::ItemListCache *acquireSharedItemListCache(const ItemFetchScope &scope);
+    virtual void releaseSharedItemListCache(Akonadi::ItemListCache *cache);
+
 protected:
     Q_DISABLE_COPY_MOVE(ChangeNotificationDependenciesFactory)
 
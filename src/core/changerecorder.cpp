@@ -49,7 +49,7 @@ void ChangeRecorder::replayNext()
     }
 
     if (!d->pendingNotifications.isEmpty()) {
-        const auto msg = d->pendingNotifications.head();
+        const auto msg = d->nextReplayBatch();
         if (d->ensureDataAvailable(msg)) {
             d->emitNotification(msg);
         } else if (d->translateAndCompress(d->pipeline, msg)) {
@@ -59,7 +59,7 @@ void ChangeRecorder::replayNext()
         } else {
             // In the case of a move where both source and destination are
             // ignored, we ignore the message and process the next one.
-            d->dequeueNotification();
+            d->dequeueReplayedNotifications();
             replayNext();
             return;
         }
@@ -89,7 +89,7 @@ void ChangeRecorder::changeProcessed()
     // so test for emptiness. Not sure real code does this though.
     // Q_ASSERT( !d->pendingNotifications.isEmpty() )
     if (!d->pendingNotifications.isEmpty()) {
-        d->dequeueNotification();
+        d->dequeueReplayedNotifications();
     }
 }
 
@@ -108,6 +108,18 @@ void ChangeRecorder::setChangeRecordingEnabled(bool enable)
     }
 }
 
+void ChangeRecorder::setReplayBatchSize(int size)
+{
+    Q_D(ChangeRecorder);
+    d->replayBatchSize = qMax(1, size);
+}
+
+int ChangeRecorder::replayBatchSize() const
+{
+    Q_D(const ChangeRecorder);
+    return d->replayBatchSize;
+}
+
 QString Akonadi::ChangeRecorder::dumpNotificationListToString() const
 {
     Q_D(const ChangeRecorder);
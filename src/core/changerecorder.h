@@ -69,6 +69,30 @@ public:
      */
     void setChangeRecordingEnabled(bool enable);
 
+    /**
+     * Sets the maximum number of items replayed at once.
+     *
+     * When set to more than 1, consecutive recorded additions of items to the same
+     * collection, or consecutive changes of the same parts of different items, are
+     * replayed together as a single itemsAdded() or itemsChanged() signal, provided
+     * that there is a receiver for the batch signal but not for the corresponding
+     * single-item signal. changeProcessed() then removes the whole batch from the
+     * records.
+     *
+     * The default is 1, i.e. every change is replayed on its own.
+     *
+     * @param size the maximum number of items in a replayed batch
+     * @since 6.4
+     */
+    void setReplayBatchSize(int size);
+
+    /**
+     * Returns the maximum number of items replayed at once.
+     * @see setReplayBatchSize()
+     * @since 6.4
+     */
+    [[nodiscard]] int replayBatchSize() const;
+
     /**
      * Debugging: dump current list of notifications, as saved on disk.
      */
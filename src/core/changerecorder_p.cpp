@@ -12,8 +12,11 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QSet>
 #include <QSettings>
 
+#include <algorithm>
+
 using namespace Akonadi;
 
 ChangeRecorderPrivate::ChangeRecorderPrivate(ChangeNotificationDependenciesFactory *dependenciesFactory_, ChangeRecorder *parent)
@@ -176,26 +179,87 @@ void ChangeRecorderPrivate::notificationsEnqueued(int count)
     }
 }
 
-void ChangeRecorderPrivate::dequeueNotification()
+void ChangeRecorderPrivate::dequeueNotification(int count)
 {
-    if (pendingNotifications.isEmpty()) {
+    count = qMin(count, pendingNotifications.count());
+    if (count <= 0) {
         return;
     }
 
-    pendingNotifications.dequeue();
+    pendingNotifications.remove(0, count);
     if (enableChangeRecording) {
-        Q_ASSERT(pendingNotifications.count() == m_lastKnownNotificationsCount - 1);
-        --m_lastKnownNotificationsCount;
+        Q_ASSERT(pendingNotifications.count() == m_lastKnownNotificationsCount - count);
+        m_lastKnownNotificationsCount -= count;
 
         if (m_needFullSave || pendingNotifications.isEmpty()) {
             saveNotifications();
         } else {
-            ++m_startOffset;
+            m_startOffset += count;
             writeStartOffset();
         }
     }
 }
 
+void ChangeRecorderPrivate::dequeueReplayedNotifications()
+{
+    dequeueNotification(qMax(1, m_replayedCount));
+    m_replayedCount = 0;
+}
+
+Protocol::ChangeNotificationPtr ChangeRecorderPrivate::nextReplayBatch()
+{
+    Q_ASSERT(!pendingNotifications.isEmpty());
+    const auto head = pendingNotifications.head();
+    m_replayedCount = 1;
+    if (replayBatchSize <= 1 || head->type() != Protocol::Command::ItemChangeNotification) {
+        return head;
+    }
+
+    const auto &headNtf = Protocol::cmdCast<Protocol::ItemChangeNotification>(head);
+    const auto op = headNtf.operation();
+    // Batches are only delivered to receivers of the batch signals
+    if ((op != Protocol::ItemChangeNotification::Add || hasListeners(&Monitor::itemAdded) || !hasListeners(&Monitor::itemsAdded))
+        && (op != Protocol::ItemChangeNotification::Modify || hasListeners(&Monitor::itemChanged) || !hasListeners(&Monitor::itemsChanged))) {
+        return head;
+    }
+
+    auto items = headNtf.items();
+    QSet<qint64> ids;
+    for (const auto &item : std::as_const(items)) {
+        ids.insert(item.id());
+    }
+    for (auto it = pendingNotifications.cbegin() + 1; it != pendingNotifications.cend(); ++it) {
+        if ((*it)->type() != Protocol::Command::ItemChangeNotification) {
+            break;
+        }
+        const auto &ntf = Protocol::cmdCast<Protocol::ItemChangeNotification>(*it);
+        if (ntf.operation() != op || ntf.parentCollection() != headNtf.parentCollection() || ntf.resource() != headNtf.resource()
+            || ntf.itemParts() != headNtf.itemParts() || items.size() + ntf.items().size() > replayBatchSize) {
+            break;
+        }
+        // Each item may appear only once in a batch, later changes are replayed in a later batch
+        const bool duplicate = std::any_of(ntf.items().cbegin(), ntf.items().cend(), [&ids](const auto &item) {
+            return ids.contains(item.id());
+        });
+        if (duplicate) {
+            break;
+        }
+        for (const auto &item : ntf.items()) {
+            ids.insert(item.id());
+        }
+        items += ntf.items();
+        ++m_replayedCount;
+    }
+
+    if (m_replayedCount == 1) {
+        return head;
+    }
+
+    auto batch = Protocol::ItemChangeNotificationPtr::create(headNtf);
+    batch->setItems(items);
+    return batch;
+}
+
 void ChangeRecorderPrivate::notificationsErased()
 {
     if (enableChangeRecording) {
@@ -216,7 +280,7 @@ bool ChangeRecorderPrivate::emitNotification(const Protocol::ChangeNotificationP
     const bool someoneWasListening = MonitorPrivate::emitNotification(msg);
     if (!someoneWasListening && enableChangeRecording) {
         // If no signal was emitted (e.g. because no one was connected to it), no one is going to call changeProcessed, so we help ourselves.
-        dequeueNotification();
+        dequeueReplayedNotifications();
         QMetaObject::invokeMethod(q_ptr, "replayNext", Qt::QueuedConnection);
     }
     return someoneWasListening;
@@ -23,6 +23,7 @@ public:
     Q_DECLARE_PUBLIC(ChangeRecorder)
     QSettings *settings = nullptr;
     bool enableChangeRecording = true;
+    int replayBatchSize = 1;
 
     int pipelineSize() const override;
     void notificationsEnqueued(int count) override;
@@ -37,13 +38,17 @@ public:
     QString dumpNotificationListToString() const;
     void saveNotifications();
 
+    Protocol::ChangeNotificationPtr nextReplayBatch();
+    void dequeueReplayedNotifications();
+
 private:
-    void dequeueNotification();
+    void dequeueNotification(int count = 1);
     void notificationsLoaded();
     void writeStartOffset() const;
 
     int m_lastKnownNotificationsCount = 0; // just for invariant checking
     int m_startOffset = 0; // number of saved notifications to skip
+    int m_replayedCount = 0; // number of pending notifications merged into the last replayed batch
     bool m_needFullSave = true;
 };
 
@@ -155,6 +155,8 @@ void Connection::doReconnect()
     }
 
     mSocket.reset(new QLocalSocket(this));
+    mEncoding = Protocol::DataStream::Encoding::Legacy;
+    mRequestedEncoding = Protocol::DataStream::Encoding::Legacy;
     connect(mSocket.data(), &QLocalSocket::errorOccurred, this, [this](QLocalSocket::LocalSocketError /*unused*/) {
         qCWarning(AKONADICORE_LOG) << mSocket->errorString() << mSocket->serverName();
         Q_EMIT socketError(mSocket->errorString());
@@ -228,10 +230,9 @@ void Connection::handleIncomingData()
         return;
     }
 
-    while (mSocket->bytesAvailable() >= int(sizeof(qint64))) {
-        Protocol::DataStream stream(mSocket.data());
-        qint64 tag;
-        stream >> tag;
+    while (Protocol::DataStream::hasMessage(mSocket.data(), mEncoding)) {
+        Protocol::DataStream stream(mSocket.data(), mEncoding);
+        qint64 tag = -1;
 
         // temporarily disconnect from readyRead-signal to avoid re-entering this function when we
         // call waitForData() deep inside Protocol::deserialize
@@ -239,7 +240,9 @@ void Connection::handleIncomingData()
 
         Protocol::CommandPtr cmd;
         try {
-            cmd = Protocol::deserialize(mSocket.data());
+            stream.beginMessage();
+            stream >> tag;
+            cmd = Protocol::deserialize(stream);
         } catch (const Akonadi::ProtocolException &e) {
             qCWarning(AKONADICORE_LOG) << "Protocol exception:" << e.what();
             // cmd's type will be Invalid by default, so fall-through
@@ -267,6 +270,9 @@ void Connection::handleIncomingData()
 
         if (cmd->type() == Protocol::Command::Hello) {
             Q_ASSERT(cmd->isResponse());
+        } else if (cmd->type() == Protocol::Command::Login && cmd->isResponse() && !Protocol::cmdCast<Protocol::Response>(cmd).isError()) {
+            // Everything after the Login response uses the encoding we asked for
+            mEncoding = mRequestedEncoding;
         }
 
         {
@@ -297,8 +303,14 @@ void Connection::doSendCommand(qint64 tag, const Protocol::CommandPtr &cmd)
         mLogFile->flush();
     }
 
+    if (cmd->type() == Protocol::Command::Login && !cmd->isResponse()) {
+        mRequestedEncoding = Protocol::cmdCast<Protocol::LoginCommand>(cmd).encoding() == Protocol::LoginCommand::CompactEncoding
+            ? Protocol::DataStream::Encoding::Compact
+            : Protocol::DataStream::Encoding::Legacy;
+    }
+
     if (mSocket && mSocket->isOpen()) {
-        Protocol::DataStream stream(mSocket.data());
+        Protocol::DataStream stream(mSocket.data(), mEncoding);
         try {
             stream << tag;
             Protocol::serialize(stream, cmd);
@@ -10,6 +10,7 @@
 #include <QScopedPointer>
 #include <QThread>
 
+#include "private/datastream_p_p.h"
 #include "private/protocol_p.h"
 
 #include "akonadicore_export.h"
@@ -69,6 +70,9 @@ private:
     QFile *mLogFile = nullptr;
     QByteArray mSessionId;
     CommandBuffer *mCommandBuffer;
+    Protocol::DataStream::Encoding mEncoding = Protocol::DataStream::Encoding::Legacy;
+    // encoding requested in Login, used once the server acknowledges it
+    Protocol::DataStream::Encoding mRequestedEncoding = Protocol::DataStream::Encoding::Legacy;
 
     friend class Akonadi::SessionThread;
 };
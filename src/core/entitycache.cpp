@@ -5,9 +5,28 @@
 */
 
 #include "entitycache_p.h"
+#include "protocolhelper_p.h"
 
 using namespace Akonadi;
 
+namespace
+{
+// Big enough to keep the items of a few notification bursts around, which is
+// what makes sharing worth it.
+constexpr qint64 SharedItemCacheMaxCost = 16 * 1024 * 1024;
+
+struct SharedItemListCacheEntry {
+    Protocol::ItemFetchScope scope;
+    Protocol::TagFetchScope tagScope;
+    ItemListCache *cache = nullptr;
+    int refCount = 0;
+};
+
+// Sessions and fetch jobs are bound to a thread, so are the shared caches
+thread_local QList<SharedItemListCacheEntry> sharedItemListCaches;
+
+} // namespace
+
 EntityCacheBase::EntityCacheBase(Session *_session, QObject *parent)
     : QObject(parent)
     , session(_session)
@@ -19,4 +38,49 @@ void EntityCacheBase::setSession(Session *_session)
     session = _session;
 }
 
+void EntityCacheBase::setMaxCost(qint64 maxCost)
+{
+    mMaxCost = maxCost;
+}
+
+qint64 EntityCacheBase::maxCost() const
+{
+    return mMaxCost;
+}
+
+qint64 EntityCacheBase::totalCost() const
+{
+    return mTotalCost;
+}
+
+ItemListCache *SharedItemListCache::acquire(const ItemFetchScope &scope)
+{
+    const auto protoScope = ProtocolHelper::itemFetchScopeToProtocol(scope);
+    const auto protoTagScope = ProtocolHelper::tagFetchScopeToProtocol(scope.tagFetchScope());
+    for (auto &entry : sharedItemListCaches) {
+        if (entry.scope == protoScope && entry.tagScope == protoTagScope) {
+            ++entry.refCount;
+            return entry.cache;
+        }
+    }
+
+    auto cache = new ItemListCache(0, Session::defaultSession());
+    cache->setMaxCost(SharedItemCacheMaxCost);
+    sharedItemListCaches.push_back({protoScope, protoTagScope, cache, 1});
+    return cache;
+}
+
+void SharedItemListCache::release(ItemListCache *cache)
+{
+    for (auto it = sharedItemListCaches.begin(), end = sharedItemListCaches.end(); it != end; ++it) {
+        if (it->cache == cache) {
+            if (--it->refCount == 0) {
+                delete it->cache;
+                sharedItemListCaches.erase(it);
+            }
+            return;
+        }
+    }
+}
+
 #include "moc_entitycache_p.cpp"
@@ -21,9 +21,11 @@
 
 #include <QHash>
 #include <QObject>
-#include <QQueue>
+#include <QSet>
 #include <QVariant>
 
+#include <list>
+
 class KJob;
 
 Q_DECLARE_METATYPE(QList<qint64>)
@@ -42,8 +44,21 @@ public:
 
     void setSession(Session *session);
 
+    /**
+     * Bounds the cache by the estimated memory footprint of the cached entities
+     * (in bytes) instead of by the number of entries. Pass 0 to go back to the
+     * count-based capacity passed to the constructor.
+     */
+    void setMaxCost(qint64 maxCost);
+    qint64 maxCost() const;
+
+    /** Estimated memory footprint of all the entities currently in the cache. */
+    qint64 totalCost() const;
+
 protected:
     Session *session = nullptr;
+    qint64 mMaxCost = 0;
+    qint64 mTotalCost = 0;
 
 Q_SIGNALS:
     void dataAvailable();
@@ -52,6 +67,29 @@ private Q_SLOTS:
     virtual void processResult(KJob *job) = 0;
 };
 
+/**
+ * @internal
+ * Rough estimate of the heap memory held by a cached entity, used to bound the caches by size.
+ */
+inline qint64 entityCacheCost(const Item &item)
+{
+    qint64 cost = 512 + item.remoteId().size() * 2 + item.flags().size() * 16;
+    if (item.hasPayload()) {
+        cost += item.size();
+    }
+    return cost;
+}
+
+inline qint64 entityCacheCost(const Collection &collection)
+{
+    return 512 + (collection.name().size() + collection.remoteId().size()) * 2 + collection.contentMimeTypes().size() * 32;
+}
+
+inline qint64 entityCacheCost(const Tag &tag)
+{
+    return 256 + tag.gid().size() + tag.remoteId().size();
+}
+
 template<typename T>
 struct EntityCacheNode {
     EntityCacheNode()
@@ -66,13 +104,102 @@ struct EntityCacheNode {
     {
     }
     T entity;
+    qint64 cost = 0;
     bool pending;
     bool invalid;
 };
 
 /**
  * @internal
- * A in-memory FIFO cache for a small amount of Item or Collection objects.
+ * LRU bookkeeping shared by EntityCache and EntityListCache: the nodes are kept
+ * in recently-used order in a linked list and indexed by id, so that lookups,
+ * updates and evictions are all O(1).
+ */
+template<typename T, typename Node>
+class EntityCacheLru
+{
+public:
+    using Id = typename T::Id;
+    using List = std::list<Node>;
+    using Iterator = typename List::iterator;
+
+    Node *find(Id id) const
+    {
+        auto it = mIndex.constFind(id);
+        return it == mIndex.cend() ? nullptr : &(*it.value());
+    }
+
+    /** Looks up @p id and marks it as the most recently used entry. */
+    Node *touch(Id id)
+    {
+        auto it = mIndex.constFind(id);
+        if (it == mIndex.cend()) {
+            return nullptr;
+        }
+        mNodes.splice(mNodes.begin(), mNodes, it.value());
+        return &(*it.value());
+    }
+
+    Node *insert(Id id)
+    {
+        mNodes.emplace_front(id);
+        mIndex.insert(id, mNodes.begin());
+        return &mNodes.front();
+    }
+
+    /** Removes @p id, returns the cost of the removed node. */
+    qint64 remove(Id id)
+    {
+        auto it = mIndex.find(id);
+        if (it == mIndex.end()) {
+            return 0;
+        }
+        const qint64 cost = it.value()->cost;
+        mNodes.erase(it.value());
+        mIndex.erase(it);
+        return cost;
+    }
+
+    bool contains(Id id) const
+    {
+        return mIndex.contains(id);
+    }
+
+    qsizetype size() const
+    {
+        return mNodes.size();
+    }
+
+    /**
+     * Evicts least recently used entries that are neither pending nor in @p preserveIds
+     * for as long as @p overBudget returns true. Returns the cost of the evicted entries.
+     */
+    template<typename Predicate>
+    qint64 evict(const QSet<Id> &preserveIds, Predicate &&overBudget)
+    {
+        qint64 evicted = 0;
+        auto it = mNodes.end();
+        while (it != mNodes.begin() && overBudget(evicted)) {
+            --it;
+            const Id id = it->entity.id();
+            if (it->pending || preserveIds.contains(id)) {
+                continue;
+            }
+            evicted += it->cost;
+            mIndex.remove(id);
+            it = mNodes.erase(it);
+        }
+        return evicted;
+    }
+
+private:
+    List mNodes;
+    QHash<Id, Iterator> mIndex;
+};
+
+/**
+ * @internal
+ * A in-memory LRU cache for a small amount of Item or Collection objects.
  */
 template<typename T, typename FetchJob, typename FetchScope_>
 class EntityCache : public EntityCacheBase
@@ -85,28 +212,23 @@ public:
     {
     }
 
-    ~EntityCache() override
-    {
-        qDeleteAll(mCache);
-    }
-
     /** Object is available in the cache and can be retrieved. */
     bool isCached(typename T::Id id) const
     {
-        EntityCacheNode<T> *node = cacheNodeForId(id);
+        EntityCacheNode<T> *node = mCache.find(id);
         return node && !node->pending;
     }
 
     /** Object has been requested but is not yet loaded into the cache or is already available. */
     bool isRequested(typename T::Id id) const
     {
-        return cacheNodeForId(id);
+        return mCache.contains(id);
     }
 
     /** Returns the cached object if available, an empty instance otherwise. */
     virtual T retrieve(typename T::Id id) const
     {
-        EntityCacheNode<T> *node = cacheNodeForId(id);
+        EntityCacheNode<T> *node = mCache.touch(id);
         if (node && !node->pending && !node->invalid) {
             return node->entity;
         }
@@ -116,7 +238,7 @@ public:
     /** Marks the cache entry as invalid, use in case the object has been deleted on the server. */
     void invalidate(typename T::Id id)
     {
-        EntityCacheNode<T> *node = cacheNodeForId(id);
+        EntityCacheNode<T> *node = mCache.find(id);
         if (node) {
             node->invalid = true;
         }
@@ -125,20 +247,20 @@ public:
     /** Triggers a re-fetching of a cache entry, use if it has changed on the server. */
     void update(typename T::Id id, const FetchScope &scope)
     {
-        EntityCacheNode<T> *node = cacheNodeForId(id);
+        EntityCacheNode<T> *node = mCache.find(id);
         if (node) {
-            mCache.removeAll(node);
-            if (node->pending) {
+            const bool pending = node->pending;
+            mTotalCost -= mCache.remove(id);
+            if (pending) {
                 request(id, scope);
             }
-            delete node;
         }
     }
 
     /** Requests the object to be cached if it is not yet in the cache. @returns @c true if it was in the cache already. */
     virtual bool ensureCached(typename T::Id id, const FetchScope &scope)
     {
-        EntityCacheNode<T> *node = cacheNodeForId(id);
+        EntityCacheNode<T> *node = mCache.touch(id);
         if (!node) {
             request(id, scope);
             return false;
@@ -155,32 +277,21 @@ public:
     {
         Q_ASSERT(!isRequested(id));
         shrinkCache();
-        auto node = new EntityCacheNode<T>(id);
+        mCache.insert(id);
         FetchJob *job = createFetchJob(id, scope);
         job->setProperty("EntityCacheNode", QVariant::fromValue<typename T::Id>(id));
         connect(job, SIGNAL(result(KJob *)), SLOT(processResult(KJob *)));
-        mCache.enqueue(node);
     }
 
 private:
-    EntityCacheNode<T> *cacheNodeForId(typename T::Id id) const
-    {
-        for (typename QQueue<EntityCacheNode<T> *>::const_iterator it = mCache.constBegin(), endIt = mCache.constEnd(); it != endIt; ++it) {
-            if ((*it)->entity.id() == id) {
-                return *it;
-            }
-        }
-        return nullptr;
-    }
-
     void processResult(KJob *job) override
     {
         if (job->error()) {
             // This can happen if we have stale notifications for items that have already been removed
         }
         auto id = job->property("EntityCacheNode").template value<typename T::Id>();
-        EntityCacheNode<T> *node = cacheNodeForId(id);
-        if (!node) {
+        EntityCacheNode<T> *node = mCache.find(id);
+        if (!node || !node->pending) {
             return; // got replaced in the meantime
         }
 
@@ -193,6 +304,9 @@ private:
             node->entity.setId(id);
             node->invalid = true;
         }
+        mTotalCost -= node->cost;
+        node->cost = entityCacheCost(node->entity);
+        mTotalCost += node->cost;
         Q_EMIT dataAvailable();
     }
 
@@ -208,13 +322,13 @@ private:
     /** Tries to reduce the cache size until at least one more object fits in. */
     void shrinkCache()
     {
-        while (mCache.size() >= mCapacity && !mCache.first()->pending) {
-            delete mCache.dequeue();
-        }
+        mTotalCost -= mCache.evict({}, [this](qint64 evicted) {
+            return mMaxCost > 0 ? (mTotalCost - evicted >= mMaxCost) : (mCache.size() >= mCapacity);
+        });
     }
 
 private:
-    QQueue<EntityCacheNode<T> *> mCache;
+    mutable EntityCacheLru<T, EntityCacheNode<T>> mCache;
     int mCapacity;
 };
 
@@ -282,6 +396,7 @@ struct EntityListCacheNode {
     }
 
     T entity;
+    qint64 cost = 0;
     bool pending;
     bool invalid;
 };
@@ -298,18 +413,14 @@ public:
     {
     }
 
-    ~EntityListCache() override
-    {
-        qDeleteAll(mCache);
-    }
-
     /** Returns the cached object if available, an empty instance otherwise. */
     typename T::List retrieve(const QList<typename T::Id> &ids) const
     {
         typename T::List list;
+        list.reserve(ids.size());
 
         for (typename T::Id id : ids) {
-            EntityListCacheNode<T> *node = mCache.value(id);
+            EntityListCacheNode<T> *node = mCache.touch(id);
             if (!node || node->pending || node->invalid) {
                 return typename T::List();
             }
@@ -327,7 +438,7 @@ public:
         bool result = true;
 
         for (typename T::Id id : ids) {
-            EntityListCacheNode<T> *node = mCache.value(id);
+            EntityListCacheNode<T> *node = mCache.touch(id);
             if (!node) {
                 toRequest << id;
                 continue;
@@ -350,7 +461,7 @@ public:
     void invalidate(const QList<typename T::Id> &ids)
     {
         for (typename T::Id id : ids) {
-            EntityListCacheNode<T> *node = mCache.value(id);
+            EntityListCacheNode<T> *node = mCache.find(id);
             if (node) {
                 node->invalid = true;
             }
@@ -363,13 +474,12 @@ public:
         QList<typename T::Id> toRequest;
 
         for (typename T::Id id : ids) {
-            EntityListCacheNode<T> *node = mCache.value(id);
+            EntityListCacheNode<T> *node = mCache.find(id);
             if (node) {
-                mCache.remove(id);
                 if (node->pending) {
                     toRequest << id;
                 }
-                delete node;
+                mTotalCost -= mCache.remove(id);
             }
         }
 
@@ -388,8 +498,7 @@ public:
         Q_ASSERT(isNotRequested(ids));
         shrinkCache(preserveIds);
         for (typename T::Id id : ids) {
-            auto node = new EntityListCacheNode<T>(id);
-            mCache.insert(id, node);
+            mCache.insert(id);
         }
         FetchJob *job = createFetchJob(ids, scope);
         job->setProperty("EntityListCacheIds", QVariant::fromValue<QList<typename T::Id>>(ids));
@@ -411,7 +520,7 @@ public:
     bool isCached(const QList<typename T::Id> &ids) const
     {
         for (typename T::Id id : ids) {
-            EntityListCacheNode<T> *node = mCache.value(id);
+            EntityListCacheNode<T> *node = mCache.find(id);
             if (!node || node->pending) {
                 return false;
             }
@@ -423,16 +532,10 @@ private:
     /** Tries to reduce the cache size until at least one more object fits in. */
     void shrinkCache(const QList<typename T::Id> &preserveIds)
     {
-        typename QHash<typename T::Id, EntityListCacheNode<T> *>::Iterator iter = mCache.begin();
-        while (iter != mCache.end() && mCache.size() >= mCapacity) {
-            if (iter.value()->pending || preserveIds.contains(iter.key())) {
-                ++iter;
-                continue;
-            }
-
-            delete iter.value();
-            iter = mCache.erase(iter);
-        }
+        const QSet<typename T::Id> preserve(preserveIds.cbegin(), preserveIds.cend());
+        mTotalCost -= mCache.evict(preserve, [this](qint64 evicted) {
+            return mMaxCost > 0 ? (mTotalCost - evicted >= mMaxCost) : (mCache.size() >= mCapacity);
+        });
     }
 
     inline FetchJob *createFetchJob(const QList<typename T::Id> &ids, const FetchScope &scope)
@@ -452,32 +555,32 @@ private:
         typename T::List entities;
         extractResults(job, entities);
 
+        QHash<typename T::Id, qsizetype> entityIndex;
+        entityIndex.reserve(entities.size());
+        for (qsizetype i = 0; i < entities.size(); ++i) {
+            entityIndex.insert(entities.at(i).id(), i);
+        }
+
         for (typename T::Id id : ids) {
-            EntityListCacheNode<T> *node = mCache.value(id);
-            if (!node) {
+            EntityListCacheNode<T> *node = mCache.find(id);
+            if (!node || !node->pending) {
                 continue; // got replaced in the meantime
             }
 
             node->pending = false;
 
-            T result;
-            typename T::List::Iterator iter = entities.begin();
-            for (; iter != entities.end(); ++iter) {
-                if ((*iter).id() == id) {
-                    result = *iter;
-                    entities.erase(iter);
-                    break;
-                }
-            }
-
             // make sure we find this node again if something went wrong here,
             // most likely the object got deleted from the server in the meantime
-            if (!result.isValid()) {
+            const auto idx = entityIndex.constFind(id);
+            if (idx == entityIndex.cend() || !entities.at(*idx).isValid()) {
                 node->entity = T(id);
                 node->invalid = true;
             } else {
-                node->entity = result;
+                node->entity = entities.at(*idx);
             }
+            mTotalCost -= node->cost;
+            node->cost = entityCacheCost(node->entity);
+            mTotalCost += node->cost;
         }
 
         Q_EMIT dataAvailable();
@@ -486,7 +589,7 @@ private:
     void extractResults(KJob *job, typename T::List &entities) const;
 
 private:
-    QHash<typename T::Id, EntityListCacheNode<T> *> mCache;
+    mutable EntityCacheLru<T, EntityListCacheNode<T>> mCache;
     int mCapacity;
 };
 
@@ -526,4 +629,23 @@ inline CollectionFetchJob *EntityListCache<Collection, CollectionFetchJob, Colle
 using CollectionListCache = EntityListCache<Collection, CollectionFetchJob, CollectionFetchScope>;
 using ItemListCache = EntityListCache<Item, ItemFetchJob, ItemFetchScope>;
 using TagListCache = EntityListCache<Tag, TagFetchJob, TagFetchScope>;
+
+/**
+ * @internal
+ * Per-thread registry of item caches shared by all Monitors which use the same
+ * item fetch scope, so that a process with several Monitors or models holds just
+ * one copy of each cached item and its payload.
+ *
+ * Shared caches fetch through the thread's default session and are bounded by
+ * the estimated size of the cached items. Monitors with a custom session keep
+ * a cache of their own.
+ */
+class AKONADI_TESTS_EXPORT SharedItemListCache
+{
+public:
+    /** Returns a cache for @p scope and increases its reference count. */
+    static ItemListCache *acquire(const ItemFetchScope &scope);
+    /** Drops a reference obtained from acquire(), the cache is deleted once unused. */
+    static void release(ItemListCache *cache);
+};
 }
@@ -77,12 +77,15 @@ QString Item::remoteId() const
 
 void Item::setRemoteRevision(const QString &revision)
 {
-    d_ptr->mRemoteRevision = revision;
+    if (!revision.isEmpty() || d_ptr->extra()) {
+        d_ptr->ensureExtra().mRemoteRevision = revision;
+    }
 }
 
 QString Item::remoteRevision() const
 {
-    return d_ptr->mRemoteRevision;
+    const auto extra = d_ptr->extra();
+    return extra ? extra->mRemoteRevision : QString();
 }
 
 bool Item::isValid() const
@@ -234,13 +237,15 @@ bool Item::hasFlag(const QByteArray &name) const
 
 void Item::setTags(const Tag::List &list)
 {
-    d_ptr->mTags = list;
+    if (!list.isEmpty() || d_ptr->extra()) {
+        d_ptr->ensureExtra().mTags = list;
+    }
     d_ptr->mTagsOverwritten = true;
 }
 
 void Item::setTag(const Tag &tag)
 {
-    d_ptr->mTags << tag;
+    d_ptr->ensureExtra().mTags << tag;
     if (!d_ptr->mTagsOverwritten) {
         Tag::List &deletedTags = ItemChangeLog::instance()->deletedTags(d_ptr);
         if (deletedTags.contains(tag)) {
@@ -253,13 +258,17 @@ void Item::setTag(const Tag &tag)
 
 void Item::clearTags()
 {
-    d_ptr->mTags.clear();
+    if (d_ptr->extra()) {
+        d_ptr->ensureExtra().mTags.clear();
+    }
     d_ptr->mTagsOverwritten = true;
 }
 
 void Item::clearTag(const Tag &tag)
 {
-    d_ptr->mTags.removeOne(tag);
+    if (d_ptr->extra()) {
+        d_ptr->ensureExtra().mTags.removeOne(tag);
+    }
     if (!d_ptr->mTagsOverwritten) {
         Tag::List &addedTags = ItemChangeLog::instance()->addedTags(d_ptr);
         if (addedTags.contains(tag)) {
@@ -272,12 +281,14 @@ void Item::clearTag(const Tag &tag)
 
 bool Item::hasTag(const Tag &tag) const
 {
-    return d_ptr->mTags.contains(tag);
+    const auto extra = d_ptr->extra();
+    return extra && extra->mTags.contains(tag);
 }
 
 Tag::List Item::tags() const
 {
-    return d_ptr->mTags;
+    const auto extra = d_ptr->extra();
+    return extra ? extra->mTags : Tag::List();
 }
 
 QSet<QByteArray> Item::loadedPayloadParts() const
@@ -346,22 +357,28 @@ void Item::setMimeType(const QString &mimeType)
 
 void Item::setGid(const QString &id)
 {
-    d_ptr->mGid = id;
+    if (!id.isEmpty() || d_ptr->extra()) {
+        d_ptr->ensureExtra().mGid = id;
+    }
 }
 
 QString Item::gid() const
 {
-    return d_ptr->mGid;
+    const auto extra = d_ptr->extra();
+    return extra ? extra->mGid : QString();
 }
 
 void Item::setVirtualReferences(const Collection::List &collections)
 {
-    d_ptr->mVirtualReferences = collections;
+    if (!collections.isEmpty() || d_ptr->extra()) {
+        d_ptr->ensureExtra().mVirtualReferences = collections;
+    }
 }
 
 Collection::List Item::virtualReferences() const
 {
-    return d_ptr->mVirtualReferences;
+    const auto extra = d_ptr->extra();
+    return extra ? extra->mVirtualReferences : Collection::List();
 }
 
 bool Item::hasPayload() const
@@ -518,12 +535,12 @@ void Item::setPayloadPath(const QString &filePath)
     // Item::payload(). It internally calls setPayload(), which will clear
     // mPayloadPath, so we call it afterwards
     ItemSerializer::deserialize(*this, "RFC822", filePath.toUtf8(), 0, ItemSerializer::Foreign);
-    d_ptr->mPayloadPath = filePath;
+    d_ptr->setPayloadPath(filePath);
 }
 
 QString Item::payloadPath() const
 {
-    return d_ptr->mPayloadPath;
+    return d_ptr->payloadPath();
 }
 
 void Item::apply(const Item &other)
@@ -551,5 +568,5 @@ void Item::apply(const Item &other)
     d_ptr->resetChangeLog();
 
     // Must happen after payload update
-    d_ptr->mPayloadPath = other.payloadPath();
+    d_ptr->setPayloadPath(other.payloadPath());
 }
@@ -135,6 +135,19 @@ inline void swap<Akonadi::_detail::TypedPayload>(Akonadi::_detail::TypedPayload
 namespace Akonadi
 {
 using PayloadContainer = std::vector<_detail::TypedPayload>;
+
+/**
+ * @internal
+ * Rarely used Item properties, only allocated when one of them is set.
+ */
+struct ItemPrivateExtra {
+    QString mRemoteRevision;
+    QString mPayloadPath;
+    // Only fetched when the fetch scope asks for them
+    QString mGid;
+    Tag::List mTags;
+    Collection::List mVirtualReferences;
+};
 }
 
 namespace Akonadi
@@ -166,17 +179,12 @@ public:
         , mRevision(other.mRevision)
         , mId(other.mId)
         , mRemoteId(other.mRemoteId)
-        , mRemoteRevision(other.mRemoteRevision)
-        , mPayloadPath(other.mPayloadPath)
         , mPayloads(other.mPayloads)
         , mFlags(other.mFlags)
-        , mTags(other.mTags)
         , mCollectionId(other.mCollectionId)
-        , mVirtualReferences(other.mVirtualReferences)
         , mSize(other.mSize)
         , mModificationTime(other.mModificationTime)
         , mMimeType(other.mMimeType)
-        , mGid(other.mGid)
         , mCachedPayloadParts(other.mCachedPayloadParts)
         , mFlagsOverwritten(other.mFlagsOverwritten)
         , mTagsOverwritten(other.mTagsOverwritten)
@@ -187,6 +195,9 @@ public:
         if (other.mParent) {
             mParent.reset(new Collection(*(other.mParent)));
         }
+        if (other.mExtra) {
+            mExtra.reset(new ItemPrivateExtra(*(other.mExtra)));
+        }
 
         ItemChangeLog *changelog = ItemChangeLog::instance();
         changelog->addedFlags(this) = changelog->addedFlags(&other);
@@ -210,6 +221,31 @@ public:
         ItemChangeLog::instance()->clearItemChangelog(this);
     }
 
+    const ItemPrivateExtra *extra() const
+    {
+        return mExtra.get();
+    }
+
+    ItemPrivateExtra &ensureExtra() const /*sic!*/
+    {
+        if (!mExtra) {
+            mExtra = std::make_unique<ItemPrivateExtra>();
+        }
+        return *mExtra;
+    }
+
+    QString payloadPath() const
+    {
+        return mExtra ? mExtra->mPayloadPath : QString();
+    }
+
+    void setPayloadPath(const QString &path) const /*sic!*/
+    {
+        if (!path.isEmpty() || mExtra) {
+            ensureExtra().mPayloadPath = path;
+        }
+    }
+
     bool hasMetaTypeId(int mtid) const
     {
         return std::any_of(mPayloads.cbegin(), mPayloads.cend(), _detail::BySharedPointerAndMetaTypeID(-1, mtid));
@@ -250,7 +286,7 @@ public:
 
         // if !add, delete all payload variants
         // (they're conversions of each other)
-        mPayloadPath.clear();
+        setPayloadPath(QString());
         mPayloads.resize(add ? mPayloads.size() + 1 : 1);
         _detail::TypedPayload &tp = mPayloads.back();
         tp.payload.reset(p.release());
@@ -262,26 +298,22 @@ public:
     int mRevision;
     Item::Id mId;
     QString mRemoteId;
-    QString mRemoteRevision;
-    mutable QString mPayloadPath;
+    // Only allocated when needed, most items have no parent beyond the storage collection id
     mutable QScopedPointer<Collection> mParent;
+    mutable std::unique_ptr<ItemPrivateExtra> mExtra;
     mutable PayloadContainer mPayloads;
     Item::Flags mFlags;
-    Tag::List mTags;
     Item::Id mCollectionId;
-    Collection::List mVirtualReferences;
     // TODO: Maybe just use uint? Would save us another 8 bytes after reordering
     qint64 mSize;
     QDateTime mModificationTime;
     QString mMimeType;
-    QString mGid;
     QSet<QByteArray> mCachedPayloadParts;
     bool mFlagsOverwritten : 1;
     bool mTagsOverwritten : 1;
     bool mSizeChanged : 1;
     bool mClearPayload : 1;
     mutable bool mConversionInProgress;
-    // 6 bytes padding here
 };
 
 }
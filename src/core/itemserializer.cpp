@@ -81,6 +81,17 @@ void ItemSerializer::deserialize(Item &item, const QByteArray &label, const QByt
         buffer.open(QIODevice::ReadOnly);
         deserialize(item, label, buffer, version);
         buffer.close();
+    } else if (storage == External && ExternalPartStorage::isPackedName(data)) {
+        bool ok = false;
+        QBuffer buffer;
+        buffer.setData(ExternalPartStorage::readPartFile(data, &ok));
+        if (ok) {
+            buffer.open(QIODevice::ReadOnly);
+            deserialize(item, label, buffer, version);
+            buffer.close();
+        } else {
+            qCWarning(AKONADICORE_LOG) << "Failed to read packed external payload:" << data;
+        }
     } else {
         QFile file;
         if (storage == External) {
@@ -76,8 +76,8 @@ Protocol::PartMetaData ItemCreateJobPrivate::preparePart(const QByteArray &partN
 
     int version = 0;
     if (mForeignParts.contains(partLabel)) {
-        mPendingPart = PendingPart{.name = partName, .data = mItem.d_ptr->mPayloadPath.toUtf8()};
-        const auto size = QFile(mItem.d_ptr->mPayloadPath).size();
+        mPendingPart = PendingPart{.name = partName, .data = mItem.d_ptr->payloadPath().toUtf8()};
+        const auto size = QFile(mItem.d_ptr->payloadPath()).size();
         return Protocol::PartMetaData(partName, size, version, Protocol::PartMetaData::Foreign);
     } else {
         mPendingPart.clear();
@@ -290,5 +290,16 @@ void ItemFetchJob::setLimit(int limit, int start, Qt::SortOrder order)
     d->mItemsLimit.setLimit(limit);
     d->mItemsLimit.setLimitOffset(start);
     d->mItemsLimit.setSortOrder(order);
+    d->mItemsLimit.setAfterId(-1);
 }
+
+void ItemFetchJob::setLimitAfterId(int limit, Item::Id afterId, Qt::SortOrder order)
+{
+    Q_D(ItemFetchJob);
+    d->mItemsLimit.setLimit(limit);
+    d->mItemsLimit.setLimitOffset(-1);
+    d->mItemsLimit.setSortOrder(order);
+    d->mItemsLimit.setAfterId(afterId);
+}
+
 #include "moc_itemfetchjob.cpp"
@@ -230,6 +230,23 @@ public:
 
     void setLimit(int limit, int start, Qt::SortOrder order = Qt::DescendingOrder);
 
+    /**
+     * Sets the limit of fetched items, like setLimit(), but starts with the first
+     * item following the item with the ID @p afterId in @p order.
+     *
+     * Use this to page through a large collection by passing the ID of the last
+     * item of the previous page. Unlike an offset it does not skip or repeat items
+     * when items are added or removed in between, and the server does not have to
+     * walk over all the previous pages.
+     *
+     * @param limit the maximum number of items to retrieve.
+     * @param afterId the ID of the last item of the previous page, -1 to start with the first page.
+     * @param order specifies whether items will be fetched
+     * starting with the highest or lowest ID of the item.
+     * @since 6.4
+     */
+    void setLimitAfterId(int limit, Item::Id afterId, Qt::SortOrder order = Qt::AscendingOrder);
+
 Q_SIGNALS:
     /**
      * This signal is emitted whenever new items have been fetched completely.
@@ -47,8 +47,8 @@ Protocol::PartMetaData ItemModifyJobPrivate::preparePart(const QByteArray &partN
     int version = 0;
     const auto item = mItems.first();
     if (mForeignParts.contains(partLabel)) {
-        mPendingData = item.d_ptr->mPayloadPath.toUtf8();
-        const auto size = QFile(item.d_ptr->mPayloadPath).size();
+        mPendingData = item.d_ptr->payloadPath().toUtf8();
+        const auto size = QFile(item.d_ptr->payloadPath()).size();
         return Protocol::PartMetaData(partName, size, version, Protocol::PartMetaData::Foreign);
     } else {
         ItemSerializer::serialize(mItems.first(), partLabel, mPendingData, version);
@@ -12,11 +12,18 @@
 
 #include <QStringList>
 
+#include <utility>
+
 using namespace Akonadi;
 
 class Akonadi::RecursiveItemFetchJobPrivate
 {
 public:
+    struct PendingFetch {
+        Collection collection;
+        Item::Id lastId = -1; // of the previous page
+    };
+
     RecursiveItemFetchJobPrivate(const Collection &collection, const QStringList &mimeTypes, RecursiveItemFetchJob *parent)
         : mParent(parent)
         , mCollection(collection)
@@ -27,6 +34,8 @@ public:
     void collectionFetchResult(KJob *job)
     {
         if (job->error()) {
+            mParent->setError(job->error());
+            mParent->setErrorText(job->errorText());
             mParent->emitResult();
             return;
         }
@@ -36,54 +45,130 @@ public:
         Collection::List collections = fetchJob->collections();
         collections.prepend(mCollection);
 
+        mPendingFetches.reserve(collections.size());
         for (const Collection &collection : std::as_const(collections)) {
-            auto itemFetchJob = new ItemFetchJob(collection, mParent);
-            itemFetchJob->setFetchScope(mFetchScope);
-            mParent->connect(itemFetchJob, &KJob::result, mParent, [this](KJob *job) {
-                itemFetchResult(job);
-            });
+            mPendingFetches.push_back({collection, -1});
+        }
+
+        scheduleFetches();
+    }
+
+    void scheduleFetches()
+    {
+        while (!mSuspended && !mPendingFetches.isEmpty() && (mMaxParallelFetches <= 0 || mFetchCount < mMaxParallelFetches)) {
+            startFetch(mPendingFetches.takeFirst());
+        }
 
-            mFetchCount++;
+        if (mFetchCount == 0 && mPendingFetches.isEmpty() && mBufferedItems.isEmpty()) {
+            mParent->emitResult();
         }
     }
 
-    void itemFetchResult(KJob *job)
+    void startFetch(const PendingFetch &fetch)
+    {
+        auto itemFetchJob = new ItemFetchJob(fetch.collection, mParent);
+        itemFetchJob->setFetchScope(mFetchScope);
+        if (mBatchSize > 0) {
+            itemFetchJob->setDeliveryOption(ItemFetchJob::ItemGetter);
+            itemFetchJob->setLimitAfterId(mBatchSize, fetch.lastId, Qt::AscendingOrder);
+        }
+        mParent->connect(itemFetchJob, &KJob::result, mParent, [this, fetch](KJob *job) {
+            itemFetchResult(job, fetch);
+        });
+
+        mFetchCount++;
+    }
+
+    void itemFetchResult(KJob *job, const PendingFetch &fetch)
     {
-        if (!job->error()) {
+        mFetchCount--;
+
+        if (job->error()) {
+            // Report the first error, and only wait for the running fetches before giving up
+            if (!mParent->error()) {
+                mParent->setError(job->error());
+                mParent->setErrorText(job->errorText());
+            }
+            mPendingFetches.clear();
+        } else {
             const ItemFetchJob *fetchJob = qobject_cast<ItemFetchJob *>(job);
 
+            Item::List items;
             if (!mMimeTypes.isEmpty()) {
                 const Akonadi::Item::List lstItems = fetchJob->items();
                 for (const Item &item : lstItems) {
                     if (mMimeTypes.contains(item.mimeType())) {
-                        mItems << item;
+                        items << item;
                     }
                 }
             } else {
-                mItems << fetchJob->items();
+                items = fetchJob->items();
+            }
+
+            if (mBatchSize > 0) {
+                // A full page means there might be more, continue with this collection
+                // before moving on to the next one
+                const Item::List &page = fetchJob->items();
+                if (fetchJob->count() >= mBatchSize && !page.isEmpty() && !mParent->error()) {
+                    mPendingFetches.prepend({fetch.collection, page.constLast().id()});
+                }
+            } else {
+                mItems << items;
             }
+            deliverItems(items);
         }
 
-        mFetchCount--;
+        scheduleFetches();
+    }
 
-        if (mFetchCount == 0) {
-            mParent->emitResult();
+    void deliverItems(const Item::List &items)
+    {
+        if (items.isEmpty()) {
+            return;
+        }
+        if (mSuspended) {
+            mBufferedItems << items;
+            return;
+        }
+        Q_EMIT mParent->itemsReceived(items);
+    }
+
+    void suspend()
+    {
+        mSuspended = true;
+    }
+
+    void resume()
+    {
+        mSuspended = false;
+        if (!mBufferedItems.isEmpty()) {
+            Q_EMIT mParent->itemsReceived(std::exchange(mBufferedItems, {}));
+        }
+        // The receiver may have suspended us again
+        if (!mSuspended) {
+            scheduleFetches();
         }
     }
 
     RecursiveItemFetchJob *const mParent;
     const Collection mCollection;
     Item::List mItems;
+    Item::List mBufferedItems; // received while suspended
+    QList<PendingFetch> mPendingFetches;
     ItemFetchScope mFetchScope;
     const QStringList mMimeTypes;
 
     int mFetchCount = 0;
+    int mMaxParallelFetches = 0;
+    int mBatchSize = 0;
+    bool mSuspended = false;
 };
 
 RecursiveItemFetchJob::RecursiveItemFetchJob(const Collection &collection, const QStringList &mimeTypes, QObject *parent)
     : KJob(parent)
     , d(new RecursiveItemFetchJobPrivate(collection, mimeTypes, this))
 {
+    setCapabilities(KJob::Suspendable);
 }
 
 RecursiveItemFetchJob::~RecursiveItemFetchJob() = default;
@@ -98,6 +183,26 @@ ItemFetchScope &RecursiveItemFetchJob::fetchScope()
     return d->mFetchScope;
 }
 
+void RecursiveItemFetchJob::setMaximumParallelFetches(int count)
+{
+    d->mMaxParallelFetches = count;
+}
+
+int RecursiveItemFetchJob::maximumParallelFetches() const
+{
+    return d->mMaxParallelFetches;
+}
+
+void RecursiveItemFetchJob::setStreamingBatchSize(int batchSize)
+{
+    d->mBatchSize = batchSize;
+}
+
+int RecursiveItemFetchJob::streamingBatchSize() const
+{
+    return d->mBatchSize;
+}
+
 void RecursiveItemFetchJob::start()
 {
     auto job = new CollectionFetchJob(d->mCollection, CollectionFetchJob::Recursive, this);
@@ -111,6 +216,18 @@ void RecursiveItemFetchJob::start()
     });
 }
 
+bool RecursiveItemFetchJob::doSuspend()
+{
+    d->suspend();
+    return true;
+}
+
+bool RecursiveItemFetchJob::doResume()
+{
+    d->resume();
+    return true;
+}
+
 Akonadi::Item::List RecursiveItemFetchJob::items() const
 {
     return d->mItems;
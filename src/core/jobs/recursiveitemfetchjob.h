@@ -67,6 +67,26 @@ class RecursiveItemFetchJobPrivate;
  *
  * @endcode
  *
+ * For large trees, e.g. when exporting or indexing a whole account, the job can
+ * be switched to streaming mode with setStreamingBatchSize(). The items are then
+ * fetched page by page, handed out through itemsReceived() and not kept in memory.
+ * The job can be suspended with KJob::suspend() while the receiver catches up, so
+ * the memory use is bounded by maximumParallelFetches() times the batch size.
+ *
+ * @code
+ *
+ * auto job = new Akonadi::RecursiveItemFetchJob(accountCollection, QStringList());
+ * job->setStreamingBatchSize(500);
+ * job->setMaximumParallelFetches(2);
+ * connect(job, &Akonadi::RecursiveItemFetchJob::itemsReceived, this, [job](const Akonadi::Item::List &items) {
+ *     if (!writeToArchive(items)) {
+ *         job->suspend(); // resume() once the archive has been flushed
+ *     }
+ * });
+ * job->start();
+ *
+ * @endcode
+ *
  * @author Tobias Koenig <tokoe@kde.org>
  * @since 4.6
  */
@@ -118,14 +138,66 @@ public:
 
     /**
      * Returns the list of fetched items.
+     *
+     * In streaming mode the items are only delivered through itemsReceived()
+     * and this list stays empty.
      */
     [[nodiscard]] Akonadi::Item::List items() const;
 
+    /**
+     * Sets the maximum number of collections whose items are fetched at the
+     * same time. The default, 0, fetches all collections at once.
+     *
+     * @since 6.4
+     */
+    void setMaximumParallelFetches(int count);
+
+    /**
+     * Returns the maximum number of collections whose items are fetched at the same time.
+     *
+     * @since 6.4
+     */
+    [[nodiscard]] int maximumParallelFetches() const;
+
+    /**
+     * Enables streaming mode: items are fetched in pages of at most @p batchSize
+     * items per collection, delivered through itemsReceived() and not accumulated
+     * for items(). Pass 0 to disable streaming, which is the default.
+     *
+     * @since 6.4
+     */
+    void setStreamingBatchSize(int batchSize);
+
+    /**
+     * Returns the page size used in streaming mode, or 0 if streaming is disabled.
+     *
+     * @since 6.4
+     */
+    [[nodiscard]] int streamingBatchSize() const;
+
     /**
      * Starts the recursive item fetch job.
+     *
+     * If the items of one of the collections cannot be fetched, no further
+     * collections are fetched and the job finishes with the first error.
      */
     void start() override;
 
+Q_SIGNALS:
+    /**
+     * Emitted whenever items of one of the collections have been received.
+     * No items are emitted while the job is suspended, they are delivered
+     * when it is resumed.
+     *
+     * @param items The fetched items.
+     * @since 6.4
+     */
+    void itemsReceived(const Akonadi::Item::List &items);
+
+protected:
+    bool doSuspend() override;
+    bool doResume() override;
+
 private:
     /// @cond PRIVATE
     friend class RecursiveItemFetchJobPrivate;
@@ -222,6 +222,7 @@ void Monitor::fetchChangedOnly(bool enable)
 {
     Q_D(Monitor);
     d->mFetchChangedOnly = enable;
+    d->updateItemCache();
 }
 
 void Monitor::setCollectionFetchScope(const CollectionFetchScope &fetchScope)
@@ -338,7 +339,10 @@ void Monitor::setSession(Akonadi::Session *session)
         d->session = session;
     }
 
-    d->itemCache->setSession(d->session);
+    if (!d->itemCacheShared) {
+        d->itemCache->setSession(d->session);
+    }
+    d->updateItemCache();
     d->collectionCache->setSession(d->session);
     d->tagCache->setSession(d->session);
 
@@ -432,6 +432,18 @@ Q_SIGNALS:
      */
     void itemChanged(const Akonadi::Item &item, const QSet<QByteArray> &partIdentifiers);
 
+    /**
+     * This signal is emitted if the same parts of multiple monitored items have changed.
+     *
+     * Item changes are only delivered in batches by ChangeRecorder, see
+     * ChangeRecorder::setReplayBatchSize().
+     *
+     * @param items The changed items.
+     * @param partIdentifiers The identifiers of the item parts that have been changed in each item in @p items.
+     * @since 6.4
+     */
+    void itemsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &partIdentifiers);
+
     /**
      * This signal is emitted if flags of monitored items have changed.
      *
@@ -480,6 +492,18 @@ Q_SIGNALS:
      */
     void itemAdded(const Akonadi::Item &item, const Akonadi::Collection &collection);
 
+    /**
+     * This signal is emitted if multiple items have been added to a monitored collection in the Akonadi storage.
+     *
+     * Item additions are only delivered in batches by ChangeRecorder, see
+     * ChangeRecorder::setReplayBatchSize().
+     *
+     * @param items The new items.
+     * @param collection The collection the items have been added to.
+     * @since 6.4
+     */
+    void itemsAdded(const Akonadi::Item::List &items, const Akonadi::Collection &collection);
+
     /**
      * This signal is emitted if
      *   - a monitored item has been removed from the Akonadi storage
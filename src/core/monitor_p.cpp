@@ -30,6 +30,11 @@ class operation;
 
 static const int PipelineSize = 5;
 
+// Size budgets of the per-Monitor caches, the shared item cache has its own
+static const qint64 ItemCacheMaxCost = 4 * 1024 * 1024;
+static const qint64 CollectionCacheMaxCost = 512 * 1024;
+static const qint64 TagCacheMaxCost = 128 * 1024;
+
 MonitorPrivate::MonitorPrivate(ChangeNotificationDependenciesFactory *dependenciesFactory_, Monitor *parent)
     : q_ptr(parent)
     , dependenciesFactory(dependenciesFactory_ ? dependenciesFactory_ : new ChangeNotificationDependenciesFactory)
@@ -52,9 +57,14 @@ MonitorPrivate::MonitorPrivate(ChangeNotificationDependenciesFactory *dependenci
 MonitorPrivate::~MonitorPrivate()
 {
     disconnectFromNotificationManager();
+    if (itemCacheShared) {
+        QObject::disconnect(itemCache, nullptr, q_ptr, nullptr);
+        dependenciesFactory->releaseSharedItemListCache(itemCache);
+    } else {
+        delete itemCache;
+    }
     delete dependenciesFactory;
     delete collectionCache;
-    delete itemCache;
     delete tagCache;
 }
 
@@ -67,6 +77,10 @@ void MonitorPrivate::init()
     // 20 tags looks like a reasonable amount to keep around
     tagCache = dependenciesFactory->createTagListCache(20, session);
 
+    collectionCache->setMaxCost(CollectionCacheMaxCost);
+    itemCache->setMaxCost(ItemCacheMaxCost);
+    tagCache->setMaxCost(TagCacheMaxCost);
+
     QObject::connect(collectionCache, &CollectionCache::dataAvailable, q_ptr, [this]() {
         dataAvailable();
     });
@@ -181,6 +195,7 @@ void MonitorPrivate::slotUpdateSubscription()
 
     if (pendingModificationChanges & Protocol::ModifySubscriptionCommand::ItemFetchScope) {
         pendingModification.setItemFetchScope(ProtocolHelper::itemFetchScopeToProtocol(mItemFetchScope));
+        updateItemCache();
     }
     if (pendingModificationChanges & Protocol::ModifySubscriptionCommand::CollectionFetchScope) {
         pendingModification.setCollectionFetchScope(ProtocolHelper::collectionFetchScopeToProtocol(mCollectionFetchScope));
@@ -196,6 +211,49 @@ void MonitorPrivate::slotUpdateSubscription()
     }
 }
 
+void MonitorPrivate::updateItemCache()
+{
+    // Items fetched with a per-notification scope (mFetchChangedOnly) must not leak
+    // into the caches of other Monitors. The shared caches fetch through the default
+    // session, so a Monitor with its own session keeps its own cache, too.
+    const bool share = fetchItems() && !mFetchChangedOnly && session == Session::defaultSession();
+    ItemListCache *cache = share ? dependenciesFactory->acquireSharedItemListCache(mItemFetchScope) : nullptr;
+    if (cache == itemCache) {
+        dependenciesFactory->releaseSharedItemListCache(cache);
+        return;
+    }
+    if (!cache && !itemCacheShared) {
+        return;
+    }
+
+    QObject::disconnect(itemCache, nullptr, q_ptr, nullptr);
+    if (itemCacheShared) {
+        dependenciesFactory->releaseSharedItemListCache(itemCache);
+    } else {
+        delete itemCache;
+    }
+
+    itemCacheShared = (cache != nullptr);
+    if (itemCacheShared) {
+        itemCache = cache;
+    } else {
+        itemCache = dependenciesFactory->createItemListCache(PipelineSize, session);
+        itemCache->setMaxCost(ItemCacheMaxCost);
+    }
+    QObject::connect(itemCache, &ItemCache::dataAvailable, q_ptr, [this]() {
+        dataAvailable();
+    });
+
+    // The pipeline may be waiting for items which are in the new cache already,
+    // or which have been requested from the old one only.
+    QMetaObject::invokeMethod(
+        q_ptr,
+        [this]() {
+            dataAvailable();
+        },
+        Qt::QueuedConnection);
+}
+
 bool MonitorPrivate::isLazilyIgnored(const Protocol::ChangeNotificationPtr &msg, bool allowModifyFlagsConversion) const
 {
     if (msg->type() == Protocol::Command::CollectionChangeNotification) {
@@ -213,9 +271,9 @@ bool MonitorPrivate::isLazilyIgnored(const Protocol::ChangeNotificationPtr &msg,
     if (!fetchCollectionStatistics && msg->type() == Protocol::Command::ItemChangeNotification) {
         const auto &itemNtf = Protocol::cmdCast<Protocol::ItemChangeNotification>(msg);
         const auto op = itemNtf.operation();
-        if ((op == Protocol::ItemChangeNotification::Add && !hasListeners(&Monitor::itemAdded))
+        if ((op == Protocol::ItemChangeNotification::Add && !hasListeners(&Monitor::itemAdded) && !hasListeners(&Monitor::itemsAdded))
             || (op == Protocol::ItemChangeNotification::Remove && !hasListeners(&Monitor::itemRemoved) && !hasListeners(&Monitor::itemsRemoved))
-            || (op == Protocol::ItemChangeNotification::Modify && !hasListeners(&Monitor::itemChanged))
+            || (op == Protocol::ItemChangeNotification::Modify && !hasListeners(&Monitor::itemChanged) && !hasListeners(&Monitor::itemsChanged))
             || (op == Protocol::ItemChangeNotification::ModifyFlags
                 && !hasListeners(&Monitor::itemsFlagsChanged)
                 // Newly delivered ModifyFlags notifications will be converted to
@@ -266,12 +324,12 @@ void MonitorPrivate::checkBatchSupport(const Protocol::ChangeNotificationPtr &ms
 
     switch (itemNtf.operation()) {
     case Protocol::ItemChangeNotification::Add:
-    case Protocol::ItemChangeNotification::Modify:
-        needsSplit = isBatch;
-        batchSupported = false;
+        needsSplit = isBatch && hasListeners(&Monitor::itemAdded);
+        batchSupported = hasListeners(&Monitor::itemsAdded);
         return;
-        needsSplit = isBatch;
-        batchSupported = false;
+    case Protocol::ItemChangeNotification::Modify:
+        needsSplit = isBatch && hasListeners(&Monitor::itemChanged);
+        batchSupported = hasListeners(&Monitor::itemsChanged);
         return;
     case Protocol::ItemChangeNotification::ModifyFlags:
         batchSupported = hasListeners(&Monitor::itemsFlagsChanged);
@@ -760,6 +818,7 @@ void MonitorPrivate::handleCommands()
 
     CommandBufferLocker lock(&mCommandBuffer);
     CommandBufferNotifyBlocker notify(&mCommandBuffer);
+    bool notified = false;
     while (!mCommandBuffer.isEmpty()) {
         const auto cmd = mCommandBuffer.dequeue();
         lock.unlock();
@@ -835,6 +894,7 @@ void MonitorPrivate::handleCommands()
             case Protocol::Command::SubscriptionChangeNotification:
             case Protocol::Command::DebugChangeNotification:
                 slotNotify(command.staticCast<Protocol::ChangeNotification>());
+                notified = true;
                 break;
             default:
                 qCWarning(AKONADICORE_LOG) << "Received an unexpected message on Notification stream:" << Protocol::debugString(command);
@@ -846,6 +906,13 @@ void MonitorPrivate::handleCommands()
     }
     notify.unblock();
     lock.unlock();
+
+    // Fetch the data for the whole batch of notifications at once, before the
+    // pipeline requests it for the first notifications one by one
+    if (notified) {
+        prefetchPendingData();
+        dispatchNotifications();
+    }
 }
 
 /*
@@ -936,7 +1003,7 @@ void MonitorPrivate::slotNotify(const Protocol::ChangeNotificationPtr &msg)
         }
     }
 
-    dispatchNotifications();
+    // The notifications are dispatched once the received batch is queued, see handleCommands()
 }
 
 void MonitorPrivate::flushPipeline()
@@ -960,6 +1027,113 @@ void MonitorPrivate::dataAvailable()
     dispatchNotifications();
 }
 
+void MonitorPrivate::collectPrefetchIds(const Protocol::ChangeNotificationPtr &msg,
+                                        QSet<Item::Id> &itemIds,
+                                        QList<Collection::Id> &collectionIds,
+                                        QSet<Tag::Id> &tagIds) const
+{
+    // Mirrors the requirements checked by ensureDataAvailable(), but only for the
+    // monitor-wide fetch scopes. Notifications that need a custom scope (mFetchChangedOnly)
+    // are still fetched individually when they reach the pipeline.
+    const auto addCollection = [&collectionIds](Collection::Id id) {
+        if (id > -1 && !collectionIds.contains(id)) {
+            collectionIds.push_back(id);
+        }
+    };
+
+    switch (msg->type()) {
+    case Protocol::Command::TagChangeNotification: {
+        const auto &tagMsg = Protocol::cmdCast<Protocol::TagChangeNotification>(msg);
+        if (tagMsg.metadata().contains("FETCH_TAG")) {
+            tagIds.insert(tagMsg.tag().id());
+        }
+        return;
+    }
+    case Protocol::Command::CollectionChangeNotification: {
+        const auto &colMsg = Protocol::cmdCast<Protocol::CollectionChangeNotification>(msg);
+        if (colMsg.operation() == Protocol::CollectionChangeNotification::Remove) {
+            addCollection(colMsg.parentCollection());
+            return;
+        }
+        if (fetchCollections()) {
+            addCollection(colMsg.parentCollection());
+            if (colMsg.operation() == Protocol::CollectionChangeNotification::Move) {
+                addCollection(colMsg.parentDestCollection());
+            }
+            if (colMsg.metadata().contains("FETCH_COLLECTION")) {
+                addCollection(colMsg.collection().id());
+            }
+        }
+        return;
+    }
+    case Protocol::Command::ItemChangeNotification: {
+        const auto &itemMsg = Protocol::cmdCast<Protocol::ItemChangeNotification>(msg);
+        if (fetchCollections()) {
+            addCollection(itemMsg.parentCollection());
+            if (itemMsg.operation() == Protocol::ItemChangeNotification::Move) {
+                addCollection(itemMsg.parentDestCollection());
+            }
+        }
+        if (itemMsg.isRemove() || !fetchItems()) {
+            return;
+        }
+        if (mFetchChangedOnly
+            && (itemMsg.operation() == Protocol::ItemChangeNotification::Modify || itemMsg.operation() == Protocol::ItemChangeNotification::ModifyFlags)) {
+            return;
+        }
+        if (itemMsg.metadata().contains("FETCH_ITEM") || itemMsg.mustRetrieve()) {
+            for (const auto &item : itemMsg.items()) {
+                itemIds.insert(item.id());
+            }
+        }
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+void MonitorPrivate::prefetchPendingData()
+{
+    // Note that this code is not used in a ChangeRecorder (pipelineSize==0), which
+    // replays its notifications one by one and would only bloat the caches.
+    if (pipelineSize() == 0 || pendingNotifications.size() < 2) {
+        return;
+    }
+
+    QSet<Item::Id> itemIds;
+    QList<Collection::Id> collectionIds;
+    QSet<Tag::Id> tagIds;
+    // Include the pipeline too, so that the data it is waiting for is preserved
+    // when the list caches make room for the new requests.
+    for (const auto &msg : std::as_const(pipeline)) {
+        collectPrefetchIds(msg, itemIds, collectionIds, tagIds);
+    }
+    for (const auto &msg : std::as_const(pendingNotifications)) {
+        collectPrefetchIds(msg, itemIds, collectionIds, tagIds);
+    }
+
+    if (!itemIds.isEmpty()) {
+        itemCache->ensureCached(QList<Item::Id>(itemIds.cbegin(), itemIds.cend()), mItemFetchScope);
+    }
+    if (!tagIds.isEmpty()) {
+        tagCache->ensureCached(QList<Tag::Id>(tagIds.cbegin(), tagIds.cend()), mTagFetchScope);
+    }
+
+    // The collection cache fetches one collection per job, so only warm it up for
+    // as many new collections as one pipeline can consume.
+    int requested = 0;
+    for (const auto id : std::as_const(collectionIds)) {
+        if (requested >= PipelineSize) {
+            break;
+        }
+        if (!collectionCache->isRequested(id)) {
+            collectionCache->ensureCached(id, mCollectionFetchScope);
+            ++requested;
+        }
+    }
+}
+
 void MonitorPrivate::dispatchNotifications()
 {
     // Note that this code is not used in a ChangeRecorder (pipelineSize==0)
@@ -1017,9 +1191,13 @@ bool MonitorPrivate::emitItemsNotification(const Protocol::ItemChangeNotificatio
     bool handled = false;
     switch (msg.operation()) {
     case Protocol::ItemChangeNotification::Add:
-        return emitToListeners(&Monitor::itemAdded, its.first(), col);
+        handled |= emitToListeners(&Monitor::itemAdded, its.first(), col);
+        handled |= emitToListeners(&Monitor::itemsAdded, its, col);
+        return handled;
     case Protocol::ItemChangeNotification::Modify:
-        return emitToListeners(&Monitor::itemChanged, its.first(), msg.itemParts());
+        handled |= emitToListeners(&Monitor::itemChanged, its.first(), msg.itemParts());
+        handled |= emitToListeners(&Monitor::itemsChanged, its, msg.itemParts());
+        return handled;
     case Protocol::ItemChangeNotification::ModifyFlags:
         return emitToListeners(&Monitor::itemsFlagsChanged, its, msg.addedFlags(), msg.removedFlags());
     case Protocol::ItemChangeNotification::Move:
@@ -1296,12 +1474,13 @@ void MonitorPrivate::updateListeners(QMetaMethod signal, ListenerAction action)
     }
 
     UPDATE_LISTENERS(&Monitor::itemChanged)
-    UPDATE_LISTENERS(&Monitor::itemChanged)
+    UPDATE_LISTENERS(&Monitor::itemsChanged)
     UPDATE_LISTENERS(&Monitor::itemsFlagsChanged)
     UPDATE_LISTENERS(&Monitor::itemsTagsChanged)
     UPDATE_LISTENERS(&Monitor::itemMoved)
     UPDATE_LISTENERS(&Monitor::itemsMoved)
     UPDATE_LISTENERS(&Monitor::itemAdded)
+    UPDATE_LISTENERS(&Monitor::itemsAdded)
     UPDATE_LISTENERS(&Monitor::itemRemoved)
     UPDATE_LISTENERS(&Monitor::itemsRemoved)
     UPDATE_LISTENERS(&Monitor::itemLinked)
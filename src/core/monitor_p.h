@@ -96,6 +96,7 @@ public:
     Session *session = nullptr;
     CollectionCache *collectionCache = nullptr;
     ItemListCache *itemCache = nullptr;
+    bool itemCacheShared = false;
     TagListCache *tagCache = nullptr;
     QMimeDatabase mimeDatabase;
     QHash<SignalId, quint16> listeners;
@@ -136,6 +137,12 @@ public:
     void dispatchNotifications();
     void flushPipeline();
 
+    /**
+     * Requests the data needed by all queued notifications in as few fetch
+     * jobs as possible, so that dispatchNotifications() finds it cached.
+     */
+    void prefetchPendingData();
+
     bool ensureDataAvailable(const Protocol::ChangeNotificationPtr &msg);
     /**
      * Sends out the change notification @p msg.
@@ -212,6 +219,12 @@ public:
     void scheduleSubscriptionUpdate();
     void slotUpdateSubscription();
 
+    /**
+     * Switches to the item cache shared by all Monitors with the same item fetch
+     * scope, or back to a private one when the scope cannot be shared.
+     */
+    void updateItemCache();
+
     void updateListeners(QMetaMethod signal, ListenerAction action);
 
     template<typename Signal>
@@ -364,6 +377,10 @@ private:
     }
 
     void notifyCollectionStatisticsWatchers(Collection::Id collection, const QByteArray &resource);
+    void collectPrefetchIds(const Protocol::ChangeNotificationPtr &msg,
+                            QSet<Item::Id> &itemIds,
+                            QList<Collection::Id> &collectionIds,
+                            QSet<Tag::Id> &tagIds) const;
     bool fetchCollections() const;
     bool fetchItems() const;
 
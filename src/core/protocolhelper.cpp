@@ -18,6 +18,7 @@
 #include "tagfetchscope.h"
 
 #include "private/externalpartstorage_p.h"
+#include "private/partcompression_p.h"
 #include "private/protocol_p.h"
 
 #include "shared/akranges.h"
@@ -556,28 +557,38 @@ TagFetchScope ProtocolHelper::parseTagFetchScope(const Protocol::TagFetchScope &
     return tfs;
 }
 
-static Item::Flags convertFlags(const QList<QByteArray> &flags, ProtocolHelperValuePool *valuePool)
+using FlagPool = Internal::ConcurrentSharedValuePool<QByteArray, QList>;
+Q_GLOBAL_STATIC(FlagPool, s_flagPool) // NOLINT(readability-redundant-member-init)
+
+QByteArray ProtocolHelperValuePool::sharedFlag(const QByteArray &flag)
+{
+    return s_flagPool->sharedValue(flag);
+}
+
+static Item::Flags convertFlags(const QList<QByteArray> &flags)
 {
-#if __cplusplus >= 201103L || defined(__GNUC__) || defined(__clang__)
-    // When the compiler supports thread-safe static initialization (mandated by the C++11 memory model)
-    // then use it to share the common case of a single-item set only containing the \SEEN flag.
-    // NOTE: GCC and clang has threadsafe static initialization for some time now, even without C++11.
+    // Share the common case of a set only containing the \SEEN flag
     if (flags.size() == 1 && flags.first() == "\\SEEN") {
-        static const Item::Flags sharedSeen = Item::Flags() << QByteArray("\\SEEN");
+        static const Item::Flags sharedSeen{ProtocolHelperValuePool::sharedFlag(QByteArrayLiteral("\\SEEN"))};
         return sharedSeen;
     }
-#endif
 
-    Item::Flags convertedFlags;
-    convertedFlags.reserve(flags.size());
+    Item::Flags converted;
+    converted.reserve(flags.size());
     for (const QByteArray &flag : flags) {
-        if (valuePool) {
-            convertedFlags.insert(valuePool->flagPool.sharedValue(flag));
-        } else {
-            convertedFlags.insert(flag);
-        }
+        converted.insert(ProtocolHelperValuePool::sharedFlag(flag));
+    }
+    return converted;
+}
+
+static QSet<QByteArray> convertPartNames(const QList<QByteArray> &parts, ProtocolHelperValuePool *valuePool)
+{
+    QSet<QByteArray> converted;
+    converted.reserve(parts.size());
+    for (const QByteArray &part : parts) {
+        converted.insert(valuePool ? valuePool->partNamePool.sharedValue(part) : part);
     }
-    return convertedFlags;
+    return converted;
 }
 
 Item ProtocolHelper::parseItemFetchResult(const Protocol::FetchItemsResponse &data,
@@ -604,7 +615,7 @@ Item ProtocolHelper::parseItemFetchResult(const Protocol::FetchItemsResponse &da
         return Item();
     }
 
-    item.setFlags(convertFlags(data.flags(), valuePool));
+    item.setFlags(convertFlags(data.flags()));
 
     const auto fetchedTags = data.tags();
     if ((!fetchScope || fetchScope->fetchTags()) && !fetchedTags.isEmpty()) {
@@ -628,12 +639,7 @@ Item ProtocolHelper::parseItemFetchResult(const Protocol::FetchItemsResponse &da
 
     const auto cachedParts = data.cachedParts();
     if (!cachedParts.isEmpty()) {
-        QSet<QByteArray> cp;
-        cp.reserve(cachedParts.size());
-        for (const QByteArray &ba : cachedParts) {
-            cp.insert(ba);
-        }
-        item.setCachedPayloadParts(cp);
+        item.setCachedPayloadParts(convertPartNames(cachedParts, valuePool));
     }
 
     item.setSize(data.size());
@@ -644,14 +650,33 @@ Item ProtocolHelper::parseItemFetchResult(const Protocol::FetchItemsResponse &da
         ProtocolHelper::PartNamespace ns;
         const QByteArray plainKey = decodePartIdentifier(part.payloadName(), ns);
         const auto metaData = part.metaData();
+        auto storageType = metaData.storageType();
+        QByteArray partData = part.data();
+        if (metaData.compression() == Protocol::PartMetaData::Zstd) {
+            // Compressed parts are decompressed here, so from now on they are just internal parts
+            bool ok = false;
+            if (storageType == Protocol::PartMetaData::External) {
+                partData = ExternalPartStorage::readPartFile(partData, &ok);
+            } else {
+                ok = true;
+            }
+            if (ok) {
+                partData = PartCompression::decompress(partData, &ok);
+            }
+            if (!ok) {
+                qCWarning(AKONADICORE_LOG) << "Failed to decompress item part:" << part.payloadName();
+                continue;
+            }
+            storageType = Protocol::PartMetaData::Internal;
+        }
         switch (ns) {
         case ProtocolHelper::PartPayload:
             if (fetchScope && !fetchScope->fullPayload() && !fetchScope->payloadParts().contains(plainKey)) {
                 continue;
             }
-            ItemSerializer::deserialize(item, plainKey, part.data(), metaData.version(), static_cast<ItemSerializer::PayloadStorage>(metaData.storageType()));
-            if (metaData.storageType() == Protocol::PartMetaData::Foreign) {
-                item.d_ptr->mPayloadPath = QString::fromUtf8(part.data());
+            ItemSerializer::deserialize(item, plainKey, partData, metaData.version(), static_cast<ItemSerializer::PayloadStorage>(storageType));
+            if (storageType == Protocol::PartMetaData::Foreign) {
+                item.d_ptr->setPayloadPath(QString::fromUtf8(partData));
             }
             break;
         case ProtocolHelper::PartAttribute: {
@@ -660,18 +685,18 @@ Item ProtocolHelper::parseItemFetchResult(const Protocol::FetchItemsResponse &da
             }
             Attribute *attr = AttributeFactory::createAttribute(plainKey);
             Q_ASSERT(attr);
-            if (metaData.storageType() == Protocol::PartMetaData::External) {
-                const QString filename = ExternalPartStorage::resolveAbsolutePath(part.data());
-                QFile file(filename);
-                if (file.open(QFile::ReadOnly)) {
-                    attr->deserialize(file.readAll());
+            if (storageType == Protocol::PartMetaData::External) {
+                bool ok = false;
+                const QByteArray data = ExternalPartStorage::readPartFile(partData, &ok);
+                if (ok) {
+                    attr->deserialize(data);
                 } else {
-                    qCWarning(AKONADICORE_LOG) << "Failed to open attribute file: " << filename;
+                    qCWarning(AKONADICORE_LOG) << "Failed to open attribute file: " << partData;
                     delete attr;
                     attr = nullptr;
                 }
             } else {
-                attr->deserialize(part.data());
+                attr->deserialize(partData);
             }
             if (attr) {
                 item.addAttribute(attr);
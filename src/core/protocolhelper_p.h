@@ -33,11 +33,18 @@ using namespace AkRanges;
 namespace Akonadi
 {
 struct ProtocolHelperValuePool {
-    using FlagPool = Internal::SharedValuePool<QByteArray, QList>;
     using MimeTypePool = Internal::SharedValuePool<QString, QList>;
+    using PartNamePool = Internal::SharedValuePool<QByteArray, QList>;
+
+    /**
+      Returns the process-wide shared instance of @p flag. Flags are interned
+      across all fetch jobs, there are typically few distinct flags but a lot
+      of items carrying them.
+    */
+    static QByteArray sharedFlag(const QByteArray &flag);
 
-    FlagPool flagPool;
     MimeTypePool mimeTypePool;
+    PartNamePool partNamePool;
     QHash<Collection::Id, Collection> ancestorCollections;
 };
 
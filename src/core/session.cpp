@@ -9,6 +9,7 @@
 
 #include "job.h"
 #include "job_p.h"
+#include "private/partcompression_p.h"
 #include "private/protocol_p.h"
 #include "protocolhelper_p.h"
 #include "servermanager.h"
@@ -116,7 +117,9 @@ bool SessionPrivate::handleCommands()
             Internal::setServerProtocolVersion(protocolVersion);
             Internal::setGeneration(hello.generation());
 
-            sendCommand(nextTag(), Protocol::LoginCommandPtr::create(sessionId));
+            auto login = Protocol::LoginCommandPtr::create(sessionId, Protocol::LoginCommand::CompactEncoding);
+            login->setAcceptCompressedParts(PartCompression::isAvailable());
+            sendCommand(nextTag(), login);
         } else if (cmd->type() == Protocol::Command::Login) {
             const auto &login = Protocol::cmdCast<Protocol::LoginResponse>(cmd);
             if (login.isError()) {
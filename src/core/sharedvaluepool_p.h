@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <QMutex>
+#include <QSet>
+
 #include <algorithm>
 
 namespace Akonadi
@@ -15,25 +18,79 @@ namespace Internal
 /**
  * Pool of implicitly shared values, use for optimizing memory use
  * when having a large amount of copies from a small set of different values.
+ *
+ * Small pools are searched linearly, once the pool grows beyond HashThreshold
+ * values it switches to a hash lookup.
  */
 template<typename T, template<typename> class Container>
 class SharedValuePool
 {
 public:
+    /** Number of values up to which a linear search is used. */
+    static constexpr qsizetype HashThreshold = 32;
+
     /** Returns the shared value equal to @p value .*/
     T sharedValue(const T &value)
     {
+        if (!m_index.isEmpty()) {
+            const auto it = m_index.constFind(value);
+            if (it != m_index.constEnd()) {
+                return *it;
+            }
+            m_index.insert(value);
+            return value;
+        }
+
         // for small pool sizes this is actually faster than using lower_bound and a sorted vector
+        // or hashing the value
         typename Container<T>::const_iterator it = std::find(m_pool.constBegin(), m_pool.constEnd(), value);
         if (it != m_pool.constEnd()) {
             return *it;
         }
         m_pool.push_back(value);
+        if (m_pool.size() > HashThreshold) {
+            m_index = QSet<T>(m_pool.constBegin(), m_pool.constEnd());
+            m_pool = Container<T>();
+        }
         return value;
     }
 
+    /** Returns the number of distinct values in the pool. */
+    qsizetype size() const
+    {
+        return m_index.isEmpty() ? m_pool.size() : m_index.size();
+    }
+
 private:
     Container<T> m_pool;
+    QSet<T> m_index;
+};
+
+/**
+ * Thread-safe variant of SharedValuePool, for process-wide interning of values
+ * like flag names. The pool never shrinks, so only use it for value sets that
+ * are bounded in practice.
+ */
+template<typename T, template<typename> class Container>
+class ConcurrentSharedValuePool
+{
+public:
+    /** Returns the shared value equal to @p value .*/
+    T sharedValue(const T &value)
+    {
+        QMutexLocker locker(&m_lock);
+        return m_pool.sharedValue(value);
+    }
+
+    qsizetype size() const
+    {
+        QMutexLocker locker(&m_lock);
+        return m_pool.size();
+    }
+
+private:
+    mutable QMutex m_lock;
+    SharedValuePool<T, Container> m_pool;
 };
 
 }
@@ -0,0 +1,67 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "binarytrace_p.h"
+
+#include <QIODevice>
+#include <QtEndian>
+
+#include <cstring>
+
+using namespace Akonadi;
+
+namespace
+{
+constexpr char Magic[8] = {'A', 'K', 'T', 'R', 'A', 'C', 'E', '\0'};
+}
+
+bool BinaryTrace::writeHeader(QIODevice *device, const Header &header)
+{
+    char buffer[HeaderSize];
+    std::memcpy(buffer, Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(Version, buffer + 8);
+    qToLittleEndian<quint32>(EventSize, buffer + 12);
+    qToLittleEndian<qint64>(header.startTime, buffer + 16);
+    return device->write(buffer, HeaderSize) == HeaderSize;
+}
+
+bool BinaryTrace::readHeader(QIODevice *device, Header *header)
+{
+    char buffer[HeaderSize];
+    if (device->read(buffer, HeaderSize) != HeaderSize || std::memcmp(buffer, Magic, sizeof(Magic)) != 0) {
+        return false;
+    }
+    // Newer versions may only append fields to the events
+    if (qFromLittleEndian<quint32>(buffer + 8) != Version || qFromLittleEndian<quint32>(buffer + 12) != EventSize) {
+        return false;
+    }
+    header->startTime = qFromLittleEndian<qint64>(buffer + 16);
+    return true;
+}
+
+void BinaryTrace::encodeEvent(const Event &event, char *buffer)
+{
+    qToLittleEndian<quint64>(event.timestamp, buffer);
+    qToLittleEndian<qint64>(event.tag, buffer + 8);
+    qToLittleEndian<quint32>(event.connection, buffer + 16);
+    qToLittleEndian<quint32>(event.duration, buffer + 20);
+    qToLittleEndian<quint32>(event.count, buffer + 24);
+    qToLittleEndian<quint16>(event.command, buffer + 28);
+    qToLittleEndian<quint16>(event.flags, buffer + 30);
+}
+
+BinaryTrace::Event BinaryTrace::decodeEvent(const char *buffer)
+{
+    Event event;
+    event.timestamp = qFromLittleEndian<quint64>(buffer);
+    event.tag = qFromLittleEndian<qint64>(buffer + 8);
+    event.connection = qFromLittleEndian<quint32>(buffer + 16);
+    event.duration = qFromLittleEndian<quint32>(buffer + 20);
+    event.count = qFromLittleEndian<quint32>(buffer + 24);
+    event.command = qFromLittleEndian<quint16>(buffer + 28);
+    event.flags = qFromLittleEndian<quint16>(buffer + 30);
+    return event;
+}
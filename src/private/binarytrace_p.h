@@ -0,0 +1,70 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "akonadiprivate_export.h"
+
+#include <QtGlobal>
+
+class QIODevice;
+
+namespace Akonadi
+{
+/**
+ * File format of the binary trace written by the Akonadi server.
+ *
+ * The file starts with a header, followed by fixed-size event records in
+ * little endian, so that the server can write them without formatting
+ * anything and the trace can be decoded after the fact, e.g. by
+ * `akonadictl trace`.
+ */
+class AKONADIPRIVATE_EXPORT BinaryTrace
+{
+public:
+    static constexpr quint32 Version = 1;
+
+    struct Header {
+        /// Wall clock time of the beginning of the trace, in ms since the epoch
+        qint64 startTime = 0;
+    };
+
+    enum Flag : quint16 {
+        /// The command was answered with an error
+        Failed = 0x1,
+        /// Not a command: @c count events were lost because the buffer was full
+        Dropped = 0x2,
+    };
+
+    /// A command handled by a connection
+    struct Event {
+        /// Start of the command, in µs since the beginning of the trace
+        quint64 timestamp = 0;
+        qint64 tag = 0;
+        quint32 connection = 0;
+        /// Time it took to handle the command, in µs
+        quint32 duration = 0;
+        /// Number of responses sent for the command, e.g. items fetched
+        quint32 count = 0;
+        /// Protocol::Command::Type
+        quint16 command = 0;
+        quint16 flags = 0;
+    };
+
+    static constexpr qsizetype HeaderSize = 24;
+    static constexpr qsizetype EventSize = 32;
+
+    static bool writeHeader(QIODevice *device, const Header &header);
+    static bool readHeader(QIODevice *device, Header *header);
+
+    /**
+     * Encodes @p event into the first EventSize bytes of @p buffer.
+     */
+    static void encodeEvent(const Event &event, char *buffer);
+    static Event decodeEvent(const char *buffer);
+};
+
+} // namespace Akonadi
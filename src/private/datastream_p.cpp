@@ -21,8 +21,9 @@ DataStream::DataStream()
 {
 }
 
-DataStream::DataStream(QIODevice *device)
+DataStream::DataStream(QIODevice *device, Encoding encoding)
     : mDev(device)
+    , mEncoding(encoding)
 {
 }
 
@@ -34,8 +35,13 @@ DataStream::~DataStream()
 void DataStream::flush()
 {
     if (!mWriteBuffer.isEmpty()) {
+        if (mEncoding == Encoding::Compact) {
+            const auto frameSize = static_cast<quint32>(mWriteBuffer.size());
+            mWriteBuffer.prepend(reinterpret_cast<const char *>(&frameSize), sizeof(frameSize));
+        }
+        QIODevice *dev = mMessageSource ? mMessageSource : mDev;
         const int len = mWriteBuffer.size();
-        int ret = mDev->write(mWriteBuffer);
+        int ret = dev->write(mWriteBuffer);
         if (ret != len) {
             // TODO: Try to write data again unless ret is -1?
             throw ProtocolException("Failed to write all data");
@@ -90,6 +96,57 @@ QIODevice *DataStream::device() const
 void DataStream::setDevice(QIODevice *device)
 {
     mDev = device;
+    mMessageSource = nullptr;
+}
+
+DataStream::Encoding DataStream::encoding() const
+{
+    return mEncoding;
+}
+
+void DataStream::setEncoding(Encoding encoding)
+{
+    mEncoding = encoding;
+}
+
+bool DataStream::hasMessage(QIODevice *device, Encoding encoding)
+{
+    if (encoding == Encoding::Legacy) {
+        return device->bytesAvailable() >= static_cast<qint64>(sizeof(qint64));
+    }
+
+    quint32 frameSize = 0;
+    if (device->peek(reinterpret_cast<char *>(&frameSize), sizeof(frameSize)) != sizeof(frameSize)) {
+        return false;
+    }
+    return device->bytesAvailable() >= static_cast<qint64>(sizeof(frameSize) + frameSize);
+}
+
+void DataStream::beginMessage()
+{
+    if (mEncoding == Encoding::Legacy) {
+        return;
+    }
+
+    if (mMessageSource) {
+        mDev = mMessageSource;
+    }
+    checkDevice();
+
+    quint32 frameSize = 0;
+    if (mDev->read(reinterpret_cast<char *>(&frameSize), sizeof(frameSize)) != sizeof(frameSize)) {
+        throw ProtocolException("Failed to read message frame");
+    }
+    QByteArray frame = mDev->read(frameSize);
+    if (frame.size() != static_cast<qsizetype>(frameSize)) {
+        throw ProtocolException("Failed to read message frame");
+    }
+
+    mMessage.close();
+    mMessage.setData(frame);
+    mMessage.open(QIODevice::ReadOnly);
+    mMessageSource = mDev;
+    mDev = &mMessage;
 }
 
 std::chrono::milliseconds DataStream::waitTimeout() const
@@ -106,6 +163,10 @@ void DataStream::waitForData(quint32 size)
     checkDevice();
 
     while (mDev->bytesAvailable() < size) {
+        if (mMessageSource) {
+            // The whole message has been received already, nothing more will come
+            throw ProtocolException("Message is truncated");
+        }
         waitForData(mDev, mWaitTimeout.count());
     }
 }
@@ -119,12 +180,74 @@ void DataStream::writeRawData(const char *data, qsizetype len)
 
 void DataStream::writeBytes(const char *bytes, qsizetype len)
 {
-    *this << static_cast<quint32>(len);
+    if (mEncoding == Encoding::Compact) {
+        // 0 is reserved for null values
+        writeVarint(static_cast<quint64>(len) + 1);
+    } else {
+        *this << static_cast<quint32>(len);
+    }
     if (len) {
         writeRawData(bytes, len);
     }
 }
 
+void DataStream::writeNull()
+{
+    if (mEncoding == Encoding::Compact) {
+        writeVarint(0);
+    } else {
+        *this << (quint32)0xffffffff;
+    }
+}
+
+bool DataStream::readLength(quint32 &len)
+{
+    if (mEncoding == Encoding::Compact) {
+        const quint64 raw = readVarint();
+        if (raw == 0) {
+            return false;
+        }
+        if (raw - 1 >= 0xffffffff) {
+            throw Akonadi::ProtocolException("Read corrupt data");
+        }
+        len = static_cast<quint32>(raw - 1);
+        return true;
+    }
+
+    *this >> len;
+    return len != 0xffffffff;
+}
+
+void DataStream::writeVarint(quint64 val)
+{
+    char buf[10];
+    int len = 0;
+    while (val >= 0x80) {
+        buf[len++] = static_cast<char>((val & 0x7f) | 0x80);
+        val >>= 7;
+    }
+    buf[len++] = static_cast<char>(val);
+    writeRawData(buf, len);
+}
+
+quint64 DataStream::readVarint()
+{
+    quint64 val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        waitForData(1);
+        char byte = 0;
+        if (!mDev->getChar(&byte)) {
+            throw Akonadi::ProtocolException("Failed to read enough data from stream");
+        }
+        val |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return val;
+        }
+    }
+
+    throw Akonadi::ProtocolException("Read corrupt data");
+}
+
 qint64 DataStream::readRawData(char *buffer, qint64 len)
 {
     checkDevice();
@@ -135,7 +258,10 @@ qint64 DataStream::readRawData(char *buffer, qint64 len)
 DataStream &DataStream::operator<<(const QString &str)
 {
     if (str.isNull()) {
-        *this << (quint32)0xffffffff;
+        writeNull();
+    } else if (mEncoding == Encoding::Compact) {
+        const QByteArray utf8 = str.toUtf8();
+        writeBytes(utf8.constData(), utf8.size());
     } else {
         writeBytes(reinterpret_cast<const char *>(str.unicode()), sizeof(QChar) * str.length());
     }
@@ -147,14 +273,18 @@ DataStream &DataStream::operator>>(QString &str)
     str.clear();
 
     quint32 bytes = 0;
-    *this >> bytes;
-    if (bytes == 0xffffffff) {
+    if (!readLength(bytes)) {
         return *this;
     } else if (bytes == 0) {
         str = QString(QLatin1StringView(""));
         return *this;
     }
 
+    if (mEncoding == Encoding::Compact) {
+        str = QString::fromUtf8(readByteArray(bytes));
+        return *this;
+    }
+
     if (bytes & 0x1) {
         str.clear();
         throw Akonadi::ProtocolException("Read corrupt data");
@@ -180,7 +310,7 @@ DataStream &DataStream::operator>>(QString &str)
 DataStream &DataStream::operator<<(const QByteArray &data)
 {
     if (data.isNull()) {
-        *this << (quint32)0xffffffff;
+        writeNull();
     } else {
         writeBytes(data.constData(), data.size());
     }
@@ -192,11 +322,15 @@ DataStream &DataStream::operator>>(QByteArray &data)
     data.clear();
 
     quint32 len = 0;
-    *this >> len;
-    if (len == 0xffffffff) {
-        return *this;
+    if (readLength(len)) {
+        data = readByteArray(len);
     }
+    return *this;
+}
 
+QByteArray DataStream::readByteArray(quint32 len)
+{
+    QByteArray data;
     const quint32 step = 1024 * 1024;
     quint32 allocated = 0;
 
@@ -210,7 +344,7 @@ DataStream &DataStream::operator>>(QByteArray &data)
         allocated += blockSize;
     }
 
-    return *this;
+    return data;
 }
 
 DataStream &DataStream::operator<<(const QDateTime &dt)
@@ -14,6 +14,7 @@
 #include "akonadiprivate_export.h"
 #include "protocol_exception_p.h"
 
+#include <QBuffer>
 #include <QByteArray>
 #include <QIODevice>
 #include <QTimeZone>
@@ -24,12 +25,48 @@ namespace Akonadi::Protocol
 class AKONADIPRIVATE_EXPORT DataStream
 {
 public:
+    /**
+     * Wire encoding of the data.
+     *
+     * Legacy encoding writes integers in their native size, strings as raw
+     * UTF-16 and messages back to back.
+     *
+     * Compact encoding writes integers wider than one byte as (zig-zag) varints,
+     * strings as UTF-8, and prefixes each message (everything written between
+     * two flush() calls) with its length, so that the receiver can read whole
+     * messages without blocking. It is negotiated during Login.
+     */
+    enum class Encoding {
+        Legacy,
+        Compact,
+    };
+
     explicit DataStream();
-    explicit DataStream(QIODevice *device);
+    explicit DataStream(QIODevice *device, Encoding encoding = Encoding::Legacy);
     ~DataStream();
 
     static void waitForData(QIODevice *device, int timeoutMs);
 
+    /**
+     * Returns whether the next message can be read from @p device.
+     *
+     * With the Compact encoding this means the whole message has been received,
+     * with the Legacy encoding only its tag is guaranteed to be available.
+     */
+    static bool hasMessage(QIODevice *device, Encoding encoding);
+
+    /**
+     * Starts reading the next message. With the Compact encoding the whole message
+     * is read from the device and all subsequent reads, as well as device(), use it
+     * until the next call.
+     *
+     * Must only be called when hasMessage() returns true.
+     */
+    void beginMessage();
+
+    Encoding encoding() const;
+    void setEncoding(Encoding encoding);
+
     QIODevice *device() const;
     void setDevice(QIODevice *device);
 
@@ -69,6 +106,12 @@ public:
 private:
     Q_DISABLE_COPY(DataStream)
 
+    void writeVarint(quint64 val);
+    quint64 readVarint();
+    void writeNull();
+    bool readLength(quint32 &len);
+    QByteArray readByteArray(quint32 len);
+
     inline void checkDevice() const
     {
         if (Q_UNLIKELY(!mDev)) {
@@ -77,8 +120,11 @@ private:
     }
 
     QIODevice *mDev;
+    QIODevice *mMessageSource = nullptr; // the device mMessage was read from
+    QBuffer mMessage;
     QByteArray mWriteBuffer;
     std::chrono::milliseconds mWaitTimeout = std::chrono::seconds{30};
+    Encoding mEncoding = Encoding::Legacy;
 };
 
 template<typename T>
@@ -86,6 +132,17 @@ template<typename T>
 inline DataStream &DataStream::operator<<(T val)
 {
     checkDevice();
+    if constexpr (sizeof(T) > 1) {
+        if (mEncoding == Encoding::Compact) {
+            if constexpr (std::is_signed_v<T>) {
+                // zig-zag encoding, so that small negative numbers stay small
+                writeVarint((static_cast<quint64>(val) << 1) ^ static_cast<quint64>(static_cast<qint64>(val) >> 63));
+            } else {
+                writeVarint(static_cast<quint64>(val));
+            }
+            return *this;
+        }
+    }
     writeRawData((char *)&val, sizeof(T));
     return *this;
 }
@@ -103,6 +160,18 @@ inline DataStream &DataStream::operator>>(T &val)
 {
     checkDevice();
 
+    if constexpr (sizeof(T) > 1) {
+        if (mEncoding == Encoding::Compact) {
+            const quint64 raw = readVarint();
+            if constexpr (std::is_signed_v<T>) {
+                val = static_cast<T>(static_cast<qint64>(raw >> 1) ^ -static_cast<qint64>(raw & 1));
+            } else {
+                val = static_cast<T>(raw);
+            }
+            return *this;
+        }
+    }
+
     waitForData(sizeof(T));
 
     if (mDev->read((char *)&val, sizeof(T)) != sizeof(T)) {
@@ -9,13 +9,71 @@
 #include "externalpartstorage_p.h"
 #include "standarddirs_p.h"
 
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
 #include <QThread>
 
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
 using namespace Akonadi;
 
+namespace
+{
+constexpr char blobSuffix[] = "_b";
+constexpr qsizetype blobNameLength = 64 /* hex SHA-256 */ + sizeof(blobSuffix) - 1;
+constexpr char packExtension[] = ".pack";
+// Packed payloads are referenced as "PACKID.pack:OFFSET:LENGTH"
+constexpr char packedNameMarker[] = ".pack:";
+
+QString packDirectory()
+{
+    return ExternalPartStorage::akonadiStoragePath() + QDir::separator() + QLatin1StringView("packs");
+}
+
+qint64 findLastPackId()
+{
+    qint64 lastPackId = 0;
+    const auto packs = QDir(packDirectory()).entryList({QStringLiteral("*.pack")}, QDir::Files);
+    for (const QString &pack : packs) {
+        lastPackId = std::max(lastPackId, QStringView(pack).chopped(sizeof(packExtension) - 1).toLongLong());
+    }
+    return lastPackId;
+}
+
+void syncFile(const QString &path)
+{
+#ifdef Q_OS_UNIX
+    QFile f(path);
+    if (!f.open(QIODevice::Append) || ::fsync(f.handle()) != 0) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Warning: failed to sync" << path << "to disk";
+    }
+#else
+    Q_UNUSED(path)
+#endif
+}
+
+// Marks a reused blob as recently used, so that the StorageJanitor does not collect
+// it before the transaction referencing it is committed. Returns false if the blob
+// does not exist (anymore), it is never created here.
+bool touchBlob(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::Append | QIODevice::ExistingOnly)) {
+        return false;
+    }
+    return f.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+}
+} // namespace
+
 ExternalPartStorageTransaction::ExternalPartStorageTransaction()
 {
     ExternalPartStorage::self()->beginTransaction();
@@ -42,6 +100,8 @@ ExternalPartStorage::ExternalPartStorage()
 {
 }
 
+ExternalPartStorage::~ExternalPartStorage() = default;
+
 ExternalPartStorage *ExternalPartStorage::self()
 {
     static ExternalPartStorage sInstance;
@@ -59,6 +119,16 @@ QString ExternalPartStorage::resolveAbsolutePath(const QString &filename, bool *
         *exists = false;
     }
 
+    // All payloads in a pack resolve to the pack file
+    qint64 packId = -1;
+    if (isPackedName(filename) && parsePackedName(filename.toLatin1(), &packId)) {
+        const QString path = packPath(packId);
+        if (exists) {
+            *exists = QFile::exists(path);
+        }
+        return path;
+    }
+
     QFileInfo finfo(filename);
     if (finfo.isAbsolute()) {
         if (exists && finfo.exists()) {
@@ -210,6 +280,229 @@ QByteArray ExternalPartStorage::nameForPartId(qint64 partId)
     return QByteArray::number(partId) + "_r0";
 }
 
+QByteArray ExternalPartStorage::nameForBlob(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex() + blobSuffix;
+}
+
+bool ExternalPartStorage::isBlobName(const QByteArray &filename)
+{
+    return filename.size() == blobNameLength && filename.endsWith(blobSuffix);
+}
+
+bool ExternalPartStorage::isBlobName(const QString &filename)
+{
+    return filename.size() == blobNameLength && filename.endsWith(QLatin1StringView(blobSuffix));
+}
+
+QByteArray ExternalPartStorage::packedName(qint64 packId, qint64 offset, qint64 length)
+{
+    return QByteArray::number(packId) + packExtension + ':' + QByteArray::number(offset) + ':' + QByteArray::number(length);
+}
+
+bool ExternalPartStorage::isPackedName(const QByteArray &filename)
+{
+    return filename.contains(packedNameMarker);
+}
+
+bool ExternalPartStorage::isPackedName(const QString &filename)
+{
+    return filename.contains(QLatin1StringView(packedNameMarker));
+}
+
+bool ExternalPartStorage::parsePackedName(const QByteArray &filename, qint64 *packId, qint64 *offset, qint64 *length)
+{
+    const int markerPos = filename.indexOf(packedNameMarker);
+    if (markerPos <= 0) {
+        return false;
+    }
+    const QList<QByteArray> location = filename.mid(markerPos + sizeof(packedNameMarker) - 1).split(':');
+    if (location.size() != 2) {
+        return false;
+    }
+
+    bool idOk = false;
+    bool offsetOk = false;
+    bool lengthOk = false;
+    const qint64 id = filename.left(markerPos).toLongLong(&idOk);
+    const qint64 off = location[0].toLongLong(&offsetOk);
+    const qint64 len = location[1].toLongLong(&lengthOk);
+    if (!idOk || !offsetOk || !lengthOk || off < 0 || len < 0) {
+        return false;
+    }
+
+    if (packId) {
+        *packId = id;
+    }
+    if (offset) {
+        *offset = off;
+    }
+    if (length) {
+        *length = len;
+    }
+    return true;
+}
+
+bool ExternalPartStorage::isPackFile(const QString &path)
+{
+    return path.endsWith(QLatin1StringView(packExtension));
+}
+
+QString ExternalPartStorage::packPath(qint64 packId)
+{
+    return packDirectory() + QDir::separator() + QString::number(packId) + QLatin1StringView(packExtension);
+}
+
+QByteArray ExternalPartStorage::readPartFile(const QByteArray &filename, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+    qint64 packId = -1;
+    qint64 offset = 0;
+    qint64 length = 0;
+    if (parsePackedName(filename, &packId, &offset, &length)) {
+        // Read just the payload, there's no point in buffering the rest of the pack
+        QFile f(packPath(packId));
+        if (!f.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !f.seek(offset)) {
+            qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to open pack" << f.fileName() << "for reading:" << f.errorString();
+            return {};
+        }
+        QByteArray data = f.read(length);
+        if (data.size() != length) {
+            qCWarning(AKONADIPRIVATE_LOG) << "Error: packed payload" << filename << "is truncated";
+            return {};
+        }
+        if (ok) {
+            *ok = true;
+        }
+        return data;
+    }
+
+    QFile f(resolveAbsolutePath(filename));
+    if (!f.open(QIODevice::ReadOnly)) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to open part file" << f.fileName() << "for reading:" << f.errorString();
+        return {};
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return f.readAll();
+}
+
+bool ExternalPartStorage::storeBlob(const QByteArray &data, QByteArray &blobName)
+{
+    blobName = nameForBlob(data);
+    const QString path = resolveAbsolutePath(blobName, nullptr, false);
+    // The StorageJanitor may have collected the blob since, then it is written again
+    if (touchBlob(path)) {
+        return true;
+    }
+
+    // Another connection may be storing the same blob concurrently, write it atomically
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to open new blob file for writing:" << f.errorString();
+        return false;
+    }
+    if (f.write(data) != data.size() || !f.commit()) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to write all data into the blob file:" << f.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ExternalPartStorage::adoptPartFile(const QByteArray &partFile, QByteArray &blobName)
+{
+    bool exists = false;
+    const QString partPath = resolveAbsolutePath(partFile, &exists);
+    if (!exists) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: asked to adopt a non-existent part file" << partFile;
+        return false;
+    }
+
+    QFile f(partPath);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!f.open(QIODevice::ReadOnly) || !hash.addData(&f)) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to read part file" << partPath << ":" << f.errorString();
+        return false;
+    }
+    f.close();
+
+    blobName = hash.result().toHex() + blobSuffix;
+    const QString blobPath = resolveAbsolutePath(blobName, nullptr, false);
+    if (!touchBlob(blobPath)) {
+        bool linked = false;
+#ifdef Q_OS_UNIX
+        linked = ::link(QFile::encodeName(partPath).constData(), QFile::encodeName(blobPath).constData()) == 0;
+#endif
+        if (!linked && !QFile::exists(blobPath) && !QFile::copy(partPath, blobPath)) {
+            qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to create blob" << blobName << "from part file" << partPath;
+            return false;
+        }
+    }
+
+    return removePartFile(partPath);
+}
+
+bool ExternalPartStorage::releasePartFile(const QString &partFile)
+{
+    if (isBlobName(QFileInfo(partFile).fileName()) || isPackFile(partFile)) {
+        return true;
+    }
+    return removePartFile(partFile);
+}
+
+bool ExternalPartStorage::openPack(qint64 packId)
+{
+    QDir().mkpath(packDirectory());
+    auto pack = std::make_unique<QFile>(packPath(packId));
+    if (!pack->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to open pack" << pack->fileName() << "for writing:" << pack->errorString();
+        return false;
+    }
+
+    mPack = std::move(pack);
+    mPackId = packId;
+    return true;
+}
+
+bool ExternalPartStorage::storePacked(const QByteArray &data, QByteArray &packedName)
+{
+    QMutexLocker locker(&mPackLock);
+    // Never append to packs from a previous run, the StorageJanitor may be compacting them
+    if (!mPack || (mPack->size() > 0 && mPack->size() + data.size() > maxPackSize)) {
+        if (!openPack(mPackId < 0 ? findLastPackId() + 1 : mPackId + 1)) {
+            return false;
+        }
+    }
+
+    const qint64 offset = mPack->size();
+    if (mPack->write(data) != data.size()) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to append payload to pack" << mPack->fileName() << ":" << mPack->errorString();
+        mPack->resize(offset);
+        return false;
+    }
+    packedName = ExternalPartStorage::packedName(mPackId, offset, data.size());
+    const QString path = mPack->fileName();
+    locker.unlock();
+
+    if (inTransaction()) {
+        addToTransaction({{Operation::Sync, path}});
+    } else {
+        syncFile(path);
+    }
+    return true;
+}
+
+qint64 ExternalPartStorage::activePackId() const
+{
+    QMutexLocker locker(&mPackLock);
+    return mPackId;
+}
+
 bool ExternalPartStorage::beginTransaction()
 {
     QMutexLocker locker(&mTransactionLock);
@@ -279,6 +572,7 @@ void ExternalPartStorage::addToTransaction(const QList<Operation> &ops)
 
 bool ExternalPartStorage::replayTransaction(const QList<Operation> &trx, bool commit)
 {
+    QSet<QString> syncedFiles;
     for (auto iter = trx.constBegin(), end = trx.constEnd(); iter != end; ++iter) {
         const Operation &op = *iter;
 
@@ -302,6 +596,13 @@ bool ExternalPartStorage::replayTransaction(const QList<Operation> &trx, bool co
             } else {
                 // no-op: we did not actually delete the file yet
             }
+        } else if (op.type == Operation::Sync) {
+            // Payloads that were appended to a pack in a rolled back transaction
+            // are just unreferenced and will be compacted away
+            if (commit && !syncedFiles.contains(op.filename)) {
+                syncFile(op.filename);
+                syncedFiles.insert(op.filename);
+            }
         } else {
             Q_UNREACHABLE();
         }
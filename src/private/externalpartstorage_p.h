@@ -15,6 +15,9 @@
 #include <QList>
 #include <QMutex>
 
+#include <memory>
+
+class QFile;
 class QString;
 class QByteArray;
 class QThread;
@@ -40,6 +43,18 @@ private:
  * Use ExternalPartStorageTransaction to delay deletion of part files until
  * commit. Files created during the transaction will be deleted when transaction
  * is rolled back to keep the storage clean.
+ *
+ * Besides the per-part files, named after the part ID and revision, payloads can
+ * be stored in content-addressed blobs, named after the SHA-256 hash of their content.
+ * Blobs are shared by all parts with identical payload, so they are never deleted
+ * by releasePartFile() and are not part of transactions. Unreferenced blobs are
+ * garbage-collected by the StorageJanitor.
+ *
+ * Small payloads can be appended to pack files instead, to avoid creating a file
+ * for each of them. A packed payload is referenced by the pack ID, its offset in
+ * the pack and its length, see packedName(). Packed payloads are immutable as well,
+ * the space of released ones is reclaimed when the StorageJanitor compacts the pack.
+ * Packs written in a transaction are synced to disk once, when it is committed.
  */
 class AKONADIPRIVATE_EXPORT ExternalPartStorage
 {
@@ -50,12 +65,62 @@ public:
     static QString resolveAbsolutePath(const QString &filename, bool *exists = nullptr, bool legacyFallback = true);
     static QByteArray updateFileNameRevision(const QByteArray &filename);
     static QByteArray nameForPartId(qint64 partId);
+    static QByteArray nameForBlob(const QByteArray &data);
+    static bool isBlobName(const QByteArray &filename);
+    static bool isBlobName(const QString &filename);
+    static QByteArray packedName(qint64 packId, qint64 offset, qint64 length);
+    static bool isPackedName(const QByteArray &filename);
+    static bool isPackedName(const QString &filename);
+    static bool parsePackedName(const QByteArray &filename, qint64 *packId, qint64 *offset = nullptr, qint64 *length = nullptr);
+    static bool isPackFile(const QString &path);
+    static QString packPath(qint64 packId);
     static QString akonadiStoragePath();
 
+    /**
+     * Returns the payload stored in the part file @p filename, which may
+     * also be a packed payload. Sets @p ok to false if it cannot be read.
+     */
+    static QByteArray readPartFile(const QByteArray &filename, bool *ok = nullptr);
+
     bool updatePartFile(const QByteArray &newData, const QByteArray &partFile, QByteArray &newPartFile);
     bool createPartFile(const QByteArray &newData, qint64 partId, QByteArray &partFileName);
     bool removePartFile(const QString &partFile);
 
+    /**
+     * Stores @p data in a blob, unless an identical blob exists already,
+     * and returns its name in @p blobName.
+     */
+    bool storeBlob(const QByteArray &data, QByteArray &blobName);
+
+    /**
+     * Turns the per-part file @p partFile into a blob and returns its name in
+     * @p blobName. The data is not copied if the file system supports hard links.
+     * The per-part file is removed (on commit when in a transaction).
+     */
+    bool adoptPartFile(const QByteArray &partFile, QByteArray &blobName);
+
+    /**
+     * Releases the part file @p partFile, a path as returned by resolveAbsolutePath(),
+     * when a part no longer references it. Per-part files are removed, blobs are left
+     * for the StorageJanitor to collect once no part references them anymore.
+     */
+    bool releasePartFile(const QString &partFile);
+
+    /**
+     * Appends @p data to the current pack and returns the reference to it in
+     * @p packedName. A new pack is started once the current one reaches
+     * maxPackSize.
+     */
+    bool storePacked(const QByteArray &data, QByteArray &packedName);
+
+    /**
+     * Returns the ID of the pack new payloads are appended to, or -1 if no
+     * pack was written to yet.
+     */
+    qint64 activePackId() const;
+
+    static constexpr qint64 maxPackSize = 64 * 1024 * 1024;
+
     bool inTransaction() const;
 
 private:
@@ -64,7 +129,8 @@ private:
     struct Operation {
         enum Type {
             Create,
-            Delete
+            Delete,
+            Sync // packs are synced to disk once, on commit
             // We never update files, we always create a new one with increased
             // revision number, hence no "Update"
         };
@@ -74,6 +140,7 @@ private:
     };
 
     ExternalPartStorage();
+    ~ExternalPartStorage();
 
     AKONADIPRIVATE_NO_EXPORT bool beginTransaction();
     AKONADIPRIVATE_NO_EXPORT bool commitTransaction();
@@ -81,9 +148,14 @@ private:
 
     AKONADIPRIVATE_NO_EXPORT bool replayTransaction(const QList<Operation> &trx, bool commit);
     AKONADIPRIVATE_NO_EXPORT void addToTransaction(const QList<Operation> &ops);
+    AKONADIPRIVATE_NO_EXPORT bool openPack(qint64 packId);
 
     mutable QMutex mTransactionLock;
     QHash<QThread *, QList<Operation>> mTransactions;
+
+    mutable QMutex mPackLock;
+    std::unique_ptr<QFile> mPack;
+    qint64 mPackId = -1;
 };
 
 }
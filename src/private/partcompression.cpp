@@ -0,0 +1,251 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "akonadiprivate_debug.h"
+#include "externalpartstorage_p.h"
+#include "partcompression_p.h"
+
+#include <config-akonadi.h>
+
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#if HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace Akonadi;
+
+namespace
+{
+QString dictionaryDirectory()
+{
+    return ExternalPartStorage::akonadiStoragePath() + QDir::separator() + QLatin1StringView("dictionaries");
+}
+
+#if HAVE_ZSTD
+constexpr int compressionLevel = 3;
+constexpr qsizetype maxDictionarySize = 64 * 1024;
+
+struct ZstdDeleter {
+    void operator()(ZSTD_CCtx *ctx) const
+    {
+        ZSTD_freeCCtx(ctx);
+    }
+    void operator()(ZSTD_DCtx *ctx) const
+    {
+        ZSTD_freeDCtx(ctx);
+    }
+    void operator()(ZSTD_CDict *dict) const
+    {
+        ZSTD_freeCDict(dict);
+    }
+    void operator()(ZSTD_DDict *dict) const
+    {
+        ZSTD_freeDDict(dict);
+    }
+};
+
+// Contexts are expensive to create, but can't be shared between threads
+ZSTD_CCtx *compressionContext()
+{
+    static thread_local std::unique_ptr<ZSTD_CCtx, ZstdDeleter> ctx(ZSTD_createCCtx());
+    return ctx.get();
+}
+
+ZSTD_DCtx *decompressionContext()
+{
+    static thread_local std::unique_ptr<ZSTD_DCtx, ZstdDeleter> ctx(ZSTD_createDCtx());
+    return ctx.get();
+}
+
+// Digested dictionaries, loaded on first use and kept until the process exits
+class DictionaryCache
+{
+public:
+    ZSTD_CDict *compressionDictionary(quint32 dictionaryId)
+    {
+        QMutexLocker locker(&mLock);
+        auto it = mCompressionDictionaries.find(dictionaryId);
+        if (it == mCompressionDictionaries.end()) {
+            const QByteArray dict = load(dictionaryId);
+            std::unique_ptr<ZSTD_CDict, ZstdDeleter> cdict(dict.isEmpty() ? nullptr : ZSTD_createCDict(dict.constData(), dict.size(), compressionLevel));
+            if (!cdict) {
+                return nullptr;
+            }
+            it = mCompressionDictionaries.emplace(dictionaryId, std::move(cdict)).first;
+        }
+        return it->second.get();
+    }
+
+    ZSTD_DDict *decompressionDictionary(quint32 dictionaryId)
+    {
+        QMutexLocker locker(&mLock);
+        auto it = mDecompressionDictionaries.find(dictionaryId);
+        if (it == mDecompressionDictionaries.end()) {
+            const QByteArray dict = load(dictionaryId);
+            std::unique_ptr<ZSTD_DDict, ZstdDeleter> ddict(dict.isEmpty() ? nullptr : ZSTD_createDDict(dict.constData(), dict.size()));
+            if (!ddict) {
+                return nullptr;
+            }
+            it = mDecompressionDictionaries.emplace(dictionaryId, std::move(ddict)).first;
+        }
+        return it->second.get();
+    }
+
+private:
+    static QByteArray load(quint32 dictionaryId)
+    {
+        QFile f(PartCompression::dictionaryPath(dictionaryId));
+        if (!f.open(QIODevice::ReadOnly)) {
+            qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to open compression dictionary" << f.fileName() << ":" << f.errorString();
+            return {};
+        }
+        const QByteArray dict = f.readAll();
+        if (ZDICT_getDictID(dict.constData(), dict.size()) != dictionaryId) {
+            qCWarning(AKONADIPRIVATE_LOG) << "Error: compression dictionary" << f.fileName() << "is corrupted";
+            return {};
+        }
+        return dict;
+    }
+
+    QMutex mLock;
+    std::unordered_map<quint32, std::unique_ptr<ZSTD_CDict, ZstdDeleter>> mCompressionDictionaries;
+    std::unordered_map<quint32, std::unique_ptr<ZSTD_DDict, ZstdDeleter>> mDecompressionDictionaries;
+};
+
+Q_GLOBAL_STATIC(DictionaryCache, sDictionaries)
+#endif
+} // namespace
+
+bool PartCompression::isAvailable()
+{
+    return HAVE_ZSTD;
+}
+
+QByteArray PartCompression::compress(const QByteArray &data, quint32 dictionaryId)
+{
+#if HAVE_ZSTD
+    ZSTD_CDict *dict = nullptr;
+    if (dictionaryId != 0) {
+        dict = sDictionaries->compressionDictionary(dictionaryId);
+        if (!dict) {
+            return {};
+        }
+    }
+
+    QByteArray compressed(ZSTD_compressBound(data.size()), Qt::Uninitialized);
+    const size_t size = dict ? ZSTD_compress_usingCDict(compressionContext(), compressed.data(), compressed.size(), data.constData(), data.size(), dict)
+                             : ZSTD_compressCCtx(compressionContext(), compressed.data(), compressed.size(), data.constData(), data.size(), compressionLevel);
+    if (ZSTD_isError(size)) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to compress part:" << ZSTD_getErrorName(size);
+        return {};
+    }
+    compressed.resize(size);
+    return compressed;
+#else
+    Q_UNUSED(data)
+    Q_UNUSED(dictionaryId)
+    return {};
+#endif
+}
+
+QByteArray PartCompression::decompress(const QByteArray &data, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+
+#if HAVE_ZSTD
+    // We always compress whole parts at once, so the frame knows the size of its content
+    const unsigned long long size = ZSTD_getFrameContentSize(data.constData(), data.size());
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN || size > quint64(std::numeric_limits<qsizetype>::max())) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: compressed part is corrupted";
+        return {};
+    }
+
+    ZSTD_DDict *dict = nullptr;
+    if (const unsigned dictionaryId = ZSTD_getDictID_fromFrame(data.constData(), data.size()); dictionaryId != 0) {
+        dict = sDictionaries->decompressionDictionary(dictionaryId);
+        if (!dict) {
+            qCWarning(AKONADIPRIVATE_LOG) << "Error: compression dictionary" << dictionaryId << "is not available";
+            return {};
+        }
+    }
+
+    QByteArray decompressed(qsizetype(size), Qt::Uninitialized);
+    const size_t result = dict
+        ? ZSTD_decompress_usingDDict(decompressionContext(), decompressed.data(), decompressed.size(), data.constData(), data.size(), dict)
+        : ZSTD_decompressDCtx(decompressionContext(), decompressed.data(), decompressed.size(), data.constData(), data.size());
+    if (ZSTD_isError(result) || result != size) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to decompress part:" << (ZSTD_isError(result) ? ZSTD_getErrorName(result) : "size mismatch");
+        return {};
+    }
+
+    if (ok) {
+        *ok = true;
+    }
+    return decompressed;
+#else
+    Q_UNUSED(data)
+    qCWarning(AKONADIPRIVATE_LOG) << "Error: cannot decompress part, Akonadi was built without Zstandard support";
+    return {};
+#endif
+}
+
+quint32 PartCompression::trainDictionary(const QList<QByteArray> &samples)
+{
+#if HAVE_ZSTD
+    QByteArray samplesBuffer;
+    std::vector<size_t> sampleSizes;
+    sampleSizes.reserve(samples.size());
+    for (const QByteArray &sample : samples) {
+        samplesBuffer += sample;
+        sampleSizes.push_back(sample.size());
+    }
+
+    QByteArray dict(maxDictionarySize, Qt::Uninitialized);
+    const size_t size = ZDICT_trainFromBuffer(dict.data(), dict.size(), samplesBuffer.constData(), sampleSizes.data(), unsigned(sampleSizes.size()));
+    if (ZDICT_isError(size)) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to train compression dictionary:" << ZDICT_getErrorName(size);
+        return 0;
+    }
+    dict.resize(size);
+
+    const quint32 dictionaryId = ZDICT_getDictID(dict.constData(), dict.size());
+    const QString path = dictionaryPath(dictionaryId);
+    if (dictionaryId == 0 || QFile::exists(path)) {
+        // Dictionary IDs are random, just try again next time
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: trained compression dictionary has an invalid or existing ID" << dictionaryId;
+        return 0;
+    }
+
+    QDir().mkpath(dictionaryDirectory());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || f.write(dict) != dict.size() || !f.commit()) {
+        qCWarning(AKONADIPRIVATE_LOG) << "Error: failed to store compression dictionary" << path << ":" << f.errorString();
+        return 0;
+    }
+    return dictionaryId;
+#else
+    Q_UNUSED(samples)
+    return 0;
+#endif
+}
+
+QString PartCompression::dictionaryPath(quint32 dictionaryId)
+{
+    return dictionaryDirectory() + QDir::separator() + QString::number(dictionaryId) + QLatin1StringView(".zdict");
+}
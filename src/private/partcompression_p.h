@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "akonadiprivate_export.h"
+
+#include <QByteArray>
+#include <QList>
+
+class QString;
+
+namespace Akonadi
+{
+/**
+ * Zstandard compression of item parts stored by the server.
+ *
+ * Parts can be compressed with a dictionary trained from parts of the same
+ * type, which helps a lot with small, repetitive payloads like mail headers
+ * or vCards. Dictionaries are stored next to the external part files and are
+ * identified by the dictionary ID, which zstd records in each compressed frame,
+ * so that clients can decompress parts they receive without asking the server.
+ *
+ * All methods fail when Akonadi was built without Zstandard support.
+ */
+class AKONADIPRIVATE_EXPORT PartCompression
+{
+public:
+    /**
+     * Returns whether Akonadi was built with Zstandard support.
+     */
+    static bool isAvailable();
+
+    /**
+     * Compresses @p data using the dictionary @p dictionaryId, or without
+     * a dictionary if it's 0. Returns an empty array on failure.
+     */
+    static QByteArray compress(const QByteArray &data, quint32 dictionaryId = 0);
+
+    /**
+     * Decompresses @p data, looking up the dictionary it was compressed with.
+     * Sets @p ok to false on failure.
+     */
+    static QByteArray decompress(const QByteArray &data, bool *ok = nullptr);
+
+    /**
+     * Trains a new dictionary from @p samples and stores it.
+     * Returns the ID of the dictionary or 0 on failure.
+     */
+    static quint32 trainDictionary(const QList<QByteArray> &samples);
+
+    static QString dictionaryPath(quint32 dictionaryId);
+};
+
+} // namespace Akonadi
@@ -101,6 +101,10 @@ QDebug operator<<(QDebug _dbg, Command::Type type)
 
     case Command::SelectResource:
         return dbg << "SelectResource";
+    case Command::OpenRetrievalChannel:
+        return dbg << "OpenRetrievalChannel";
+    case Command::RetrieveItems:
+        return dbg << "RetrieveItems";
 
     case Command::StreamPayload:
         return dbg << "StreamPayload";
@@ -138,7 +142,7 @@ DataStream &operator<<(DataStream &stream, const QSharedPointer<T> &ptr)
 template<typename T>
 DataStream &operator>>(DataStream &stream, QSharedPointer<T> &ptr)
 {
-    ptr = Protocol::deserialize(stream.device()).staticCast<T>();
+    ptr = Protocol::deserialize(stream).staticCast<T>();
     return stream;
 }
 
@@ -198,6 +202,8 @@ void Command::toJson(QJsonObject &json) const
         case_label(ModifyTag)
 
         case_label(SelectResource)
+        case_label(OpenRetrievalChannel)
+        case_label(RetrieveItems)
 
         case_label(StreamPayload)
         case_label(CreateSubscription)
@@ -282,6 +288,8 @@ void toJson(const Akonadi::Protocol::Command *command, QJsonObject &json)
    case_commandlabel(ModifyTag, ModifyTagCommand, ModifyTagResponse)
 
     case_commandlabel(SelectResource, SelectResourceCommand, SelectResourceResponse)
+    case_commandlabel(OpenRetrievalChannel, OpenRetrievalChannelCommand, OpenRetrievalChannelResponse)
+    case_commandlabel(RetrieveItems, RetrieveItemsCommand, RetrieveItemsResponse)
 
     case_commandlabel(StreamPayload, StreamPayloadCommand, StreamPayloadResponse)
 
@@ -396,6 +404,8 @@ public:
 
         // Resources
         registerType<Command::SelectResource, SelectResourceCommand, SelectResourceResponse>();
+        registerType<Command::OpenRetrievalChannel, OpenRetrievalChannelCommand, OpenRetrievalChannelResponse>();
+        registerType<Command::RetrieveItems, RetrieveItemsCommand, RetrieveItemsResponse>();
 
         // Other...?
         registerType<Command::StreamPayload, StreamPayloadCommand, StreamPayloadResponse>();
@@ -103,6 +103,8 @@ public:
 
         // Resources
         SelectResource = 90,
+        OpenRetrievalChannel,
+        RetrieveItems,
 
         // Other
         StreamPayload = 100,
@@ -271,6 +273,7 @@ private:
 
 AKONADIPRIVATE_EXPORT void serialize(DataStream &stream, const CommandPtr &command);
 AKONADIPRIVATE_EXPORT CommandPtr deserialize(QIODevice *device);
+AKONADIPRIVATE_EXPORT CommandPtr deserialize(DataStream &stream);
 AKONADIPRIVATE_EXPORT QString debugString(const Command &command);
 AKONADIPRIVATE_EXPORT inline QString debugString(const CommandPtr &command)
 {
@@ -158,9 +158,14 @@ void CppGenerator::writeImplSerializer(DocumentNode const *node)
     mImpl << "CommandPtr deserialize(QIODevice *device)\n"
              "{\n"
              "    DataStream stream(device);\n"
+             "    return deserialize(stream);\n"
+             "}\n\n";
+
+    mImpl << "CommandPtr deserialize(DataStream &stream)\n"
+             "{\n"
              "    stream.waitForData(sizeof(Command::Type));\n"
              "    Command::Type cmdType;\n"
-             "    if (Q_UNLIKELY(device->peek((char *) &cmdType, sizeof(Command::Type)) != sizeof(Command::Type))) {\n"
+             "    if (Q_UNLIKELY(stream.device()->peek((char *) &cmdType, sizeof(Command::Type)) != sizeof(Command::Type))) {\n"
              "        throw ProtocolException(\"Failed to peek command type\");\n"
              "    }\n"
              "    CommandPtr cmd;\n"
@@ -125,6 +125,7 @@ bool AkonadiServer::init()
 
     mDebugInterface = std::make_unique<DebugInterface>(*mTracer);
     mResourceManager = std::make_unique<ResourceManager>(*mTracer);
+    connect(mResourceManager.get(), &ResourceManager::resourceInstanceRemoved, mNotificationManager.get(), &NotificationManager::forgetResource);
     mPreprocessorManager = std::make_unique<PreprocessorManager>(*mTracer);
     mIntervalCheck = AkThread::create<IntervalCheck>(*mItemRetrieval);
     mSearchManager = AkThread::create<SearchManager>(searchManagers, *mAgentSearchManager);
@@ -133,6 +134,8 @@ bool AkonadiServer::init()
     if (settings.value(QStringLiteral("General/DisablePreprocessing"), false).toBool()) {
         mPreprocessorManager->setEnabled(false);
     }
+    mPreprocessorManager->setBatchWindow(settings.value(QStringLiteral("Preprocessing/BatchWindow"), mPreprocessorManager->batchWindow()).toInt());
+    mPreprocessorManager->setMaximumBatchSize(settings.value(QStringLiteral("Preprocessing/MaxBatchSize"), mPreprocessorManager->maximumBatchSize()).toInt());
 
     new ServerAdaptor(this);
     QDBusConnection::sessionBus().registerObject(QStringLiteral("/Server"), this);
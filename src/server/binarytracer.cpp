@@ -0,0 +1,177 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "binarytracer.h"
+#include "akonadiserver_debug.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+using namespace std::chrono_literals;
+
+namespace
+{
+constexpr auto FlushInterval = 1s;
+
+std::atomic<quint64> sTracerIds = 0;
+
+struct ThreadBuffer {
+    quint64 tracer = 0;
+    std::shared_ptr<TraceEventBuffer> buffer;
+};
+thread_local ThreadBuffer tThreadBuffer;
+
+} // namespace
+
+BinaryTracer::BinaryTracer(const QString &fileName, qint64 maxFileSize, StartMode startMode)
+    : AkThread(QStringLiteral("BinaryTracer"), startMode, QThread::LowPriority)
+    , mFileName(fileName)
+    , mMaxFileSize(maxFileSize)
+    , mStart(Clock::now())
+    , mStartTime(QDateTime::currentMSecsSinceEpoch())
+    , mId(++sTracerIds)
+{
+}
+
+BinaryTracer::~BinaryTracer()
+{
+    quitThread();
+}
+
+void BinaryTracer::init()
+{
+    AkThread::init();
+
+    rotateFile();
+    if (!openFile()) {
+        return;
+    }
+
+    mTimer = new QTimer(this);
+    connect(mTimer, &QTimer::timeout, this, &BinaryTracer::flush);
+    mTimer->start(FlushInterval);
+}
+
+void BinaryTracer::quit()
+{
+    delete mTimer;
+    mTimer = nullptr;
+
+    flush();
+    mFile.close();
+
+    AkThread::quit();
+}
+
+TraceEventBuffer *BinaryTracer::threadBuffer()
+{
+    if (tThreadBuffer.tracer != mId) {
+        tThreadBuffer.tracer = mId;
+        tThreadBuffer.buffer = std::make_shared<TraceEventBuffer>();
+        QMutexLocker locker(&mBuffersLock);
+        mBuffers.push_back(tThreadBuffer.buffer);
+    }
+    return tThreadBuffer.buffer.get();
+}
+
+void BinaryTracer::recordCommand(quint32 connection, qint64 tag, quint16 command, Clock::time_point start, quint32 responses, bool failed)
+{
+    BinaryTrace::Event event;
+    event.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(start - mStart).count();
+    event.tag = tag;
+    event.connection = connection;
+    event.duration = quint32(std::min<qint64>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count(), std::numeric_limits<quint32>::max()));
+    event.count = responses;
+    event.command = command;
+    event.flags = failed ? BinaryTrace::Failed : 0;
+    threadBuffer()->push(event);
+}
+
+bool BinaryTracer::openFile()
+{
+    QDir().mkpath(QFileInfo(mFileName).absolutePath());
+    mFile.setFileName(mFileName);
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || !BinaryTrace::writeHeader(&mFile, {mStartTime})) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to open binary trace file" << mFileName << ":" << mFile.errorString();
+        mFile.close();
+        return false;
+    }
+    return true;
+}
+
+void BinaryTracer::rotateFile()
+{
+    if (!QFile::exists(mFileName)) {
+        return;
+    }
+    const QString oldFileName = mFileName + QLatin1StringView(".1");
+    QFile::remove(oldFileName);
+    QFile::rename(mFileName, oldFileName);
+}
+
+void BinaryTracer::writeEvent(const BinaryTrace::Event &event)
+{
+    const auto size = mWriteBuffer.size();
+    mWriteBuffer.resize(size + BinaryTrace::EventSize);
+    BinaryTrace::encodeEvent(event, mWriteBuffer.data() + size);
+}
+
+void BinaryTracer::flush()
+{
+    if (!mFile.isOpen()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mBuffersLock);
+        for (auto it = mBuffers.begin(); it != mBuffers.end();) {
+            auto &buffer = *it;
+            buffer->drain([this](const BinaryTrace::Event &event) {
+                writeEvent(event);
+            });
+            if (const quint32 dropped = buffer->takeDropped(); dropped > 0) {
+                BinaryTrace::Event event;
+                event.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - mStart).count();
+                event.count = dropped;
+                event.flags = BinaryTrace::Dropped;
+                writeEvent(event);
+            }
+            // The thread that recorded into the buffer is gone
+            if (buffer.use_count() == 1) {
+                it = mBuffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    if (mWriteBuffer.isEmpty()) {
+        return;
+    }
+
+    if (mMaxFileSize > 0 && mFile.size() + mWriteBuffer.size() > mMaxFileSize) {
+        mFile.close();
+        rotateFile();
+        if (!openFile()) {
+            mWriteBuffer.clear();
+            return;
+        }
+    }
+
+    if (mFile.write(mWriteBuffer) != mWriteBuffer.size() || !mFile.flush()) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to write binary trace file" << mFileName << ":" << mFile.errorString();
+    }
+    mWriteBuffer.clear();
+}
+
+#include "moc_binarytracer.cpp"
@@ -0,0 +1,139 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "akthread.h"
+
+#include "private/binarytrace_p.h"
+
+#include <QFile>
+#include <QMutex>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+class QTimer;
+
+namespace Akonadi
+{
+namespace Server
+{
+/**
+ * Fixed-size single-producer, single-consumer queue of trace events.
+ *
+ * The producer never blocks nor allocates: events that don't fit are counted
+ * as dropped instead.
+ */
+class TraceEventBuffer
+{
+public:
+    static constexpr quint32 Capacity = 2048;
+
+    /// Called by the thread owning the buffer
+    void push(const BinaryTrace::Event &event)
+    {
+        const quint32 head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) == Capacity) {
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        mEvents[head % Capacity] = event;
+        mHead.store(head + 1, std::memory_order_release);
+    }
+
+    /// Called by the writer, passes the queued events to @p consume
+    template<typename Func>
+    void drain(Func &&consume)
+    {
+        const quint32 head = mHead.load(std::memory_order_acquire);
+        quint32 tail = mTail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            consume(mEvents[tail % Capacity]);
+        }
+        mTail.store(tail, std::memory_order_release);
+    }
+
+    quint32 takeDropped()
+    {
+        return mDropped.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<BinaryTrace::Event, Capacity> mEvents;
+    std::atomic<quint32> mHead = 0;
+    std::atomic<quint32> mTail = 0;
+    std::atomic<quint32> mDropped = 0;
+};
+
+/**
+ * Low-overhead trace of the commands handled by the server.
+ *
+ * Connections record fixed-size events into per-thread buffers, which the
+ * tracer thread periodically writes to a binary trace file, see BinaryTrace.
+ * This is cheap enough to stay enabled, so that latency issues can be looked
+ * into after they happened.
+ *
+ * The trace file is rotated when the tracer starts and once it reaches its
+ * maximum size, keeping the previous one with a ".1" suffix, so that the
+ * trace of the last run is still there after a restart.
+ */
+class BinaryTracer : public AkThread
+{
+    Q_OBJECT
+
+protected:
+    /**
+     * Use AkThread::create() to create and start a new BinaryTracer thread.
+     */
+    explicit BinaryTracer(const QString &fileName, qint64 maxFileSize, StartMode startMode = AutoStart);
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ~BinaryTracer() override;
+
+    /**
+     * Records that connection @p connection handled command @p tag.
+     *
+     * Can be called from any thread.
+     */
+    void recordCommand(quint32 connection, qint64 tag, quint16 command, Clock::time_point start, quint32 responses, bool failed);
+
+    /**
+     * Writes the recorded events to the file.
+     */
+    void flush();
+
+protected:
+    void init() override;
+    void quit() override;
+
+private:
+    TraceEventBuffer *threadBuffer();
+    bool openFile();
+    void rotateFile();
+    void writeEvent(const BinaryTrace::Event &event);
+
+    const QString mFileName;
+    const qint64 mMaxFileSize;
+    const Clock::time_point mStart;
+    const qint64 mStartTime;
+    const quint64 mId;
+
+    QMutex mBuffersLock;
+    std::vector<std::shared_ptr<TraceEventBuffer>> mBuffers;
+
+    QFile mFile;
+    QByteArray mWriteBuffer;
+    QTimer *mTimer = nullptr;
+};
+
+} // namespace Server
+} // namespace Akonadi
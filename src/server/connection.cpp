@@ -8,14 +8,17 @@
 #include "akonadiserver_debug.h"
 
 #include <QEventLoop>
+#include <QScopeGuard>
 #include <QSettings>
 #include <QThreadStorage>
 
+#include "binarytracer.h"
 #include "handler.h"
 #include "notificationmanager.h"
 #include "storage/datastore.h"
 #include "storage/dbdeadlockcatcher.h"
 
+#include <atomic>
 #include <cassert>
 
 #ifndef Q_OS_WIN
@@ -29,6 +32,9 @@ using namespace Akonadi::Server;
 
 #define IDLE_TIMER_TIMEOUT 180000 // 3 min
 
+static std::atomic_int sActiveCommands = 0;
+static std::atomic<quint32> sTraceIds = 0;
+
 static QString connectionIdentifier(Connection *c)
 {
     const QString id = QString::asprintf("%p", static_cast<void *>(c));
@@ -47,6 +53,7 @@ Connection::Connection(quintptr socketDescriptor, AkonadiServer &akonadi)
 {
     m_socketDescriptor = socketDescriptor;
     m_identifier = connectionIdentifier(this); // same as objectName()
+    m_traceId = ++sTraceIds;
 
     const QSettings settings(Akonadi::StandardDirs::serverConfigFile(), QSettings::IniFormat);
     m_verifyCacheOnRetrieval = settings.value(QStringLiteral("Cache/VerifyOnRetrieval"), m_verifyCacheOnRetrieval).toBool();
@@ -178,7 +185,7 @@ void Connection::handleIncomingData()
 
         // Blocks with event loop until some data arrive, allows us to still use QTimers
         // and similar while waiting for some data to arrive
-        if (m_socket->bytesAvailable() < int(sizeof(qint64))) {
+        if (!Protocol::DataStream::hasMessage(m_socket.get(), m_encoding)) {
             QEventLoop loop;
             connect(m_socket.get(), &QLocalSocket::readyRead, &loop, &QEventLoop::quit);
             connect(m_socket.get(), &QLocalSocket::stateChanged, &loop, &QEventLoop::quit);
@@ -204,15 +211,16 @@ void Connection::handleIncomingData()
         }
 
         QString currentCommand;
-        while (m_socket->bytesAvailable() >= int(sizeof(qint64))) {
-            Protocol::DataStream stream(m_socket.get());
+        while (Protocol::DataStream::hasMessage(m_socket.get(), m_encoding)) {
+            Protocol::DataStream stream(m_socket.get(), m_encoding);
             qint64 tag = -1;
-            stream >> tag;
-            // TODO: Check tag is incremental sequence
-
             Protocol::CommandPtr cmd;
             try {
-                cmd = Protocol::deserialize(m_socket.get());
+                stream.beginMessage();
+                stream >> tag;
+                // TODO: Check tag is incremental sequence
+
+                cmd = Protocol::deserialize(stream);
             } catch (const Akonadi::ProtocolException &e) {
                 qCWarning(AKONADISERVER_LOG) << "ProtocolException while deserializing incoming data on connection" << m_identifier << ":" << e.what();
                 setState(Server::LoggingOut);
@@ -231,9 +239,13 @@ void Connection::handleIncomingData()
             // Tag context and collection context is not persistent.
             m_context.setTag(std::nullopt);
             m_context.setCollection({});
-            if (m_akonadi.tracer().currentTracer() != QLatin1StringView("null")) {
+            if (m_akonadi.tracer().isEnabled()) {
                 m_akonadi.tracer().connectionInput(m_identifier, tag, cmd);
             }
+            BinaryTracer *binaryTracer = m_akonadi.tracer().binaryTracer();
+            const auto traceStart = binaryTracer ? BinaryTracer::Clock::now() : BinaryTracer::Clock::time_point{};
+            m_traceResponses = 0;
+            m_traceFailed = false;
 
             m_currentHandler = findHandlerForCommand(cmd->type());
             if (!m_currentHandler) {
@@ -248,6 +260,10 @@ void Connection::handleIncomingData()
             m_currentHandler->setConnection(this);
             m_currentHandler->setTag(tag);
             m_currentHandler->setCommand(cmd);
+            ++sActiveCommands;
+            const auto activeCommandGuard = qScopeGuard([]() {
+                --sActiveCommands;
+            });
             try {
                 DbDeadlockCatcher catcher([this, &cmd]() {
                     parseStream(cmd);
@@ -301,6 +317,9 @@ void Connection::handleIncomingData()
             if (m_reportTime) {
                 stopTime(currentCommand);
             }
+            if (binaryTracer) {
+                binaryTracer->recordCommand(m_traceId, tag, cmd->type(), traceStart, m_traceResponses, m_traceFailed);
+            }
             m_currentHandler.reset();
 
             if (!m_socket || m_socket->state() != QLocalSocket::ConnectedState) {
@@ -400,6 +419,16 @@ QByteArray Connection::sessionId() const
     return m_sessionId;
 }
 
+void Connection::setEncoding(Protocol::DataStream::Encoding encoding)
+{
+    m_encoding = encoding;
+}
+
+Protocol::DataStream::Encoding Connection::encoding() const
+{
+    return m_encoding;
+}
+
 bool Connection::isOwnerResource(const PimItem &item) const
 {
     if (context().resource().isValid() && item.collection().resourceId() == context().resource().id()) {
@@ -423,6 +452,21 @@ bool Connection::isOwnerResource(const Collection &collection) const
     return false;
 }
 
+void Connection::setAcceptCompressedParts(bool accept)
+{
+    m_acceptCompressedParts = accept;
+}
+
+bool Connection::acceptCompressedParts() const
+{
+    return m_acceptCompressedParts;
+}
+
+int Connection::activeCommandCount()
+{
+    return sActiveCommands;
+}
+
 bool Connection::verifyCacheOnRetrieval() const
 {
     return m_verifyCacheOnRetrieval;
@@ -456,10 +500,14 @@ void Connection::reportTime() const
 
 void Connection::sendResponse(qint64 tag, const Protocol::CommandPtr &response)
 {
-    if (m_akonadi.tracer().currentTracer() != QLatin1StringView("null")) {
+    if (m_akonadi.tracer().isEnabled()) {
         m_akonadi.tracer().connectionOutput(m_identifier, tag, response);
     }
-    Protocol::DataStream stream(m_socket.get());
+    ++m_traceResponses;
+    if (response->isResponse()) {
+        m_traceFailed |= Protocol::cmdCast<Protocol::Response>(response).isError();
+    }
+    Protocol::DataStream stream(m_socket.get(), m_encoding);
     stream << tag;
     Protocol::serialize(stream, response);
     stream.flush();
@@ -475,16 +523,17 @@ void Connection::sendResponse(qint64 tag, const Protocol::CommandPtr &response)
 
 Protocol::CommandPtr Connection::readCommand()
 {
-    while (m_socket->bytesAvailable() < static_cast<int>(sizeof(qint64))) {
+    while (!Protocol::DataStream::hasMessage(m_socket.get(), m_encoding)) {
         Protocol::DataStream::waitForData(m_socket.get(), 30000); // 30 seconds, just in case client is busy
     }
 
-    Protocol::DataStream stream(m_socket.get());
+    Protocol::DataStream stream(m_socket.get(), m_encoding);
+    stream.beginMessage();
     qint64 tag;
     stream >> tag;
 
     // TODO: compare tag with m_currentHandler->tag() ?
-    return Protocol::deserialize(m_socket.get());
+    return Protocol::deserialize(stream);
 }
 
 #include "moc_connection.cpp"
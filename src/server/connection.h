@@ -66,9 +66,29 @@ public:
     void setSessionId(const QByteArray &id);
     QByteArray sessionId() const;
 
+    /**
+      Sets the wire encoding used for all subsequent commands and responses.
+      The encoding is negotiated by the client during Login.
+    */
+    void setEncoding(Protocol::DataStream::Encoding encoding);
+    Protocol::DataStream::Encoding encoding() const;
+
+    /**
+      Sets whether the client can decompress parts itself, in which case
+      compressed parts are sent to it as they are stored.
+    */
+    void setAcceptCompressedParts(bool accept);
+    bool acceptCompressedParts() const;
+
     /** Returns @c true if permanent cache verification is enabled. */
     bool verifyCacheOnRetrieval() const;
 
+    /**
+      Returns the number of commands currently being handled by all connections,
+      used by background tasks to back off while the server is busy.
+    */
+    static int activeCommandCount();
+
     Protocol::CommandPtr readCommand();
 
     void setState(ConnectionState state);
@@ -112,7 +132,9 @@ protected:
     QList<QByteArray> m_statusMessageQueue;
     QString m_identifier;
     QByteArray m_sessionId;
+    Protocol::DataStream::Encoding m_encoding = Protocol::DataStream::Encoding::Legacy;
     bool m_verifyCacheOnRetrieval = false;
+    bool m_acceptCompressedParts = false;
     CommandContext m_context;
 
     QElapsedTimer m_time;
@@ -122,6 +144,12 @@ protected:
 
     bool m_connectionClosing = false;
 
+    /// Identifies the connection in the binary trace
+    quint32 m_traceId = 0;
+    /// Responses sent for the current command, for the binary trace
+    quint32 m_traceResponses = 0;
+    bool m_traceFailed = false;
+
 private:
     void parseStream(const Protocol::CommandPtr &cmd);
     template<typename T>
@@ -143,10 +171,14 @@ inline typename std::enable_if<std::is_base_of<Protocol::Command, T>::value>::ty
 template<typename T>
 inline typename std::enable_if<std::is_base_of<Protocol::Command, T>::value>::type Connection::sendResponse(qint64 tag, T &&response)
 {
-    if (m_akonadi.tracer().currentTracer() != QLatin1StringView("null")) {
+    if (m_akonadi.tracer().isEnabled()) {
         m_akonadi.tracer().connectionOutput(m_identifier, tag, response);
     }
-    Protocol::DataStream stream(m_socket.get());
+    ++m_traceResponses;
+    if constexpr (std::is_base_of_v<Protocol::Response, std::remove_cvref_t<T>>) {
+        m_traceFailed |= response.isError();
+    }
+    Protocol::DataStream stream(m_socket.get(), m_encoding);
     stream << tag;
     stream << std::move(response);
     stream.flush();
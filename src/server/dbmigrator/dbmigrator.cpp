@@ -20,6 +20,7 @@
 #include "storage/dbconfigmysql.h"
 #include "storage/dbconfigpostgresql.h"
 #include "storage/dbconfigsqlite.h"
+#include "storage/dbinitializer.h"
 #include "storage/dbintrospector.h"
 #include "storage/querybuilder.h"
 #include "storage/schematypes.h"
@@ -37,7 +38,9 @@
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutex>
 #include <QScopeGuard>
+#include <QSet>
 #include <QSettings>
 #include <QSqlDatabase>
 #include <QSqlError>
@@ -47,6 +50,7 @@
 
 #include <KLocalizedString>
 
+#include <atomic>
 #include <chrono>
 #include <qdbusconnection.h>
 
@@ -60,7 +64,16 @@ Q_DECLARE_METATYPE(UIDelegate::Result);
 namespace
 {
 
-constexpr size_t maxTransactionSize = 1000; // Arbitary guess
+constexpr int maxParallelTables = 4;
+
+/// Number of rows inserted in a single transaction
+size_t maxTransactionSize(DbType::Type type)
+{
+    // SQLite pays for every commit with an fsync of the whole database, so make the
+    // transactions as large as reasonably possible. Client/server databases are better
+    // off with smaller transactions that don't blow up their undo logs. Both are guesses.
+    return type == DbType::Sqlite ? 100'000 : 10'000;
+}
 
 class MigratorDataStoreFactory : public DataStoreFactory
 {
@@ -253,6 +266,44 @@ bool syncAutoIncrementValue(DataStore *sourceStore, DataStore *destStore, const
     return setAutoIncrementValue(destStore, table.name, idCol->name, *seq);
 }
 
+/**
+ * Drops the non-unique indexes of @p table, they get recreated by DbInitializer::updateIndexesAndConstraints()
+ * once the data is loaded, which is much faster than updating them for every inserted row.
+ */
+void dropIndexes(DataStore *store, const TableDescription &table)
+{
+    auto db = store->database();
+    const auto introspector = DbIntrospector::createInstance(db);
+    const auto dbType = DbType::type(db);
+    for (const auto &index : table.indexes) {
+        if (index.isUnique) {
+            continue;
+        }
+
+        const auto indexName = QStringLiteral("%1_%2").arg(table.name, index.name);
+        if (!introspector->hasIndex(table.name, indexName)) {
+            continue;
+        }
+
+        QSqlQuery query(db);
+        const auto statement = dbType == DbType::MySQL ? QStringLiteral("DROP INDEX %1 ON %2").arg(indexName, table.name)
+                                                       : QStringLiteral("DROP INDEX %1").arg(indexName);
+        if (!query.exec(statement)) {
+            // Not fatal, the index will just be kept up-to-date during the load
+            qCWarning(AKONADIDBMIGRATOR_LOG) << "Failed to drop index" << indexName << ":" << query.lastError().text();
+        }
+    }
+}
+
+int rowCount(DataStore *store, const QString &table)
+{
+    CountQueryBuilder countQb(store, table);
+    if (!countQb.exec()) {
+        return -1;
+    }
+    return countQb.result();
+}
+
 bool analyzeTable(const QString &table, DataStore *store)
 {
     auto dbType = DbType::type(store->database());
@@ -414,6 +465,68 @@ bool releaseAkonadiLock()
 
 } // namespace
 
+namespace Akonadi::Server
+{
+
+/**
+ * Keeps track of tables that have already been fully migrated, so that an interrupted
+ * migration can resume from where it stopped.
+ */
+class MigrationCheckpoint
+{
+    Q_DISABLE_COPY_MOVE(MigrationCheckpoint)
+public:
+    explicit MigrationCheckpoint(const QString &sourceDriver, const QString &destDriver)
+        : m_settings(StandardDirs::saveDir("data", QStringLiteral("db_migration")) + QStringLiteral("/checkpoint"), QSettings::IniFormat)
+    {
+        if (m_settings.value(QStringLiteral("SourceDriver")).toString() == sourceDriver
+            && m_settings.value(QStringLiteral("DestinationDriver")).toString() == destDriver) {
+            const auto tables = m_settings.value(QStringLiteral("Tables")).toStringList();
+            m_tables = QSet<QString>{tables.cbegin(), tables.cend()};
+        } else {
+            m_settings.clear();
+            m_settings.setValue(QStringLiteral("SourceDriver"), sourceDriver);
+            m_settings.setValue(QStringLiteral("DestinationDriver"), destDriver);
+            m_settings.sync();
+        }
+    }
+
+    bool isEmpty() const
+    {
+        return m_tables.isEmpty();
+    }
+
+    bool contains(const QString &table) const
+    {
+        return m_tables.contains(table);
+    }
+
+    void add(const QString &table)
+    {
+        const QMutexLocker locker(&m_lock);
+        m_tables.insert(table);
+        m_settings.setValue(QStringLiteral("Tables"), QStringList{m_tables.cbegin(), m_tables.cend()});
+        m_settings.sync();
+    }
+
+    void remove()
+    {
+        const QMutexLocker locker(&m_lock);
+        const auto fileName = m_settings.fileName();
+        m_settings.clear();
+        m_settings.sync();
+        QFile::remove(fileName);
+        m_tables.clear();
+    }
+
+private:
+    QSettings m_settings;
+    QSet<QString> m_tables;
+    QMutex m_lock;
+};
+
+} // namespace Akonadi::Server
+
 DbMigrator::DbMigrator(const QString &targetEngine, UIDelegate *delegate, QObject *parent)
     : QObject(parent)
     , m_targetEngine(targetEngine)
@@ -540,7 +653,7 @@ bool DbMigrator::runMigrationThread()
     emitInfo(i18nc("@info:status", "Running fsck on the source database"));
     runStorageJanitor(sourceConfig.get());
 
-    const bool migrationSuccess = migrateTables(sourceStore.get(), destStore.get(), destConfig.get());
+    const bool migrationSuccess = migrateTables(sourceStore.get(), destStore.get(), sourceConfig.get(), destConfig.get());
 
     // Stop database servers and close connections. Make sure we always reach here, even if the migration failed
     cleanupDatabase(sourceStore.get(), sourceConfig.get());
@@ -589,7 +702,7 @@ bool DbMigrator::runMigrationThread()
     return true;
 }
 
-bool DbMigrator::migrateTables(DataStore *sourceStore, DataStore *destStore, DbConfig *destConfig)
+bool DbMigrator::migrateTables(DataStore *sourceStore, DataStore *destStore, DbConfig *sourceConfig, DbConfig *destConfig)
 {
     // Disable foreign key constraint checks
     if (!destConfig->disableConstraintChecks(destStore->database())) {
@@ -597,26 +710,44 @@ bool DbMigrator::migrateTables(DataStore *sourceStore, DataStore *destStore, DbC
     }
 
     AkonadiSchema schema;
-    const int totalTables = schema.tables().size() + schema.relations().size();
-    int doneTables = 0;
-
-    // Copy regular tables
-    for (const auto &table : schema.tables()) {
-        ++doneTables;
-        emitProgress(table.name, doneTables, totalTables);
-        if (!copyTable(sourceStore, destStore, table)) {
-            emitError(i18nc("@info:shell", "Error has occurred while migrating table %1", table.name));
-            return false;
-        }
+    QList<TableDescription> tables = schema.tables();
+    for (const auto &relation : schema.relations()) {
+        tables.push_back(RelationTableDescription{relation});
     }
+    const int totalTables = tables.size();
 
-    // Copy relational tables
-    for (const auto &relation : schema.relations()) {
-        const RelationTableDescription table{relation};
-        ++doneTables;
-        emitProgress(table.name, doneTables, totalTables);
-        if (!copyTable(sourceStore, destStore, table)) {
-            emitError(i18nc("@info:shell", "Error has occurred while migrating table %1", table.name));
+    // Skip tables that have been fully migrated by a previous, interrupted run
+    MigrationCheckpoint checkpoint(sourceConfig->driverName(), destConfig->driverName());
+    if (!checkpoint.isEmpty()) {
+        emitInfo(i18nc("@info:status", "Resuming previously interrupted migration..."));
+    }
+    const auto pendingTables = tables | Views::filter([&](const TableDescription &table) {
+                                   // Don't trust the checkpoint blindly, the new database might have been removed meanwhile
+                                   return !checkpoint.contains(table.name) || rowCount(sourceStore, table.name) != rowCount(destStore, table.name);
+                               })
+        | Actions::toQList;
+    int doneTables = totalTables - pendingTables.size();
+
+    // Defer index creation until all the data are loaded
+    for (const auto &table : pendingTables) {
+        dropIndexes(destStore, table);
+    }
+
+    if (!copyTables(pendingTables, sourceConfig, destConfig, doneTables, totalTables, checkpoint)) {
+        return false;
+    }
+
+    emitInfo(i18nc("@info:status", "Creating indexes..."));
+    auto initializer = DbInitializer::createInstance(destStore->database(), &schema);
+    if (!initializer->updateIndexesAndConstraints()) {
+        emitError(i18nc("@info:status", "Error: failed to create indexes: %1", initializer->errorMsg()));
+        return false;
+    }
+
+    for (const auto &table : pendingTables) {
+        emitInfo(i18nc("@info:status", "Optimizing table %1...", table.name));
+        if (!analyzeTable(table.name, destStore)) {
+            emitError(i18nc("@info:status", "Error: failed to optimize table %1", table.name));
             return false;
         }
     }
@@ -626,9 +757,87 @@ bool DbMigrator::migrateTables(DataStore *sourceStore, DataStore *destStore, DbC
         return false;
     }
 
+    checkpoint.remove();
+
     return true;
 }
 
+bool DbMigrator::copyTables(const QList<TableDescription> &tables,
+                            DbConfig *sourceConfig,
+                            DbConfig *destConfig,
+                            int doneTables,
+                            int totalTables,
+                            MigrationCheckpoint &checkpoint)
+{
+    if (tables.isEmpty()) {
+        return true;
+    }
+
+    // SQLite only allows a single writer at a time, so copying in parallel would only
+    // make the connections wait for each other.
+    const int workerCount = destConfig->driverName().startsWith(QLatin1StringView("QSQLITE"))
+        ? 1
+        : std::clamp(QThread::idealThreadCount(), 1, std::min<int>(maxParallelTables, tables.size()));
+
+    std::atomic<qsizetype> nextTable = 0;
+    std::atomic<int> done = doneTables;
+    std::atomic<bool> failed = false;
+
+    const auto worker = [&]() {
+        // Each worker needs its own connections, since a QSqlDatabase can only be used from
+        // the thread it was created in.
+        MigratorDataStoreFactory sourceFactory(sourceConfig);
+        MigratorDataStoreFactory destFactory(destConfig);
+        std::unique_ptr<DataStore> sourceStore{sourceFactory.createStore()};
+        std::unique_ptr<DataStore> destStore{destFactory.createStore()};
+        const auto closeStores = qScopeGuard([&]() {
+            sourceStore->close();
+            destStore->close();
+        });
+
+        if (!sourceStore->database().isOpen() || !destStore->database().isOpen()) {
+            emitError(i18nc("@info:shell", "Error: failed to open database connection for migration."));
+            failed = true;
+            return;
+        }
+        // PostgreSQL disables the constraints per table, which has already been done by migrateTables(),
+        // other backends disable them per connection.
+        if (DbType::type(destStore->database()) != DbType::PostgreSQL && !destConfig->disableConstraintChecks(destStore->database())) {
+            failed = true;
+            return;
+        }
+
+        while (!failed) {
+            const auto idx = nextTable++;
+            if (idx >= tables.size()) {
+                break;
+            }
+
+            const auto &table = tables.at(idx);
+            if (!copyTable(sourceStore.get(), destStore.get(), table)) {
+                emitError(i18nc("@info:shell", "Error has occurred while migrating table %1", table.name));
+                failed = true;
+                break;
+            }
+            checkpoint.add(table.name);
+            emitProgress(table.name, ++done, totalTables);
+        }
+    };
+
+    std::vector<std::unique_ptr<QThread>> threads;
+    for (int i = 1; i < workerCount; ++i) {
+        threads.emplace_back(QThread::create(worker));
+        threads.back()->start();
+    }
+    // The current thread is a worker, too
+    worker();
+    for (auto &thread : threads) {
+        thread->wait();
+    }
+
+    return !failed;
+}
+
 std::optional<QString> DbMigrator::moveDatabaseToBackupLocation(DbConfig *config)
 {
     const std::filesystem::path dbPath = config->databasePath().toStdString();
@@ -745,11 +954,7 @@ bool DbMigrator::copyTable(DataStore *sourceStore, DataStore *destStore, const T
         | Actions::toQList;
 
     // Count number of items in the current table
-    const auto totalRows = [](DataStore *store, const QString &table) {
-        CountQueryBuilder countQb(store, table);
-        countQb.exec();
-        return countQb.result();
-    }(sourceStore, table.name);
+    const auto totalRows = rowCount(sourceStore, table.name);
 
     // Fetch *everything* from the current able
     QueryBuilder sourceQb(sourceStore, table.name);
@@ -757,22 +962,36 @@ bool DbMigrator::copyTable(DataStore *sourceStore, DataStore *destStore, const T
     sourceQb.exec();
     auto &sourceQuery = sourceQb.query();
 
-    // Clean the destination table (from data pre-inserted by DbInitializer)
+    // Clean the destination table (from data pre-inserted by DbInitializer or by an interrupted migration)
     {
         QueryBuilder clearQb(destStore, table.name, QueryBuilder::Delete);
         clearQb.exec();
     }
 
+    const auto insertRows = [&](const QList<QVariantList> &values) {
+        // Insert the rows as a single multi-row INSERT, full batches all share the same statement
+        QueryBuilder destQb(destStore, table.name, QueryBuilder::Insert);
+        destQb.setIdentificationColumn({});
+        for (int col = 0; col < table.columns.size(); ++col) {
+            destQb.setColumnValues(table.columns[col].name, values[col]);
+        }
+        if (!destQb.exec()) {
+            qCWarning(AKONADIDBMIGRATOR_LOG) << "Failed to insert rows into table" << table.name << ":" << destQb.query().lastError().text();
+            return false;
+        }
+        return true;
+    };
+
     // Begin insertion transaction
     Transaction transaction(destStore, QStringLiteral("Migrator"));
+    const size_t transactionSize = maxTransactionSize(DbType::type(destStore->database()));
+    const qsizetype batchSize = QueryBuilder::maxInsertRows(table.columns.size());
     size_t trxSize = 0;
     size_t processed = 0;
+    QList<QVariantList> batch(table.columns.size());
 
     // Loop over source resluts
     while (sourceQuery.next()) {
-        // Insert the current row into the new database
-        QueryBuilder destQb(destStore, table.name, QueryBuilder::Insert);
-        destQb.setIdentificationColumn({});
         for (int col = 0; col < table.columns.size(); ++col) {
             QVariant value;
             if (table.columns[col].type == QLatin1StringView("QDateTime")) {
@@ -786,15 +1005,24 @@ bool DbMigrator::copyTable(DataStore *sourceStore, DataStore *destStore, const T
             } else {
                 value = sourceQuery.value(col);
             }
-            destQb.setColumnValue(table.columns[col].name, value);
+            batch[col].push_back(value);
         }
-        if (!destQb.exec()) {
-            qCWarning(AKONADIDBMIGRATOR_LOG) << "Failed to insert row into table" << table.name << ":" << destQb.query().lastError().text();
+
+        if (batch.front().size() < batchSize) {
+            continue;
+        }
+
+        if (!insertRows(batch)) {
             return false;
         }
+        processed += batch.front().size();
+        trxSize += batch.front().size();
+        for (auto &values : batch) {
+            values.clear();
+        }
 
-        // Commit the transaction after every "maxTransactionSize" inserts to make it reasonably fast
-        if (++trxSize > maxTransactionSize) {
+        // Commit the transaction after every "transactionSize" inserts to make it reasonably fast
+        if (trxSize >= transactionSize) {
             if (!transaction.commit()) {
                 qCWarning(AKONADIDBMIGRATOR_LOG) << "Failed to commit transaction:" << destStore->database().lastError().text();
                 return false;
@@ -803,7 +1031,16 @@ bool DbMigrator::copyTable(DataStore *sourceStore, DataStore *destStore, const T
             transaction.begin();
         }
 
-        emitTableProgress(table.name, ++processed, totalRows);
+        emitTableProgress(table.name, processed, totalRows);
+    }
+
+    // Insert whatever is left in the last batch
+    if (!batch.front().isEmpty()) {
+        if (!insertRows(batch)) {
+            return false;
+        }
+        processed += batch.front().size();
+        emitTableProgress(table.name, processed, totalRows);
     }
 
     // Commit whatever is left in the transaction
@@ -825,13 +1062,6 @@ bool DbMigrator::copyTable(DataStore *sourceStore, DataStore *destStore, const T
         }
     }
 
-    emitInfo(i18nc("@info:status", "Optimizing table %1...", table.name));
-    // Optimize the new table
-    if (!analyzeTable(table.name, destStore)) {
-        emitError(i18nc("@info:status", "Error: failed to optimize table %1", table.name));
-        return false;
-    }
-
     return true;
 }
 
@@ -20,6 +20,7 @@ namespace Akonadi::Server
 {
 
 class DbConfig;
+class MigrationCheckpoint;
 class TableDescription;
 class DataStore;
 
@@ -58,7 +59,13 @@ private:
     [[nodiscard]] bool runMigrationThread();
     bool copyTable(DataStore *sourceStore, DataStore *destStore, const TableDescription &table);
 
-    [[nodiscard]] bool migrateTables(DataStore *sourceStore, DataStore *destStore, DbConfig *destConfig);
+    [[nodiscard]] bool migrateTables(DataStore *sourceStore, DataStore *destStore, DbConfig *sourceConfig, DbConfig *destConfig);
+    [[nodiscard]] bool copyTables(const QList<TableDescription> &tables,
+                                  DbConfig *sourceConfig,
+                                  DbConfig *destConfig,
+                                  int doneTables,
+                                  int totalTables,
+                                  MigrationCheckpoint &checkpoint);
     [[nodiscard]] bool moveDatabaseToMainLocation(DbConfig *destConfig, const QString &destServerCfgFile);
     std::optional<QString> moveDatabaseToBackupLocation(DbConfig *config);
     std::optional<QString> backupAkonadiServerRc();
@@ -0,0 +1,504 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "dbpopulator.h"
+#include "entities.h"
+#include "storage/datastore.h"
+#include "storage/dbconfig.h"
+#include "storage/parthelper.h"
+#include "storage/querybuilder.h"
+#include "storage/transaction.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QSqlError>
+#include <QTimeZone>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+namespace
+{
+/// Number of items inserted in a single transaction
+constexpr qsizetype BatchSize = 10'000;
+
+/// Share of the items with a keyword flag or a tag, in percent
+constexpr int KeywordPercent = 20;
+constexpr int TagPercent = 10;
+
+struct SystemFlag {
+    const char *name;
+    int percent;
+};
+
+// Roughly what a mail store looks like
+const SystemFlag systemFlags[] = {
+    {"\\SEEN", 85},
+    {"\\ANSWERED", 10},
+    {"\\FLAGGED", 4},
+    {"$ATTACHMENT", 15},
+    {"$TODO", 2},
+};
+
+const char *const words[] = {
+    "the",     "of",      "and",     "to",       "in",       "a",        "is",     "that",    "for",     "it",       "as",      "was",
+    "with",    "be",      "by",      "on",       "not",      "he",       "this",   "are",     "or",      "his",      "from",    "at",
+    "which",   "but",     "have",    "an",       "had",      "they",     "you",    "were",    "their",   "one",      "all",     "we",
+    "meeting", "project", "release", "schedule", "attached", "document", "review", "please",  "thanks",  "question", "update",  "report",
+    "tomorrow", "today",  "week",    "server",   "database", "change",   "issue",  "version", "team",    "customer", "invoice", "budget",
+};
+constexpr quint64 wordCount = sizeof(words) / sizeof(*words);
+
+// The items are dated within five years from then
+const QDateTime baseDateTime(QDate(2020, 1, 1), QTime(0, 0), QTimeZone::UTC);
+constexpr qint64 dateRange = 5 * 365 * 24 * 3600;
+
+/// Cumulative weights of a Zipf distribution over @p count ranks
+QList<double> zipfWeights(qsizetype count, double exponent)
+{
+    QList<double> weights;
+    weights.reserve(count);
+    double total = 0;
+    for (qsizetype rank = 1; rank <= count; ++rank) {
+        total += 1.0 / std::pow(double(rank), exponent);
+        weights.push_back(total);
+    }
+    return weights;
+}
+
+} // namespace
+
+struct DbPopulator::PendingItem {
+    qint64 collectionId = -1;
+    QString remoteId;
+    QString gid;
+    QDateTime dateTime;
+    QByteArray payload;
+    QList<qint64> flags;
+    qint64 tagId = -1;
+};
+
+DbPopulator::DbPopulator(const Options &options, DataStore *store, QObject *parent)
+    : QObject(parent)
+    , mOptions(options)
+    , mStore(store)
+    , mRandom(options.seed)
+{
+}
+
+DbPopulator::~DbPopulator() = default;
+
+bool DbPopulator::run()
+{
+    mSizeThreshold = DbConfig::configuredDatabase()->sizeThreshold();
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!createResource() || !createCollections() || !createTags() || !createItems()) {
+        return false;
+    }
+
+    Q_EMIT info(QStringLiteral("Created %1 collections, %2 tags and %3 items (%4 with an external payload) in %5 s")
+                    .arg(mCollectionIds.size())
+                    .arg(mTagIds.size())
+                    .arg(mOptions.items)
+                    .arg(mExternalParts)
+                    .arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+    return true;
+}
+
+bool DbPopulator::createResource()
+{
+    if (Resource::retrieveByName(mStore, mOptions.resource).isValid()) {
+        Q_EMIT error(QStringLiteral("Resource %1 exists already, choose another one").arg(mOptions.resource));
+        return false;
+    }
+
+    Transaction transaction(mStore, QStringLiteral("DbPopulator::createResource"));
+    Resource resource;
+    resource.setName(mOptions.resource);
+    if (!resource.insert(mStore, &mResourceId)) {
+        Q_EMIT error(QStringLiteral("Failed to create resource %1").arg(mOptions.resource));
+        return false;
+    }
+
+    mMimeTypeId = MimeType::retrieveByNameOrCreate(mStore, QStringLiteral("message/rfc822")).id();
+    mPartTypeId = PartType::retrieveByFQNameOrCreate(mStore, QStringLiteral("PLD"), QStringLiteral("RFC822")).id();
+    for (const auto &flag : systemFlags) {
+        mSystemFlagIds.push_back(Flag::retrieveByNameOrCreate(mStore, QString::fromLatin1(flag.name)).id());
+    }
+    for (int i = 1; i <= mOptions.keywords; ++i) {
+        mKeywordIds.push_back(Flag::retrieveByNameOrCreate(mStore, QStringLiteral("$label%1").arg(i)).id());
+    }
+    mKeywordWeights = zipfWeights(mKeywordIds.size(), 1.0);
+
+    if (mMimeTypeId < 0 || mPartTypeId < 0 || mSystemFlagIds.contains(-1) || mKeywordIds.contains(-1)) {
+        Q_EMIT error(QStringLiteral("Failed to create the mime type, part type and flags"));
+        return false;
+    }
+    return transaction.commit();
+}
+
+bool DbPopulator::createCollections()
+{
+    Transaction transaction(mStore, QStringLiteral("DbPopulator::createCollections"));
+
+    Collection root;
+    root.setName(mOptions.resource);
+    root.setRemoteId(mOptions.resource);
+    root.setResourceId(mResourceId);
+    root.setCachePolicyInherit(false);
+    root.setCachePolicyLocalParts(QStringLiteral("ALL"));
+    qint64 rootId = -1;
+    if (!root.insert(mStore, &rootId)) {
+        Q_EMIT error(QStringLiteral("Failed to create the resource collection"));
+        return false;
+    }
+
+    // Shape the tree first: every collection goes below a random one that
+    // isn't at the maximum depth yet, which makes for deep, uneven trees
+    QList<qsizetype> parents;
+    QList<int> depths;
+    QList<qsizetype> candidates = {-1};
+    parents.reserve(mOptions.collections);
+    depths.reserve(mOptions.collections);
+    for (qsizetype i = 0; i < mOptions.collections; ++i) {
+        const qsizetype parent = candidates[mRandom.bounded(candidates.size())];
+        const int depth = parent < 0 ? 1 : depths[parent] + 1;
+        parents.push_back(parent);
+        depths.push_back(depth);
+        if (depth < mOptions.depth) {
+            candidates.push_back(i);
+        }
+    }
+
+    // Then insert it one level at a time, so that the parents have their ID
+    mCollectionIds.resize(mOptions.collections);
+    constexpr qsizetype chunkSize = QueryBuilder::maxInsertRows(4);
+    for (int depth = 1; depth <= mOptions.depth; ++depth) {
+        QList<qsizetype> level;
+        for (qsizetype i = 0; i < mOptions.collections; ++i) {
+            if (depths[i] == depth) {
+                level.push_back(i);
+            }
+        }
+
+        for (qsizetype offset = 0; offset < level.size(); offset += chunkSize) {
+            QList<QString> names;
+            QList<QString> remoteIds;
+            QList<qint64> parentIds;
+            QList<qint64> resourceIds;
+            for (const qsizetype i : level.mid(offset, chunkSize)) {
+                names.push_back(QStringLiteral("Folder %1").arg(i + 1));
+                remoteIds.push_back(QStringLiteral("/folder%1").arg(i + 1));
+                parentIds.push_back(parents[i] < 0 ? rootId : mCollectionIds[parents[i]]);
+                resourceIds.push_back(mResourceId);
+            }
+
+            QueryBuilder qb(mStore, Collection::tableName(), QueryBuilder::Insert);
+            qb.setColumnValues(Collection::nameColumn(), names);
+            qb.setColumnValues(Collection::remoteIdColumn(), remoteIds);
+            qb.setColumnValues(Collection::parentIdColumn(), parentIds);
+            qb.setColumnValues(Collection::resourceIdColumn(), resourceIds);
+            if (!qb.exec()) {
+                Q_EMIT error(QStringLiteral("Failed to create collections: %1").arg(qb.query().lastError().text()));
+                return false;
+            }
+            const auto ids = qb.insertIds();
+            if (ids.size() != names.size()) {
+                Q_EMIT error(QStringLiteral("Failed to retrieve the IDs of the created collections"));
+                return false;
+            }
+            for (qsizetype row = 0; row < ids.size(); ++row) {
+                mCollectionIds[level[offset + row]] = ids[row];
+            }
+        }
+    }
+
+    const qint64 folderMimeTypeId = MimeType::retrieveByNameOrCreate(mStore, QStringLiteral("inode/directory")).id();
+    QList<qint64> collectionIds;
+    QList<qint64> mimeTypeIds;
+    for (const qint64 id : std::as_const(mCollectionIds)) {
+        collectionIds += {id, id};
+        mimeTypeIds += {folderMimeTypeId, mMimeTypeId};
+    }
+    collectionIds += {rootId, rootId};
+    mimeTypeIds += {folderMimeTypeId, mMimeTypeId};
+    if (!Entity::addToRelation<CollectionMimeTypeRelation>(mStore, collectionIds, mimeTypeIds)) {
+        Q_EMIT error(QStringLiteral("Failed to set the content mime types of the collections"));
+        return false;
+    }
+
+    return transaction.commit();
+}
+
+bool DbPopulator::createTags()
+{
+    if (mOptions.tags == 0) {
+        return true;
+    }
+
+    Transaction transaction(mStore, QStringLiteral("DbPopulator::createTags"));
+    const qint64 typeId = TagType::retrieveByNameOrCreate(mStore, QStringLiteral("PLAIN")).id();
+
+    constexpr qsizetype chunkSize = QueryBuilder::maxInsertRows(2);
+    for (qsizetype offset = 0; offset < mOptions.tags; offset += chunkSize) {
+        QList<QString> gids;
+        QList<qint64> typeIds;
+        for (qsizetype i = offset; i < std::min<qsizetype>(offset + chunkSize, mOptions.tags); ++i) {
+            gids.push_back(QStringLiteral("%1-tag%2@generated.akonadi").arg(mOptions.seed).arg(i + 1));
+            typeIds.push_back(typeId);
+        }
+
+        QueryBuilder qb(mStore, Tag::tableName(), QueryBuilder::Insert);
+        qb.setColumnValues(Tag::gidColumn(), gids);
+        qb.setColumnValues(Tag::typeIdColumn(), typeIds);
+        if (!qb.exec()) {
+            Q_EMIT error(QStringLiteral("Failed to create tags: %1").arg(qb.query().lastError().text()));
+            return false;
+        }
+        const auto ids = qb.insertIds();
+        if (ids.size() != gids.size()) {
+            Q_EMIT error(QStringLiteral("Failed to retrieve the IDs of the created tags"));
+            return false;
+        }
+        mTagIds += ids;
+    }
+    mTagWeights = zipfWeights(mTagIds.size(), 1.0);
+
+    return transaction.commit();
+}
+
+QList<qint64> DbPopulator::folderSizes()
+{
+    // A few folders hold most of the mail: the rank of each folder in a Zipf
+    // distribution is shuffled, so that the large ones end up anywhere in the tree
+    const qsizetype count = mCollectionIds.size();
+    QList<qsizetype> ranks(count);
+    std::iota(ranks.begin(), ranks.end(), 0);
+    for (qsizetype i = count - 1; i > 0; --i) {
+        std::swap(ranks[i], ranks[mRandom.bounded(i + 1)]);
+    }
+
+    QList<double> weights;
+    weights.reserve(count);
+    double total = 0;
+    for (qsizetype rank = 1; rank <= count; ++rank) {
+        weights.push_back(1.0 / std::pow(double(rank), mOptions.zipfExponent));
+        total += weights.constLast();
+    }
+
+    // Round down, then hand out the remaining items to the largest folders
+    QList<qint64> sizes(count);
+    qint64 assigned = 0;
+    for (qsizetype i = 0; i < count; ++i) {
+        sizes[i] = qint64(double(mOptions.items) * weights[ranks[i]] / total);
+        assigned += sizes[i];
+    }
+    QList<qsizetype> folders(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        folders[ranks[i]] = i;
+    }
+    for (qsizetype rank = 0; assigned < mOptions.items; rank = (rank + 1) % count, ++assigned) {
+        ++sizes[folders[rank]];
+    }
+    return sizes;
+}
+
+QByteArray DbPopulator::generatePayload(const QString &gid, const QDateTime &dateTime, qsizetype size)
+{
+    const auto appendWords = [this](QByteArray &data, int count) {
+        for (int i = 0; i < count; ++i) {
+            if (i > 0) {
+                data += ' ';
+            }
+            data += words[mRandom.bounded(wordCount)];
+        }
+    };
+
+    QByteArray payload;
+    payload.reserve(size + 128);
+    const quint64 sender = mRandom.bounded(1000);
+    payload += "From: Sender " + QByteArray::number(sender) + " <sender" + QByteArray::number(sender) + "@example.org>\r\n";
+    payload += "To: User <user@example.org>\r\n";
+    payload += "Subject: ";
+    appendWords(payload, 3 + int(mRandom.bounded(6)));
+    payload += "\r\nDate: " + QLocale::c().toString(dateTime, QStringLiteral("ddd, dd MMM yyyy hh:mm:ss +0000")).toLatin1();
+    payload += "\r\nMessage-ID: <" + gid.toLatin1() + ">\r\n";
+    payload += "MIME-Version: 1.0\r\nContent-Type: text/plain; charset=utf-8\r\n\r\n";
+    while (payload.size() < size) {
+        appendWords(payload, 8 + int(mRandom.bounded(8)));
+        payload += "\r\n";
+    }
+    payload.truncate(size);
+    return payload;
+}
+
+DbPopulator::PendingItem DbPopulator::generateItem(qint64 index, qint64 collectionId)
+{
+    PendingItem item;
+    item.collectionId = collectionId;
+    item.remoteId = QString::number(index + 1);
+    item.gid = QStringLiteral("%1.%2@generated.akonadi").arg(mOptions.seed).arg(index + 1);
+    item.dateTime = baseDateTime.addSecs(qint64(mRandom.bounded(dateRange)));
+
+    // Payloads larger than the size threshold are stored in external files
+    qsizetype size = 0;
+    if (mRandom.chance(mOptions.externalPercent)) {
+        size = mSizeThreshold + 1 + qsizetype(mRandom.bounded(15 * mSizeThreshold + 1));
+    } else {
+        size = std::min<qsizetype>(mOptions.payloadSize / 2 + qsizetype(mRandom.bounded(mOptions.payloadSize + 1)), mSizeThreshold);
+    }
+    item.payload = generatePayload(item.gid, item.dateTime, size);
+
+    for (qsizetype i = 0; i < mSystemFlagIds.size(); ++i) {
+        if (mRandom.chance(systemFlags[i].percent)) {
+            item.flags.push_back(mSystemFlagIds[i]);
+        }
+    }
+    if (!mKeywordIds.isEmpty() && mRandom.chance(KeywordPercent)) {
+        item.flags.push_back(mKeywordIds[mRandom.sample(mKeywordWeights)]);
+    }
+    if (!mTagIds.isEmpty() && mRandom.chance(TagPercent)) {
+        item.tagId = mTagIds[mRandom.sample(mTagWeights)];
+    }
+    return item;
+}
+
+bool DbPopulator::createItems()
+{
+    const auto sizes = folderSizes();
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<PendingItem> batch;
+    batch.reserve(BatchSize);
+    qint64 index = 0;
+    const auto flush = [&]() {
+        if (!insertItems(batch)) {
+            return false;
+        }
+        batch.clear();
+        Q_EMIT info(QStringLiteral("Created %1 of %2 items (%3 items/s)")
+                        .arg(index)
+                        .arg(mOptions.items)
+                        .arg(double(index) * 1000 / std::max<qint64>(timer.elapsed(), 1), 0, 'f', 0));
+        return true;
+    };
+
+    for (qsizetype collection = 0; collection < mCollectionIds.size(); ++collection) {
+        for (qint64 i = 0; i < sizes[collection]; ++i) {
+            batch.push_back(generateItem(index++, mCollectionIds[collection]));
+            if (batch.size() == BatchSize && !flush()) {
+                return false;
+            }
+        }
+    }
+    return batch.isEmpty() || flush();
+}
+
+bool DbPopulator::insertItems(QList<PendingItem> &items)
+{
+    Transaction transaction(mStore, QStringLiteral("DbPopulator::insertItems"));
+
+    QList<int> revisions;
+    QList<QString> remoteIds;
+    QList<QString> gids;
+    QList<qint64> collectionIds;
+    QList<qint64> mimeTypeIds;
+    QList<QDateTime> dateTimes;
+    QList<bool> dirty;
+    QList<qint64> sizes;
+    for (const auto &item : std::as_const(items)) {
+        revisions.push_back(0);
+        remoteIds.push_back(item.remoteId);
+        gids.push_back(item.gid);
+        collectionIds.push_back(item.collectionId);
+        mimeTypeIds.push_back(mMimeTypeId);
+        dateTimes.push_back(item.dateTime);
+        dirty.push_back(false);
+        sizes.push_back(item.payload.size());
+    }
+
+    QList<qint64> ids;
+    ids.reserve(items.size());
+    constexpr qsizetype chunkSize = QueryBuilder::maxInsertRows(9);
+    for (qsizetype offset = 0; offset < items.size(); offset += chunkSize) {
+        QueryBuilder qb(mStore, PimItem::tableName(), QueryBuilder::Insert);
+        qb.setColumnValues(PimItem::revColumn(), revisions.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::remoteIdColumn(), remoteIds.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::gidColumn(), gids.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::collectionIdColumn(), collectionIds.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::mimeTypeIdColumn(), mimeTypeIds.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::datetimeColumn(), dateTimes.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::atimeColumn(), dateTimes.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::dirtyColumn(), dirty.mid(offset, chunkSize));
+        qb.setColumnValues(PimItem::sizeColumn(), sizes.mid(offset, chunkSize));
+        if (!qb.exec()) {
+            Q_EMIT error(QStringLiteral("Failed to create items: %1").arg(qb.query().lastError().text()));
+            return false;
+        }
+        const auto chunkIds = qb.insertIds();
+        if (chunkIds.size() != std::min(chunkSize, items.size() - offset)) {
+            Q_EMIT error(QStringLiteral("Failed to retrieve the IDs of the created items"));
+            return false;
+        }
+        ids += chunkIds;
+    }
+
+    QList<Part> parts;
+    parts.reserve(items.size());
+    QList<qint64> flagItemIds;
+    QList<qint64> flagIds;
+    QList<qint64> tagItemIds;
+    QList<qint64> tagIds;
+    for (qsizetype i = 0; i < items.size(); ++i) {
+        auto &item = items[i];
+        Part part;
+        part.setPimItemId(ids[i]);
+        part.setPartTypeId(mPartTypeId);
+        part.setDatasize(item.payload.size());
+        part.setData(std::exchange(item.payload, {}));
+        parts.push_back(part);
+
+        for (const qint64 flagId : std::as_const(item.flags)) {
+            flagItemIds.push_back(ids[i]);
+            flagIds.push_back(flagId);
+        }
+        if (item.tagId >= 0) {
+            tagItemIds.push_back(ids[i]);
+            tagIds.push_back(item.tagId);
+        }
+    }
+
+    try {
+        if (!PartHelper::insert(parts)) {
+            Q_EMIT error(QStringLiteral("Failed to create the payload parts"));
+            return false;
+        }
+    } catch (const PartHelperException &e) {
+        Q_EMIT error(QStringLiteral("Failed to store the payload parts: %1").arg(QString::fromUtf8(e.what())));
+        return false;
+    }
+    mExternalParts += std::count_if(parts.cbegin(), parts.cend(), [](const Part &part) {
+        return part.storage() == Part::External;
+    });
+
+    if (!Entity::addToRelation<PimItemFlagRelation>(mStore, flagItemIds, flagIds)
+        || !Entity::addToRelation<PimItemTagRelation>(mStore, tagItemIds, tagIds)) {
+        Q_EMIT error(QStringLiteral("Failed to set the flags and tags of the items"));
+        return false;
+    }
+
+    return transaction.commit();
+}
+
+#include "moc_dbpopulator.cpp"
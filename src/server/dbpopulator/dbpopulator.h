@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "shared/akrandom.h"
+
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QDateTime;
+
+namespace Akonadi
+{
+namespace Server
+{
+class DataStore;
+
+/**
+ * Fills the database with a large synthetic mail store for scale testing.
+ *
+ * Rows are inserted directly with multi-row INSERT queries and the parts go
+ * through PartHelper, so that the payloads are compressed and stored
+ * internally or externally exactly like the server would do it. A million
+ * items take minutes rather than the hours it would take through the client
+ * API.
+ *
+ * The generated data depends only on the options, see AkRandom, so that a
+ * seed produces the same store everywhere.
+ */
+class DbPopulator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        /// Resource owning the generated collections, must not exist yet
+        QString resource = QStringLiteral("akonadi_generated_resource_0");
+        int collections = 1000;
+        /// Maximum depth of the collection tree, the resource collection being at depth 0
+        int depth = 10;
+        qint64 items = 100'000;
+        /// Exponent of the Zipf distribution of the items over the collections
+        double zipfExponent = 1.0;
+        /// Average size of the payloads stored in the database
+        int payloadSize = 2048;
+        /// Percentage of items with a payload large enough to be stored externally
+        int externalPercent = 10;
+        /// Number of distinct keyword flags, e.g. $label1
+        int keywords = 20;
+        int tags = 50;
+        quint64 seed = 1;
+    };
+
+    explicit DbPopulator(const Options &options, DataStore *store, QObject *parent = nullptr);
+    ~DbPopulator() override;
+
+    bool run();
+
+Q_SIGNALS:
+    void info(const QString &message);
+    void error(const QString &message);
+
+private:
+    struct PendingItem;
+
+    bool createResource();
+    bool createCollections();
+    bool createTags();
+    bool createItems();
+    bool insertItems(QList<PendingItem> &items);
+
+    QList<qint64> folderSizes();
+    PendingItem generateItem(qint64 index, qint64 collectionId);
+    QByteArray generatePayload(const QString &gid, const QDateTime &dateTime, qsizetype size);
+
+    const Options mOptions;
+    DataStore *const mStore;
+    AkRandom mRandom;
+    qint64 mSizeThreshold = 0;
+
+    qint64 mResourceId = -1;
+    qint64 mMimeTypeId = -1;
+    qint64 mPartTypeId = -1;
+    QList<qint64> mCollectionIds;
+    QList<qint64> mTagIds;
+    QList<double> mTagWeights;
+    QList<qint64> mSystemFlagIds;
+    QList<qint64> mKeywordIds;
+    QList<double> mKeywordWeights;
+    qint64 mExternalParts = 0;
+};
+
+} // namespace Server
+} // namespace Akonadi
@@ -0,0 +1,187 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "akonadidbpopulator_debug.h"
+#include "dbpopulator.h"
+#include "private/dbus_p.h"
+#include "private/standarddirs_p.h"
+#include "shared/akapplication.h"
+#include "storage/datastore.h"
+#include "storage/dbconfig.h"
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+namespace
+{
+class PopulatorDataStoreFactory : public DataStoreFactory
+{
+public:
+    explicit PopulatorDataStoreFactory(DbConfig *config)
+        : m_dbConfig(config)
+    {
+    }
+
+    DataStore *createStore() override
+    {
+        class PopulatorDataStore : public DataStore
+        {
+        public:
+            explicit PopulatorDataStore(DbConfig *config)
+                : DataStore(config)
+            {
+            }
+        };
+        return new PopulatorDataStore(m_dbConfig);
+    }
+
+private:
+    DbConfig *const m_dbConfig;
+};
+
+bool akonadiIsRunning()
+{
+    auto sessionIface = QDBusConnection::sessionBus().interface();
+    return sessionIface->isServiceRegistered(DBus::serviceName(DBus::ControlLock)) || sessionIface->isServiceRegistered(DBus::serviceName(DBus::Server));
+}
+
+bool acquireAkonadiLock()
+{
+    const auto reply = QDBusConnection::sessionBus().interface()->registerService(DBus::serviceName(DBus::ControlLock));
+    return reply.isValid() && reply == QDBusConnectionInterface::ServiceRegistered;
+}
+
+void releaseAkonadiLock()
+{
+    QDBusConnection::sessionBus().interface()->unregisterService(DBus::serviceName(DBus::ControlLock));
+}
+
+int intOption(const QCommandLineParser &args, const QString &name, int defaultValue)
+{
+    bool ok = false;
+    const int value = args.value(name).toInt(&ok);
+    return ok && value >= 0 ? value : defaultValue;
+}
+
+bool populate(DbConfig *config, const DbPopulator::Options &options)
+{
+    if (config->useInternalServer()) {
+        StandardDirs::saveDir("data");
+        StandardDirs::saveDir("data", QStringLiteral("file_db_data"));
+        if (!config->startInternalServer()) {
+            std::cerr << "Failed to start the database server" << std::endl;
+            return false;
+        }
+    }
+    config->setup();
+
+    DataStore::setFactory(std::make_unique<PopulatorDataStoreFactory>(config));
+    DataStore *store = DataStore::self();
+    bool success = false;
+    if (!store->database().isOpen() || !store->init()) {
+        std::cerr << "Failed to open and initialize the database" << std::endl;
+    } else {
+        DbPopulator populator(options, store);
+        QObject::connect(&populator, &DbPopulator::info, &populator, [](const QString &message) {
+            std::cout << qUtf8Printable(message) << std::endl;
+        });
+        QObject::connect(&populator, &DbPopulator::error, &populator, [](const QString &message) {
+            std::cerr << qUtf8Printable(message) << std::endl;
+        });
+        success = populator.run();
+    }
+
+    store->close();
+    if (config->useInternalServer()) {
+        config->stopInternalServer();
+    }
+    return success;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Q_INIT_RESOURCE(akonadidb);
+
+    AkCoreApplication app(argc, argv, AKONADIDBPOPULATOR_LOG());
+    app.setDescription(
+        QStringLiteral("Akonadi database populator\n"
+                       "Fills the configured Akonadi database with a large synthetic mail store for scale testing.\n"
+                       "Akonadi must not be running. Use AKONADI_INSTANCE to populate a separate instance."));
+
+    const DbPopulator::Options defaults;
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("resource"),
+                                                 QStringLiteral("Identifier of the resource to create, must not exist yet"),
+                                                 QStringLiteral("identifier"),
+                                                 defaults.resource));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("collections"),
+                                                 QStringLiteral("Number of collections to create"),
+                                                 QStringLiteral("count"),
+                                                 QString::number(defaults.collections)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("depth"), QStringLiteral("Maximum depth of the collection tree"), QStringLiteral("depth"), QString::number(defaults.depth)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("items"), QStringLiteral("Number of items to create"), QStringLiteral("count"), QString::number(defaults.items)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("zipf"),
+                                                 QStringLiteral("Exponent of the Zipf distribution of the items over the collections, 0 for uniform"),
+                                                 QStringLiteral("exponent"),
+                                                 QString::number(defaults.zipfExponent)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("payload-size"),
+                                                 QStringLiteral("Average size of the payloads stored in the database, in bytes"),
+                                                 QStringLiteral("size"),
+                                                 QString::number(defaults.payloadSize)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("external"),
+                                                 QStringLiteral("Percentage of items with a payload stored in an external file"),
+                                                 QStringLiteral("percent"),
+                                                 QString::number(defaults.externalPercent)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("keywords"),
+                                                 QStringLiteral("Number of keyword flags to create"),
+                                                 QStringLiteral("count"),
+                                                 QString::number(defaults.keywords)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("tags"), QStringLiteral("Number of tags to create"), QStringLiteral("count"), QString::number(defaults.tags)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("seed"), QStringLiteral("Seed of the generated data"), QStringLiteral("seed"), QString::number(defaults.seed)));
+    app.parseCommandLine();
+
+    const auto &args = app.commandLineArguments();
+    DbPopulator::Options options;
+    options.resource = args.value(QStringLiteral("resource"));
+    options.collections = std::max(intOption(args, QStringLiteral("collections"), defaults.collections), 1);
+    options.depth = std::max(intOption(args, QStringLiteral("depth"), defaults.depth), 1);
+    options.items = args.value(QStringLiteral("items")).toLongLong();
+    options.zipfExponent = std::max(args.value(QStringLiteral("zipf")).toDouble(), 0.0);
+    options.payloadSize = intOption(args, QStringLiteral("payload-size"), defaults.payloadSize);
+    options.externalPercent = std::min(intOption(args, QStringLiteral("external"), defaults.externalPercent), 100);
+    options.keywords = intOption(args, QStringLiteral("keywords"), defaults.keywords);
+    options.tags = intOption(args, QStringLiteral("tags"), defaults.tags);
+    options.seed = args.value(QStringLiteral("seed")).toULongLong();
+
+    if (options.resource.isEmpty() || options.items < 0) {
+        app.printUsage();
+        return 1;
+    }
+
+    if (akonadiIsRunning()) {
+        std::cerr << "Akonadi is running, stop it first with \"akonadictl stop\"" << std::endl;
+        return 1;
+    }
+    if (!acquireAkonadiLock()) {
+        std::cerr << "Failed to acquire the Akonadi D-Bus lock" << std::endl;
+        return 1;
+    }
+
+    const bool success = populate(DbConfig::configuredDatabase(), options);
+    releaseAkonadiLock();
+    return success ? 0 : 1;
+}
@@ -24,6 +24,7 @@
 #include "handler/loginhandler.h"
 #include "handler/logouthandler.h"
 #include "handler/resourceselecthandler.h"
+#include "handler/retrievalchannelhandler.h"
 #include "handler/searchcreatehandler.h"
 #include "handler/searchhandler.h"
 #include "handler/searchresulthandler.h"
@@ -123,6 +124,9 @@ std::unique_ptr<Handler> Handler::findHandlerForCommandAuthenticated(Protocol::C
 
     case Protocol::Command::SelectResource:
         return std::make_unique<ResourceSelectHandler>(akonadi);
+    case Protocol::Command::OpenRetrievalChannel:
+    case Protocol::Command::RetrieveItems:
+        return std::make_unique<RetrievalChannelHandler>(akonadi);
 
     case Protocol::Command::StreamPayload:
         Q_ASSERT_X(cmd != Protocol::Command::StreamPayload, __FUNCTION__, "StreamPayload command is not allowed in this context");
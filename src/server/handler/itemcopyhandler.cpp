@@ -36,13 +36,20 @@ bool ItemCopyHandler::copyItem(const PimItem &item, const Collection &target)
     newItem.setRemoteRevision(QString());
     newItem.setCollectionId(target.id());
     Part::List newParts;
-    const auto parts = item.parts();
+    auto parts = item.parts();
     newParts.reserve(parts.size());
-    for (const Part &part : parts) {
+    for (Part &part : parts) {
+        if (part.storage() == Part::External) {
+            // Reference the same blob or packed payload, copying external payloads is a metadata-only operation
+            if (!PartHelper::share(part)) {
+                return false;
+            }
+        } else if (part.storage() == Part::Foreign) {
+            part.setData(PartHelper::translateData(part));
+            part.setStorage(Part::Internal);
+        }
         Part newPart(part);
-        newPart.setData(PartHelper::translateData(newPart.data(), part.storage()));
         newPart.setPimItemId(-1);
-        newPart.setStorage(Part::Internal);
         newParts << newPart;
     }
 
@@ -14,6 +14,7 @@
 #include "shared/akranges.h"
 #include "storage/itemqueryhelper.h"
 #include "storage/itemretrievalmanager.h"
+#include "storage/parthelper.h"
 #include "storage/parttypehelper.h"
 #include "storage/selectquerybuilder.h"
 #include "storage/transaction.h"
@@ -90,7 +91,8 @@ enum PartQueryColumns {
     PartQueryDataColumn,
     PartQueryStorageColumn,
     PartQueryVersionColumn,
-    PartQueryDataSizeColumn
+    PartQueryDataSizeColumn,
+    PartQueryCompressionColumn
 };
 
 QueryBuilder ItemFetchHelper::buildPartQuery(QSqlQuery &itemQuery, const QList<QByteArray> &partList, bool allPayload, bool allAttrs)
@@ -106,6 +108,7 @@ QueryBuilder ItemFetchHelper::buildPartQuery(QSqlQuery &itemQuery, const QList<Q
         partQuery.addColumn(Part::storageFullColumnName());
         partQuery.addColumn(Part::versionFullColumnName());
         partQuery.addColumn(Part::datasizeFullColumnName());
+        partQuery.addColumn(Part::compressionFullColumnName());
 
         partQuery.addSortColumn(partQuery.getTableWithColumn(PimItem::idColumn()), Query::Descending);
 
@@ -174,6 +177,11 @@ QueryBuilder ItemFetchHelper::buildItemQuery()
     if (mItemsLimit.limit() > 0) {
         itemQuery.setLimit(mItemsLimit.limit(), mItemsLimit.limitOffset());
     }
+    if (mItemsLimit.afterId() >= 0) {
+        itemQuery.addValueCondition(PimItem::idFullColumnName(),
+                                    mItemsLimit.sortOrder() == Qt::AscendingOrder ? Query::Greater : Query::Less,
+                                    mItemsLimit.afterId());
+    }
 
     ItemQueryHelper::scopeToQuery(mScope, mContext, itemQuery);
 
@@ -445,6 +453,8 @@ bool ItemFetchHelper::fetchItems(std::function<void(Protocol::FetchItemsResponse
     QHash<qint64, QByteArray> flagIdNameCache;
     QHash<qint64, QString> mimeTypeIdNameCache;
     QHash<qint64, QByteArray> partTypeIdNameCache;
+    // Responses passed to the callback end up in notifications, which any client may receive
+    const bool sendCompressedParts = !itemCallback && mConnection && mConnection->acceptCompressedParts();
     while (itemQuery.isValid()) {
         PROF_INC(itemsCount)
 
@@ -597,11 +607,22 @@ bool ItemFetchHelper::fetchItems(std::function<void(Protocol::FetchItemsResponse
                         skipItem = true;
                         break;
                     }
-                    metaPart.setStorageType(static_cast<Protocol::PartMetaData::StorageType>(partQuery.value(PartQueryStorageColumn).toInt()));
-                    if (data.isEmpty()) {
-                        partData.setData(QByteArray(""));
+                    const auto storage = static_cast<Part::Storage>(partQuery.value(PartQueryStorageColumn).toInt());
+                    const auto compression = static_cast<Part::Compression>(partQuery.value(PartQueryCompressionColumn).toInt());
+                    if (compression == Part::Uncompressed || sendCompressedParts) {
+                        metaPart.setStorageType(static_cast<Protocol::PartMetaData::StorageType>(storage));
+                        if (compression == Part::Zstd) {
+                            metaPart.setCompression(Protocol::PartMetaData::Zstd);
+                        }
+                        if (data.isEmpty()) {
+                            partData.setData(QByteArray(""));
+                        } else {
+                            partData.setData(data);
+                        }
                     } else {
-                        partData.setData(data);
+                        // The client can't decompress the part, send the plain payload inline
+                        metaPart.setStorageType(Protocol::PartMetaData::Internal);
+                        partData.setData(PartHelper::translateData(data, storage, compression));
                     }
                     partData.setMetaData(metaPart);
 
@@ -26,6 +26,14 @@ bool LoginHandler::parseStream()
 
     connection()->setSessionId(cmd.sessionId());
     connection()->setState(Server::Authenticated);
+    connection()->setAcceptCompressedParts(cmd.acceptCompressedParts());
 
-    return successResponse<Protocol::LoginResponse>();
+    successResponse<Protocol::LoginResponse>();
+
+    // The response is still sent in the legacy encoding, the client switches
+    // to the negotiated one once it receives it.
+    if (cmd.encoding() == Protocol::LoginCommand::CompactEncoding) {
+        connection()->setEncoding(Protocol::DataStream::Encoding::Compact);
+    }
+    return true;
 }
@@ -0,0 +1,51 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "retrievalchannelhandler.h"
+
+#include "connection.h"
+#include "storage/itemretrievalmanager.h"
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+RetrievalChannelHandler::RetrievalChannelHandler(AkonadiServer &akonadi)
+    : Handler(akonadi)
+{
+}
+
+bool RetrievalChannelHandler::parseStream()
+{
+    if (m_command->type() == Protocol::Command::RetrieveItems) {
+        if (!m_command->isResponse()) {
+            return failureResponse("RetrieveItems can only be sent by the server");
+        }
+
+        const auto &response = Protocol::cmdCast<Protocol::RetrieveItemsResponse>(m_command);
+        std::optional<QString> errorMsg;
+        if (response.isError()) {
+            errorMsg = response.errorMessage();
+        }
+        akonadi().itemRetrievalManager().retrievalChannelReplied(connection(), tag(), errorMsg);
+        // This is an answer to our own command, so there is nothing to respond to
+        return true;
+    }
+
+    const auto &cmd = Protocol::cmdCast<Protocol::OpenRetrievalChannelCommand>(m_command);
+
+    const Resource res = Resource::retrieveByName(cmd.resourceId());
+    if (!res.isValid()) {
+        return failureResponse(cmd.resourceId() % QStringLiteral(" is not a valid resource identifier"));
+    }
+
+    CommandContext context = connection()->context();
+    context.setResource(res);
+    connection()->setContext(context);
+
+    akonadi().itemRetrievalManager().registerRetrievalChannel(cmd.resourceId(), connection());
+
+    return successResponse<Protocol::OpenRetrievalChannelResponse>();
+}
@@ -0,0 +1,39 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "handler.h"
+
+namespace Akonadi
+{
+namespace Server
+{
+/**
+  @ingroup akonadi_server_handler
+
+  Handler for the item retrieval channel.
+
+  <h4>Semantics</h4>
+  The OpenRetrievalChannel command turns the connection into the retrieval channel
+  of the given resource. From then on, the server sends RetrieveItems commands
+  to the resource over this connection instead of calling requestItemDelivery()
+  over D-Bus.
+
+  The resource answers each RetrieveItems command, with the tag it was sent with,
+  once the payloads have been stored. These answers are handled here too.
+*/
+class RetrievalChannelHandler : public Handler
+{
+public:
+    RetrievalChannelHandler(AkonadiServer &akonadi);
+    ~RetrievalChannelHandler() override = default;
+
+    bool parseStream() override;
+};
+
+} // namespace Server
+} // namespace Akonadi
@@ -10,15 +10,20 @@
 #include "akonadiserver_debug.h"
 #include "handlerhelper.h"
 #include "notificationsubscriber.h"
+#include "resourcemanager.h"
 #include "storage/collectionstatistics.h"
 #include "storage/notificationcollector.h"
 #include "tracer.h"
 
+#include "private/datastream_p_p.h"
+#include "private/protocol_exception_p.h"
 #include "private/scope_p.h"
 #include "private/standarddirs_p.h"
 #include "shared/akranges.h"
 
 #include <QDateTime>
+#include <QDir>
+#include <QFile>
 #include <QSettings>
 #include <QThreadPool>
 #include <QTimer>
@@ -26,6 +31,106 @@
 using namespace Akonadi;
 using namespace Akonadi::Server;
 using namespace AkRanges;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// How often to ask again for the resources with held notifications to be started
+constexpr auto HeldNotificationsActivationInterval = 1min;
+
+QByteArrayList resourcePair(const QByteArray &resource, const QByteArray &destinationResource)
+{
+    // Moves within a resource have it as destination as well
+    if (destinationResource == resource) {
+        return {resource};
+    }
+    return {resource, destinationResource};
+}
+
+QByteArrayList notificationResources(const Protocol::ChangeNotification &ntf)
+{
+    switch (ntf.type()) {
+    case Protocol::Command::ItemChangeNotification: {
+        const auto &itemNtf = static_cast<const Protocol::ItemChangeNotification &>(ntf);
+        return resourcePair(itemNtf.resource(), itemNtf.destinationResource());
+    }
+    case Protocol::Command::CollectionChangeNotification: {
+        const auto &colNtf = static_cast<const Protocol::CollectionChangeNotification &>(ntf);
+        return resourcePair(colNtf.resource(), colNtf.destinationResource());
+    }
+    case Protocol::Command::TagChangeNotification:
+        return {static_cast<const Protocol::TagChangeNotification &>(ntf).resource()};
+    default:
+        return {};
+    }
+}
+
+/// Whether @p subscriber gets @p ntf from the notifications held for its resource instead
+bool isHeldFor(const NotificationSubscriber &subscriber,
+               const QHash<const Protocol::ChangeNotification *, QByteArrayList> &heldResources,
+               const Protocol::ChangeNotificationPtr &ntf)
+{
+    const auto held = heldResources.constFind(ntf.get());
+    return held != heldResources.cend() && std::any_of(held->cbegin(), held->cend(), [&subscriber](const QByteArray &resource) {
+               return subscriber.isChangeRecorderOf(resource);
+           });
+}
+
+QString heldNotificationsDir()
+{
+    return StandardDirs::saveDir("data", QStringLiteral("held_notifications"));
+}
+
+/// The notifications held for @p resource are kept in this file, so that they survive a restart
+QString heldNotificationsFile(const QByteArray &resource)
+{
+    return heldNotificationsDir() + QDir::separator() + QString::fromLatin1(resource);
+}
+
+void storeHeldNotifications(const QByteArray &resource, const Protocol::ChangeNotificationList &notifications)
+{
+    QFile file(heldNotificationsFile(resource));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to store held notifications for resource" << resource << ":" << file.errorString();
+        return;
+    }
+    // Each notification is a message of its own, so that one that was not written completely is not loaded
+    Protocol::DataStream stream(&file, Protocol::DataStream::Encoding::Compact);
+    try {
+        for (const auto &ntf : notifications) {
+            Protocol::serialize(stream, ntf);
+            stream.flush();
+        }
+    } catch (const ProtocolException &e) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to store held notifications for resource" << resource << ":" << e.what();
+    }
+}
+
+Protocol::ChangeNotificationList loadHeldNotifications(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to load held notifications from" << path << ":" << file.errorString();
+        return {};
+    }
+    Protocol::ChangeNotificationList notifications;
+    Protocol::DataStream stream(&file, Protocol::DataStream::Encoding::Compact);
+    try {
+        while (Protocol::DataStream::hasMessage(&file, Protocol::DataStream::Encoding::Compact)) {
+            stream.beginMessage();
+            const auto ntf = Protocol::deserialize(stream).staticCast<Protocol::ChangeNotification>();
+            // Only notifications for resources are held
+            if (!notificationResources(*ntf).isEmpty()) {
+                notifications.push_back(ntf);
+            }
+        }
+    } catch (const ProtocolException &e) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to load held notifications from" << path << ":" << e.what();
+    }
+    return notifications;
+}
+
+} // namespace
 
 NotificationManager::NotificationManager(StartMode startMode)
     : AkThread(QStringLiteral("NotificationManager"), startMode)
@@ -58,6 +163,38 @@ void NotificationManager::init()
     mCollectionFetchScope = new AggregatedCollectionFetchScope();
     mItemFetchScope = new AggregatedItemFetchScope();
     mTagFetchScope = new AggregatedTagFetchScope();
+
+    // Resources may not be running until someone needs them, see AgentManager in akonadicontrol
+    const QSettings agentsSettings(StandardDirs::agentsConfigFile(), QSettings::IniFormat);
+    if (agentsSettings.value(QStringLiteral("OnDemandActivation/Enabled"), false).toBool()) {
+        enableHoldingNotifications();
+    }
+}
+
+void NotificationManager::enableHoldingNotifications()
+{
+    mHoldNotifications = true;
+    mActivationTimer = new QTimer(this);
+    mActivationTimer->setInterval(HeldNotificationsActivationInterval);
+    connect(mActivationTimer, &QTimer::timeout, this, &NotificationManager::activateResourcesWithHeldNotifications);
+
+    // Notifications held before the server was stopped
+    const QDir dir(heldNotificationsDir());
+    const auto files = dir.entryList(QDir::Files);
+    for (const QString &file : files) {
+        auto notifications = loadHeldNotifications(dir.absoluteFilePath(file));
+        if (notifications.isEmpty()) {
+            QFile::remove(dir.absoluteFilePath(file));
+            continue;
+        }
+        const QByteArray resource = file.toLatin1();
+        qCDebug(AKONADISERVER_LOG) << "Resource" << resource << "has" << notifications.size() << "held notifications from the last run";
+        mHeldNotifications.insert(resource, std::move(notifications));
+        activateResource(resource);
+    }
+    if (!mHeldNotifications.isEmpty()) {
+        mActivationTimer->start();
+    }
 }
 
 void NotificationManager::quit()
@@ -66,6 +203,7 @@ void NotificationManager::quit()
 
     mTimer->stop();
     delete mTimer;
+    delete mActivationTimer;
 
     mNotifyThreadPool->clear();
     mNotifyThreadPool->waitForDone();
@@ -95,6 +233,10 @@ void NotificationManager::registerConnection(quintptr socketDescriptor)
         Q_ASSERT(mDebugNotifications >= 0);
         Q_ASSERT(mDebugNotifications <= mSubscribers.count());
     });
+    if (mHoldNotifications) {
+        // Queued, the subscriber is still locked when it emits the signal
+        connect(subscriber, &NotificationSubscriber::subscriptionChanged, this, &NotificationManager::releaseHeldNotifications, Qt::QueuedConnection);
+    }
 
     mSubscribers.push_back(subscriber);
 }
@@ -133,9 +275,12 @@ void NotificationManager::slotNotify(const Protocol::ChangeNotificationList &msg
 class NotifyRunnable : public QRunnable
 {
 public:
-    explicit NotifyRunnable(NotificationSubscriber *subscriber, const Protocol::ChangeNotificationList &notifications)
+    explicit NotifyRunnable(NotificationSubscriber *subscriber,
+                            const Protocol::ChangeNotificationList &notifications,
+                            const QHash<const Protocol::ChangeNotification *, QByteArrayList> &heldResources = {})
         : mSubscriber(subscriber)
         , mNotifications(notifications)
+        , mHeldResources(heldResources)
     {
     }
 
@@ -144,11 +289,14 @@ public:
     void run() override
     {
         for (const auto &ntf : std::as_const(mNotifications)) {
-            if (mSubscriber) {
-                mSubscriber->notify(ntf);
-            } else {
+            if (!mSubscriber) {
                 break;
             }
+            // The change recorder may have subscribed since the notification was held
+            if (!mHeldResources.isEmpty() && isHeldFor(*mSubscriber, mHeldResources, ntf)) {
+                continue;
+            }
+            mSubscriber->notify(ntf);
         }
     }
 
@@ -157,19 +305,29 @@ private:
 
     QPointer<NotificationSubscriber> mSubscriber;
     Protocol::ChangeNotificationList mNotifications;
+    QHash<const Protocol::ChangeNotification *, QByteArrayList> mHeldResources;
 };
 
 void NotificationManager::emitPendingNotifications()
 {
     Q_ASSERT(QThread::currentThread() == thread());
 
+    if (mHoldNotifications) {
+        releaseHeldNotifications();
+    }
+
     if (mNotifications.isEmpty()) {
         return;
     }
 
+    HeldResources heldResources;
+    if (mHoldNotifications) {
+        heldResources = holdNotificationsForInactiveResources();
+    }
+
     if (mDebugNotifications == 0) {
-        mSubscribers | Views::filter(IsNotNull) | Actions::forEach([this](const auto &subscriber) {
-            mNotifyThreadPool->start(new NotifyRunnable(subscriber, mNotifications));
+        mSubscribers | Views::filter(IsNotNull) | Actions::forEach([this, &heldResources](const auto &subscriber) {
+            mNotifyThreadPool->start(new NotifyRunnable(subscriber, mNotifications, heldResources));
         });
     } else {
         // When debugging notification we have to use a non-threaded approach
@@ -177,7 +335,7 @@ void NotificationManager::emitPendingNotifications()
         for (const auto &notification : std::as_const(mNotifications)) {
             QList<QByteArray> listeners;
             for (NotificationSubscriber *subscriber : std::as_const(mSubscribers)) {
-                if (subscriber && subscriber->notify(notification)) {
+                if (subscriber && !isHeldFor(*subscriber, heldResources, notification) && subscriber->notify(notification)) {
                     listeners.push_back(subscriber->subscriber());
                 }
             }
@@ -200,4 +358,127 @@ void NotificationManager::emitDebugNotification(const Protocol::ChangeNotificati
     });
 }
 
+NotificationManager::HeldResources NotificationManager::holdNotificationsForInactiveResources()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    QHash<QByteArray, bool> recorded;
+    const auto isRecorded = [this, &recorded](const QByteArray &resource) {
+        auto it = recorded.find(resource);
+        if (it == recorded.end()) {
+            const bool hasRecorder = std::any_of(mSubscribers.cbegin(), mSubscribers.cend(), [&resource](const auto &subscriber) {
+                return subscriber && subscriber->isChangeRecorderOf(resource);
+            });
+            it = recorded.insert(resource, hasRecorder);
+        }
+        return *it;
+    };
+
+    HeldResources heldResources;
+    QHash<QByteArray, Protocol::ChangeNotificationList> newlyHeld;
+    for (const auto &ntf : std::as_const(mNotifications)) {
+        const auto resources = notificationResources(*ntf);
+        for (const auto &resource : resources) {
+            // The resource itself does not replay the changes it made
+            if (resource.isEmpty() || resource == ntf->sessionId()) {
+                continue;
+            }
+
+            // Once some are held, all of them are until they are released, to keep them in order
+            auto held = mHeldNotifications.find(resource);
+            if (held == mHeldNotifications.end()) {
+                if (isRecorded(resource) || mInactiveResources.contains(resource)) {
+                    continue;
+                }
+                held = mHeldNotifications.insert(resource, {});
+                activateResource(resource);
+                if (!mActivationTimer->isActive()) {
+                    mActivationTimer->start();
+                }
+            }
+            held->push_back(ntf);
+            newlyHeld[resource].push_back(ntf);
+            heldResources[ntf.get()].push_back(resource);
+        }
+    }
+    for (auto it = newlyHeld.cbegin(), end = newlyHeld.cend(); it != end; ++it) {
+        storeHeldNotifications(it.key(), *it);
+    }
+    return heldResources;
+}
+
+void NotificationManager::releaseHeldNotifications()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    for (auto it = mHeldNotifications.begin(); it != mHeldNotifications.end();) {
+        const auto recorder = std::find_if(mSubscribers.cbegin(), mSubscribers.cend(), [&it](const auto &subscriber) {
+            return subscriber && subscriber->isChangeRecorderOf(it.key());
+        });
+        if (recorder == mSubscribers.cend()) {
+            ++it;
+            continue;
+        }
+
+        // notify() only queues the notifications to the subscriber's thread, so they are sent
+        // before any that are queued by the next NotifyRunnable
+        qCDebug(AKONADISERVER_LOG) << "Resource" << it.key() << "started, sending it" << it->size() << "held notifications";
+        for (const auto &ntf : std::as_const(*it)) {
+            (*recorder)->notify(ntf);
+        }
+        QFile::remove(heldNotificationsFile(it.key()));
+        it = mHeldNotifications.erase(it);
+    }
+
+    if (mHeldNotifications.isEmpty() && mActivationTimer) {
+        mActivationTimer->stop();
+    }
+}
+
+void NotificationManager::forgetResource(const QString &resource)
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    const QByteArray name = resource.toLatin1();
+    mInactiveResources.remove(name);
+    if (mHeldNotifications.remove(name)) {
+        QFile::remove(heldNotificationsFile(name));
+        if (mHeldNotifications.isEmpty() && mActivationTimer) {
+            mActivationTimer->stop();
+        }
+    }
+}
+
+void NotificationManager::activateResource(const QByteArray &resource)
+{
+    ResourceManager::activateResourceInstance(QString::fromLatin1(resource), this, [this, resource](ResourceManager::ActivationResult result) {
+        switch (result) {
+        case ResourceManager::ActivationResult::OnDemand:
+            // Held until its change recorder subscribes
+            break;
+        case ResourceManager::ActivationResult::NotOnDemand:
+            // Its change recorder is not running, but it is not ours to start. What is held
+            // already is kept for when it subscribes, nothing else is held for it.
+            mInactiveResources.insert(resource);
+            break;
+        case ResourceManager::ActivationResult::Failed:
+            // Asked again by activateResourcesWithHeldNotifications()
+            break;
+        }
+    });
+}
+
+void NotificationManager::activateResourcesWithHeldNotifications()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    // The resource may have failed to start, or been stopped again before its change recorder subscribed
+    for (auto it = mHeldNotifications.cbegin(), end = mHeldNotifications.cend(); it != end; ++it) {
+        if (!mInactiveResources.contains(it.key())) {
+            qCDebug(AKONADISERVER_LOG) << "Resource" << it.key() << "has" << it->size() << "held notifications, but did not start yet";
+            activateResource(it.key());
+        }
+    }
+}
+
 #include "moc_notificationmanager.cpp"
@@ -10,7 +10,9 @@
 
 #include "private/protocol_p.h"
 
+#include <QHash>
 #include <QPointer>
+#include <QSet>
 class QTimer;
 
 class NotificationManagerTest;
@@ -60,6 +62,11 @@ public Q_SLOTS:
 
     void slotNotify(const Akonadi::Protocol::ChangeNotificationList &msgs);
 
+    /**
+     * Drops everything kept for @p resource, which has been removed.
+     */
+    void forgetResource(const QString &resource);
+
 protected:
     void init() override;
     void quit() override;
@@ -67,6 +74,30 @@ protected:
     void emitDebugNotification(const Protocol::ChangeNotificationPtr &ntf, const QList<QByteArray> &listeners);
 
 private:
+    /// Resources that a notification is held for, by notification
+    using HeldResources = QHash<const Protocol::ChangeNotification *, QByteArrayList>;
+
+    /**
+     * Keeps the notifications for resources that have no change recorder,
+     * so that it gets them once the resource is started. Returns the
+     * notifications that were held, the change recorders of these resources
+     * must only get them through releaseHeldNotifications().
+     */
+    HeldResources holdNotificationsForInactiveResources();
+    /**
+     * Holds notifications for resources that are started on demand, and loads
+     * the notifications that were held when the server was stopped.
+     */
+    void enableHoldingNotifications();
+    /**
+     * Sends the held notifications to the change recorders that have
+     * subscribed since. Must be called before any new notifications are sent,
+     * so that the recorders get them in order.
+     */
+    void releaseHeldNotifications();
+    void activateResource(const QByteArray &resource);
+    void activateResourcesWithHeldNotifications();
+
     Protocol::ChangeNotificationList mNotifications;
     QTimer *mTimer = nullptr;
 
@@ -77,6 +108,15 @@ private:
     AggregatedItemFetchScope *mItemFetchScope = nullptr;
     AggregatedTagFetchScope *mTagFetchScope = nullptr;
 
+    /// Notifications for resources without a change recorder, until it subscribes.
+    /// They are stored on disk as well, so that they survive a restart
+    QHash<QByteArray, Protocol::ChangeNotificationList> mHeldNotifications;
+    /// Resources that are not started on demand
+    QSet<QByteArray> mInactiveResources;
+    /// Asks again for the resources with held notifications to be started
+    QTimer *mActivationTimer = nullptr;
+    bool mHoldNotifications = false;
+
     bool mWaiting = false;
     bool mQuitting = false;
 
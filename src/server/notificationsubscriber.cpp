@@ -306,6 +306,8 @@ void NotificationSubscriber::modifySubscription(const Protocol::ModifySubscripti
         auto changeNtf = toChangeNotification();
         changeNtf->setOperation(Protocol::SubscriptionChangeNotification::Modify);
         mManager->slotNotify({changeNtf});
+
+        Q_EMIT subscriptionChanged();
     }
 
 #undef START_MONITORING
@@ -314,6 +316,13 @@ void NotificationSubscriber::modifySubscription(const Protocol::ModifySubscripti
 #undef REMOVE
 }
 
+bool NotificationSubscriber::isChangeRecorderOf(const QByteArray &resource) const
+{
+    QMutexLocker locker(&mLock);
+    // Resources monitor themselves in the session named after them
+    return mSession == resource && mMonitoredResources.contains(resource);
+}
+
 Protocol::SubscriptionChangeNotificationPtr NotificationSubscriber::toChangeNotification() const
 {
     // Assumes mLock being locked by caller
@@ -40,6 +40,12 @@ public:
         return mSocket;
     }
 
+    /**
+     * Returns whether this is the change recorder of @p resource, i.e. the
+     * subscriber that replays the changes made to the resource by others.
+     */
+    [[nodiscard]] bool isChangeRecorderOf(const QByteArray &resource) const;
+
     void handleIncomingData();
 
 public Q_SLOTS:
@@ -50,6 +56,7 @@ private Q_SLOTS:
 
 Q_SIGNALS:
     void notificationDebuggingChanged(bool enabled);
+    void subscriptionChanged();
 
 protected:
     void registerSubscriber(const Protocol::CreateSubscriptionCommand &command);
@@ -23,6 +23,12 @@
 
 #include "private/dbus_p.h"
 
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QTimer>
+
+#include <algorithm>
+
 using namespace Akonadi;
 using namespace Akonadi::Server;
 
@@ -56,6 +62,22 @@ bool PreprocessorInstance::init()
     }
 
     QObject::connect(mInterface, &OrgFreedesktopAkonadiPreprocessorInterface::itemProcessed, this, &PreprocessorInstance::itemProcessed);
+    QObject::connect(mInterface, &OrgFreedesktopAkonadiPreprocessorInterface::itemsProcessed, this, &PreprocessorInstance::itemsProcessed);
+
+    // Don't block on the preprocessor here, until it replies we just process one item at a time
+    auto watcher = new QDBusPendingCallWatcher(mInterface->maximumBatchSize(), this);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        const QDBusPendingReply<int> reply = *watcher;
+        if (reply.isError()) {
+            // Preprocessors built against an older Akonadi don't support batches
+            qCDebug(AKONADISERVER_LOG) << "Pre-processor instance" << mId << "does not support batches:" << reply.error().message();
+            return;
+        }
+
+        QMutexLocker locker(&mManager.mMutex);
+        mAgentBatchSize = std::max(1, reply.value());
+    });
 
     return true;
 }
@@ -66,17 +88,57 @@ void PreprocessorInstance::enqueueItem(qint64 itemId)
 
     mItemQueue.push_back(itemId);
 
-    // If the preprocessor is already busy processing another item then do nothing.
-    if (mBusy) {
-        // The "head" item is the one being processed and we have just added another one.
-        Q_ASSERT(mItemQueue.size() > 1);
+    scheduleProcessing();
+}
+
+void PreprocessorInstance::enqueueItems(const QList<qint64> &itemIds)
+{
+    qCDebug(AKONADISERVER_LOG) << "PreprocessorInstance::enqueueItems(" << itemIds.size() << "items )";
+
+    mItemQueue.insert(mItemQueue.end(), itemIds.cbegin(), itemIds.cend());
+
+    scheduleProcessing();
+}
+
+int PreprocessorInstance::maximumBatchSize() const
+{
+    return std::min(mAgentBatchSize, mManager.maximumBatchSize());
+}
+
+void PreprocessorInstance::scheduleProcessing()
+{
+    // If the preprocessor is already busy processing other items then do nothing:
+    // the new ones are picked up when it's done.
+    if (mBusy || mItemQueue.empty()) {
         return;
     }
 
-    // Not busy: handle the item.
+    const int batchSize = maximumBatchSize();
+    const int batchWindow = mManager.batchWindow();
+    if (batchSize > 1 && batchWindow > 0 && mItemQueue.size() < std::size_t(batchSize)) {
+        // New items usually arrive in bursts, wait a bit so that they end up in the same batch.
+        // We may be called from a Connection thread, the timer is delivered to our thread.
+        if (!mBatchPending) {
+            mBatchPending = true;
+            QTimer::singleShot(batchWindow, this, &PreprocessorInstance::batchWindowElapsed);
+        }
+        return;
+    }
+
+    // Not busy: handle the items.
     processHeadItem();
 }
 
+void PreprocessorInstance::batchWindowElapsed()
+{
+    QMutexLocker locker(&mManager.mMutex);
+
+    mBatchPending = false;
+    if (!mBusy && !mItemQueue.empty()) {
+        processHeadItem();
+    }
+}
+
 void PreprocessorInstance::processHeadItem()
 {
     // We shouldn't be called if there are no items in the queue
@@ -84,6 +146,24 @@ void PreprocessorInstance::processHeadItem()
     // We shouldn't be here with no interface
     Q_ASSERT(mInterface);
 
+    const int batchSize = maximumBatchSize();
+    if (batchSize > 1) {
+        // The preprocessor fetches the items itself and reports the ones that are gone
+        // as failed, so there's no need to look them up here.
+        mCurrentBatchSize = std::min(std::size_t(batchSize), mItemQueue.size());
+        const QList<qlonglong> batch(mItemQueue.cbegin(), mItemQueue.cbegin() + mCurrentBatchSize);
+
+        qCDebug(AKONADISERVER_LOG) << "PreprocessorInstance::processHeadItem(): about to begin processing a batch of" << batch.size() << "items";
+
+        mBusy = true;
+
+        mItemProcessingStartDateTime = QDateTime::currentDateTime();
+
+        // The beginProcessItems() D-Bus call is asynchronous (marked with NoReply attribute)
+        mInterface->beginProcessItems(batch);
+        return;
+    }
+
     qint64 itemId = mItemQueue.front();
 
     // Fetch the actual item data (as it may have changed since it was enqueued)
@@ -112,6 +192,7 @@ void PreprocessorInstance::processHeadItem()
     qCDebug(AKONADISERVER_LOG) << "PreprocessorInstance::processHeadItem(): about to begin processing item " << itemId;
 
     mBusy = true;
+    mCurrentBatchSize = 1;
 
     mItemProcessingStartDateTime = QDateTime::currentDateTime();
 
@@ -194,6 +275,7 @@ void PreprocessorInstance::itemProcessed(qlonglong id)
     }
 
     mItemQueue.pop_front();
+    mCurrentBatchSize = 0;
 
     mManager.preProcessorFinishedHandlingItem(this, itemId);
 
@@ -207,4 +289,49 @@ void PreprocessorInstance::itemProcessed(qlonglong id)
     processHeadItem();
 }
 
+void PreprocessorInstance::itemsProcessed(const QList<qlonglong> &ids, const QList<int> &results)
+{
+    qCDebug(AKONADISERVER_LOG) << "PreprocessorInstance::itemsProcessed(" << ids.size() << "items )";
+
+    // We shouldn't be called if we haven't sent a batch
+    if (mCurrentBatchSize == 0 || mItemQueue.size() < mCurrentBatchSize) {
+        mTracer.warning(QStringLiteral("PreprocessorInstance"),
+                        QStringLiteral("Pre-processor instance '%1' emitted itemsProcessed() but we actually have no batch in progress").arg(mId));
+        return; // preprocessor is buggy
+    }
+
+    Q_ASSERT(mBusy);
+
+    const auto batchEnd = mItemQueue.cbegin() + mCurrentBatchSize;
+    const QList<qint64> batch(mItemQueue.cbegin(), batchEnd);
+    mItemQueue.erase(mItemQueue.cbegin(), batchEnd);
+    mCurrentBatchSize = 0;
+
+    if (ids != batch) {
+        mTracer.warning(QStringLiteral("PreprocessorInstance"),
+                        QStringLiteral("Pre-processor instance '%1' emitted itemsProcessed() for %2 items that don't match the current batch of %3 items")
+                            .arg(mId)
+                            .arg(ids.size())
+                            .arg(batch.size()));
+    }
+
+    // Failed items are passed on and unhidden all the same, just like with single items
+    for (qsizetype i = 0; i < std::min(ids.size(), results.size()); ++i) {
+        if (results.at(i) != 0 /* PreprocessorBase::ProcessingCompleted */) {
+            qCDebug(AKONADISERVER_LOG) << "Pre-processor instance" << mId << "did not process item" << ids.at(i) << ", result:" << results.at(i);
+        }
+    }
+
+    mManager.preProcessorFinishedHandlingItems(this, batch);
+
+    if (mItemQueue.empty()) {
+        // Nothing more to do
+        mBusy = false;
+        return;
+    }
+
+    // Stay busy and process the next batch, which has filled up meanwhile
+    processHeadItem();
+}
+
 #include "moc_preprocessorinstance.cpp"
@@ -12,11 +12,13 @@
 #pragma once
 
 #include <QDateTime>
+#include <QList>
 #include <QObject>
 
 #include <deque>
 
 class OrgFreedesktopAkonadiPreprocessorInterface;
+class PreprocessorTest;
 
 namespace Akonadi
 {
@@ -38,6 +40,7 @@ class Tracer;
 class PreprocessorInstance : public QObject
 {
     friend class PreprocessorManager;
+    friend class ::PreprocessorTest;
 
     Q_OBJECT
 
@@ -61,11 +64,28 @@ private:
 
     /**
      * The internal queue if item identifiers.
-     * The head item in the queue is the one currently being processed.
-     * The other ones are waiting.
+     * The head items in the queue (mCurrentBatchSize of them) are the ones
+     * currently being processed. The other ones are waiting.
      */
     std::deque<qint64> mItemQueue;
 
+    /**
+     * The number of items at the head of mItemQueue that are being processed.
+     */
+    std::size_t mCurrentBatchSize = 0;
+
+    /**
+     * The maximum number of items the preprocessor accepts at once.
+     * Preprocessors that don't know about batches only support 1.
+     */
+    int mAgentBatchSize = 1;
+
+    /**
+     * Set when items were enqueued to an idle preprocessor and we are waiting
+     * for more items before processing them in a batch.
+     */
+    bool mBatchPending = false;
+
     /**
      * Is this processor busy ?
      * This, in fact, *should* be equivalent to "mItemQueue.count() > 0"
@@ -118,6 +138,14 @@ protected:
      */
     qint64 currentProcessingTime();
 
+    /**
+     * Returns the number of items currently being processed.
+     */
+    std::size_t currentBatchSize() const
+    {
+        return mCurrentBatchSize;
+    }
+
     /**
      * Returns the id of this preprocessor. This is actually
      * the AgentInstance identifier but it's not a requirement.
@@ -147,6 +175,18 @@ protected:
      */
     void enqueueItem(qint64 itemId);
 
+    /**
+     * This is called by PreprocessorManager to enqueue several PimItems
+     * for processing by this preprocessor instance. The items may be
+     * processed in batches.
+     */
+    void enqueueItems(const QList<qint64> &itemIds);
+
+    /**
+     * Returns the maximum number of items passed to the preprocessor at once.
+     */
+    int maximumBatchSize() const;
+
     /**
      * Attempts to abort the processing of the current item.
      * May be called only if isBusy() returns true and an assertion
@@ -167,10 +207,18 @@ protected:
 private:
     /**
      * This function starts processing of the first item in mItemQueue.
+     * If the preprocessor supports batches then the following items are
+     * processed together with it.
      * It's only used internally.
      */
     void processHeadItem();
 
+    /**
+     * Starts processing unless the preprocessor is busy or it's
+     * worth waiting for more items to fill a batch.
+     */
+    void scheduleProcessing();
+
 private Q_SLOTS:
 
     /**
@@ -179,6 +227,17 @@ private Q_SLOTS:
      */
     void itemProcessed(qlonglong id);
 
+    /**
+     * This is invoked to signal that the processing of the current batch
+     * has terminated and the next items should be processed.
+     */
+    void itemsProcessed(const QList<qlonglong> &ids, const QList<int> &results);
+
+    /**
+     * The batch window has elapsed: process the items we have.
+     */
+    void batchWindowElapsed();
+
 }; // class PreprocessorInstance
 
 } // namespace Server
@@ -19,6 +19,8 @@
 
 #include "preprocessormanageradaptor.h"
 
+#include <algorithm>
+
 namespace Akonadi
 {
 namespace Server
@@ -148,9 +150,7 @@ void PreprocessorManager::lockedUnregisterInstance(const QString &id)
         Q_ASSERT(nextPreprocessor);
         Q_ASSERT(nextPreprocessor != instance);
 
-        for (qint64 itemId : *itemList) {
-            nextPreprocessor->enqueueItem(itemId);
-        }
+        nextPreprocessor->enqueueItems(QList<qint64>(itemList->cbegin(), itemList->cend()));
     } else {
         // This was the last preprocessor: end handling the items
         for (qint64 itemId : *itemList) {
@@ -238,6 +238,14 @@ void PreprocessorManager::lockedActivateFirstPreprocessor(qint64 itemId)
     // FIXME: Am I *really* sure of this ? If I'm wrong for some obscure reason then we have a deadlock.
 }
 
+void PreprocessorManager::lockedActivateFirstPreprocessor(const QList<qint64> &itemIds)
+{
+    PreprocessorInstance *preProcessor = mPreprocessorChain.first();
+    Q_ASSERT(preProcessor);
+
+    preProcessor->enqueueItems(itemIds);
+}
+
 void PreprocessorManager::lockedKillWaitQueue(const DataStore *dataStore, bool disconnectSlots)
 {
     std::deque<qint64> *waitQueue = mTransactionWaitQueueHash.value(dataStore, nullptr);
@@ -298,9 +306,8 @@ void PreprocessorManager::dataStoreTransactionCommitted()
             lockedEndHandleItem(id);
         }
     } else {
-        for (qint64 id : *waitQueue) {
-            lockedActivateFirstPreprocessor(id);
-        }
+        // Push the whole transaction at once, so that the items can be processed in batches
+        lockedActivateFirstPreprocessor(QList<qint64>(waitQueue->cbegin(), waitQueue->cend()));
     }
 
     lockedKillWaitQueue(dataStore, true); // disconnect slots this time
@@ -341,6 +348,28 @@ void PreprocessorManager::preProcessorFinishedHandlingItem(PreprocessorInstance
     }
 }
 
+void PreprocessorManager::preProcessorFinishedHandlingItems(PreprocessorInstance *preProcessor, const QList<qint64> &itemIds)
+{
+    QMutexLocker locker(&mMutex);
+
+    int idx = mPreprocessorChain.indexOf(preProcessor);
+    Q_ASSERT(idx >= 0); // must be there!
+
+    if (idx < (mPreprocessorChain.count() - 1)) {
+        // This wasn't the last preprocessor: trigger the next one.
+        PreprocessorInstance *nextPreprocessor = mPreprocessorChain[idx + 1];
+        Q_ASSERT(nextPreprocessor);
+        Q_ASSERT(nextPreprocessor != preProcessor);
+
+        nextPreprocessor->enqueueItems(itemIds);
+    } else {
+        // This was the last preprocessor: end handling the items.
+        for (qint64 itemId : itemIds) {
+            lockedEndHandleItem(itemId);
+        }
+    }
+}
+
 void PreprocessorManager::lockedEndHandleItem(qint64 itemId)
 {
     // The exit point of the pre-processing chain.
@@ -381,9 +410,11 @@ void PreprocessorManager::heartbeat()
     for (PreprocessorInstance *instance : std::as_const(mPreprocessorChain)) {
         // In this loop we check for "stuck" preprocessors.
 
-        int elapsedTime = instance->currentProcessingTime();
+        // The limits are per item: a batch gets as long as its items would get one by one.
+        const qint64 elapsedTime = instance->currentProcessingTime();
+        const qint64 batchSize = std::max<qint64>(1, instance->currentBatchSize());
 
-        if (elapsedTime < gWarningItemProcessingTimeInSecs) {
+        if (elapsedTime < gWarningItemProcessingTimeInSecs * batchSize) {
             continue; // ok, still in time.
         }
 
@@ -398,7 +429,7 @@ void PreprocessorManager::heartbeat()
         // - if it doesn't obey, we drop the interface and assume it's dead until
         //   it's effectively restarted.
 
-        if (elapsedTime < gMaximumItemProcessingTimeInSecs) {
+        if (elapsedTime < gMaximumItemProcessingTimeInSecs * batchSize) {
             // Kindly ask the preprocessor to abort the job.
 
             mTracer.warning(QStringLiteral("PreprocessorManager"),
@@ -410,7 +441,7 @@ void PreprocessorManager::heartbeat()
             // If we're here then abortProcessing() failed.
         }
 
-        if (elapsedTime < gDeadlineItemProcessingTimeInSecs) {
+        if (elapsedTime < gDeadlineItemProcessingTimeInSecs * batchSize) {
             // Attempt to restart the preprocessor via AgentManager interface
 
             mTracer.warning(QStringLiteral("PreprocessorManager"), QStringLiteral("Preprocessor '%1' is stuck... trying to restart it").arg(instance->id()));
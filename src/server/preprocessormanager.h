@@ -19,6 +19,7 @@
 #include <deque>
 
 class QTimer;
+class PreprocessorTest;
 
 #include "preprocessorinstance.h"
 
@@ -57,6 +58,7 @@ class Tracer;
 class PreprocessorManager : public QObject
 {
     friend class PreprocessorInstance;
+    friend class ::PreprocessorTest;
 
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.freedesktop.Akonadi.PreprocessorManager")
@@ -95,6 +97,18 @@ protected:
      */
     QTimer *mHeartbeatTimer = nullptr;
 
+    /**
+     * The time in milliseconds a preprocessor waits for more items to arrive
+     * before it starts processing a batch that is not full yet.
+     */
+    int mBatchWindow = 100;
+
+    /**
+     * The maximum number of items passed to a preprocessor at once.
+     * Preprocessors may support less.
+     */
+    int mMaximumBatchSize = 100;
+
     Tracer &mTracer;
 
 public:
@@ -149,6 +163,37 @@ public:
         mEnabled = enabled;
     }
 
+    /**
+     * Sets the time in milliseconds a preprocessor that supports batches
+     * waits for more items to arrive before it starts processing a batch
+     * that is not full yet. Items that arrive while a preprocessor is busy
+     * are always batched. 0 disables waiting.
+     */
+    void setBatchWindow(int msecs)
+    {
+        mBatchWindow = msecs;
+    }
+
+    int batchWindow() const
+    {
+        return mBatchWindow;
+    }
+
+    /**
+     * Sets the maximum number of items passed to a preprocessor at once.
+     * The time after which a preprocessor is considered stuck grows with
+     * the number of items in its batch.
+     */
+    void setMaximumBatchSize(int size)
+    {
+        mMaximumBatchSize = qMax(1, size);
+    }
+
+    int maximumBatchSize() const
+    {
+        return mMaximumBatchSize;
+    }
+
     /**
      * Trigger the preprocessor chain for the specified item.
      * The item should have been added to the Akonadi database via
@@ -190,6 +235,14 @@ protected:
      */
     void preProcessorFinishedHandlingItem(PreprocessorInstance *preProcessor, qint64 itemId);
 
+    /**
+     * This is called by PreprocessorInstance to signal that a certain preprocessor has finished
+     * handling a batch of items.
+     *
+     * This function is thread-safe.
+     */
+    void preProcessorFinishedHandlingItems(PreprocessorInstance *preProcessor, const QList<qint64> &itemIds);
+
 private:
     /**
      * Finds the preprocessor instance by its identifier.
@@ -204,6 +257,12 @@ private:
      */
     void lockedActivateFirstPreprocessor(qint64 itemId);
 
+    /**
+     * Pushes the specified items to the first preprocessor, so that it can process them together.
+     * The caller *MUST* make sure that there is at least one preprocessor in the chain.
+     */
+    void lockedActivateFirstPreprocessor(const QList<qint64> &itemIds);
+
     /**
      * This is called internally to terminate the pre-processing
      * chain for the specified Item. All the preprocessors have
@@ -5,16 +5,22 @@
 */
 
 #include "resourcemanager.h"
+#include "agentmanagerinternalinterface.h"
+#include "akonadiserver_debug.h"
 #include "resourcemanageradaptor.h"
 #include "storage/datastore.h"
 #include "storage/transaction.h"
 #include "tracer.h"
 
 #include "private/capabilities_p.h"
+#include "private/dbus_p.h"
 #include "shared/akranges.h"
 
 #include <QDBusConnection>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 
+using namespace Akonadi;
 using namespace Akonadi::Server;
 using namespace AkRanges;
 
@@ -55,6 +61,7 @@ void ResourceManager::removeResourceInstance(const QString &name)
         // remove resource
         resource.remove();
     }
+    Q_EMIT resourceInstanceRemoved(name);
 }
 
 QStringList ResourceManager::resourceInstances() const
@@ -62,4 +69,22 @@ QStringList ResourceManager::resourceInstances() const
     return Resource::retrieveAll() | Views::transform(&Resource::name) | Actions::toQList;
 }
 
+void ResourceManager::activateResourceInstance(const QString &name, QObject *context, const std::function<void(ActivationResult)> &callback)
+{
+    OrgFreedesktopAkonadiAgentManagerInternalInterface iface(DBus::serviceName(DBus::Control),
+                                                             QStringLiteral("/AgentManager"),
+                                                             QDBusConnection::sessionBus());
+    auto watcher = new QDBusPendingCallWatcher(iface.activateAgentInstance(name), context);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context, [name, callback](QDBusPendingCallWatcher *watcher) {
+        watcher->deleteLater();
+        QDBusPendingReply<bool> reply = *watcher;
+        if (reply.isError()) {
+            qCWarning(AKONADISERVER_LOG) << "Failed to activate resource" << name << ":" << reply.error().message();
+            callback(ActivationResult::Failed);
+            return;
+        }
+        callback(reply.value() ? ActivationResult::OnDemand : ActivationResult::NotOnDemand);
+    });
+}
+
 #include "moc_resourcemanager.cpp"
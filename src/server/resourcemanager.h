@@ -8,6 +8,8 @@
 
 #include <QObject>
 
+#include <functional>
+
 namespace Akonadi
 {
 namespace Server
@@ -27,10 +29,25 @@ public:
 
     QStringList resourceInstances() const;
 
+    enum class ActivationResult {
+        OnDemand, ///< The resource is started on demand, and is running or being started
+        NotOnDemand, ///< The resource is not started on demand
+        Failed, ///< The Akonadi control could not be asked, try again later
+    };
+
+    /**
+     * Asks the Akonadi control to start resource @p name if it's only started
+     * on demand. @p callback is invoked in the thread of @p context.
+     */
+    static void activateResourceInstance(const QString &name, QObject *context, const std::function<void(ActivationResult)> &callback);
+
 public Q_SLOTS:
     void addResourceInstance(const QString &name, const QStringList &capabilities);
     void removeResourceInstance(const QString &name);
 
+Q_SIGNALS:
+    void resourceInstanceRemoved(const QString &name);
+
 private:
     Tracer &mTracer;
 };
@@ -0,0 +1,1015 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "localsearchplugin.h"
+#include "akonadiserver_search_debug.h"
+
+#include "entities.h"
+#include "storage/parthelper.h"
+#include "storage/parttypehelper.h"
+#include "storage/querybuilder.h"
+#include "storage/selectquerybuilder.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringDecoder>
+#include <QUuid>
+
+#include <array>
+#include <optional>
+
+using namespace Akonadi;
+using namespace Akonadi::Server;
+
+namespace
+{
+/// Bump when the schema or the text extraction changes, the index is rebuilt from scratch then
+constexpr int IndexVersion = 1;
+/// Number of items indexed in a single transaction
+constexpr qsizetype IndexBatchSize = 500;
+/// Maximum amount of text indexed per item
+constexpr qsizetype MaxIndexedTextSize = 1024 * 1024;
+/// Maximum nesting of MIME parts we descend into
+constexpr int MaxMimeDepth = 10;
+
+/// Columns of the FTS table, in order
+constexpr std::array<QLatin1StringView, 17> ContentColumns = {
+    QLatin1StringView("subject"),
+    QLatin1StringView("sender"),
+    QLatin1StringView("recipient_to"),
+    QLatin1StringView("recipient_cc"),
+    QLatin1StringView("recipient_bcc"),
+    QLatin1StringView("replyto"),
+    QLatin1StringView("organization"),
+    QLatin1StringView("listid"),
+    QLatin1StringView("headers"),
+    QLatin1StringView("body"),
+    QLatin1StringView("name"),
+    QLatin1StringView("nickname"),
+    QLatin1StringView("email"),
+    QLatin1StringView("uid"),
+    QLatin1StringView("summary"),
+    QLatin1StringView("location"),
+    QLatin1StringView("organizer"),
+};
+
+/// Mirrors SearchTerm::Relation and SearchTerm::Condition in the SearchQuery JSON
+enum Relation {
+    RelAnd,
+    RelOr,
+};
+
+enum Condition {
+    CondEqual,
+    CondGreaterThan,
+    CondGreaterOrEqual,
+    CondLessThan,
+    CondLessOrEqual,
+    CondContains,
+};
+
+QStringList contentColumnNames()
+{
+    QStringList columns;
+    columns.reserve(ContentColumns.size());
+    for (const auto column : ContentColumns) {
+        columns.push_back(column);
+    }
+    return columns;
+}
+
+struct Document {
+    qint64 collectionId = -1;
+    QString mimeType;
+    qint64 size = 0;
+    QDateTime date;
+    bool hasAttachment = false;
+    QHash<QLatin1StringView, QString> fields;
+    QHash<QByteArray, QByteArray> parts;
+
+    void append(QLatin1StringView column, const QString &text)
+    {
+        if (text.isEmpty()) {
+            return;
+        }
+        QString &field = fields[column];
+        if (field.size() >= MaxIndexedTextSize) {
+            return;
+        }
+        if (!field.isEmpty()) {
+            field += QLatin1Char('\n');
+        }
+        field += text.left(MaxIndexedTextSize - field.size());
+    }
+};
+
+bool execQuery(QSqlQuery &query)
+{
+    if (!query.exec()) {
+        qCWarning(AKONADISERVER_SEARCH_LOG) << "Local search index query failed:" << query.lastError().text() << query.lastQuery();
+        return false;
+    }
+    return true;
+}
+
+bool execQuery(const QSqlDatabase &db, const QString &statement)
+{
+    QSqlQuery query(db);
+    if (!query.exec(statement)) {
+        qCWarning(AKONADISERVER_SEARCH_LOG) << "Local search index query failed:" << query.lastError().text() << statement;
+        return false;
+    }
+    return true;
+}
+
+QSqlDatabase openDatabase(const QString &connectionName, const QString &path)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName);
+    db.setDatabaseName(path);
+    db.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+    if (!db.open()) {
+        qCWarning(AKONADISERVER_SEARCH_LOG) << "Failed to open local search index" << path << ":" << db.lastError().text();
+    }
+    return db;
+}
+
+/**
+ * Opens a connection to the index for the duration of a single search, so that
+ * searches can run from any thread without leaving connections behind.
+ */
+class ScopedConnection
+{
+public:
+    explicit ScopedConnection(const QString &path)
+        : mName(QStringLiteral("LocalSearch-") + QUuid::createUuid().toString(QUuid::WithoutBraces))
+    {
+        mDb = openDatabase(mName, path);
+    }
+
+    ~ScopedConnection()
+    {
+        mDb.close();
+        mDb = QSqlDatabase();
+        QSqlDatabase::removeDatabase(mName);
+    }
+
+    const QSqlDatabase &database() const
+    {
+        return mDb;
+    }
+
+private:
+    Q_DISABLE_COPY_MOVE(ScopedConnection)
+
+    QString mName;
+    QSqlDatabase mDb;
+};
+
+// Text extraction
+
+QString decodeCharset(const QByteArray &data, const QByteArray &charset)
+{
+    if (!charset.isEmpty()) {
+        QStringDecoder decoder(charset.constData());
+        if (decoder.isValid()) {
+            return decoder.decode(data);
+        }
+    }
+    QStringDecoder utf8(QStringDecoder::Utf8);
+    const QString text = utf8.decode(data);
+    return utf8.hasError() ? QString::fromLatin1(data) : text;
+}
+
+QByteArray decodeQuotedPrintable(QByteArrayView data, bool rfc2047)
+{
+    QByteArray out;
+    out.reserve(data.size());
+    for (qsizetype i = 0; i < data.size(); ++i) {
+        const char c = data[i];
+        if (c == '_' && rfc2047) {
+            out.append(' ');
+            continue;
+        }
+        if (c != '=' || i + 1 >= data.size()) {
+            out.append(c);
+            continue;
+        }
+        if (data[i + 1] == '\n') {
+            // Soft line break
+            i += 1;
+        } else if (data[i + 1] == '\r') {
+            i += (i + 2 < data.size() && data[i + 2] == '\n') ? 2 : 1;
+        } else if (bool ok = false; i + 2 < data.size()) {
+            const int value = data.sliced(i + 1, 2).toInt(&ok, 16);
+            if (ok) {
+                out.append(static_cast<char>(value));
+                i += 2;
+            } else {
+                out.append(c);
+            }
+        } else {
+            out.append(c);
+        }
+    }
+    return out;
+}
+
+/// Decodes RFC 2047 encoded words in a header value
+QString decodeHeader(const QByteArray &value)
+{
+    static const QRegularExpression encodedWord(QStringLiteral(R"(=\?([^?]+)\?([bBqQ])\?([^?]*)\?=(\s+(?==\?))?)"));
+
+    const QString raw = QString::fromLatin1(value);
+    QString result;
+    qsizetype pos = 0;
+    auto it = encodedWord.globalMatch(raw);
+    while (it.hasNext()) {
+        const auto match = it.next();
+        if (match.capturedStart() > pos) {
+            result += decodeCharset(value.mid(pos, match.capturedStart() - pos), {});
+        }
+        QByteArray charset = match.captured(1).toLatin1();
+        // Strip RFC 2231 language suffix
+        charset = charset.left(charset.indexOf('*'));
+        const QByteArray text = match.captured(3).toLatin1();
+        const QByteArray decoded = match.captured(2).compare(QLatin1StringView("b"), Qt::CaseInsensitive) == 0 ? QByteArray::fromBase64(text)
+                                                                                                                : decodeQuotedPrintable(text, true);
+        result += decodeCharset(decoded, charset);
+        pos = match.capturedEnd();
+    }
+    if (pos < value.size()) {
+        result += decodeCharset(value.mid(pos), {});
+    }
+    return result.simplified();
+}
+
+struct MimeEntity {
+    QList<std::pair<QByteArray, QByteArray>> headers;
+    QByteArrayView body;
+
+    QByteArray header(const QByteArray &name) const
+    {
+        for (const auto &[key, value] : headers) {
+            if (key == name) {
+                return value;
+            }
+        }
+        return {};
+    }
+
+    QList<QByteArray> headerValues(const QByteArray &name) const
+    {
+        QList<QByteArray> values;
+        for (const auto &[key, value] : headers) {
+            if (key == name) {
+                values.push_back(value);
+            }
+        }
+        return values;
+    }
+};
+
+MimeEntity parseEntity(QByteArrayView data)
+{
+    MimeEntity entity;
+    qsizetype pos = 0;
+    while (pos < data.size()) {
+        qsizetype end = data.indexOf('\n', pos);
+        if (end < 0) {
+            end = data.size();
+        }
+        QByteArrayView line = data.sliced(pos, end - pos);
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        pos = end + 1;
+        if (line.isEmpty()) {
+            break;
+        }
+        if ((line.startsWith(' ') || line.startsWith('\t')) && !entity.headers.isEmpty()) {
+            // Folded header line
+            entity.headers.last().second += ' ' + line.trimmed().toByteArray();
+            continue;
+        }
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+        entity.headers.emplace_back(line.first(colon).trimmed().toByteArray().toLower(), line.sliced(colon + 1).trimmed().toByteArray());
+    }
+    entity.body = pos < data.size() ? data.sliced(pos) : QByteArrayView();
+    return entity;
+}
+
+/// Returns the main value of a structured header, e.g. the MIME type of Content-Type
+QByteArray headerMainValue(const QByteArray &value)
+{
+    const qsizetype semicolon = value.indexOf(';');
+    return (semicolon < 0 ? value : value.left(semicolon)).trimmed().toLower();
+}
+
+QByteArray headerParameter(const QByteArray &value, const QByteArray &parameter)
+{
+    const QList<QByteArray> params = value.split(';');
+    for (qsizetype i = 1; i < params.size(); ++i) {
+        const QByteArray param = params[i].trimmed();
+        const qsizetype eq = param.indexOf('=');
+        if (eq < 0 || param.left(eq).trimmed().toLower() != parameter) {
+            continue;
+        }
+        QByteArray result = param.mid(eq + 1).trimmed();
+        if (result.size() >= 2 && result.startsWith('"') && result.endsWith('"')) {
+            result = result.mid(1, result.size() - 2);
+        }
+        return result;
+    }
+    return {};
+}
+
+QString htmlToText(const QString &html)
+{
+    static const QRegularExpression scripts(QStringLiteral("<(script|style)[^>]*>.*?</\\1>"),
+                                            QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression tags(QStringLiteral("<[^>]*>"));
+
+    QString text = html;
+    text.remove(scripts);
+    text.replace(tags, QStringLiteral(" "));
+    text.replace(QLatin1StringView("&nbsp;"), QLatin1StringView(" "));
+    text.replace(QLatin1StringView("&lt;"), QLatin1StringView("<"));
+    text.replace(QLatin1StringView("&gt;"), QLatin1StringView(">"));
+    text.replace(QLatin1StringView("&quot;"), QLatin1StringView("\""));
+    text.replace(QLatin1StringView("&amp;"), QLatin1StringView("&"));
+    return text;
+}
+
+/// Collects the text of all textual leaf parts of a MIME entity into the document body
+void collectMimeText(const MimeEntity &entity, Document &doc, int depth)
+{
+    if (depth > MaxMimeDepth) {
+        return;
+    }
+
+    const QByteArray contentType = entity.header("content-type");
+    const QByteArray mimeType = contentType.isEmpty() ? QByteArray("text/plain") : headerMainValue(contentType);
+    const QByteArray disposition = entity.header("content-disposition");
+
+    if (mimeType.startsWith("multipart/")) {
+        const QByteArray boundary = "--" + headerParameter(contentType, "boundary");
+        if (boundary.size() <= 2) {
+            return;
+        }
+        QByteArrayView body = entity.body;
+        qsizetype pos = body.indexOf(boundary);
+        while (pos >= 0) {
+            pos += boundary.size();
+            if (body.sliced(pos).startsWith("--")) {
+                break; // closing delimiter
+            }
+            const qsizetype next = body.indexOf(boundary, pos);
+            const QByteArrayView part = body.sliced(pos, (next < 0 ? body.size() : next) - pos);
+            // Skip the rest of the delimiter line
+            const qsizetype lineEnd = part.indexOf('\n');
+            if (lineEnd >= 0) {
+                collectMimeText(parseEntity(part.sliced(lineEnd + 1)), doc, depth + 1);
+            }
+            pos = next;
+        }
+        return;
+    }
+
+    if (mimeType == "message/rfc822") {
+        const MimeEntity message = parseEntity(entity.body);
+        doc.append(QLatin1StringView("body"), decodeHeader(message.header("subject")));
+        collectMimeText(message, doc, depth + 1);
+        return;
+    }
+
+    const bool isAttachment = headerMainValue(disposition) == "attachment" || !headerParameter(disposition, "filename").isEmpty()
+        || !headerParameter(contentType, "name").isEmpty();
+    if (isAttachment || !mimeType.startsWith("text/")) {
+        doc.hasAttachment = true;
+        return;
+    }
+
+    QByteArray data = entity.body.toByteArray();
+    const QByteArray encoding = entity.header("content-transfer-encoding").trimmed().toLower();
+    if (encoding == "base64") {
+        data = QByteArray::fromBase64(data);
+    } else if (encoding == "quoted-printable") {
+        data = decodeQuotedPrintable(data, false);
+    }
+
+    QString text = decodeCharset(data, headerParameter(contentType, "charset"));
+    if (mimeType == "text/html") {
+        text = htmlToText(text);
+    }
+    doc.append(QLatin1StringView("body"), text);
+}
+
+void extractMessage(const QByteArray &data, Document &doc)
+{
+    const MimeEntity message = parseEntity(data);
+
+    const auto appendHeader = [&](QLatin1StringView column, const QByteArray &name) {
+        const auto values = message.headerValues(name);
+        for (const QByteArray &value : values) {
+            doc.append(column, decodeHeader(value));
+        }
+    };
+    appendHeader(QLatin1StringView("subject"), "subject");
+    appendHeader(QLatin1StringView("sender"), "from");
+    appendHeader(QLatin1StringView("recipient_to"), "to");
+    appendHeader(QLatin1StringView("recipient_cc"), "cc");
+    appendHeader(QLatin1StringView("recipient_bcc"), "bcc");
+    appendHeader(QLatin1StringView("replyto"), "reply-to");
+    appendHeader(QLatin1StringView("organization"), "organization");
+    appendHeader(QLatin1StringView("listid"), "list-id");
+
+    for (const auto &[name, value] : message.headers) {
+        doc.append(QLatin1StringView("headers"), QString::fromLatin1(name) + QLatin1StringView(": ") + decodeHeader(value));
+    }
+
+    const QDateTime date = QDateTime::fromString(QString::fromLatin1(message.header("date")), Qt::RFC2822Date);
+    if (date.isValid()) {
+        doc.date = date;
+    }
+
+    collectMimeText(message, doc, 0);
+}
+
+/// Extracts the properties of a vCard or iCalendar object
+void extractContentLines(const QByteArray &data, Document &doc)
+{
+    // Unfold lines
+    QByteArray unfolded = data;
+    unfolded.replace("\r\n ", "").replace("\r\n\t", "").replace("\n ", "").replace("\n\t", "");
+
+    const QList<QByteArray> lines = unfolded.split('\n');
+    for (QByteArray line : lines) {
+        line = line.trimmed();
+        const qsizetype colon = line.indexOf(':');
+        if (colon <= 0) {
+            continue;
+        }
+        const QByteArray property = line.left(colon);
+        QByteArray name = property.left(property.indexOf(';')).toUpper();
+        // Strip vCard group prefix
+        name = name.mid(name.lastIndexOf('.') + 1);
+        if (name == "BEGIN" || name == "END" || name == "VERSION" || name == "PRODID") {
+            continue;
+        }
+
+        QString value = QString::fromUtf8(line.mid(colon + 1));
+        value.replace(QLatin1StringView("\\n"), QLatin1StringView("\n"), Qt::CaseInsensitive);
+        value.replace(QLatin1StringView("\\,"), QLatin1StringView(","));
+        value.replace(QLatin1StringView("\\;"), QLatin1StringView(";"));
+        if (value.startsWith(QLatin1StringView("mailto:"), Qt::CaseInsensitive)) {
+            value = value.mid(7);
+        }
+
+        if (name == "FN" || name == "N") {
+            doc.append(QLatin1StringView("name"), QString(value).replace(QLatin1Char(';'), QLatin1Char(' ')).simplified());
+        } else if (name == "NICKNAME") {
+            doc.append(QLatin1StringView("nickname"), value);
+        } else if (name == "EMAIL") {
+            doc.append(QLatin1StringView("email"), value);
+        } else if (name == "UID") {
+            doc.append(QLatin1StringView("uid"), value);
+        } else if (name == "SUMMARY") {
+            doc.append(QLatin1StringView("summary"), value);
+        } else if (name == "LOCATION") {
+            doc.append(QLatin1StringView("location"), value);
+        } else if (name == "ORGANIZER") {
+            doc.append(QLatin1StringView("organizer"), value);
+        } else if (name == "PHOTO" || name == "LOGO" || name == "SOUND" || name == "KEY" || name == "ATTACH") {
+            continue;
+        }
+        doc.append(QLatin1StringView("body"), value);
+    }
+}
+
+void extractText(Document &doc)
+{
+    // Prefer the full payload, fall back to the separately stored header and body
+    QByteArray payload = doc.parts.value("RFC822");
+    if (payload.isEmpty()) {
+        payload = doc.parts.value("HEAD");
+        const QByteArray body = doc.parts.value("BODY");
+        if (!body.isEmpty()) {
+            payload += "\r\n" + body;
+        }
+    }
+    doc.parts.clear();
+    if (payload.isEmpty()) {
+        return;
+    }
+
+    if (doc.mimeType.startsWith(QLatin1StringView("message/"))) {
+        extractMessage(payload, doc);
+    } else if (payload.trimmed().startsWith("BEGIN:")) {
+        extractContentLines(payload, doc);
+    } else {
+        doc.append(QLatin1StringView("body"), decodeCharset(payload, {}));
+    }
+}
+
+// Query translation
+
+QString sqlOperator(int condition)
+{
+    switch (condition) {
+    case CondGreaterThan:
+        return QStringLiteral(">");
+    case CondGreaterOrEqual:
+        return QStringLiteral(">=");
+    case CondLessThan:
+        return QStringLiteral("<");
+    case CondLessOrEqual:
+        return QStringLiteral("<=");
+    default:
+        break;
+    }
+    return QStringLiteral("=");
+}
+
+/// Returns the FTS columns a search key maps to. An empty list means all columns.
+std::optional<QStringList> contentColumns(const QString &key)
+{
+    static const QHash<QString, QStringList> mapping = {
+        {QStringLiteral("all"), {}},
+        {QStringLiteral("message"), {}},
+        {QStringLiteral("body"), {QStringLiteral("body")}},
+        {QStringLiteral("headers"), {QStringLiteral("headers")}},
+        {QStringLiteral("subject"), {QStringLiteral("subject")}},
+        {QStringLiteral("from"), {QStringLiteral("sender")}},
+        {QStringLiteral("to"), {QStringLiteral("recipient_to")}},
+        {QStringLiteral("cc"), {QStringLiteral("recipient_cc")}},
+        {QStringLiteral("bcc"), {QStringLiteral("recipient_bcc")}},
+        {QStringLiteral("replyto"), {QStringLiteral("replyto")}},
+        {QStringLiteral("organization"), {QStringLiteral("organization")}},
+        {QStringLiteral("listid"), {QStringLiteral("listid")}},
+        // These have no dedicated column, but are part of the indexed headers
+        {QStringLiteral("resentfrom"), {QStringLiteral("headers")}},
+        {QStringLiteral("xloop"), {QStringLiteral("headers")}},
+        {QStringLiteral("xmailinglist"), {QStringLiteral("headers")}},
+        {QStringLiteral("xspamflag"), {QStringLiteral("headers")}},
+        {QStringLiteral("name"), {QStringLiteral("name")}},
+        {QStringLiteral("nickname"), {QStringLiteral("nickname")}},
+        {QStringLiteral("email"), {QStringLiteral("email")}},
+        {QStringLiteral("uid"), {QStringLiteral("uid")}},
+        {QStringLiteral("summary"), {QStringLiteral("summary")}},
+        {QStringLiteral("location"), {QStringLiteral("location")}},
+        {QStringLiteral("organizer"), {QStringLiteral("organizer")}},
+    };
+
+    const auto it = mapping.constFind(key);
+    if (it == mapping.cend()) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+QString quoteFtsString(const QString &string)
+{
+    return QLatin1Char('"') + QString(string).replace(QLatin1Char('"'), QLatin1StringView("\"\"")) + QLatin1Char('"');
+}
+
+/// Builds an FTS5 MATCH expression; exact matches are phrases, everything else is a prefix search for every word
+QString ftsExpression(const QStringList &columns, const QString &value, int condition)
+{
+    if (value.isEmpty()) {
+        return {};
+    }
+
+    QString expression;
+    if (condition == CondEqual) {
+        expression = quoteFtsString(value);
+    } else {
+        const QStringList words = value.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+        QStringList tokens;
+        tokens.reserve(words.size());
+        for (const QString &word : words) {
+            tokens.push_back(quoteFtsString(word) + QLatin1Char('*'));
+        }
+        expression = tokens.join(QLatin1StringView(" AND "));
+    }
+
+    if (columns.isEmpty()) {
+        return expression;
+    }
+    return QLatin1Char('{') + columns.join(QLatin1Char(' ')) + QLatin1StringView("} : (") + expression + QLatin1Char(')');
+}
+
+QString jsonArray(const QJsonArray &array)
+{
+    return QString::fromUtf8(QJsonDocument(array).toJson(QJsonDocument::Compact));
+}
+
+} // namespace
+
+LocalSearchPlugin::LocalSearchPlugin(const QString &indexPath)
+    : mIndexPath(indexPath)
+    , mConnectionName(QStringLiteral("LocalSearchIndex"))
+    , mIndexedParts({QStringLiteral("PLD:RFC822"), QStringLiteral("PLD:HEAD"), QStringLiteral("PLD:BODY")})
+{
+    QDir().mkpath(QFileInfo(mIndexPath).absolutePath());
+
+    const QSqlDatabase db = openDatabase(mConnectionName, mIndexPath);
+    if (!db.isOpen()) {
+        return;
+    }
+
+    mValid = initSchema();
+    if (mValid) {
+        qCInfo(AKONADISERVER_SEARCH_LOG) << "Local search index opened at" << mIndexPath;
+    }
+}
+
+LocalSearchPlugin::~LocalSearchPlugin()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(mConnectionName, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(mConnectionName);
+}
+
+bool LocalSearchPlugin::isValid() const
+{
+    return mValid;
+}
+
+bool LocalSearchPlugin::initSchema()
+{
+    const QSqlDatabase db = QSqlDatabase::database(mConnectionName);
+
+    // Allow searches to read the index while it's being written to
+    execQuery(db, QStringLiteral("PRAGMA journal_mode=WAL"));
+    execQuery(db, QStringLiteral("PRAGMA synchronous=NORMAL"));
+
+    if (!execQuery(db, QStringLiteral("CREATE TABLE IF NOT EXISTS state (key TEXT PRIMARY KEY, value INTEGER)"))) {
+        return false;
+    }
+
+    int version = 0;
+    {
+        QSqlQuery query(db);
+        if (query.exec(QStringLiteral("SELECT value FROM state WHERE key = 'version'")) && query.next()) {
+            version = query.value(0).toInt();
+        }
+    }
+
+    if (version != IndexVersion) {
+        if (version != 0) {
+            qCInfo(AKONADISERVER_SEARCH_LOG) << "Local search index format changed, rebuilding the index";
+        }
+        execQuery(db, QStringLiteral("DROP TABLE IF EXISTS content"));
+        execQuery(db, QStringLiteral("DROP TABLE IF EXISTS items"));
+
+        const QString createContent = QStringLiteral("CREATE VIRTUAL TABLE content USING fts5(%1, tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3')")
+                                          .arg(contentColumnNames().join(QLatin1StringView(", ")));
+        if (!execQuery(db, createContent)) {
+            qCWarning(AKONADISERVER_SEARCH_LOG) << "SQLite does not support FTS5, local search is disabled";
+            return false;
+        }
+        if (!execQuery(db,
+                       QStringLiteral("CREATE TABLE items (id INTEGER PRIMARY KEY, collection INTEGER NOT NULL, mimetype TEXT NOT NULL, "
+                                      "date INTEGER, onlydate TEXT, size INTEGER NOT NULL DEFAULT 0, attachment INTEGER NOT NULL DEFAULT 0)"))
+            || !execQuery(db, QStringLiteral("CREATE INDEX items_collection ON items (collection)"))) {
+            return false;
+        }
+
+        QSqlQuery query(db);
+        query.prepare(QStringLiteral("INSERT OR REPLACE INTO state (key, value) VALUES ('version', ?)"));
+        query.addBindValue(IndexVersion);
+        if (!execQuery(query)) {
+            return false;
+        }
+        // Index all existing items
+        if (!setBackfillCursor(0)) {
+            return false;
+        }
+    }
+
+    QSqlQuery query(db);
+    if (query.exec(QStringLiteral("SELECT value FROM state WHERE key = 'backfill'")) && query.next()) {
+        mBackfillCursor = query.value(0).toLongLong();
+    }
+    return true;
+}
+
+bool LocalSearchPlugin::setBackfillCursor(qint64 cursor)
+{
+    QSqlQuery query(QSqlDatabase::database(mConnectionName));
+    query.prepare(QStringLiteral("INSERT OR REPLACE INTO state (key, value) VALUES ('backfill', ?)"));
+    query.addBindValue(cursor);
+    if (!execQuery(query)) {
+        return false;
+    }
+    mBackfillCursor = cursor;
+    return true;
+}
+
+void LocalSearchPlugin::scheduleUpdate(const QSet<qint64> &items)
+{
+    QMutexLocker locker(&mLock);
+    mPendingItems.unite(items);
+}
+
+bool LocalSearchPlugin::indexNextBatch()
+{
+    if (!mValid) {
+        return false;
+    }
+
+    QList<qint64> batch;
+    bool morePending = false;
+    {
+        QMutexLocker locker(&mLock);
+        batch.reserve(std::min(mPendingItems.size(), IndexBatchSize));
+        for (auto it = mPendingItems.begin(); it != mPendingItems.end() && batch.size() < IndexBatchSize;) {
+            batch.push_back(*it);
+            it = mPendingItems.erase(it);
+        }
+        morePending = !mPendingItems.isEmpty();
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(mConnectionName);
+    if (!batch.isEmpty()) {
+        db.transaction();
+        if (!indexItems(batch) || !db.commit()) {
+            db.rollback();
+            // Retry later
+            scheduleUpdate(QSet<qint64>(batch.cbegin(), batch.cend()));
+            return false;
+        }
+        return morePending || mBackfillCursor >= 0;
+    }
+
+    if (mBackfillCursor < 0) {
+        return false;
+    }
+
+    // Continue indexing of items that existed before the index was created
+    QueryBuilder qb(PimItem::tableName());
+    qb.addColumn(PimItem::idColumn());
+    qb.addValueCondition(PimItem::idColumn(), Query::Greater, mBackfillCursor);
+    qb.addSortColumn(PimItem::idColumn(), Query::Ascending);
+    qb.setLimit(IndexBatchSize);
+    if (!qb.exec()) {
+        return false;
+    }
+    while (qb.query().next()) {
+        batch.push_back(qb.query().value(0).toLongLong());
+    }
+    qb.query().finish();
+
+    db.transaction();
+    if (!indexItems(batch) || !setBackfillCursor(batch.size() < IndexBatchSize ? -1 : batch.last()) || !db.commit()) {
+        db.rollback();
+        return false;
+    }
+    if (mBackfillCursor < 0) {
+        qCInfo(AKONADISERVER_SEARCH_LOG) << "Initial local search indexing finished";
+    }
+    return mBackfillCursor >= 0;
+}
+
+void LocalSearchPlugin::indexPendingChanges()
+{
+    while (true) {
+        {
+            QMutexLocker locker(&mLock);
+            if (mPendingItems.isEmpty()) {
+                return;
+            }
+        }
+        if (!indexNextBatch()) {
+            return;
+        }
+    }
+}
+
+bool LocalSearchPlugin::indexItems(const QList<qint64> &ids)
+{
+    if (ids.isEmpty()) {
+        return true;
+    }
+
+    QHash<qint64, Document> documents;
+    documents.reserve(ids.size());
+    {
+        SelectQueryBuilder<PimItem> qb;
+        qb.addValueCondition(PimItem::idFullColumnName(), Query::In, ids);
+        if (!qb.exec()) {
+            return false;
+        }
+        const auto items = qb.result();
+        for (const PimItem &item : items) {
+            auto &doc = documents[item.id()];
+            doc.collectionId = item.collectionId();
+            doc.mimeType = MimeType::retrieveById(item.mimeTypeId()).name();
+            doc.size = item.size();
+            doc.date = item.datetime();
+        }
+    }
+
+    if (!documents.isEmpty()) {
+        QueryBuilder qb(Part::tableName());
+        qb.addJoin(QueryBuilder::InnerJoin, PartType::tableName(), Part::partTypeIdFullColumnName(), PartType::idFullColumnName());
+        qb.addColumn(Part::pimItemIdFullColumnName());
+        qb.addColumn(PartType::nameFullColumnName());
+        qb.addColumn(Part::dataFullColumnName());
+        qb.addColumn(Part::storageFullColumnName());
+        qb.addColumn(Part::compressionFullColumnName());
+        qb.addValueCondition(Part::pimItemIdFullColumnName(), Query::In, documents.keys());
+        qb.addCondition(PartTypeHelper::conditionFromFqNames(mIndexedParts));
+        if (!qb.exec()) {
+            return false;
+        }
+        while (qb.query().next()) {
+            auto &doc = documents[qb.query().value(0).toLongLong()];
+            const auto storage = static_cast<Part::Storage>(qb.query().value(3).toInt());
+            const auto compression = static_cast<Part::Compression>(qb.query().value(4).toInt());
+            try {
+                doc.parts.insert(qb.query().value(1).toString().toLatin1(),
+                                 PartHelper::translateData(qb.query().value(2).toByteArray(), storage, compression));
+            } catch (const PartHelperException &e) {
+                qCWarning(AKONADISERVER_SEARCH_LOG) << "Failed to read payload for indexing:" << e.what();
+            }
+        }
+        qb.query().finish();
+    }
+
+    const QSqlDatabase db = QSqlDatabase::database(mConnectionName);
+
+    // Drop the old entries, this also takes care of removed items
+    const QString idList = jsonArray(QJsonArray::fromVariantList(QVariantList(ids.cbegin(), ids.cend())));
+    for (const auto table : {QLatin1StringView("content"), QLatin1StringView("items")}) {
+        QSqlQuery query(db);
+        query.prepare(QStringLiteral("DELETE FROM %1 WHERE rowid IN (SELECT value FROM json_each(?))").arg(table));
+        query.addBindValue(idList);
+        if (!execQuery(query)) {
+            return false;
+        }
+    }
+
+    const QStringList placeholders(ContentColumns.size() + 1, QStringLiteral("?"));
+    QSqlQuery insertContent(db);
+    insertContent.prepare(QStringLiteral("INSERT INTO content (rowid, %1) VALUES (%2)")
+                              .arg(contentColumnNames().join(QLatin1StringView(", ")),
+                                   placeholders.join(QLatin1StringView(", "))));
+    QSqlQuery insertItem(db);
+    insertItem.prepare(QStringLiteral("INSERT INTO items (id, collection, mimetype, date, onlydate, size, attachment) VALUES (?, ?, ?, ?, ?, ?, ?)"));
+
+    for (auto it = documents.begin(), end = documents.end(); it != end; ++it) {
+        Document &doc = *it;
+        extractText(doc);
+
+        insertContent.addBindValue(it.key());
+        for (const auto column : ContentColumns) {
+            insertContent.addBindValue(doc.fields.value(column));
+        }
+        if (!execQuery(insertContent)) {
+            return false;
+        }
+
+        const QDateTime date = doc.date.toUTC();
+        insertItem.addBindValue(it.key());
+        insertItem.addBindValue(doc.collectionId);
+        insertItem.addBindValue(doc.mimeType);
+        insertItem.addBindValue(date.isValid() ? QVariant(date.toSecsSinceEpoch()) : QVariant());
+        insertItem.addBindValue(date.isValid() ? QVariant(date.date().toString(Qt::ISODate)) : QVariant());
+        insertItem.addBindValue(doc.size);
+        insertItem.addBindValue(doc.hasAttachment);
+        if (!execQuery(insertItem)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QString LocalSearchPlugin::buildCondition(const QJsonObject &term, QVariantList &bindValues) const
+{
+    QString condition;
+    if (term.contains(QLatin1StringView("key"))) {
+        condition = buildTermCondition(term, bindValues);
+    } else {
+        const QJsonArray subTerms = term.value(QLatin1StringView("subTerms")).toArray();
+        const bool isOr = term.value(QLatin1StringView("rel")).toInt() == RelOr;
+        QStringList conditions;
+        conditions.reserve(subTerms.size());
+        for (const auto &subTerm : subTerms) {
+            conditions.push_back(buildCondition(subTerm.toObject(), bindValues));
+        }
+        condition = conditions.isEmpty() ? QStringLiteral("1") : conditions.join(isOr ? QLatin1StringView(" OR ") : QLatin1StringView(" AND "));
+    }
+
+    if (term.value(QLatin1StringView("negated")).toBool()) {
+        return QLatin1StringView("NOT (") + condition + QLatin1Char(')');
+    }
+    return QLatin1Char('(') + condition + QLatin1Char(')');
+}
+
+QString LocalSearchPlugin::buildTermCondition(const QJsonObject &term, QVariantList &bindValues) const
+{
+    const QString key = term.value(QLatin1StringView("key")).toString();
+    const QVariant value = term.value(QLatin1StringView("value")).toVariant();
+    const int condition = term.value(QLatin1StringView("cond")).toInt();
+
+    if (const auto columns = contentColumns(key); columns.has_value()) {
+        const QString expression = ftsExpression(*columns, value.toString().trimmed(), condition);
+        if (expression.isEmpty()) {
+            return QStringLiteral("1");
+        }
+        bindValues.push_back(expression);
+        return QStringLiteral("items.id IN (SELECT rowid FROM content WHERE content MATCH ?)");
+    }
+
+    if (key == QLatin1StringView("date")) {
+        const QDateTime date = QDateTime::fromString(value.toString(), Qt::ISODate);
+        if (!date.isValid()) {
+            return QStringLiteral("0");
+        }
+        bindValues.push_back(date.toUTC().toSecsSinceEpoch());
+        return QStringLiteral("items.date %1 ?").arg(sqlOperator(condition));
+    } else if (key == QLatin1StringView("onlydate")) {
+        const QDate date = QDate::fromString(value.toString().left(10), Qt::ISODate);
+        if (!date.isValid()) {
+            return QStringLiteral("0");
+        }
+        bindValues.push_back(date.toString(Qt::ISODate));
+        return QStringLiteral("items.onlydate %1 ?").arg(sqlOperator(condition));
+    } else if (key == QLatin1StringView("size")) {
+        bindValues.push_back(value.toLongLong());
+        return QStringLiteral("items.size %1 ?").arg(sqlOperator(condition));
+    } else if (key == QLatin1StringView("attachment")) {
+        bindValues.push_back(value.toBool());
+        return QStringLiteral("items.attachment = ?");
+    }
+
+    // Flags, tags and attendee status are not indexed
+    qCDebug(AKONADISERVER_SEARCH_LOG) << "Local search does not support search term" << key;
+    return QStringLiteral("0");
+}
+
+QSet<qint64> LocalSearchPlugin::search(const QString &query, const QList<qint64> &collections, const QStringList &mimeTypes)
+{
+    if (!mValid) {
+        return {};
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(query.toUtf8()).object();
+    if (root.isEmpty()) {
+        return {};
+    }
+
+    QVariantList bindValues;
+    QString statement = QStringLiteral("SELECT items.id FROM items WHERE ") + buildCondition(root, bindValues);
+    if (!collections.isEmpty()) {
+        statement += QStringLiteral(" AND items.collection IN (SELECT value FROM json_each(?))");
+        bindValues.push_back(jsonArray(QJsonArray::fromVariantList(QVariantList(collections.cbegin(), collections.cend()))));
+    }
+    if (!mimeTypes.isEmpty()) {
+        statement += QStringLiteral(" AND items.mimetype IN (SELECT value FROM json_each(?))");
+        bindValues.push_back(jsonArray(QJsonArray::fromStringList(mimeTypes)));
+    }
+    if (const int limit = root.value(QLatin1StringView("limit")).toInt(-1); limit > 0) {
+        statement += QStringLiteral(" LIMIT %1").arg(limit);
+    }
+
+    const ScopedConnection connection(mIndexPath);
+    if (!connection.database().isOpen()) {
+        return {};
+    }
+
+    QSqlQuery sqlQuery(connection.database());
+    sqlQuery.setForwardOnly(true);
+    if (!sqlQuery.prepare(statement)) {
+        qCWarning(AKONADISERVER_SEARCH_LOG) << "Failed to prepare local search query:" << sqlQuery.lastError().text() << statement;
+        return {};
+    }
+    for (const QVariant &value : std::as_const(bindValues)) {
+        sqlQuery.addBindValue(value);
+    }
+    if (!execQuery(sqlQuery)) {
+        return {};
+    }
+
+    QSet<qint64> results;
+    while (sqlQuery.next()) {
+        results.insert(sqlQuery.value(0).toLongLong());
+    }
+    return results;
+}
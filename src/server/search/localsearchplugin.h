@@ -0,0 +1,93 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "abstractsearchplugin.h"
+
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QVariantList>
+
+namespace Akonadi
+{
+namespace Server
+{
+/**
+ * A built-in search plugin that keeps a full-text index of item payloads in
+ * a sidecar SQLite database using the FTS5 extension.
+ *
+ * The index is fed by SearchManager with the IDs of items that were added,
+ * changed, moved or removed. Changes are queued and indexed in batches from
+ * the SearchManager thread; items already in the database when the index is
+ * created are indexed in the background.
+ *
+ * Search queries in SearchQuery JSON format are translated into FTS5 MATCH
+ * expressions for text fields and into range predicates for dates and sizes.
+ *
+ * The plugin is enabled by adding "Local" to the Search/Manager option in
+ * akonadiserverrc.
+ */
+class LocalSearchPlugin : public AbstractSearchPlugin
+{
+public:
+    /**
+     * Opens (or creates) the index database at @p indexPath.
+     *
+     * Must be called from the thread that will index the items.
+     */
+    explicit LocalSearchPlugin(const QString &indexPath);
+    ~LocalSearchPlugin() override;
+
+    /**
+     * Returns whether the index database could be opened and SQLite supports FTS5.
+     */
+    bool isValid() const;
+
+    /**
+     * Queues @p items to be (re)indexed. Items that no longer exist are
+     * removed from the index. Thread-safe.
+     */
+    void scheduleUpdate(const QSet<qint64> &items);
+
+    /**
+     * Indexes the next batch of queued items, or of the initial indexing
+     * if there are no queued items.
+     *
+     * Returns true if there is more work to do.
+     */
+    bool indexNextBatch();
+
+    /**
+     * Indexes all queued items. Does not continue the initial indexing.
+     */
+    void indexPendingChanges();
+
+    QSet<qint64> search(const QString &query, const QList<qint64> &collections, const QStringList &mimeTypes) override;
+
+private:
+    bool initSchema();
+    bool indexItems(const QList<qint64> &ids);
+    bool setBackfillCursor(qint64 cursor);
+
+    QString buildCondition(const QJsonObject &term, QVariantList &bindValues) const;
+    QString buildTermCondition(const QJsonObject &term, QVariantList &bindValues) const;
+
+    const QString mIndexPath;
+    const QString mConnectionName;
+    QStringList mIndexedParts;
+    bool mValid = false;
+    /// ID of the last item indexed by the initial indexing, or -1 when it is done
+    qint64 mBackfillCursor = -1;
+
+    mutable QMutex mLock;
+    QSet<qint64> mPendingItems;
+};
+
+} // namespace Server
+} // namespace Akonadi
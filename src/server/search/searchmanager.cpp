@@ -12,6 +12,7 @@
 #include "agentsearchengine.h"
 #include "akonadi.h"
 #include "handler/searchhelper.h"
+#include "localsearchplugin.h"
 #include "notificationmanager.h"
 #include "searchrequest.h"
 #include "searchtaskmanager.h"
@@ -21,13 +22,17 @@
 #include "storage/transaction.h"
 
 #include "private/protocol_p.h"
+#include "private/standarddirs_p.h"
 
 #include <QDBusConnection>
 #include <QDir>
 #include <QPluginLoader>
+#include <QThreadPool>
 #include <QTimer>
 
 #include <memory>
+#include <thread>
+#include <utility>
 
 Q_DECLARE_METATYPE(Akonadi::Server::NotificationCollector *)
 
@@ -36,14 +41,28 @@ using namespace Akonadi::Server;
 
 Q_DECLARE_METATYPE(Collection)
 
+namespace
+{
+/// Maximum number of changed items to collect for an incremental update before falling back to a full update
+constexpr qsizetype MaxIncrementalUpdateItems = 50000;
+/// Delay between a change and indexing it in the local search index
+constexpr int IndexUpdateDelay = 2 * 1000;
+/// How long the shutdown waits for running plugin searches
+constexpr int PluginShutdownTimeout = 5 * 1000;
+} // namespace
+
 SearchManager::SearchManager(const QStringList &searchEngines, SearchTaskManager &agentSearchManager)
     : AkThread(QStringLiteral("SearchManager"), AkThread::ManualStart, QThread::InheritPriority)
     , mAgentSearchManager(agentSearchManager)
     , mEngineNames(searchEngines)
+    , mSearchPool(std::make_unique<QThreadPool>())
     , mSearchUpdateTimer(nullptr)
 {
     qRegisterMetaType<Collection>();
 
+    mSearchPool->setObjectName(QStringLiteral("SearchPluginPool"));
+    mSearchPool->setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+
     // We load search plugins (as in QLibrary::load()) in the main thread so that
     // static initialization happens in the QApplication thread
     loadSearchPlugins();
@@ -65,12 +84,20 @@ void SearchManager::init()
     for (const QString &engineName : std::as_const(mEngineNames)) {
         if (engineName == QLatin1StringView("Agent")) {
             mEngines.append(new AgentSearchEngine);
+        } else if (engineName == QLatin1StringView("Local")) {
+            auto plugin = std::make_unique<LocalSearchPlugin>(StandardDirs::saveDir("data", QStringLiteral("search")) + QLatin1StringView("/localsearch.db"));
+            if (plugin->isValid()) {
+                mLocalSearch = plugin.release();
+            }
         } else {
             qCCritical(AKONADISERVER_SEARCH_LOG) << "Unknown search engine type: " << engineName;
         }
     }
 
     initSearchPlugins();
+    if (mLocalSearch) {
+        mPlugins << mLocalSearch;
+    }
 
     // The timer will tick 15 seconds after last change notification. If a new notification
     // is delivered in the meantime, the timer is reset
@@ -78,6 +105,15 @@ void SearchManager::init()
     mSearchUpdateTimer->setInterval(15 * 1000);
     mSearchUpdateTimer->setSingleShot(true);
     connect(mSearchUpdateTimer, &QTimer::timeout, this, &SearchManager::searchUpdateTimeout);
+
+    mIndexUpdateTimer = new QTimer(this);
+    mIndexUpdateTimer->setInterval(IndexUpdateDelay);
+    mIndexUpdateTimer->setSingleShot(true);
+    connect(mIndexUpdateTimer, &QTimer::timeout, this, &SearchManager::indexUpdateTimeout);
+    if (mLocalSearch) {
+        // Continue initial indexing, if any
+        mIndexUpdateTimer->start();
+    }
 }
 
 void SearchManager::quit()
@@ -90,7 +126,22 @@ void SearchManager::quit()
     qDeleteAll(children());
 
     qDeleteAll(mEngines);
-    qDeleteAll(mPlugins);
+
+    // Drop the plugin searches that have not started yet and give the running ones some
+    // time to finish. A hanging plugin must not block the shutdown, so past that the pool
+    // and the plugins are destroyed by a helper thread once the last search returns.
+    mSearchPool->clear();
+    if (mSearchPool->waitForDone(PluginShutdownTimeout)) {
+        qDeleteAll(mPlugins);
+    } else {
+        qCWarning(AKONADISERVER_SEARCH_LOG) << "Search plugins are still running, destroying them once they finish";
+        std::thread([pool = std::move(mSearchPool), plugins = mPlugins]() {
+            pool->waitForDone();
+            qDeleteAll(plugins);
+        }).detach();
+    }
+    mPlugins.clear();
+    mLocalSearch = nullptr;
     /*
      * FIXME: Unloading plugin messes up some global statics from client libs
      * and causes crash on Akonadi shutdown (below main). Keeping the plugins
@@ -125,6 +176,11 @@ QList<AbstractSearchPlugin *> SearchManager::searchPlugins() const
     return mPlugins;
 }
 
+QThreadPool *SearchManager::searchPool() const
+{
+    return mSearchPool.get();
+}
+
 void SearchManager::loadSearchPlugins()
 {
     QStringList loadedPlugins;
@@ -197,18 +253,92 @@ void SearchManager::initSearchPlugins()
 
 void SearchManager::scheduleSearchUpdate()
 {
+    {
+        QMutexLocker locker(&mLock);
+        mFullUpdatePending = true;
+        mChangedItems.clear();
+        mChangedCollections.clear();
+    }
+
     // Reset if the timer is active (use QueuedConnection to invoke start() from
     // the thread the QTimer lives in instead of caller's thread, otherwise crashes
     // and weird things can happen.
     QMetaObject::invokeMethod(mSearchUpdateTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
 }
 
+void SearchManager::scheduleSearchUpdate(const QSet<qint64> &changedItems, const QSet<qint64> &changedCollections)
+{
+    {
+        QMutexLocker locker(&mLock);
+        if (!mFullUpdatePending) {
+            mChangedItems.unite(changedItems);
+            mChangedCollections.unite(changedCollections);
+            // Past a certain point a full update is cheaper than matching the individual items
+            if (mChangedItems.size() > MaxIncrementalUpdateItems) {
+                mFullUpdatePending = true;
+                mChangedItems.clear();
+                mChangedCollections.clear();
+            }
+        }
+    }
+
+    scheduleIndexUpdate(changedItems);
+
+    QMetaObject::invokeMethod(mSearchUpdateTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+}
+
+void SearchManager::scheduleIndexUpdate(const QSet<qint64> &items)
+{
+    if (!mLocalSearch || items.isEmpty()) {
+        return;
+    }
+
+    mLocalSearch->scheduleUpdate(items);
+    QMetaObject::invokeMethod(mIndexUpdateTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+}
+
+void SearchManager::indexUpdateTimeout()
+{
+    if (mLocalSearch->indexNextBatch()) {
+        // Index the next batch once we've processed pending events
+        QTimer::singleShot(0, this, &SearchManager::indexUpdateTimeout);
+    }
+}
+
 void SearchManager::searchUpdateTimeout()
 {
+    bool fullUpdate = false;
+    QSet<qint64> changedItems;
+    QSet<qint64> changedCollections;
+    {
+        QMutexLocker locker(&mLock);
+        fullUpdate = std::exchange(mFullUpdatePending, false);
+        changedItems = std::exchange(mChangedItems, {});
+        changedCollections = std::exchange(mChangedCollections, {});
+    }
+
+    if (!fullUpdate && changedItems.isEmpty()) {
+        return;
+    }
+
+    // Make sure the local index is up to date before running the searches
+    if (mLocalSearch) {
+        mLocalSearch->indexPendingChanges();
+    }
+
     // Get all search collections, that is subcollections of "Search", which always has ID 1
     const Collection::List collections = Collection::retrieveFiltered(Collection::parentIdFullColumnName(), 1);
     for (const Collection &collection : collections) {
-        updateSearchAsync(collection);
+        if (fullUpdate) {
+            updateSearchAsync(collection);
+        } else {
+            QMetaObject::invokeMethod(
+                this,
+                [this, collection, changedItems, changedCollections]() {
+                    updateSearchDelta(collection, changedItems, changedCollections);
+                },
+                Qt::QueuedConnection);
+        }
     }
 }
 
@@ -244,27 +374,27 @@ void SearchManager::updateSearch(const Collection &collection)
     mLock.unlock();
 }
 
-void SearchManager::updateSearchImpl(const Collection &collection)
+std::optional<SearchManager::SearchScope> SearchManager::searchScope(const Collection &collection) const
 {
     if (collection.queryString().size() >= 32768) {
         qCWarning(AKONADISERVER_SEARCH_LOG) << "The query is at least 32768 chars long, which is the maximum size supported by the akonadi db schema. The "
                                                "query is therefore most likely truncated and will not be executed.";
-        return;
+        return std::nullopt;
     }
     if (collection.queryString().isEmpty()) {
-        return;
+        return std::nullopt;
     }
 
+    SearchScope scope;
     const QStringList queryAttributes = collection.queryAttributes().split(QLatin1Char(' '));
-    const bool remoteSearch = queryAttributes.contains(QLatin1StringView(AKONADI_PARAM_REMOTE));
+    scope.remote = queryAttributes.contains(QLatin1StringView(AKONADI_PARAM_REMOTE));
     bool recursive = queryAttributes.contains(QLatin1StringView(AKONADI_PARAM_RECURSIVE));
 
-    QStringList queryMimeTypes;
     const QList<MimeType> mimeTypes = collection.mimeTypes();
-    queryMimeTypes.reserve(mimeTypes.count());
+    scope.mimeTypes.reserve(mimeTypes.count());
 
     for (const MimeType &mt : mimeTypes) {
-        queryMimeTypes << mt.name();
+        scope.mimeTypes << mt.name();
     }
 
     QList<qint64> queryAncestors;
@@ -280,32 +410,49 @@ void SearchManager::updateSearchImpl(const Collection &collection)
     }
 
     // Always query the given collections
-    QList<qint64> queryCollections = queryAncestors;
+    scope.collections = queryAncestors;
 
     if (recursive) {
         // Resolve subcollections if necessary
-        queryCollections += SearchHelper::matchSubcollectionsByMimeType(queryAncestors, queryMimeTypes);
+        scope.collections += SearchHelper::matchSubcollectionsByMimeType(queryAncestors, scope.mimeTypes);
     }
 
     // This happens if we try to search a virtual collection in recursive mode (because virtual collections are excluded from listCollectionsRecursive)
-    if (queryCollections.isEmpty()) {
+    if (scope.collections.isEmpty()) {
         qCDebug(AKONADISERVER_SEARCH_LOG) << "No collections to search, you're probably trying to search a virtual collection.";
-        return;
+        return std::nullopt;
     }
 
+    return scope;
+}
+
+QSet<qint64> SearchManager::runSearch(const Collection &collection, const SearchScope &scope, bool pushResults)
+{
     // Query all plugins for search results
     const QByteArray id = "searchUpdate-" + QByteArray::number(QDateTime::currentDateTimeUtc().toSecsSinceEpoch());
     SearchRequest request(id, *this, mAgentSearchManager);
-    request.setCollections(queryCollections);
-    request.setMimeTypes(queryMimeTypes);
+    request.setCollections(scope.collections);
+    request.setMimeTypes(scope.mimeTypes);
     request.setQuery(collection.queryString());
-    request.setRemoteSearch(remoteSearch);
+    request.setRemoteSearch(scope.remote);
     request.setStoreResults(true);
-    request.setProperty("SearchCollection", QVariant::fromValue(collection));
-    connect(&request, &SearchRequest::resultsAvailable, this, &SearchManager::searchUpdateResultsAvailable);
+    if (pushResults) {
+        request.setProperty("SearchCollection", QVariant::fromValue(collection));
+        connect(&request, &SearchRequest::resultsAvailable, this, &SearchManager::searchUpdateResultsAvailable);
+    }
     request.exec(); // blocks until all searches are done
 
-    const QSet<qint64> results = request.results();
+    return request.results();
+}
+
+void SearchManager::updateSearchImpl(const Collection &collection)
+{
+    const auto scope = searchScope(collection);
+    if (!scope.has_value()) {
+        return;
+    }
+
+    const QSet<qint64> results = runSearch(collection, *scope, true);
 
     // Get all items in the collection
     QueryBuilder qb(CollectionPimItemRelation::tableName());
@@ -315,23 +462,22 @@ void SearchManager::updateSearchImpl(const Collection &collection)
         return;
     }
 
-    Transaction transaction(DataStore::self(), QStringLiteral("UPDATE SEARCH"));
-
     // Unlink all items that were not in search results from the collection
-    QVariantList toRemove;
+    QList<qint64> toRemove;
     while (qb.query().next()) {
         const qint64 id = qb.query().value(0).toLongLong();
         if (!results.contains(id)) {
             toRemove << id;
-            Collection::removePimItem(collection.id(), id);
         }
     }
-
-    if (!transaction.commit()) {
-        return;
-    }
+    qb.query().finish();
 
     if (!toRemove.isEmpty()) {
+        Transaction transaction(DataStore::self(), QStringLiteral("UPDATE SEARCH"));
+        if (!unlinkItems(collection.id(), toRemove) || !transaction.commit()) {
+            return;
+        }
+
         SelectQueryBuilder<PimItem> qb;
         qb.addValueCondition(PimItem::idFullColumnName(), Query::In, toRemove);
         if (!qb.exec()) {
@@ -346,6 +492,145 @@ void SearchManager::updateSearchImpl(const Collection &collection)
                                      << "all results: " << results.count() << ", removed results:" << toRemove.count();
 }
 
+void SearchManager::updateSearchDelta(const Collection &collection, const QSet<qint64> &changedItems, const QSet<qint64> &changedCollections)
+{
+    {
+        QMutexLocker locker(&mLock);
+        if (mUpdatingCollections.contains(collection.id())) {
+            // A full update is running, it will pick up the changes
+            return;
+        }
+    }
+
+    auto scope = searchScope(collection);
+    if (!scope.has_value()) {
+        return;
+    }
+
+    // The changed items are all in the changed collections, so only those need to be
+    // searched. Recursive scopes list their subcollections, so this also covers them.
+    scope->collections.removeIf([&changedCollections](qint64 id) {
+        return !changedCollections.contains(id);
+    });
+    if (scope->collections.isEmpty()) {
+        // The search doesn't cover any of the changed collections
+        return;
+    }
+
+    // The search plugins can't evaluate the query for individual items, but we only
+    // need to reconcile the membership of the changed items.
+    const QSet<qint64> searchResults = runSearch(collection, *scope, false);
+
+    const QSet<qint64> linked = linkedItems(collection.id(), changedItems);
+    QList<qint64> toAdd;
+    QList<qint64> toRemove;
+    for (const qint64 id : changedItems) {
+        const bool matches = searchResults.contains(id);
+        if (matches && !linked.contains(id)) {
+            toAdd.push_back(id);
+        } else if (!matches && linked.contains(id)) {
+            toRemove.push_back(id);
+        }
+    }
+
+    if (toAdd.isEmpty() && toRemove.isEmpty()) {
+        return;
+    }
+
+    PimItem::List addedItems;
+    PimItem::List removedItems;
+    {
+        Transaction transaction(DataStore::self(), QStringLiteral("UPDATE SEARCH DELTA"));
+        if (!toAdd.isEmpty()) {
+            // Make sure the items still exist
+            SelectQueryBuilder<PimItem> qb;
+            qb.addValueCondition(PimItem::idFullColumnName(), Query::In, toAdd);
+            if (!qb.exec()) {
+                return;
+            }
+            addedItems = qb.result();
+            toAdd.clear();
+            for (const auto &item : std::as_const(addedItems)) {
+                toAdd.push_back(item.id());
+            }
+            if (!linkItems(collection.id(), toAdd)) {
+                return;
+            }
+        }
+        if (!toRemove.isEmpty()) {
+            SelectQueryBuilder<PimItem> qb;
+            qb.addValueCondition(PimItem::idFullColumnName(), Query::In, toRemove);
+            if (!qb.exec()) {
+                return;
+            }
+            removedItems = qb.result();
+            if (!unlinkItems(collection.id(), toRemove)) {
+                return;
+            }
+        }
+        if (!transaction.commit()) {
+            return;
+        }
+    }
+
+    auto *collector = DataStore::self()->notificationCollector();
+    if (!addedItems.isEmpty()) {
+        collector->itemsLinked(addedItems, collection);
+    }
+    if (!removedItems.isEmpty()) {
+        collector->itemsUnlinked(removedItems, collection);
+    }
+    collector->dispatchNotifications();
+
+    qCDebug(AKONADISERVER_SEARCH_LOG) << "Incremental search update for collection" << collection.id() << "finished:" << changedItems.count()
+                                      << "changed items, added results:" << addedItems.count() << ", removed results:" << removedItems.count();
+}
+
+QSet<qint64> SearchManager::linkedItems(qint64 collectionId, const QSet<qint64> &items)
+{
+    constexpr qsizetype chunkSize = QueryBuilder::MaxBindValues - 1;
+    const QList<qint64> itemList(items.cbegin(), items.cend());
+    QSet<qint64> linked;
+    for (qsizetype offset = 0; offset < itemList.size(); offset += chunkSize) {
+        QueryBuilder qb(CollectionPimItemRelation::tableName());
+        qb.addColumn(CollectionPimItemRelation::rightColumn());
+        qb.addValueCondition(CollectionPimItemRelation::leftColumn(), Query::Equals, collectionId);
+        qb.addValueCondition(CollectionPimItemRelation::rightColumn(), Query::In, itemList.mid(offset, chunkSize));
+        if (!qb.exec()) {
+            break;
+        }
+        while (qb.query().next()) {
+            linked.insert(qb.query().value(0).toLongLong());
+        }
+        qb.query().finish();
+    }
+    return linked;
+}
+
+bool SearchManager::linkItems(qint64 collectionId, const QList<qint64> &items)
+{
+    if (items.isEmpty()) {
+        return true;
+    }
+    const QList<qint64> collectionIds(items.size(), collectionId);
+    return Entity::addToRelation<CollectionPimItemRelation>(DataStore::self(), collectionIds, items);
+}
+
+bool SearchManager::unlinkItems(qint64 collectionId, const QList<qint64> &items)
+{
+    constexpr qsizetype chunkSize = QueryBuilder::MaxBindValues - 1;
+    for (qsizetype offset = 0; offset < items.size(); offset += chunkSize) {
+        QueryBuilder qb(CollectionPimItemRelation::tableName(), QueryBuilder::Delete);
+        qb.addValueCondition(CollectionPimItemRelation::leftColumn(), Query::Equals, collectionId);
+        qb.addValueCondition(CollectionPimItemRelation::rightColumn(), Query::In, items.mid(offset, chunkSize));
+        if (!qb.exec()) {
+            qCWarning(AKONADISERVER_SEARCH_LOG) << "Failed to unlink items from search collection" << collectionId;
+            return false;
+        }
+    }
+    return true;
+}
+
 void SearchManager::searchUpdateResultsAvailable(const QSet<qint64> &results)
 {
     const auto collection = sender()->property("SearchCollection").value<Collection>();
@@ -422,8 +707,13 @@ void SearchManager::searchUpdateResultsAvailable(const QSet<qint64> &results)
         return;
     }
 
-    for (const auto &item : items) {
-        Collection::addPimItem(collection.id(), item.id());
+    QList<qint64> itemIds;
+    itemIds.reserve(items.size());
+    for (const auto &item : std::as_const(items)) {
+        itemIds.push_back(item.id());
+    }
+    if (!linkItems(collection.id(), itemIds)) {
+        return;
     }
 
     if (!transaction.commit()) {
@@ -13,8 +13,12 @@
 #include <QMutex>
 #include <QSet>
 
+#include <memory>
+#include <optional>
+
 class QTimer;
 class QPluginLoader;
+class QThreadPool;
 
 namespace Akonadi
 {
@@ -24,6 +28,7 @@ namespace Server
 {
 class AbstractSearchEngine;
 class Collection;
+class LocalSearchPlugin;
 class SearchTaskManager;
 
 /**
@@ -61,7 +66,33 @@ public:
      */
     virtual QList<AbstractSearchPlugin *> searchPlugins() const;
 
+    /**
+     * Returns the thread pool in which the search plugins are queried.
+     */
+    QThreadPool *searchPool() const;
+
+    /**
+     * Schedules an incremental update of all persistent searches after items
+     * @p changedItems in collections @p changedCollections have been added or
+     * modified.
+     *
+     * Only searches that cover any of the @p changedCollections are re-evaluated,
+     * and only the membership of @p changedItems in them is updated.
+     */
+    virtual void scheduleSearchUpdate(const QSet<qint64> &changedItems, const QSet<qint64> &changedCollections);
+
+    /**
+     * Schedules reindexing of @p items in the local search index after they
+     * have been added, modified, moved or removed.
+     *
+     * Does nothing when the local search index is not enabled.
+     */
+    virtual void scheduleIndexUpdate(const QSet<qint64> &items);
+
 public Q_SLOTS:
+    /**
+     * Schedules a full re-evaluation of all persistent searches.
+     */
     virtual void scheduleSearchUpdate();
 
     /**
@@ -78,6 +109,7 @@ public Q_SLOTS:
 
 private Q_SLOTS:
     void searchUpdateTimeout();
+    void indexUpdateTimeout();
     void searchUpdateResultsAvailable(const QSet<qint64> &results);
 
     /**
@@ -88,6 +120,20 @@ private Q_SLOTS:
     void updateSearchImpl(const Akonadi::Server::Collection &collection);
 
 private:
+    struct SearchScope {
+        QList<qint64> collections;
+        QStringList mimeTypes;
+        bool remote = false;
+    };
+
+    std::optional<SearchScope> searchScope(const Collection &collection) const;
+    QSet<qint64> runSearch(const Collection &collection, const SearchScope &scope, bool pushResults);
+    void updateSearchDelta(const Collection &collection, const QSet<qint64> &changedItems, const QSet<qint64> &changedCollections);
+
+    static QSet<qint64> linkedItems(qint64 collectionId, const QSet<qint64> &items);
+    static bool linkItems(qint64 collectionId, const QList<qint64> &items);
+    static bool unlinkItems(qint64 collectionId, const QList<qint64> &items);
+
     void init() override;
     void quit() override;
 
@@ -101,11 +147,18 @@ private:
     QList<QPluginLoader *> mPluginLoaders;
     QList<AbstractSearchEngine *> mEngines;
     QList<AbstractSearchPlugin *> mPlugins;
+    LocalSearchPlugin *mLocalSearch = nullptr;
+    std::unique_ptr<QThreadPool> mSearchPool;
 
     QTimer *mSearchUpdateTimer = nullptr;
+    QTimer *mIndexUpdateTimer = nullptr;
 
     QMutex mLock;
     QSet<qint64> mUpdatingCollections;
+    // Changes accumulated since the last search update, protected by mLock
+    QSet<qint64> mChangedItems;
+    QSet<qint64> mChangedCollections;
+    bool mFullUpdatePending = false;
 };
 
 } // namespace Server
@@ -13,10 +13,25 @@
 #include "searchmanager.h"
 #include "searchtaskmanager.h"
 
+#include <QDeadlineTimer>
+#include <QThreadPool>
+
+#include <chrono>
+#include <memory>
+#include <utility>
+
 using namespace Akonadi::Server;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// How long to wait for a search plugin to return its results
+constexpr auto PluginSearchTimeout = 30s;
+} // namespace
 
 SearchRequest::SearchRequest(const QByteArray &connectionId, SearchManager &searchManager, SearchTaskManager &agentSearchManager)
     : mConnectionId(connectionId)
+    , mPluginTimeout(PluginSearchTimeout)
     , mSearchManager(searchManager)
     , mAgentSearchManager(agentSearchManager)
 {
@@ -76,6 +91,11 @@ void SearchRequest::setStoreResults(bool storeResults)
     mStoreResults = storeResults;
 }
 
+void SearchRequest::setPluginTimeout(std::chrono::milliseconds timeout)
+{
+    mPluginTimeout = timeout;
+}
+
 QSet<qint64> SearchRequest::results() const
 {
     return mResults;
@@ -89,12 +109,21 @@ void SearchRequest::emitResults(const QSet<qint64> &results)
     }
 }
 
-void SearchRequest::searchPlugins()
+void SearchRequest::searchPlugins(const std::shared_ptr<SearchTask> &task)
 {
     const QList<AbstractSearchPlugin *> plugins = mSearchManager.searchPlugins();
+    task->pendingPlugins = plugins.size();
     for (AbstractSearchPlugin *plugin : plugins) {
-        const QSet<qint64> result = plugin->search(mQuery, mCollections, mMimeTypes);
-        emitResults(result);
+        // The task is shared with the runnable, so that a plugin that is still running after
+        // we gave up waiting for it can deliver its results into the void.
+        mSearchManager.searchPool()->start([task, plugin]() {
+            const QSet<qint64> result = plugin->search(task->query, task->collections, task->mimeTypes);
+
+            QMutexLocker locker(&task->sharedLock);
+            task->pendingResults.unite(result);
+            --task->pendingPlugins;
+            task->notifier.wakeAll();
+        });
     }
 }
 
@@ -102,46 +131,47 @@ void SearchRequest::exec()
 {
     qCInfo(AKONADISERVER_SEARCH_LOG) << "Executing search" << mConnectionId;
 
-    // TODO should we move this to the AgentSearchManager as well? If we keep it here the agents can be searched in parallel
-    // since the plugin search is executed in this thread directly.
-    searchPlugins();
-
-    // If remote search is disabled, just finish here after searching the plugins
-    if (!mRemoteSearch) {
-        qCInfo(AKONADISERVER_SEARCH_LOG) << "Search " << mConnectionId << "done (without remote search)";
-        return;
+    auto task = std::make_shared<SearchTask>();
+    task->id = mConnectionId;
+    task->query = mQuery;
+    task->mimeTypes = mMimeTypes;
+    task->collections = mCollections;
+    task->complete = !mRemoteSearch;
+
+    // Query all search plugins and agents at the same time, results are emitted
+    // as soon as each source delivers them.
+    searchPlugins(task);
+    if (mRemoteSearch) {
+        mAgentSearchManager.addTask(task.get());
     }
 
-    SearchTask task;
-    task.id = mConnectionId;
-    task.query = mQuery;
-    task.mimeTypes = mMimeTypes;
-    task.collections = mCollections;
-    task.complete = false;
-
-    mAgentSearchManager.addTask(&task);
-
-    task.sharedLock.lock();
+    const QDeadlineTimer pluginDeadline(mPluginTimeout);
+    task->sharedLock.lock();
     for (;;) {
-        if (task.complete) {
-            break;
+        if (!task->pendingResults.isEmpty()) {
+            const QSet<qint64> results = std::exchange(task->pendingResults, {});
+            qCDebug(AKONADISERVER_SEARCH_LOG) << results.count() << "search results available in search" << task->id;
+            // Don't block the sources while the results are being processed
+            task->sharedLock.unlock();
+            emitResults(results);
+            task->sharedLock.lock();
+            continue;
         }
 
-        task.notifier.wait(&task.sharedLock);
-
-        qCDebug(AKONADISERVER_SEARCH_LOG) << task.pendingResults.count() << "search results available in search" << task.id;
-        if (!task.pendingResults.isEmpty()) {
-            emitResults(task.pendingResults);
+        const bool pluginsDone = task->pendingPlugins == 0 || pluginDeadline.hasExpired();
+        // SearchTaskManager takes care of timing out the agents
+        if (pluginsDone && task->complete) {
+            break;
         }
-        task.pendingResults.clear();
-    }
 
-    if (!task.pendingResults.isEmpty()) {
-        emitResults(task.pendingResults);
+        task->notifier.wait(&task->sharedLock, pluginsDone ? QDeadlineTimer(QDeadlineTimer::Forever) : pluginDeadline);
+    }
+    if (task->pendingPlugins > 0) {
+        qCWarning(AKONADISERVER_SEARCH_LOG) << task->pendingPlugins << "search plugins did not finish search" << mConnectionId << "in time";
     }
-    task.sharedLock.unlock();
+    task->sharedLock.unlock();
 
-    qCInfo(AKONADISERVER_SEARCH_LOG) << "Search" << mConnectionId << "done (with remote search)";
+    qCInfo(AKONADISERVER_SEARCH_LOG) << "Search" << mConnectionId << "done" << (mRemoteSearch ? "(with remote search)" : "(without remote search)");
 }
 
 #include "moc_searchrequest.cpp"
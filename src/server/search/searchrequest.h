@@ -11,12 +11,16 @@
 #include <QSet>
 #include <QStringList>
 
+#include <chrono>
+#include <memory>
+
 namespace Akonadi
 {
 namespace Server
 {
 class Connection;
 class SearchManager;
+class SearchTask;
 class SearchTaskManager;
 
 class SearchRequest : public QObject
@@ -43,8 +47,20 @@ public:
      */
     void setStoreResults(bool storeResults);
 
+    /**
+     * How long exec() waits for the search plugins to return their results,
+     * 30 seconds by default.
+     */
+    void setPluginTimeout(std::chrono::milliseconds timeout);
+
     QByteArray connectionId() const;
 
+    /**
+     * Queries all search plugins and, for remote searches, all agents in parallel.
+     *
+     * Blocks until all of them have finished or timed out. Results are emitted
+     * via resultsAvailable() as soon as each of them delivers them.
+     */
     void exec();
 
     QSet<qint64> results() const;
@@ -53,7 +69,7 @@ Q_SIGNALS:
     void resultsAvailable(const QSet<qint64> &results);
 
 private:
-    void searchPlugins();
+    void searchPlugins(const std::shared_ptr<SearchTask> &task);
     void emitResults(const QSet<qint64> &results);
 
     QByteArray mConnectionId;
@@ -62,6 +78,7 @@ private:
     QStringList mMimeTypes;
     bool mRemoteSearch = false;
     bool mStoreResults = false;
+    std::chrono::milliseconds mPluginTimeout;
     QSet<qint64> mResults;
 
     SearchManager &mSearchManager;
@@ -18,8 +18,18 @@
 #include <QSqlError>
 #include <QTime>
 #include <QTimer>
+
+#include <chrono>
+
 using namespace Akonadi;
 using namespace Akonadi::Server;
+using namespace std::chrono_literals;
+
+namespace
+{
+/// How long to wait for an agent to deliver its search results
+constexpr auto AgentSearchTimeout = 60s;
+} // namespace
 
 SearchTaskManager::SearchTaskManager()
     : AkThread(QStringLiteral("SearchTaskManager"))
@@ -97,15 +107,21 @@ void SearchTaskManager::addTask(SearchTask *task)
 
     auto &query = qb.query();
     if (!query.next()) {
+        QMutexLocker locker(&task->sharedLock);
+        task->complete = true;
+        task->notifier.wakeAll();
         return;
     }
 
+    // Don't hold the lock during the D-Bus calls to the AgentManager
     mInstancesLock.lock();
+    const auto instances = mInstances.keys();
+    mInstancesLock.unlock();
 
     org::freedesktop::Akonadi::AgentManager agentManager(DBus::serviceName(DBus::Control), QStringLiteral("/AgentManager"), QDBusConnection::sessionBus());
     do {
         const QString resourceId = query.value(1).toString();
-        if (!mInstances.contains(resourceId)) {
+        if (!instances.contains(resourceId)) {
             qCDebug(AKONADISERVER_SEARCH_LOG) << "Resource" << resourceId << "does not implement Search interface, skipping";
         } else if (!agentManager.agentInstanceOnline(resourceId)) {
             qCDebug(AKONADISERVER_SEARCH_LOG) << "Agent" << resourceId << "is offline, skipping";
@@ -117,10 +133,10 @@ void SearchTaskManager::addTask(SearchTask *task)
             task->queries << qMakePair(resourceId, collectionId);
         }
     } while (query.next());
-    mInstancesLock.unlock();
 
     QMutexLocker locker(&mLock);
     mTasklist.append(task);
+    mChanged = true;
     mWait.wakeAll();
 }
 
@@ -147,6 +163,7 @@ void SearchTaskManager::pushResults(const QByteArray &searchId, const QSet<qint6
     task->results = ids;
     mPendingResults.append(task);
 
+    mChanged = true;
     mWait.wakeAll();
 }
 
@@ -184,19 +201,89 @@ SearchTaskManager::TasksMap::Iterator SearchTaskManager::cancelRunningTask(Tasks
     return it;
 }
 
+void SearchTaskManager::dispatchQueries(SearchTask *task, QList<PendingQuery> &queries)
+{
+    QMutexLocker taskLocker(&task->sharedLock);
+    for (auto it = task->queries.begin(); it != task->queries.end();) {
+        const auto &[resource, colId] = *it;
+        // Each agent only handles one search at a time, the query is dispatched once it's done
+        if (mRunningTasks.contains(resource)) {
+            ++it;
+            continue;
+        }
+
+        mInstancesLock.lock();
+        const bool registered = mInstances.contains(resource);
+        mInstancesLock.unlock();
+        if (!registered) {
+            // Resource disappeared in the meanwhile
+            it = task->queries.erase(it);
+            continue;
+        }
+
+        auto rTask = new ResourceTask;
+        rTask->resourceId = resource;
+        rTask->collectionId = colId;
+        rTask->parentTask = task;
+        rTask->timestamp = QDateTime::currentMSecsSinceEpoch();
+        mRunningTasks.insert(resource, rTask);
+
+        // Sent by sendQueries() once the locks are released
+        queries.push_back({resource, task->id, task->query, colId});
+        it = task->queries.erase(it);
+    }
+}
+
+void SearchTaskManager::sendQueries(const QList<PendingQuery> &queries)
+{
+    for (const PendingQuery &query : queries) {
+        mInstancesLock.lock();
+        AgentSearchInstance *instance = mInstances.value(query.resourceId);
+        if (instance) {
+            qCDebug(AKONADISERVER_SEARCH_LOG) << "\t Sending query for collection" << query.collectionId << "to resource" << query.resourceId;
+            instance->search(query.searchId, query.query, query.collectionId);
+        }
+        mInstancesLock.unlock();
+        if (instance) {
+            continue;
+        }
+
+        // Resource disappeared since the query was dispatched, don't wait for it
+        QMutexLocker locker(&mLock);
+        auto it = mRunningTasks.find(query.resourceId);
+        if (it != mRunningTasks.end() && it.value()->parentTask->id == query.searchId && it.value()->collectionId == query.collectionId) {
+            cancelRunningTask(it);
+        }
+    }
+}
+
 void SearchTaskManager::searchLoop()
 {
-    qint64 timeout = ULONG_MAX;
+    constexpr qint64 timeout = std::chrono::milliseconds(AgentSearchTimeout).count();
 
     QMutexLocker locker(&mLock);
 
     for (;;) {
-        qCDebug(AKONADISERVER_SEARCH_LOG) << "Search loop is waiting, will wake again in" << timeout << "ms";
-        mWait.wait(&mLock, QDeadlineTimer(QDeadlineTimer::Forever));
+        // Wake up when the oldest running task times out
+        QDeadlineTimer deadline(QDeadlineTimer::Forever);
+        if (!mRunningTasks.isEmpty()) {
+            const qint64 now = QDateTime::currentMSecsSinceEpoch();
+            qint64 remaining = timeout;
+            for (const ResourceTask *task : std::as_const(mRunningTasks)) {
+                remaining = std::min(remaining, task->timestamp + timeout - now);
+            }
+            deadline.setRemainingTime(std::max<qint64>(remaining, 0));
+        }
+        if (!mChanged && !mShouldStop) {
+            qCDebug(AKONADISERVER_SEARCH_LOG) << "Search loop is waiting, will wake again in" << deadline.remainingTime() << "ms";
+            mWait.wait(&mLock, deadline);
+        }
+        mChanged = false;
         if (mShouldStop) {
             for (SearchTask *task : std::as_const(mTasklist)) {
                 QMutexLocker locker(&task->sharedLock);
                 task->queries.clear();
+                task->complete = true;
                 task->notifier.wakeAll();
             }
 
@@ -228,12 +315,12 @@ void SearchTaskManager::searchLoop()
             delete finishedTask;
         }
 
-        // No check whether there are any tasks running longer than 1 minute and kill them
+        // Now check whether there are any tasks running longer than the timeout and kill them
         QMap<QString, ResourceTask *>::Iterator it = mRunningTasks.begin();
         const qint64 now = QDateTime::currentMSecsSinceEpoch();
         for (; it != mRunningTasks.end();) {
             ResourceTask *task = it.value();
-            if (now - task->timestamp > 60 * 1000) {
+            if (now - task->timestamp >= timeout) {
                 // Remove the task - and signal to parent task that it has "finished" without results
                 qCDebug(AKONADISERVER_SEARCH_LOG) << "Resource task" << task->resourceId << "for search" << task->parentTask->id << "timed out!";
                 it = cancelRunningTask(it);
@@ -242,59 +329,35 @@ void SearchTaskManager::searchLoop()
             }
         }
 
-        if (!mTasklist.isEmpty()) {
-            SearchTask *task = mTasklist.first();
+        // Dispatch queries of all tasks to idle agents, so that a busy agent does not
+        // hold back searches in other agents
+        QList<PendingQuery> queries;
+        for (auto taskIt = mTasklist.begin(); taskIt != mTasklist.end();) {
+            SearchTask *task = *taskIt;
             qCDebug(AKONADISERVER_SEARCH_LOG) << "Search task" << task->id << "available!";
-            if (task->queries.isEmpty()) {
-                qCDebug(AKONADISERVER_SEARCH_LOG) << "nothing to do for task";
-                QMutexLocker locker(&task->sharedLock);
-                // After this the AgentSearchTask will be destroyed
-                task->complete = true;
-                task->notifier.wakeAll();
-                mTasklist.remove(0);
+            dispatchQueries(task, queries);
+
+            QMutexLocker taskLocker(&task->sharedLock);
+            if (!task->queries.isEmpty()) {
+                ++taskIt;
                 continue;
             }
 
-            for (auto it = task->queries.begin(); it != task->queries.end();) {
-                if (!mRunningTasks.contains(it->first)) {
-                    const auto &[resource, colId] = *it;
-                    qCDebug(AKONADISERVER_SEARCH_LOG) << "\t Sending query for collection" << colId << "to resource" << resource;
-                    auto rTask = new ResourceTask;
-                    rTask->resourceId = resource;
-                    rTask->collectionId = colId;
-                    rTask->parentTask = task;
-                    rTask->timestamp = QDateTime::currentMSecsSinceEpoch();
-                    mRunningTasks.insert(resource, rTask);
-
-                    mInstancesLock.lock();
-                    AgentSearchInstance *instance = mInstances.value(resource);
-                    if (!instance) {
-                        mInstancesLock.unlock();
-                        // Resource disappeared in the meanwhile
-                        continue;
-                    }
-
-                    instance->search(task->id, task->query, colId);
-                    mInstancesLock.unlock();
-
-                    task->sharedLock.lock();
-                    it = task->queries.erase(it);
-                    task->sharedLock.unlock();
-                } else {
-                    ++it;
-                }
-            }
-            // Yay! We managed to dispatch all requests!
-            if (task->queries.isEmpty()) {
-                qCDebug(AKONADISERVER_SEARCH_LOG) << "All queries from task" << task->id << "dispatched!";
-                mTasklist.remove(0);
+            qCDebug(AKONADISERVER_SEARCH_LOG) << "All queries from task" << task->id << "dispatched!";
+            if (allResourceTasksCompleted(task)) {
+                // Nothing to wait for, after this the SearchTask may be destroyed
+                task->complete = true;
+                task->notifier.wakeAll();
             }
+            taskIt = mTasklist.erase(taskIt);
+        }
 
-            timeout = 60 * 1000; // check whether all tasks have finished within a minute
-        } else {
-            if (mRunningTasks.isEmpty()) {
-                timeout = ULONG_MAX;
-            }
+        // The dispatched tasks are running, so their SearchTasks stay alive until we have
+        // sent the queries. Don't block addTask() and pushResults() on D-Bus meanwhile.
+        if (!queries.isEmpty()) {
+            locker.unlock();
+            sendQueries(queries);
+            locker.relock();
         }
     }
 }
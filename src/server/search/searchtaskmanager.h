@@ -31,7 +31,10 @@ public:
     QString query;
     QStringList mimeTypes;
     QList<qint64> collections;
-    bool complete;
+    /// Whether all agent searches have finished
+    bool complete = false;
+    /// Number of search plugins that have not returned their results yet
+    int pendingPlugins = 0;
 
     QMutex sharedLock;
     QWaitCondition notifier;
@@ -75,12 +78,24 @@ private:
         qint64 timestamp;
     };
 
+    /// A query that is handed to an agent once the task locks are released
+    struct PendingQuery {
+        QString resourceId;
+        QByteArray searchId;
+        QString query;
+        qint64 collectionId;
+    };
+
     using TasksMap = QMap<QString, ResourceTask *>;
 
     bool mShouldStop;
+    /// Whether tasks or results came in since the search loop last looked
+    bool mChanged = false;
 
     TasksMap::Iterator cancelRunningTask(TasksMap::Iterator &iter);
     bool allResourceTasksCompleted(SearchTask *agentSearchTask) const;
+    void dispatchQueries(SearchTask *task, QList<PendingQuery> &queries);
+    void sendQueries(const QList<PendingQuery> &queries);
 
     QMap<QString, AgentSearchInstance *> mInstances;
     QMutex mInstancesLock;
@@ -345,8 +345,8 @@ bool DataStore::setItemsFlags(const PimItem::List &items,
 bool DataStore::doAppendItemsFlag(const PimItem::List &items, const Flag &flag, const QSet<Entity::Id> &existing, const Collection &col_, bool silent)
 {
     Collection col = col_;
-    QVariantList flagIds;
-    QVariantList appendIds;
+    QList<qint64> flagIds;
+    QList<qint64> appendIds;
     PimItem::List appendItems;
     for (const PimItem &item : items) {
         if (existing.contains(item.id())) {
@@ -368,15 +368,9 @@ bool DataStore::doAppendItemsFlag(const PimItem::List &items, const Flag &flag,
         return true; // all items have the desired flags already
     }
 
-    {
-        QueryBuilder qb2(PimItemFlagRelation::tableName(), QueryBuilder::Insert);
-        qb2.setColumnValue(PimItemFlagRelation::leftColumn(), appendIds);
-        qb2.setColumnValue(PimItemFlagRelation::rightColumn(), flagIds);
-        qb2.setIdentificationColumn(QString());
-        if (!qb2.exec()) {
-            qCWarning(AKONADISERVER_LOG) << "Failed to append flag" << flag.name() << "to Items" << appendIds;
-            return false;
-        }
+    if (!Entity::addToRelation<PimItemFlagRelation>(this, appendIds, flagIds)) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to append flag" << flag.name() << "to Items" << appendIds;
+        return false;
     }
 
     if (!silent) {
@@ -874,7 +868,7 @@ bool DataStore::cleanupCollection(Collection &collection)
 
     try {
         while (qb.query().next()) {
-            ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath(qb.query().value(0).toByteArray()));
+            ExternalPartStorage::self()->releasePartFile(ExternalPartStorage::resolveAbsolutePath(qb.query().value(0).toByteArray()));
         }
     } catch (const PartHelperException &e) {
         qb.query().finish();
@@ -1114,26 +1108,33 @@ bool DataStore::appendPimItem(QList<Part> &parts,
 
     // insert every part
     if (!parts.isEmpty()) {
-        // don't use foreach, the caller depends on knowing the part has changed, see the Append handler
-        for (QList<Part>::iterator it = parts.begin(); it != parts.end(); ++it) {
-            (*it).setPimItemId(pimItem.id());
-            if ((*it).datasize() < (*it).data().size()) {
-                (*it).setDatasize((*it).data().size());
+        // the caller depends on knowing the part has changed, see the Append handler
+        for (Part &part : parts) {
+            part.setPimItemId(pimItem.id());
+            if (part.datasize() < part.data().size()) {
+                part.setDatasize(part.data().size());
             }
+        }
 
-            //      qCDebug(AKONADISERVER_LOG) << "Insert from DataStore::appendPimItem";
-            if (!PartHelper::insert(&(*it))) {
-                qCWarning(AKONADISERVER_LOG) << "Failed to add part" << it->partType().name() << "to new PimItem" << pimItem.id();
-                return false;
-            }
+        if (!PartHelper::insert(parts)) {
+            qCWarning(AKONADISERVER_LOG) << "Failed to add parts to new PimItem" << pimItem.id();
+            return false;
         }
     }
 
     bool seen = false;
-    for (const Flag &flag : flags) {
-        seen |= (flag.name() == QLatin1StringView(AKONADI_FLAG_SEEN) || flag.name() == QLatin1StringView(AKONADI_FLAG_IGNORED));
-        if (!pimItem.addFlag(flag)) {
-            qCWarning(AKONADISERVER_LOG) << "Failed to add flag" << flag.name() << "to new PimItem" << pimItem.id();
+    if (!flags.isEmpty()) {
+        QList<qint64> itemIds;
+        QList<qint64> flagIds;
+        itemIds.reserve(flags.size());
+        flagIds.reserve(flags.size());
+        for (const Flag &flag : flags) {
+            seen |= (flag.name() == QLatin1StringView(AKONADI_FLAG_SEEN) || flag.name() == QLatin1StringView(AKONADI_FLAG_IGNORED));
+            itemIds.push_back(pimItem.id());
+            flagIds.push_back(flag.id());
+        }
+        if (!Entity::addToRelation<PimItemFlagRelation>(this, itemIds, flagIds)) {
+            qCWarning(AKONADISERVER_LOG) << "Failed to add flags" << flagIds << "to new PimItem" << pimItem.id();
             return false;
         }
     }
@@ -13,7 +13,9 @@
 
 #include <config-akonadi.h>
 
+#include "private/externalpartstorage_p.h"
 #include "private/instance_p.h"
+#include "private/partcompression_p.h"
 #include "private/standarddirs_p.h"
 
 #include <QProcess>
@@ -44,6 +46,9 @@ DbConfig::DbConfig(const QString &configFile)
     } else {
         mSizeThreshold = 0;
     }
+
+    mPackThreshold = qBound<qint64>(0, settings.value(QStringLiteral("General/PackThreshold"), 0).value<qint64>(), ExternalPartStorage::maxPackSize);
+    mPartCompression = settings.value(QStringLiteral("General/PartCompression"), false).toBool() && PartCompression::isAvailable();
 }
 
 DbConfig::~DbConfig()
@@ -140,6 +145,16 @@ qint64 DbConfig::sizeThreshold() const
     return mSizeThreshold;
 }
 
+qint64 DbConfig::packThreshold() const
+{
+    return mPackThreshold;
+}
+
+bool DbConfig::partCompression() const
+{
+    return mPartCompression;
+}
+
 QString DbConfig::defaultDatabaseName()
 {
     if (!Instance::hasIdentifier()) {
@@ -114,6 +114,22 @@ public:
      */
     virtual qint64 sizeThreshold() const;
 
+    /**
+     * External payload data up to this size will be appended to pack files, instead of
+     * being stored in a file of its own.
+     *
+     * @return the pack size threshold in bytes, defaults to 0 (packs are not used).
+     */
+    virtual qint64 packThreshold() const;
+
+    /**
+     * Payload data stored in the database or in external files is compressed
+     * with zstd when this is enabled and Akonadi was built with zstd support.
+     *
+     * @return whether parts are compressed, defaults to false.
+     */
+    virtual bool partCompression() const;
+
     /**
      * This method is called to setup initial database settings after a connection is established.
      */
@@ -156,6 +172,8 @@ private:
     Q_DISABLE_COPY(DbConfig)
 
     qint64 mSizeThreshold;
+    qint64 mPackThreshold;
+    bool mPartCompression;
 };
 
 } // namespace Server
@@ -260,6 +260,13 @@ void DbConfigSqlite::setup()
             return;
         }
 
+        // release free pages on demand, see StorageJanitor::checkOnline(); only has effect on
+        // new databases, existing ones are converted by a full vacuum
+        if (!setPragma(db, query, QStringLiteral("auto_vacuum=INCREMENTAL"))) {
+            db.close();
+            return;
+        }
+
         // set cache_size to 100000 pages; see https://www.sqlite.org/pragma.html#pragma_cache_size
         if (!setPragma(db, query, QStringLiteral("cache_size=100000"))) {
             db.close();
@@ -121,6 +121,35 @@ bool Entity::addToRelationImpl(DataStore *store, const QString &tableName, const
     return true;
 }
 
+bool Entity::addToRelationImpl(DataStore *store,
+                               const QString &tableName,
+                               const QString &leftColumn,
+                               const QString &rightColumn,
+                               const QList<qint64> &leftIds,
+                               const QList<qint64> &rightIds)
+{
+    Q_ASSERT(leftIds.size() == rightIds.size());
+    QSqlDatabase db = store->database();
+    if (!db.isOpen()) {
+        return false;
+    }
+
+    constexpr qsizetype chunkSize = QueryBuilder::maxInsertRows(2);
+    for (qsizetype offset = 0; offset < leftIds.size(); offset += chunkSize) {
+        QueryBuilder qb(store, tableName, QueryBuilder::Insert);
+        qb.setColumnValues(leftColumn, leftIds.mid(offset, chunkSize));
+        qb.setColumnValues(rightColumn, rightIds.mid(offset, chunkSize));
+        qb.setIdentificationColumn(QString());
+
+        if (!qb.exec()) {
+            qCWarning(AKONADISERVER_LOG) << "Error during adding records to table" << tableName;
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool Entity::removeFromRelationImpl(DataStore *store,
                                     const QString &tableName,
                                     const QString &leftColumn,
@@ -109,6 +109,18 @@ public:
         return Entity::addToRelationImpl(store, T::tableName(), T::leftColumn(), T::rightColumn(), leftId, rightId);
     }
 
+    /**
+      Adds multiple entries to a n:m relation table (specified by the template parameter)
+      using multi-row INSERT queries.
+      @param leftIds Identifiers of the left part of the relations.
+      @param rightIds Identifiers of the right part of the relations, must have the same size as @p leftIds.
+    */
+    template<typename T>
+    inline static bool addToRelation(DataStore *store, const QList<qint64> &leftIds, const QList<qint64> &rightIds)
+    {
+        return Entity::addToRelationImpl(store, T::tableName(), T::leftColumn(), T::rightColumn(), leftIds, rightIds);
+    }
+
     /**
       Removes an entry from a n:m relation table (specified by the template parameter).
       @param leftId Identifier of the left part of the relation.
@@ -160,6 +172,12 @@ private:
     static bool relatesToImpl(DataStore *store, const QString &tableName, const QString &leftColumn, const QString &rightColumn, qint64 leftId, qint64 rightId);
     static bool
     addToRelationImpl(DataStore *store, const QString &tableName, const QString &leftColumn, const QString &rightColumn, qint64 leftId, qint64 rightId);
+    static bool addToRelationImpl(DataStore *store,
+                                  const QString &tableName,
+                                  const QString &leftColumn,
+                                  const QString &rightColumn,
+                                  const QList<qint64> &leftIds,
+                                  const QList<qint64> &rightIds);
     static bool
     removeFromRelationImpl(DataStore *store, const QString &tableName, const QString &leftColumn, const QString &rightColumn, qint64 leftId, qint64 rightId);
     static bool
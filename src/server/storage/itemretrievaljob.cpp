@@ -6,12 +6,27 @@
 
 #include "itemretrievaljob.h"
 #include "akonadiserver_debug.h"
+#include "connection.h"
 #include "resourceinterface.h"
 
 #include <QDBusPendingCallWatcher>
+#include <QTimer>
 
+#include <atomic>
+
+using namespace Akonadi;
 using namespace Akonadi::Server;
 
+namespace
+{
+qint64 nextChannelTag()
+{
+    // Tags of commands sent by the server, kept apart from the client's own tags
+    static std::atomic<qint64> lastTag = 1LL << 32;
+    return ++lastTag;
+}
+} // namespace
+
 AbstractItemRetrievalJob::AbstractItemRetrievalJob(ItemRetrievalRequest req, QObject *parent)
     : QObject(parent)
     , m_result(std::move(req))
@@ -23,12 +38,53 @@ ItemRetrievalJob::~ItemRetrievalJob()
     Q_ASSERT(!m_active);
 }
 
+void ItemRetrievalJob::setChannel(Connection *channel)
+{
+    m_channel = channel;
+}
+
 void ItemRetrievalJob::start()
 {
     qCDebug(AKONADISERVER_LOG) << "processing retrieval request for item" << request().ids << " parts:" << request().parts
                                << " of resource:" << request().resourceId;
 
     // call the resource
+    if (m_channel) {
+        m_active = true;
+        m_channelTag = nextChannelTag();
+        connect(m_channel, &Connection::disconnected, this, &ItemRetrievalJob::channelDisconnected);
+        // The connection is deleted once it has been closed, which also covers a
+        // disconnected() signal emitted before we were connected to it
+        connect(m_channel, &QObject::destroyed, this, &ItemRetrievalJob::channelDisconnected);
+    }
+
+    if (m_channel) {
+        // The command must be written from the thread of the connection
+        const auto cmd = Protocol::RetrieveItemsCommandPtr::create(request().ids, request().parts);
+        QTimer::singleShot(0, m_channel.data(), [channel = m_channel, tag = m_channelTag, cmd]() {
+            if (!channel) {
+                return;
+            }
+            try {
+                channel->sendResponse(tag, cmd);
+            } catch (const ProtocolException &e) {
+                qCWarning(AKONADISERVER_LOG) << "Failed to send retrieval request to resource:" << e.what();
+            }
+        });
+        QTimer::singleShot(RetrievalTimeout, this, [this, tag = m_channelTag]() {
+            if (m_active && tag == m_channelTag) {
+                finish(QStringLiteral("Resource did not answer the retrieval request in time"));
+            }
+        });
+        return;
+    }
+
+    if (m_channelTag >= 0) {
+        qCDebug(AKONADISERVER_LOG) << "Retrieval channel of resource" << request().resourceId << "went away, falling back to D-Bus";
+        m_active = false;
+        m_channelTag = -1;
+    }
+
     if (m_interface) {
         m_active = true;
         auto reply = m_interface->requestItemDelivery(request().ids, request().parts);
@@ -46,6 +102,39 @@ void ItemRetrievalJob::kill()
     m_active = false;
     m_result.errorMsg = QStringLiteral("Request cancelled");
     Q_EMIT requestCompleted(this);
+    if (m_channelTag >= 0) {
+        // there is no pending D-Bus call that would delete us
+        deleteLater();
+    }
+}
+
+void ItemRetrievalJob::channelReplied(qint64 tag, const std::optional<QString> &errorMsg)
+{
+    if (!m_active || tag != m_channelTag) {
+        return;
+    }
+
+    if (errorMsg.has_value()) {
+        finish(QStringLiteral("Unable to retrieve item from resource: %1").arg(*errorMsg));
+    } else {
+        finish(std::nullopt);
+    }
+}
+
+void ItemRetrievalJob::channelDisconnected()
+{
+    // Ignore the channel once the job fell back to D-Bus
+    if (m_active && m_channelTag >= 0) {
+        finish(QStringLiteral("Resource closed the retrieval channel"));
+    }
+}
+
+void ItemRetrievalJob::finish(const std::optional<QString> &errorMsg)
+{
+    m_active = false;
+    m_result.errorMsg = errorMsg;
+    Q_EMIT requestCompleted(this);
+    deleteLater();
 }
 
 void ItemRetrievalJob::callFinished(QDBusPendingCallWatcher *watcher)
@@ -7,6 +7,9 @@
 #pragma once
 
 #include <QObject>
+#include <QPointer>
+
+#include <chrono>
 
 #include "itemretrievalrequest.h"
 
@@ -17,6 +20,7 @@ namespace Akonadi
 {
 namespace Server
 {
+class Connection;
 class ItemRetrievalRequest;
 
 class AbstractItemRetrievalJob : public QObject
@@ -45,31 +49,57 @@ protected:
     ItemRetrievalResult m_result;
 };
 
-/// Async D-Bus retrieval, no modification of the request (thus no need for locking)
+/// Async retrieval over the resource's retrieval channel, or over D-Bus if it has none.
+/// No modification of the request (thus no need for locking)
 class ItemRetrievalJob : public AbstractItemRetrievalJob
 {
     Q_OBJECT
 public:
+    /// How long the resource may take to retrieve the items, over D-Bus or the retrieval channel
+    static constexpr std::chrono::minutes RetrievalTimeout{5};
+
     ItemRetrievalJob(ItemRetrievalRequest req, QObject *parent)
         : AbstractItemRetrievalJob(std::move(req), parent)
     {
     }
 
+    /**
+     * Sets the D-Bus interface of the resource, used when it has no retrieval
+     * channel or when the channel went away before the job was started.
+     */
     void setInterface(OrgFreedesktopAkonadiResourceInterface *interface)
     {
         m_interface = interface;
     }
 
+    /**
+     * Sends the request over the retrieval channel @p channel instead of D-Bus.
+     * The job fails if the channel is closed while the resource is retrieving
+     * the items, or if the resource does not answer within RetrievalTimeout.
+     * @see RetrievalChannelHandler
+     */
+    void setChannel(Connection *channel);
+
+    /**
+     * Called when the resource answered the RetrieveItems command with tag @p tag.
+     */
+    void channelReplied(qint64 tag, const std::optional<QString> &errorMsg);
+
     ~ItemRetrievalJob() override;
     void start() override;
     void kill() override;
 
 private Q_SLOTS:
     void callFinished(QDBusPendingCallWatcher *watcher);
+    void channelDisconnected();
 
 private:
+    void finish(const std::optional<QString> &errorMsg);
+
     bool m_active = false;
     OrgFreedesktopAkonadiResourceInterface *m_interface = nullptr;
+    QPointer<Connection> m_channel;
+    qint64 m_channelTag = -1;
 };
 
 } // namespace Server
@@ -6,21 +6,48 @@
 
 #include "itemretrievalmanager.h"
 #include "akonadiserver_debug.h"
+#include "connection.h"
 #include "itemretrievaljob.h"
+#include "resourcemanager.h"
 
+#include "agentmanagerinterface.h"
 #include "resourceinterface.h"
 
 #include "private/dbus_p.h"
+#include "private/standarddirs_p.h"
 
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QScopedPointer>
+#include <QSettings>
 
 using namespace Akonadi;
 using namespace Akonadi::Server;
 
 Q_DECLARE_METATYPE(Akonadi::Server::ItemRetrievalResult)
 
+namespace
+{
+/// Upper limit of items retrieved by a single job when coalescing requests
+constexpr qsizetype MaxCoalescedItems = 500;
+
+bool isSubsetOf(const QByteArrayList &superset, const QByteArrayList &subset)
+{
+    // For very small lists like these, this is faster than copy, sort and std::include
+    return std::all_of(subset.cbegin(), subset.cend(), [&superset](const auto &val) {
+        return superset.contains(val);
+    });
+}
+
+bool canCoalesce(const ItemRetrievalRequest &request, const ItemRetrievalRequest &other)
+{
+    // Resources expect all items of a retrieval to be in the same collection
+    return request.collectionId >= 0 && request.collectionId == other.collectionId && isSubsetOf(request.parts, other.parts)
+        && isSubsetOf(other.parts, request.parts);
+}
+
+}
+
 class ItemRetrievalJobFactory : public AbstractItemRetrievalJobFactory
 {
     AbstractItemRetrievalJob *retrievalJob(ItemRetrievalRequest request, QObject *parent) override
@@ -54,21 +81,48 @@ void ItemRetrievalManager::init()
     QDBusConnection conn = QDBusConnection::sessionBus();
     connect(conn.interface(), &QDBusConnectionInterface::serviceOwnerChanged, this, &ItemRetrievalManager::serviceOwnerChanged);
     connect(this, &ItemRetrievalManager::requestAdded, this, &ItemRetrievalManager::processRequest, Qt::QueuedConnection);
+
+    // Resources may not be running until someone needs them, see AgentManager in akonadicontrol
+    const QSettings settings(StandardDirs::agentsConfigFile(), QSettings::IniFormat);
+    mActivateResources = settings.value(QStringLiteral("OnDemandActivation/Enabled"), false).toBool();
+    if (mActivateResources) {
+        // Kept up to date by serviceOwnerChanged() from now on
+        const QStringList services = conn.interface()->registeredServiceNames();
+        QWriteLocker locker(&mLock);
+        for (const auto &serviceName : services) {
+            if (const auto service = DBus::parseAgentServiceName(serviceName); service.has_value() && service->agentType == DBus::Resource) {
+                mRunningResources.insert(service->identifier);
+            }
+        }
+    }
 }
 
 // called within the retrieval thread
 void ItemRetrievalManager::serviceOwnerChanged(const QString &serviceName, const QString &oldOwner, const QString &newOwner)
 {
-    Q_UNUSED(newOwner)
-    if (oldOwner.isEmpty()) {
-        return;
-    }
     const auto service = DBus::parseAgentServiceName(serviceName);
     if (!service.has_value() || service->agentType != DBus::Resource) {
         return;
     }
-    qCDebug(AKONADISERVER_LOG) << "ItemRetrievalManager lost connection to resource" << serviceName << ", discarding cached interface";
-    mResourceInterfaces.erase(service->identifier);
+
+    if (!oldOwner.isEmpty()) {
+        qCDebug(AKONADISERVER_LOG) << "ItemRetrievalManager lost connection to resource" << serviceName << ", discarding cached interface";
+        mResourceInterfaces.erase(service->identifier);
+        if (newOwner.isEmpty()) {
+            QWriteLocker locker(&mLock);
+            mRunningResources.remove(service->identifier);
+        }
+    }
+
+    if (!newOwner.isEmpty()) {
+        QWriteLocker locker(&mLock);
+        mRunningResources.insert(service->identifier);
+        if (mActivatingResources.remove(service->identifier)) {
+            qCDebug(AKONADISERVER_LOG) << "Resource" << service->identifier << "started, processing its pending requests";
+            locker.unlock();
+            Q_EMIT requestAdded();
+        }
+    }
 }
 
 // called within the retrieval thread
@@ -93,11 +147,118 @@ org::freedesktop::Akonadi::Resource *ItemRetrievalManager::resourceInterface(con
         return nullptr;
     }
     // DBus calls can take some time to reply -- e.g. if a huge local mbox has to be parsed first.
-    iface->setTimeout(5 * 60 * 1000); // 5 minutes, rather than 25 seconds
+    iface->setTimeout(std::chrono::milliseconds(ItemRetrievalJob::RetrievalTimeout).count()); // rather than 25 seconds
     std::tie(ifaceIt, std::ignore) = mResourceInterfaces.emplace(id, std::move(iface));
     return ifaceIt->second.get();
 }
 
+// called within the retrieval thread
+Connection *ItemRetrievalManager::retrievalChannel(const QString &id)
+{
+    QReadLocker locker(&mLock);
+    return mRetrievalChannels.value(id);
+}
+
+// called from any thread
+void ItemRetrievalManager::registerRetrievalChannel(const QString &resourceId, Connection *connection)
+{
+    qCDebug(AKONADISERVER_LOG) << "Resource" << resourceId << "opened a retrieval channel on connection" << connection;
+    QWriteLocker locker(&mLock);
+    if (mRetrievalChannels.key(connection).isEmpty()) {
+        // Direct connections, so that the channel is removed before the connection
+        // is deleted, rather than when the retrieval thread gets to it
+        const auto unregister = [this, connection]() {
+            unregisterRetrievalChannel(connection);
+        };
+        connect(connection, &Connection::disconnected, this, unregister, Qt::DirectConnection);
+        connect(connection, &QObject::destroyed, this, unregister, Qt::DirectConnection);
+    }
+    mRetrievalChannels.insert(resourceId, connection);
+    if (mActivatingResources.remove(resourceId)) {
+        locker.unlock();
+        Q_EMIT requestAdded();
+    }
+}
+
+// called from the thread of the connection, or from the thread deleting it
+void ItemRetrievalManager::unregisterRetrievalChannel(Connection *connection)
+{
+    QWriteLocker locker(&mLock);
+    mRetrievalChannels.removeIf([connection](const auto &it) {
+        return it.value() == connection;
+    });
+}
+
+// called from any thread, with mLock held
+bool ItemRetrievalManager::isResourceRunningLocked(const QString &id) const
+{
+    return mRunningResources.contains(id) || mRetrievalChannels.contains(id);
+}
+
+// called within the retrieval thread, with mLock held
+bool ItemRetrievalManager::waitForResourceLocked(const QString &id, QStringList &resourcesToActivate)
+{
+    if (!mActivateResources || isResourceRunningLocked(id)) {
+        mActivatingResources.remove(id);
+        return false;
+    }
+
+    const auto it = mActivatingResources.find(id);
+    if (it == mActivatingResources.end()) {
+        mActivatingResources.insert(id, QDeadlineTimer(mResourceActivationTimeout));
+        resourcesToActivate.push_back(id);
+        return true;
+    }
+    if (!it->hasExpired()) {
+        return true;
+    }
+
+    // Let the retrieval fail, the next request tries to start the resource again
+    mActivatingResources.erase(it);
+    return false;
+}
+
+// called within the retrieval thread
+void ItemRetrievalManager::activateResource(const QString &id)
+{
+    // Resources that are started on demand by the Akonadi control are not running
+    // until someone needs them, so let the requests wait for the resource to start.
+    ResourceManager::activateResourceInstance(id, this, [this, id](ResourceManager::ActivationResult result) {
+        resourceActivationFinished(id, result);
+    });
+}
+
+// called within the retrieval thread
+void ItemRetrievalManager::resourceActivationFinished(const QString &id, ResourceManager::ActivationResult result)
+{
+    if (result == ResourceManager::ActivationResult::OnDemand) {
+        QTimer::singleShot(mResourceActivationTimeout, this, &ItemRetrievalManager::requestAdded);
+        return;
+    }
+
+    QWriteLocker locker(&mLock);
+    if (const auto it = mActivatingResources.find(id); it != mActivatingResources.end()) {
+        // Nothing to wait for, let the retrieval fail
+        *it = QDeadlineTimer(0);
+    }
+    locker.unlock();
+    Q_EMIT requestAdded();
+}
+
+// called from any thread
+void ItemRetrievalManager::retrievalChannelReplied(Connection *connection, qint64 tag, const std::optional<QString> &errorMsg)
+{
+    const QString resourceId = connection->context().resource().name();
+    QTimer::singleShot(0, this, [this, resourceId, tag, errorMsg]() {
+        QReadLocker locker(&mLock);
+        auto job = qobject_cast<ItemRetrievalJob *>(mCurrentJobs.value(resourceId));
+        locker.unlock();
+        if (job) {
+            job->channelReplied(tag, errorMsg);
+        }
+    });
+}
+
 // called from any thread
 void ItemRetrievalManager::requestItemDelivery(ItemRetrievalRequest req)
 {
@@ -110,7 +271,7 @@ void ItemRetrievalManager::requestItemDelivery(ItemRetrievalRequest req)
     Q_EMIT requestAdded();
 }
 
-QList<AbstractItemRetrievalJob *> ItemRetrievalManager::scheduleJobsForIdleResourcesLocked()
+QList<AbstractItemRetrievalJob *> ItemRetrievalManager::scheduleJobsForIdleResourcesLocked(QStringList &resourcesToActivate)
 {
     QList<AbstractItemRetrievalJob *> newJobs;
     for (auto it = mPendingRequests.begin(); it != mPendingRequests.end();) {
@@ -119,14 +280,19 @@ QList<AbstractItemRetrievalJob *> ItemRetrievalManager::scheduleJobsForIdleResou
             continue;
         }
 
-        if (!mCurrentJobs.contains(it->first) || mCurrentJobs.value(it->first) == nullptr) {
+        if ((!mCurrentJobs.contains(it->first) || mCurrentJobs.value(it->first) == nullptr) && !waitForResourceLocked(it->first, resourcesToActivate)) {
             // TODO: check if there is another one for the same uid with more parts requested
             auto req = std::move(it->second.front());
             it->second.pop_front();
             Q_ASSERT(req.resourceId == it->first);
-            auto job = mJobFactory->retrievalJob(std::move(req), this);
+            std::list<ItemRetrievalRequest> coalesced;
+            auto job = mJobFactory->retrievalJob(coalesceRequestsLocked(std::move(req), it->second, coalesced), this);
             connect(job, &AbstractItemRetrievalJob::requestCompleted, this, &ItemRetrievalManager::retrievalJobFinished);
             mCurrentJobs.insert(job->request().resourceId, job);
+            if (!coalesced.empty()) {
+                qCDebug(AKONADISERVER_LOG) << "ItemRetrievalJob" << job << "serves" << coalesced.size() << "coalesced requests";
+                mCoalescedRequests.insert(job, std::move(coalesced));
+            }
             // delay job execution until after we unlocked the mutex, since the job can emit the finished signal immediately in some cases
             newJobs.append(job);
             qCDebug(AKONADISERVER_LOG) << "ItemRetrievalJob" << job << "started for request" << job->request().id;
@@ -137,39 +303,67 @@ QList<AbstractItemRetrievalJob *> ItemRetrievalManager::scheduleJobsForIdleResou
     return newJobs;
 }
 
+ItemRetrievalRequest
+ItemRetrievalManager::coalesceRequestsLocked(ItemRetrievalRequest request, std::list<ItemRetrievalRequest> &queue, std::list<ItemRetrievalRequest> &coalesced)
+{
+    // Requests for the same collection that queued up while the resource was busy
+    // are sent to the resource as a single request, so that resources can retrieve
+    // all the items at once.
+    QList<qint64> ids;
+    for (auto it = queue.begin(); it != queue.end();) {
+        if (!canCoalesce(request, *it) || request.ids.size() + ids.size() + it->ids.size() > MaxCoalescedItems) {
+            ++it;
+            continue;
+        }
+        for (const auto id : std::as_const(it->ids)) {
+            if (!request.ids.contains(id) && !ids.contains(id)) {
+                ids.push_back(id);
+            }
+        }
+        coalesced.splice(coalesced.end(), queue, it++);
+    }
+
+    if (coalesced.empty()) {
+        return request;
+    }
+
+    ItemRetrievalRequest combined;
+    combined.ids = request.ids + ids;
+    combined.resourceId = request.resourceId;
+    combined.parts = request.parts;
+    combined.collectionId = request.collectionId;
+    coalesced.push_front(std::move(request));
+    return combined;
+}
+
 // called within the retrieval thread
 void ItemRetrievalManager::processRequest()
 {
     QWriteLocker locker(&mLock);
     // look for idle resources
-    auto newJobs = scheduleJobsForIdleResourcesLocked();
+    QStringList resourcesToActivate;
+    auto newJobs = scheduleJobsForIdleResourcesLocked(resourcesToActivate);
     // someone asked as to process requests although everything is done already, he might still be waiting
     if (mPendingRequests.empty() && mCurrentJobs.isEmpty() && newJobs.isEmpty()) {
         return;
     }
     locker.unlock();
 
+    for (const auto &resource : std::as_const(resourcesToActivate)) {
+        activateResource(resource);
+    }
+
     // Start the jobs
     for (auto job : newJobs) {
         if (auto j = qobject_cast<ItemRetrievalJob *>(job)) {
+            // The interface is the fallback for when the channel goes away before the job starts
+            j->setChannel(retrievalChannel(j->request().resourceId));
             j->setInterface(resourceInterface(j->request().resourceId));
         }
         job->start();
     }
 }
 
-namespace
-{
-bool isSubsetOf(const QByteArrayList &superset, const QByteArrayList &subset)
-{
-    // For very small lists like these, this is faster than copy, sort and std::include
-    return std::all_of(subset.cbegin(), subset.cend(), [&superset](const auto &val) {
-        return superset.contains(val);
-    });
-}
-
-}
-
 void ItemRetrievalManager::retrievalJobFinished(AbstractItemRetrievalJob *job)
 {
     const auto &request = job->request();
@@ -184,6 +378,7 @@ void ItemRetrievalManager::retrievalJobFinished(AbstractItemRetrievalJob *job)
     QWriteLocker locker(&mLock);
     Q_ASSERT(mCurrentJobs.contains(request.resourceId));
     mCurrentJobs.remove(request.resourceId);
+    const auto coalesced = mCoalescedRequests.take(job);
     // Check if there are any pending requests that are satisfied by this retrieval job
     auto &requests = mPendingRequests[request.resourceId];
     for (auto it = requests.begin(); it != requests.end();) {
@@ -200,7 +395,16 @@ void ItemRetrievalManager::retrievalJobFinished(AbstractItemRetrievalJob *job)
     }
     locker.unlock();
 
-    Q_EMIT requestFinished(result);
+    if (coalesced.empty()) {
+        Q_EMIT requestFinished(result);
+    } else {
+        // Each of the original requests is finished individually, with its own list of items
+        for (const auto &original : coalesced) {
+            ItemRetrievalResult originalResult{original};
+            originalResult.errorMsg = result.errorMsg;
+            Q_EMIT requestFinished(originalResult);
+        }
+    }
     Q_EMIT requestAdded(); // trigger processRequest() again, in case there is more in the queues
 }
 
@@ -208,7 +412,14 @@ void ItemRetrievalManager::retrievalJobFinished(AbstractItemRetrievalJob *job)
 void ItemRetrievalManager::triggerCollectionSync(const QString &resource, qint64 colId)
 {
     QTimer::singleShot(0, this, [this, resource, colId]() {
-        if (auto interface = resourceInterface(resource)) {
+        QReadLocker locker(&mLock);
+        const bool running = !mActivateResources || isResourceRunningLocked(resource);
+        locker.unlock();
+        if (!running) {
+            // Let the Akonadi control start the resource if it's started on demand
+            OrgFreedesktopAkonadiAgentManagerInterface iface(DBus::serviceName(DBus::Control), QStringLiteral("/AgentManager"), QDBusConnection::sessionBus());
+            iface.agentInstanceSynchronizeCollection(resource, colId, false);
+        } else if (auto interface = resourceInterface(resource)) {
             interface->synchronizeCollection(colId);
         }
     });
@@ -217,7 +428,13 @@ void ItemRetrievalManager::triggerCollectionSync(const QString &resource, qint64
 void ItemRetrievalManager::triggerCollectionTreeSync(const QString &resource)
 {
     QTimer::singleShot(0, this, [this, resource]() {
-        if (auto interface = resourceInterface(resource)) {
+        QReadLocker locker(&mLock);
+        const bool running = !mActivateResources || isResourceRunningLocked(resource);
+        locker.unlock();
+        if (!running) {
+            OrgFreedesktopAkonadiAgentManagerInterface iface(DBus::serviceName(DBus::Control), QStringLiteral("/AgentManager"), QDBusConnection::sessionBus());
+            iface.agentInstanceSynchronizeCollectionTree(resource);
+        } else if (auto interface = resourceInterface(resource)) {
             interface->synchronizeCollectionTree();
         }
     });
@@ -9,12 +9,16 @@
 #include "akthread.h"
 #include "itemretrievalrequest.h"
 #include "itemretriever.h"
+#include "resourcemanager.h"
 
+#include <QDeadlineTimer>
 #include <QHash>
 class QObject;
 #include <QReadWriteLock>
+#include <QSet>
 #include <QWaitCondition>
 
+#include <chrono>
 #include <unordered_map>
 
 class OrgFreedesktopAkonadiResourceInterface;
@@ -24,6 +28,7 @@ namespace Akonadi
 namespace Server
 {
 class Collection;
+class Connection;
 class ItemRetrievalJob;
 class AbstractItemRetrievalJob;
 
@@ -61,6 +66,26 @@ public:
      */
     virtual void requestItemDelivery(ItemRetrievalRequest request);
 
+    /**
+     * Makes @p connection the retrieval channel of resource @p resourceId.
+     * Retrieval requests for the resource are then sent over the connection
+     * instead of D-Bus, until the connection is closed.
+     *
+     * Can be called from any thread.
+     */
+    void registerRetrievalChannel(const QString &resourceId, Connection *connection);
+
+    /**
+     * Called when the resource answered the retrieval request sent with @p tag
+     * over its retrieval channel @p connection.
+     *
+     * Can be called from any thread.
+     */
+    void retrievalChannelReplied(Connection *connection, qint64 tag, const std::optional<QString> &errorMsg);
+
+    /// How long requests wait for a resource that is started on demand
+    static constexpr std::chrono::seconds ResourceActivationTimeout{60};
+
     void triggerCollectionSync(const QString &resource, qint64 colId);
     void triggerCollectionTreeSync(const QString &resource);
 
@@ -70,7 +95,12 @@ Q_SIGNALS:
 
 private:
     OrgFreedesktopAkonadiResourceInterface *resourceInterface(const QString &id);
-    QList<AbstractItemRetrievalJob *> scheduleJobsForIdleResourcesLocked();
+    Connection *retrievalChannel(const QString &id);
+    void unregisterRetrievalChannel(Connection *connection);
+    QList<AbstractItemRetrievalJob *> scheduleJobsForIdleResourcesLocked(QStringList &resourcesToActivate);
+    bool isResourceRunningLocked(const QString &id) const;
+    bool waitForResourceLocked(const QString &id, QStringList &resourcesToActivate);
+    ItemRetrievalRequest coalesceRequestsLocked(ItemRetrievalRequest request, std::list<ItemRetrievalRequest> &queue, std::list<ItemRetrievalRequest> &coalesced);
 
 private Q_SLOTS:
     void init() override;
@@ -80,6 +110,13 @@ private Q_SLOTS:
     void retrievalJobFinished(Akonadi::Server::AbstractItemRetrievalJob *job);
 
 protected:
+    /**
+     * Asks the Akonadi control to start resource @p id, and calls
+     * resourceActivationFinished() with its answer.
+     */
+    virtual void activateResource(const QString &id);
+    void resourceActivationFinished(const QString &id, ResourceManager::ActivationResult result);
+
     std::unique_ptr<AbstractItemRetrievalJobFactory> mJobFactory;
 
     /// Protects mPendingRequests and every Request object posted to it
@@ -91,9 +128,21 @@ protected:
     std::unordered_map<QString, std::list<ItemRetrievalRequest>> mPendingRequests;
     /// Currently running jobs, one per resource
     QHash<QString, AbstractItemRetrievalJob *> mCurrentJobs;
+    /// Original requests served by a running job that retrieves several of them at once
+    QHash<AbstractItemRetrievalJob *, std::list<ItemRetrievalRequest>> mCoalescedRequests;
 
     // resource dbus interface cache
     std::unordered_map<QString, std::unique_ptr<OrgFreedesktopAkonadiResourceInterface>> mResourceInterfaces;
+    /// Retrieval channels opened by resources, protected by mLock. A channel is
+    /// removed when its connection goes away, see unregisterRetrievalChannel()
+    QHash<QString, Connection *> mRetrievalChannels;
+    /// Resources started on demand that requests wait for, protected by mLock
+    QHash<QString, QDeadlineTimer> mActivatingResources;
+    /// Resources whose D-Bus service is registered, protected by mLock
+    QSet<QString> mRunningResources;
+    /// Whether resources that are not running are started on demand
+    bool mActivateResources = false;
+    std::chrono::milliseconds mResourceActivationTimeout = ResourceActivationTimeout;
 };
 
 } // namespace Server
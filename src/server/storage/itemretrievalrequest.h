@@ -50,6 +50,7 @@ public:
     QList<qint64> ids;
     QString resourceId;
     QByteArrayList parts; // list instead of vector to simplify client-side handling
+    qint64 collectionId = -1; // collection all items belong to, -1 if unknown
 
 private:
     static Id lastId;
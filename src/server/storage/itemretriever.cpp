@@ -300,6 +300,7 @@ std::optional<ItemRetriever::PreparedRequests> ItemRetriever::prepareRequests(QS
                 }
                 lastRequest->resourceId = *resIter;
                 lastRequest->parts = parts;
+                lastRequest->collectionId = collectionId;
                 colRequests.insert(collectionId, lastRequest);
                 itemRequests.insert(pimItemId, lastRequest);
             } else {
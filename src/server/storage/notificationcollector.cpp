@@ -26,6 +26,8 @@
 
 #include <QScopedValueRollback>
 
+#include <utility>
+
 using namespace Akonadi;
 using namespace Akonadi::Server;
 using namespace AkRanges;
@@ -36,6 +38,7 @@ NotificationCollector::NotificationCollector(AkonadiServer &akonadi, DataStore *
 {
     QObject::connect(db, &DataStore::transactionCommitted, db, [this]() {
         if (!mIgnoreTransactions) {
+            dispatchSearchUpdates();
             dispatchNotifications();
         }
     });
@@ -48,14 +51,14 @@ NotificationCollector::NotificationCollector(AkonadiServer &akonadi, DataStore *
 
 void NotificationCollector::itemAdded(const PimItem &item, bool seen, const Collection &collection, const QByteArray &resource)
 {
-    mAkonadi.searchManager().scheduleSearchUpdate();
+    scheduleSearchUpdate({item.id()}, {collection.isValid() ? collection.id() : item.collectionId()});
     mAkonadi.collectionStatistics().itemAdded(collection, item.size(), seen);
     itemNotification(Protocol::ItemChangeNotification::Add, item, collection, Collection(), resource);
 }
 
 void NotificationCollector::itemChanged(const PimItem &item, const QSet<QByteArray> &changedParts, const Collection &collection, const QByteArray &resource)
 {
-    mAkonadi.searchManager().scheduleSearchUpdate();
+    scheduleSearchUpdate({item.id()}, {collection.isValid() ? collection.id() : item.collectionId()});
     itemNotification(Protocol::ItemChangeNotification::Modify, item, collection, Collection(), resource, changedParts);
 }
 
@@ -95,12 +98,29 @@ void NotificationCollector::itemsMoved(const PimItem::List &items,
                                        const Collection &collectionDest,
                                        const QByteArray &sourceResource)
 {
-    mAkonadi.searchManager().scheduleSearchUpdate();
+    QSet<qint64> movedItems;
+    movedItems.reserve(items.size());
+    for (const auto &item : items) {
+        movedItems.insert(item.id());
+    }
+    if (collectionSrc.isValid()) {
+        scheduleSearchUpdate(movedItems, {collectionSrc.id(), collectionDest.id()});
+    } else {
+        // Items were moved from multiple collections, we don't know which searches may be affected
+        scheduleIndexUpdate(movedItems);
+        scheduleFullSearchUpdate();
+    }
     itemNotification(Protocol::ItemChangeNotification::Move, items, collectionSrc, collectionDest, sourceResource);
 }
 
 void NotificationCollector::itemsRemoved(const PimItem::List &items, const Collection &collection, const QByteArray &resource)
 {
+    QSet<qint64> removedItems;
+    removedItems.reserve(items.size());
+    for (const auto &item : items) {
+        removedItems.insert(item.id());
+    }
+    scheduleIndexUpdate(removedItems);
     itemNotification(Protocol::ItemChangeNotification::Remove, items, collection, Collection(), resource);
 }
 
@@ -197,6 +217,10 @@ void NotificationCollector::tagRemoved(const Tag &tag, const QByteArray &resourc
 void NotificationCollector::clear()
 {
     mNotifications.clear();
+    mSearchUpdateItems.clear();
+    mSearchUpdateCollections.clear();
+    mIndexUpdateItems.clear();
+    mFullSearchUpdate = false;
 }
 
 void NotificationCollector::setConnection(Connection *connection)
@@ -589,6 +613,49 @@ void NotificationCollector::dispatchNotification(const Protocol::ChangeNotificat
     }
 }
 
+void NotificationCollector::scheduleSearchUpdate(const QSet<qint64> &items, const QSet<qint64> &collections)
+{
+    // Like the notifications, the updates are only scheduled once the changes are committed,
+    // otherwise the searches and the index could see changes which are then rolled back
+    mSearchUpdateItems.unite(items);
+    mSearchUpdateCollections.unite(collections);
+    if (!mDb || !mDb->inTransaction()) {
+        dispatchSearchUpdates();
+    }
+}
+
+void NotificationCollector::scheduleIndexUpdate(const QSet<qint64> &items)
+{
+    mIndexUpdateItems.unite(items);
+    if (!mDb || !mDb->inTransaction()) {
+        dispatchSearchUpdates();
+    }
+}
+
+void NotificationCollector::scheduleFullSearchUpdate()
+{
+    mFullSearchUpdate = true;
+    if (!mDb || !mDb->inTransaction()) {
+        dispatchSearchUpdates();
+    }
+}
+
+void NotificationCollector::dispatchSearchUpdates()
+{
+    auto &searchManager = mAkonadi.searchManager();
+    // scheduleSearchUpdate() updates the index of the items, too
+    mIndexUpdateItems.subtract(mSearchUpdateItems);
+    if (!mIndexUpdateItems.isEmpty()) {
+        searchManager.scheduleIndexUpdate(std::exchange(mIndexUpdateItems, {}));
+    }
+    if (!mSearchUpdateItems.isEmpty() || !mSearchUpdateCollections.isEmpty()) {
+        searchManager.scheduleSearchUpdate(std::exchange(mSearchUpdateItems, {}), std::exchange(mSearchUpdateCollections, {}));
+    }
+    if (std::exchange(mFullSearchUpdate, false)) {
+        searchManager.scheduleSearchUpdate();
+    }
+}
+
 bool NotificationCollector::dispatchNotifications()
 {
     if (!mNotifications.isEmpty()) {
@@ -12,6 +12,7 @@
 
 #include <QByteArray>
 #include <QList>
+#include <QSet>
 #include <QString>
 
 namespace Akonadi
@@ -202,6 +203,10 @@ private:
                          const QByteArray &resource = QByteArray(),
                          const QString &remoteId = QString());
     void dispatchNotification(const Protocol::ChangeNotificationPtr &msg);
+    void scheduleSearchUpdate(const QSet<qint64> &items, const QSet<qint64> &collections);
+    void scheduleIndexUpdate(const QSet<qint64> &items);
+    void scheduleFullSearchUpdate();
+    void dispatchSearchUpdates();
     void clear();
 
     void completeNotification(const Protocol::ChangeNotificationPtr &msg);
@@ -218,6 +223,11 @@ private:
     bool mIgnoreTransactions = false;
 
     Protocol::ChangeNotificationList mNotifications;
+    // Search and index updates held back until the transaction is committed
+    QSet<qint64> mSearchUpdateItems;
+    QSet<qint64> mSearchUpdateCollections;
+    QSet<qint64> mIndexUpdateItems;
+    bool mFullSearchUpdate = false;
 };
 
 } // namespace Server
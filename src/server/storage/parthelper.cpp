@@ -11,42 +11,94 @@
 #include "selectquerybuilder.h"
 
 #include "private/externalpartstorage_p.h"
+#include "private/partcompression_p.h"
 
 #include <QFile>
+#include <QSqlError>
 
 #include "akonadiserver_debug.h"
 
 using namespace Akonadi;
 using namespace Akonadi::Server;
 
+namespace
+{
+QByteArray storeExternal(const QByteArray &data)
+{
+    QByteArray name;
+    bool stored = false;
+    if (data.size() <= DbConfig::configuredDatabase()->packThreshold()) {
+        stored = ExternalPartStorage::self()->storePacked(data, name);
+    } else {
+        stored = ExternalPartStorage::self()->storeBlob(data, name);
+    }
+    if (!stored) {
+        throw PartHelperException("Failed to store external payload part");
+    }
+    return name;
+}
+
+// Compressing tiny payloads only adds the frame overhead
+constexpr qsizetype minCompressedSize = 64;
+
+QByteArray compressData(qint64 partTypeId, const QByteArray &data, Part::Compression &compression)
+{
+    compression = Part::Uncompressed;
+    if (data.size() < minCompressedSize || !DbConfig::configuredDatabase()->partCompression()) {
+        return data;
+    }
+
+    const PartType partType = PartType::retrieveById(partTypeId);
+    QByteArray compressed = PartCompression::compress(data, quint32(partType.dictionaryId()));
+    if (compressed.isEmpty() || compressed.size() >= data.size()) {
+        return data;
+    }
+    compression = Part::Zstd;
+    return compressed;
+}
+
+// Compresses the payload of a new part, unless it's been compressed already (e.g. when copied)
+void compressPart(Part &part)
+{
+    if (part.compression() == Part::Uncompressed) {
+        Part::Compression compression;
+        part.setData(compressData(part.partTypeId(), part.data(), compression));
+        part.setCompression(compression);
+    }
+}
+
+// Whether the part references immutable external data already, for example a blob
+// shared with the part it was copied from
+bool isShareable(const Part &part)
+{
+    return part.storage() == Part::External && (ExternalPartStorage::isBlobName(part.data()) || ExternalPartStorage::isPackedName(part.data()));
+}
+
+void releaseFile(const Part &part)
+{
+    if (part.storage() == Part::External) {
+        ExternalPartStorage::self()->releasePartFile(ExternalPartStorage::resolveAbsolutePath(part.data()));
+    }
+}
+} // namespace
+
 void PartHelper::update(Part *part, const QByteArray &data, qint64 dataSize)
 {
     if (!part) {
         throw PartHelperException("Invalid part");
     }
 
-    const bool storeExternal = dataSize > DbConfig::configuredDatabase()->sizeThreshold();
+    const bool external = dataSize > DbConfig::configuredDatabase()->sizeThreshold();
 
-    QByteArray newFile;
-    if (part->storage() == Part::External && storeExternal) {
-        if (!ExternalPartStorage::self()->updatePartFile(data, part->data(), newFile)) {
-            throw PartHelperException(QStringLiteral("Failed to update external payload part"));
-        }
-        part->setData(newFile);
-    } else if (part->storage() != Part::External && storeExternal) {
-        if (!ExternalPartStorage::self()->createPartFile(data, part->id(), newFile)) {
-            throw PartHelperException(QStringLiteral("Failed to create external payload part"));
-        }
-        part->setData(newFile);
-        part->setStorage(Part::External);
-    } else {
-        if (part->storage() == Part::External && !storeExternal) {
-            const QString file = ExternalPartStorage::resolveAbsolutePath(part->data());
-            ExternalPartStorage::self()->removePartFile(file);
-        }
-        part->setData(data);
-        part->setStorage(Part::Internal);
-    }
+    Part::Compression compression;
+    const QByteArray storedData = compressData(part->partTypeId(), data, compression);
+
+    // Blobs and packed payloads are immutable, changing the payload means referencing another one
+    const QByteArray newData = external ? storeExternal(storedData) : storedData;
+    releaseFile(*part);
+    part->setData(newData);
+    part->setStorage(external ? Part::External : Part::Internal);
+    part->setCompression(compression);
 
     part->setDatasize(dataSize);
     const bool result = part->update();
@@ -61,30 +113,103 @@ bool PartHelper::insert(Part *part, qint64 *insertId)
         return false;
     }
 
-    const bool storeInFile = part->datasize() > DbConfig::configuredDatabase()->sizeThreshold();
-    // it is needed to insert first the metadata so a new id is generated for the part,
-    // and we need this id for the payload file name
-    QByteArray data;
-    if (storeInFile) {
-        data = part->data();
-        part->setData(QByteArray());
-        part->setStorage(Part::External);
-    } else {
-        part->setStorage(Part::Internal);
+    if (!isShareable(*part)) {
+        compressPart(*part);
+        if (part->datasize() > DbConfig::configuredDatabase()->sizeThreshold()) {
+            part->setData(storeExternal(part->data()));
+            part->setStorage(Part::External);
+        } else {
+            part->setStorage(Part::Internal);
+        }
+    }
+
+    return part->insert(insertId);
+}
+
+bool PartHelper::insert(QList<Part> &parts)
+{
+    if (parts.size() <= 1) {
+        return parts.isEmpty() || insert(&parts.first());
+    }
+
+    const qint64 sizeThreshold = DbConfig::configuredDatabase()->sizeThreshold();
+    QList<qint64> pimItemIds;
+    QList<qint64> partTypeIds;
+    QList<QByteArray> data;
+    QList<qint64> dataSizes;
+    QList<int> versions;
+    QList<int> storages;
+    QList<int> compressions;
+    for (Part &part : parts) {
+        if (!isShareable(part)) {
+            compressPart(part);
+            if (part.datasize() > sizeThreshold) {
+                part.setData(storeExternal(part.data()));
+                part.setStorage(Part::External);
+            } else {
+                part.setStorage(Part::Internal);
+            }
+        }
+        pimItemIds.push_back(part.pimItemId());
+        partTypeIds.push_back(part.partTypeId());
+        data.push_back(part.data());
+        dataSizes.push_back(part.datasize());
+        versions.push_back(part.version());
+        storages.push_back(static_cast<int>(part.storage()));
+        compressions.push_back(static_cast<int>(part.compression()));
     }
 
-    bool result = part->insert(insertId);
+    constexpr qsizetype chunkSize = QueryBuilder::maxInsertRows(7);
+    for (qsizetype offset = 0; offset < parts.size(); offset += chunkSize) {
+        QueryBuilder qb(Part::tableName(), QueryBuilder::Insert);
+        if (!qb.canRetrieveInsertIds()) {
+            // The IDs of a multi-row INSERT can't be told, insert the parts one by one
+            for (auto part = parts.begin() + offset, end = parts.end(); part != end; ++part) {
+                if (!part->insert()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        qb.setColumnValues(Part::pimItemIdColumn(), pimItemIds.mid(offset, chunkSize));
+        qb.setColumnValues(Part::partTypeIdColumn(), partTypeIds.mid(offset, chunkSize));
+        qb.setColumnValues(Part::dataColumn(), data.mid(offset, chunkSize));
+        qb.setColumnValues(Part::datasizeColumn(), dataSizes.mid(offset, chunkSize));
+        qb.setColumnValues(Part::versionColumn(), versions.mid(offset, chunkSize));
+        qb.setColumnValues(Part::storageColumn(), storages.mid(offset, chunkSize));
+        qb.setColumnValues(Part::compressionColumn(), compressions.mid(offset, chunkSize));
+        if (!qb.exec()) {
+            qCWarning(AKONADISERVER_LOG) << "Failed to insert parts into table" << Part::tableName() << qb.query().lastError().text();
+            return false;
+        }
 
-    if (storeInFile && result) {
-        QByteArray filename;
-        if (!ExternalPartStorage::self()->createPartFile(data, part->id(), filename)) {
-            throw PartHelperException("Failed to create external payload part");
+        const auto ids = qb.insertIds();
+        const auto rows = std::min(chunkSize, parts.size() - offset);
+        if (ids.size() != rows) {
+            qCWarning(AKONADISERVER_LOG) << "Failed to retrieve IDs of inserted parts, expected" << rows << "got" << ids.size();
+            return false;
         }
-        part->setData(filename);
-        result = part->update();
+        for (qsizetype i = 0; i < rows; ++i) {
+            parts[offset + i].setId(ids.at(i));
+        }
+    }
+
+    return true;
+}
+
+bool PartHelper::share(Part &part)
+{
+    if (part.storage() != Part::External || isShareable(part)) {
+        return true;
     }
 
-    return result;
+    QByteArray blobName;
+    if (!ExternalPartStorage::self()->adoptPartFile(part.data(), blobName)) {
+        throw PartHelperException("Failed to convert external payload part to a blob");
+    }
+    part.setData(blobName);
+    return part.update();
 }
 
 bool PartHelper::remove(Part *part)
@@ -93,9 +218,7 @@ bool PartHelper::remove(Part *part)
         return false;
     }
 
-    if (part->storage() == Part::External) {
-        ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath(part->data()));
-    }
+    releaseFile(*part);
     return part->remove();
 }
 
@@ -114,21 +237,31 @@ bool PartHelper::remove(const QString &column, const QVariant &value)
     Part::List::ConstIterator it = parts.constBegin();
     Part::List::ConstIterator end = parts.constEnd();
     for (; it != end; ++it) {
-        ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath((*it).data()));
+        releaseFile(*it);
     }
     return Part::remove(column, value);
 }
 
-QByteArray PartHelper::translateData(const QByteArray &data, Part::Storage storage)
+QByteArray PartHelper::translateData(const QByteArray &data, Part::Storage storage, Part::Compression compression)
 {
-    if (storage == Part::External || storage == Part::Foreign) {
-        QFile file;
-        if (storage == Part::External) {
-            file.setFileName(ExternalPartStorage::resolveAbsolutePath(data));
-        } else {
-            file.setFileName(QString::fromUtf8(data));
+    if (compression == Part::Zstd) {
+        bool ok = false;
+        const QByteArray payload = PartCompression::decompress(translateData(data, storage), &ok);
+        if (!ok) {
+            qCCritical(AKONADISERVER_LOG) << "Compressed payload could not be decompressed!";
         }
+        return payload;
+    }
 
+    if (storage == Part::External) {
+        bool ok = false;
+        const QByteArray payload = ExternalPartStorage::readPartFile(data, &ok);
+        if (!ok) {
+            qCCritical(AKONADISERVER_LOG) << "Payload file " << data << " could not be read!";
+        }
+        return payload;
+    } else if (storage == Part::Foreign) {
+        QFile file(QString::fromUtf8(data));
         if (file.open(QIODevice::ReadOnly)) {
             const QByteArray payload = file.readAll();
             file.close();
@@ -146,18 +279,17 @@ QByteArray PartHelper::translateData(const QByteArray &data, Part::Storage stora
 
 QByteArray PartHelper::translateData(const Part &part)
 {
-    return translateData(part.data(), part.storage());
+    return translateData(part.data(), part.storage(), part.compression());
 }
 
 bool PartHelper::truncate(Part &part)
 {
-    if (part.storage() == Part::External) {
-        ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath(part.data()));
-    }
+    releaseFile(part);
 
     part.setData(QByteArray());
     part.setDatasize(0);
     part.setStorage(Part::Internal);
+    part.setCompression(Part::Uncompressed);
     return part.update();
 }
 
@@ -181,6 +313,7 @@ bool PartHelper::verify(Part &part)
         part.setData(QByteArray());
         part.setDatasize(0);
         part.setStorage(Part::Internal);
+        part.setCompression(Part::Uncompressed);
         return part.update();
     }
 
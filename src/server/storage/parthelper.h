@@ -21,6 +21,12 @@ AKONADI_EXCEPTION_MAKE_INSTANCE(PartHelperException);
 /**
  * Helper methods that store data in a file instead of the database.
  *
+ * Payloads above the size threshold are stored in content-addressed blobs
+ * (see ExternalPartStorage), which are shared by all parts with identical payload.
+ * Payloads up to the pack threshold are appended to pack files instead.
+ * When part compression is enabled, payloads are compressed before they are stored,
+ * see PartCompression.
+ *
  * @author Andras Mantia <amantia@kde.org>
  *
  * @todo Use exceptions for error handling in all these methods. Requires that all callers
@@ -39,17 +45,33 @@ void update(Part *part, const QByteArray &data, qint64 dataSize);
 /**
  * Adds a new part to the database and if necessary to the filesystem.
  * @p part must not be in the database yet (ie. valid() == false) and must have
- * a data size set.
+ * a data size set. Parts that reference a blob or packed payload already are inserted as they are.
+ * @throw PartHelperException if file operations failed
  */
 bool insert(Part *part, qint64 *insertId = nullptr);
 
+/**
+ * Adds all @p parts to the database using multi-row INSERT queries and, where
+ * necessary, stores their payload in the filesystem. The same requirements as
+ * for insert() apply to each part. On success all parts have their ID set.
+ * @throw PartHelperException if file operations failed
+ */
+bool insert(QList<Part> &parts);
+
+/**
+ * Makes sure the external payload of @p part is stored in a blob or a pack, so that other
+ * parts can reference it, converting the part's own payload file if necessary.
+ * @throw PartHelperException if file operations failed
+ */
+bool share(Part &part);
+
 /** Deletes @p part from the database and also removes existing filesystem data if needed. */
 bool remove(Part *part);
 /** Deletes all parts which match the given constraint, including all corresponding filesystem data. */
 bool remove(const QString &column, const QVariant &value);
 
-/** Returns the payload data. */
-QByteArray translateData(const QByteArray &data, Part::Storage storageType);
+/** Returns the payload data, decompressed if necessary. */
+QByteArray translateData(const QByteArray &data, Part::Storage storageType, Part::Compression compression = Part::Uncompressed);
 /** Convenience overload of the above. */
 QByteArray translateData(const Part &part);
 
@@ -79,9 +79,9 @@ void PartStreamer::streamPayload(Part &part, const QByteArray &partName)
 
     if (metaPart.storageType() == Protocol::PartMetaData::Foreign) {
         streamForeignPayload(part, metaPart);
-    } else if (part.datasize() > DbConfig::configuredDatabase()->sizeThreshold()) {
+    } else if (part.datasize() > DbConfig::configuredDatabase()->sizeThreshold() && part.datasize() > DbConfig::configuredDatabase()->packThreshold()) {
         // actual case when streaming storage is used: external payload is enabled,
-        // data is big enough in a literal
+        // data is big enough in a literal and too big to be packed
         streamPayloadToFile(part, metaPart);
     } else {
         streamPayloadData(part, metaPart);
@@ -92,7 +92,7 @@ void PartStreamer::streamPayloadData(Part &part, const Protocol::PartMetaData &m
 {
     // If the part WAS external previously, remove data file
     if (part.storage() == Part::External) {
-        ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath(part.data()));
+        ExternalPartStorage::self()->releasePartFile(ExternalPartStorage::resolveAbsolutePath(part.data()));
     }
 
     // Request the actual data
@@ -118,13 +118,14 @@ void PartStreamer::streamPayloadData(Part &part, const Protocol::PartMetaData &m
 
     if (part.isValid()) {
         if (!mDataChanged) {
-            mDataChanged = mDataChanged || (newData != part.data());
+            // compressed payload has to be decompressed for the comparison
+            mDataChanged = mDataChanged || (newData != (part.compression() == Part::Uncompressed ? part.data() : PartHelper::translateData(part)));
         }
         PartHelper::update(&part, newData, newSize);
     } else {
         part.setData(newData);
         part.setDatasize(newSize);
-        if (!part.insert()) {
+        if (!PartHelper::insert(&part)) {
             throw PartStreamerException("Failed to insert new part into database.");
         }
     }
@@ -142,7 +143,10 @@ void PartStreamer::streamPayloadToFile(Part &part, const Protocol::PartMetaData
         if (part.storage() == Part::External) {
             // Part was external and is still external
             filename = part.data();
-            if (!filename.isEmpty()) {
+            if (ExternalPartStorage::isBlobName(filename) || ExternalPartStorage::isPackedName(filename)) {
+                // The blob or pack may be shared with other parts, stream into a file of our own
+                filename = ExternalPartStorage::nameForPartId(part.id());
+            } else if (!filename.isEmpty()) {
                 ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath(filename));
                 filename = ExternalPartStorage::updateFileNameRevision(filename);
             } else {
@@ -160,7 +164,9 @@ void PartStreamer::streamPayloadToFile(Part &part, const Protocol::PartMetaData
         }
     }
 
+    // The client writes the file directly, so streamed payloads are never compressed
     part.setStorage(Part::External);
+    part.setCompression(Part::Uncompressed);
     part.setDatasize(metaPart.size());
     part.setData(filename);
 
@@ -234,10 +240,11 @@ void PartStreamer::streamForeignPayload(Part &part, const Protocol::PartMetaData
     // If the part was previously external, clean up the data
     if (part.storage() == Part::External) {
         const QString filename = QString::fromUtf8(part.data());
-        ExternalPartStorage::self()->removePartFile(ExternalPartStorage::resolveAbsolutePath(filename));
+        ExternalPartStorage::self()->releasePartFile(ExternalPartStorage::resolveAbsolutePath(filename));
     }
 
     part.setStorage(Part::Foreign);
+    part.setCompression(Part::Uncompressed);
     part.setData(response.data());
 
     if (part.isValid()) {
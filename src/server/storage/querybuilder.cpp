@@ -42,6 +42,25 @@ DataStore *defaultDataStore()
 #endif
 }
 
+#ifndef QUERYBUILDER_UNITTEST
+/// Returns the difference between the IDs MySQL allocates for consecutive rows of a multi-row
+/// INSERT on the connection of @p store, or 0 if the IDs are not guaranteed to be consecutive
+qint64 mysqlAutoIncrementStep(DataStore *store)
+{
+    // Not cached: the session can change auto_increment_increment at any time
+    QSqlQuery query(store->database());
+    if (!query.exec(QStringLiteral("SELECT @@auto_increment_increment, @@innodb_autoinc_lock_mode")) || !query.next()) {
+        qCWarning(AKONADISERVER_LOG) << "Failed to query the auto increment settings:" << query.lastError().text();
+        return 0;
+    }
+    // In the "interleaved" lock mode concurrent INSERTs may take turns allocating IDs
+    if (query.value(1).toInt() == 2) {
+        return 0;
+    }
+    return query.value(0).toLongLong();
+}
+#endif
+
 } // namespace
 
 static QLatin1StringView compareOperatorToString(Query::CompareOperator op)
@@ -172,14 +191,20 @@ QueryBuilder::QueryBuilder(QueryBuilder &&other) noexcept
     , mSortColumns(std::move(other.mSortColumns))
     , mGroupColumns(std::move(other.mGroupColumns))
     , mColumnValues(std::move(other.mColumnValues))
+    , mColumnValueBindIndexes(std::move(other.mColumnValueBindIndexes))
     , mColumnMultiValues(std::move(other.mColumnMultiValues))
     , mIdentificationColumn(std::move(other.mIdentificationColumn))
+    , mConflictHandling(other.mConflictHandling)
+    , mInsertIdStep(other.mInsertIdStep)
+    , mConflictColumns(std::move(other.mConflictColumns))
+    , mConflictUpdateColumns(std::move(other.mConflictUpdateColumns))
     , mJoinedTables(std::move(other.mJoinedTables))
     , mJoins(std::move(other.mJoins))
     , mLimit(other.mLimit)
     , mOffset(other.mOffset)
     , mDistinct(other.mDistinct)
     , mForUpdate(other.mForUpdate)
+    , mStatement(std::move(other.mStatement))
 {
     // a moved-from QSqlQuery has null d-pointer, so calling any method on it results
     // in a crash. As a workaround, we re-initialize the moved-from QSqlQuery to an invalid one.
@@ -202,14 +227,20 @@ QueryBuilder &QueryBuilder::operator=(QueryBuilder &&other) noexcept
         mSortColumns = std::move(other.mSortColumns);
         mGroupColumns = std::move(other.mGroupColumns);
         mColumnValues = std::move(other.mColumnValues);
+        mColumnValueBindIndexes = std::move(other.mColumnValueBindIndexes);
         mColumnMultiValues = std::move(other.mColumnMultiValues);
         mIdentificationColumn = std::move(other.mIdentificationColumn);
+        mConflictHandling = other.mConflictHandling;
+        mInsertIdStep = other.mInsertIdStep;
+        mConflictColumns = std::move(other.mConflictColumns);
+        mConflictUpdateColumns = std::move(other.mConflictUpdateColumns);
         mJoinedTables = std::move(other.mJoinedTables);
         mJoins = std::move(other.mJoins);
         mLimit = other.mLimit;
         mOffset = other.mOffset;
         mDistinct = other.mDistinct;
         mForUpdate = other.mForUpdate;
+        mStatement = std::move(other.mStatement);
 
         other.mQuery = QSqlQuery(); // see the comment in move constructor
     }
@@ -230,11 +261,13 @@ QueryBuilder::~QueryBuilder()
 
 void QueryBuilder::setDatabaseType(DbType::Type type)
 {
+    invalidateStatement();
     mDatabaseType = type;
 }
 
 void QueryBuilder::addJoin(JoinType joinType, const QString &table, const Query::Condition &condition)
 {
+    invalidateStatement();
     Q_ASSERT((joinType == InnerJoin && (mType == Select || mType == Update)) || (joinType == LeftJoin && mType == Select)
              || (joinType == LeftOuterJoin && mType == Select));
 
@@ -257,24 +290,28 @@ void QueryBuilder::addJoin(JoinType joinType, const QString &table, const QStrin
 
 void QueryBuilder::addValueCondition(const QString &column, Query::CompareOperator op, const QVariant &value, ConditionType type)
 {
+    invalidateStatement();
     Q_ASSERT(type == WhereCondition || (type == HavingCondition && mType == Select));
     mRootCondition[type].addValueCondition(column, op, value);
 }
 
 void QueryBuilder::addValueCondition(const QString &column, Query::CompareOperator op, const QList<qint64> &value, ConditionType type)
 {
+    invalidateStatement();
     Q_ASSERT(type == WhereCondition || (type == HavingCondition && mType == Select));
     mRootCondition[type].addValueCondition(column, op, value);
 }
 
 void QueryBuilder::addValueCondition(const QString &column, Query::CompareOperator op, const QSet<qint64> &value, ConditionType type)
 {
+    invalidateStatement();
     Q_ASSERT(type == WhereCondition || (type == HavingCondition && mType == Select));
     mRootCondition[type].addValueCondition(column, op, value);
 }
 
 void QueryBuilder::addColumnCondition(const QString &column, Query::CompareOperator op, const QString &column2, ConditionType type)
 {
+    invalidateStatement();
     Q_ASSERT(type == WhereCondition || (type == HavingCondition && mType == Select));
     mRootCondition[type].addColumnCondition(column, op, column2);
 }
@@ -335,6 +372,7 @@ void QueryBuilder::buildInsertValues(QString *statement)
     if (mColumnMultiValues.empty()) {
         *statement += u'(';
         for (int col = 0, columnCount = mColumnValues.size(); col < columnCount; ++col) {
+            mColumnValueBindIndexes.push_back(mBindValues.size());
             bindValue(statement, mColumnValues.at(col).second);
             if (col + 1 < columnCount) {
                 *statement += u", ";
@@ -342,14 +380,17 @@ void QueryBuilder::buildInsertValues(QString *statement)
         }
         *statement += u')';
     } else {
-        const auto rows = mColumnMultiValues.front().second.toList().size();
+        // Convert each column only once, not once per cell
+        QList<QVariantList> columns;
+        columns.reserve(mColumnMultiValues.size());
+        for (const auto &[_, values] : std::as_const(mColumnMultiValues)) {
+            columns.push_back(values.toList());
+        }
+        const auto rows = columns.front().size();
         for (qsizetype row = 0; row < rows; ++row) {
             *statement += u'(';
-            for (int col = 0, columnCount = mColumnMultiValues.size(); col < columnCount; ++col) {
-                const auto &[_, values] = mColumnMultiValues.at(col);
-                // FIXME: We perform tons of throw-away .toList() conversions here: figure out a better system
-                // to store the multi-values or transpose the data before building the query.
-                bindValue(statement, values.toList().at(row));
+            for (int col = 0, columnCount = columns.size(); col < columnCount; ++col) {
+                bindValue(statement, columns.at(col).at(row));
                 if (col + 1 < columnCount) {
                     *statement += u", ";
                 }
@@ -362,6 +403,59 @@ void QueryBuilder::buildInsertValues(QString *statement)
     }
 }
 
+void QueryBuilder::buildInsertConflictClause(QString *statement)
+{
+    switch (mConflictHandling) {
+    case FailOnConflict:
+        return;
+    case IgnoreOnConflict:
+        // MySQL and SQLite use INSERT IGNORE and INSERT OR IGNORE respectively
+        if (mDatabaseType != DbType::MySQL && mDatabaseType != DbType::Sqlite) {
+            *statement += QLatin1StringView(" ON CONFLICT");
+            if (!mConflictColumns.isEmpty()) {
+                *statement += QLatin1StringView(" (");
+                appendJoined(statement, mConflictColumns);
+                *statement += u')';
+            }
+            *statement += QLatin1StringView(" DO NOTHING");
+        }
+        return;
+    case UpdateOnConflict:
+        if (mDatabaseType == DbType::MySQL) {
+            *statement += QLatin1StringView(" ON DUPLICATE KEY UPDATE ");
+        } else {
+            Q_ASSERT_X(!mConflictColumns.isEmpty(), "QueryBuilder::exec()", "UpdateOnConflict requires conflict columns");
+            *statement += QLatin1StringView(" ON CONFLICT (");
+            appendJoined(statement, mConflictColumns);
+            *statement += QLatin1StringView(") DO UPDATE SET ");
+        }
+        break;
+    }
+
+    QStringList updateColumns = mConflictUpdateColumns;
+    if (updateColumns.isEmpty()) {
+        const auto &vals = mColumnMultiValues.empty() ? mColumnValues : mColumnMultiValues;
+        for (const auto &[column, _] : vals) {
+            if (!mConflictColumns.contains(column)) {
+                updateColumns.push_back(column);
+            }
+        }
+    }
+    Q_ASSERT_X(!updateColumns.isEmpty(), "QueryBuilder::exec()", "UpdateOnConflict has no columns to update");
+    for (qsizetype i = 0; i < updateColumns.size(); ++i) {
+        const auto &column = updateColumns.at(i);
+        *statement += column;
+        if (mDatabaseType == DbType::MySQL) {
+            *statement += QLatin1StringView(" = VALUES(") + column + u')';
+        } else {
+            *statement += QLatin1StringView(" = EXCLUDED.") + column;
+        }
+        if (i + 1 < updateColumns.size()) {
+            *statement += QLatin1StringView(", ");
+        }
+    }
+}
+
 void QueryBuilder::buildQuery(QString *statement)
 {
     // we add the ON conditions of Inner Joins in a Update query here
@@ -400,11 +494,18 @@ void QueryBuilder::buildQuery(QString *statement)
         }
         break;
     case Insert: {
-        *statement += QLatin1StringView("INSERT INTO ");
+        if (mConflictHandling == IgnoreOnConflict && mDatabaseType == DbType::MySQL) {
+            *statement += QLatin1StringView("INSERT IGNORE INTO ");
+        } else if (mConflictHandling == IgnoreOnConflict && mDatabaseType == DbType::Sqlite) {
+            *statement += QLatin1StringView("INSERT OR IGNORE INTO ");
+        } else {
+            *statement += QLatin1StringView("INSERT INTO ");
+        }
         *statement += mTable + u" ";
         buildInsertColumns(statement);
         *statement += u" VALUES ";
         buildInsertValues(statement);
+        buildInsertConflictClause(statement);
         if (mDatabaseType == DbType::PostgreSQL && !mIdentificationColumn.isEmpty()) {
             *statement += QLatin1StringView(" RETURNING ") + mIdentificationColumn;
         }
@@ -438,6 +539,7 @@ void QueryBuilder::buildQuery(QString *statement)
             const auto &[column, value] = mColumnValues.at(i);
             *statement += column;
             *statement += QLatin1StringView(" = ");
+            mColumnValueBindIndexes.push_back(mBindValues.size());
             bindValue(statement, value);
             if (i + 1 < c) {
                 *statement += QLatin1StringView(", ");
@@ -507,13 +609,26 @@ void QueryBuilder::buildQuery(QString *statement)
 
 bool QueryBuilder::exec()
 {
-    QString statement;
-    statement.reserve(1024);
-    buildQuery(&statement);
+    if (mTableSubQuery.has_value()) {
+        // the bound values of the sub-query are inlined into the statement and may have changed
+        invalidateStatement();
+    }
+
+    bool reusePrepared = true;
+    if (mStatement.isEmpty()) {
+        mBindValues.clear();
+        mColumnValueBindIndexes.clear();
+        mStatement.reserve(1024);
+        buildQuery(&mStatement);
+        reusePrepared = false;
+    }
+    const QString &statement = mStatement;
 
 #ifndef QUERYBUILDER_UNITTEST
-    auto query = QueryCache::query(statement);
-    if (query) {
+    if (reusePrepared && mQuery.lastQuery() == statement) {
+        // The statement is still prepared from the previous exec(), only the bindings may have changed
+        mQuery.finish();
+    } else if (auto query = QueryCache::query(statement); query) {
         mQuery = std::move(*query);
     } else {
         mQuery = QSqlQuery(mDataStore->database());
@@ -523,6 +638,7 @@ bool QueryBuilder::exec()
             qCCritical(AKONADISERVER_LOG) << "  DB error: " << mQuery.lastError().databaseText();
             qCCritical(AKONADISERVER_LOG) << "  Error text:" << mQuery.lastError().text();
             qCCritical(AKONADISERVER_LOG) << "  Query:" << statement;
+            invalidateStatement();
             return false;
         }
     }
@@ -611,23 +727,26 @@ bool QueryBuilder::exec()
         return false;
     }
 #else
-    mStatement = statement;
+    Q_UNUSED(reusePrepared);
 #endif
     return true;
 }
 
 void QueryBuilder::addColumns(const QStringList &cols)
 {
+    invalidateStatement();
     mColumns << cols;
 }
 
 void QueryBuilder::addColumn(const QString &col)
 {
+    invalidateStatement();
     mColumns << col;
 }
 
 void QueryBuilder::addColumn(const Query::Case &caseStmt)
 {
+    invalidateStatement();
     QString query;
     buildCaseStatement(&query, caseStmt);
     mColumns.append(query);
@@ -635,11 +754,13 @@ void QueryBuilder::addColumn(const Query::Case &caseStmt)
 
 void QueryBuilder::addAggregation(const QString &col, const QString &aggregate)
 {
+    invalidateStatement();
     mColumns.append(aggregate + QLatin1Char('(') + col + QLatin1Char(')'));
 }
 
 void QueryBuilder::addAggregation(const Query::Case &caseStmt, const QString &aggregate)
 {
+    invalidateStatement();
     QString query(aggregate + QLatin1Char('('));
     buildCaseStatement(&query, caseStmt);
     query += QLatin1Char(')');
@@ -647,13 +768,17 @@ void QueryBuilder::addAggregation(const Query::Case &caseStmt, const QString &ag
     mColumns.append(query);
 }
 
-void QueryBuilder::bindValue(QString *query, const QVariant &value)
+QVariant QueryBuilder::toBindValue(const QVariant &value) const
 {
     if (value.metaType().id() == qMetaTypeId<QDateTime>()) {
-        mBindValues.emplace_back(Utils::dateTimeToVariant(value.toDateTime(), mDataStore));
-    } else {
-        mBindValues.emplace_back(value);
+        return Utils::dateTimeToVariant(value.toDateTime(), mDataStore);
     }
+    return value;
+}
+
+void QueryBuilder::bindValue(QString *query, const QVariant &value)
+{
+    mBindValues.emplace_back(toBindValue(value));
     *query += QLatin1Char(':') + QString::number(mBindValues.count() - 1);
 }
 
@@ -689,8 +814,112 @@ bool isSet(const QVariant &value)
     return isType(value, "QSet<qlonglong>");
 }
 
+bool isIdList(const QVariant &value)
+{
+    return isType(value, "QList<qlonglong>");
+}
+
+/// Rounds the number of ids up to a fixed bucket size, so that lists of similar size share a statement
+qsizetype idListBucketSize(qsizetype count)
+{
+    constexpr qsizetype maxPowerOfTwoBucket = 1024;
+    if (count <= 1) {
+        return count;
+    }
+    if (count > maxPowerOfTwoBucket) {
+        return ((count + maxPowerOfTwoBucket - 1) / maxPowerOfTwoBucket) * maxPowerOfTwoBucket;
+    }
+    qsizetype bucket = 1;
+    while (bucket < count) {
+        bucket *= 2;
+    }
+    return bucket;
+}
+
+template<typename Container>
+QString toArrayLiteral(const Container &ids, QChar open, QChar close)
+{
+    QString literal;
+    literal.reserve(2 + ids.size() * 8);
+    literal += open;
+    bool first = true;
+    for (const qint64 id : ids) {
+        if (!first) {
+            literal += u',';
+        }
+        first = false;
+        literal += QString::number(id);
+    }
+    literal += close;
+    return literal;
+}
+
 } // namespace
 
+template<typename Container>
+void QueryBuilder::buildWhereInIdsCondition(QString *query, const Query::Condition &cond, const Container &ids)
+{
+    // Binding each id as its own placeholder makes the statement text depend on the number of
+    // ids, so every batch would need to be prepared anew. Where the backend allows it, bind the
+    // whole list as a single array value instead, otherwise pad the list to a bucket size.
+    Q_ASSERT(cond.mCompareOp == Query::In || cond.mCompareOp == Query::NotIn);
+    const bool in = cond.mCompareOp == Query::In;
+    switch (mDatabaseType) {
+    case DbType::PostgreSQL:
+        *query += cond.mColumn;
+        *query += in ? QLatin1StringView(" = ANY( CAST( ") : QLatin1StringView(" <> ALL( CAST( ");
+        bindValue(query, toArrayLiteral(ids, u'{', u'}'));
+        *query += u" AS BIGINT[] ) )";
+        return;
+    case DbType::Sqlite:
+        *query += cond.mColumn;
+        *query += compareOperatorToString(cond.mCompareOp);
+        *query += u"( SELECT value FROM json_each( ";
+        bindValue(query, toArrayLiteral(ids, u'[', u']'));
+        *query += u" ) )";
+        return;
+    case DbType::MySQL:
+        if (!ids.empty()) {
+            *query += cond.mColumn;
+            *query += compareOperatorToString(cond.mCompareOp);
+            *query += u"( ";
+            qint64 last = 0;
+            qsizetype i = 0;
+            for (const qint64 id : ids) {
+                if (i++ > 0) {
+                    *query += QLatin1StringView(", ");
+                }
+                bindValue(query, id);
+                last = id;
+            }
+            // Repeating an id does not change the result of IN or NOT IN
+            for (const auto bucket = idListBucketSize(ids.size()); i < bucket; ++i) {
+                *query += QLatin1StringView(", ");
+                bindValue(query, last);
+            }
+            *query += u" )";
+            return;
+        }
+        break;
+    case DbType::Unknown:
+        break;
+    }
+
+    *query += cond.mColumn;
+    *query += compareOperatorToString(cond.mCompareOp);
+    *query += u"( ";
+    if (ids.empty()) {
+        qCWarning(AKONADISERVER_LOG) << "Empty list given for IN condition.";
+    }
+    for (const auto &[i, id] : ids | Views::enumerate()) {
+        if (i > 0) {
+            *query += QLatin1StringView(", ");
+        }
+        bindValue(query, id);
+    }
+    *query += u" )";
+}
+
 void QueryBuilder::buildWhereCondition(QString *query, const Query::Condition &cond)
 {
     constexpr auto buildWhereInContainerCondition = [](QueryBuilder *self, QString *query, const auto &values) {
@@ -718,6 +947,10 @@ void QueryBuilder::buildWhereCondition(QString *query, const Query::Condition &c
             }
         }
         *query += QLatin1StringView(" )");
+    } else if (cond.mComparedColumn.isEmpty() && (cond.mCompareOp == Query::In || cond.mCompareOp == Query::NotIn) && isIdList(cond.mComparedValue)) {
+        buildWhereInIdsCondition(query, cond, cond.mComparedValue.value<QList<qint64>>());
+    } else if (cond.mComparedColumn.isEmpty() && (cond.mCompareOp == Query::In || cond.mCompareOp == Query::NotIn) && isSet(cond.mComparedValue)) {
+        buildWhereInIdsCondition(query, cond, cond.mComparedValue.value<QSet<qint64>>());
     } else {
         *query += cond.mColumn;
         *query += compareOperatorToString(cond.mCompareOp);
@@ -753,41 +986,65 @@ void QueryBuilder::buildCaseStatement(QString *query, const Query::Case &caseStm
 
 void QueryBuilder::setSubQueryMode(Query::LogicOperator op, ConditionType type)
 {
+    invalidateStatement();
     Q_ASSERT(type == WhereCondition || (type == HavingCondition && mType == Select));
     mRootCondition[type].setSubQueryMode(op);
 }
 
 void QueryBuilder::addCondition(const Query::Condition &condition, ConditionType type)
 {
+    invalidateStatement();
     Q_ASSERT(type == WhereCondition || (type == HavingCondition && mType == Select));
     mRootCondition[type].addCondition(condition);
 }
 
 void QueryBuilder::addSortColumn(const QString &column, Query::SortOrder order)
 {
+    invalidateStatement();
     mSortColumns << qMakePair(column, order);
 }
 
 void QueryBuilder::addGroupColumn(const QString &column)
 {
+    invalidateStatement();
     Q_ASSERT(mType == Select);
     mGroupColumns << column;
 }
 
 void QueryBuilder::addGroupColumns(const QStringList &columns)
 {
+    invalidateStatement();
     Q_ASSERT(mType == Select);
     mGroupColumns += columns;
 }
 
 void QueryBuilder::setColumnValue(const QString &column, const QVariant &value)
 {
-    mColumnMultiValues.clear();
-    mColumnValues.push_back(qMakePair(column, value));
+    if (!mColumnMultiValues.empty()) {
+        invalidateStatement();
+        mColumnMultiValues.clear();
+    }
+
+    const auto it = std::find_if(mColumnValues.begin(), mColumnValues.end(), [&column](const auto &columnValue) {
+        return columnValue.first == column;
+    });
+    if (it == mColumnValues.end()) {
+        invalidateStatement();
+        mColumnValues.push_back(qMakePair(column, value));
+        return;
+    }
+
+    // Same shape, only the value changes: keep the compiled statement and just rebind
+    it->second = value;
+    if (!mStatement.isEmpty()) {
+        const auto bindIndex = mColumnValueBindIndexes.at(std::distance(mColumnValues.begin(), it));
+        mBindValues[bindIndex] = toBindValue(value);
+    }
 }
 
 void QueryBuilder::setColumnValues(const QString &column, const QVariant &values)
 {
+    invalidateStatement();
     Q_ASSERT(mType == Insert);
 
     mColumnValues.clear();
@@ -796,17 +1053,20 @@ void QueryBuilder::setColumnValues(const QString &column, const QVariant &values
 
 void QueryBuilder::setDistinct(bool distinct)
 {
+    invalidateStatement();
     mDistinct = distinct;
 }
 
 void QueryBuilder::setLimit(int limit, int offset)
 {
+    invalidateStatement();
     mLimit = limit;
     mOffset = offset;
 }
 
 void QueryBuilder::setIdentificationColumn(const QString &column)
 {
+    invalidateStatement();
     mIdentificationColumn = column;
 }
 
@@ -833,8 +1093,93 @@ qint64 QueryBuilder::insertId()
     return -1;
 }
 
+QList<qint64> QueryBuilder::insertIds()
+{
+    QList<qint64> ids;
+    if (mIdentificationColumn.isEmpty()) {
+        return ids;
+    }
+
+    if (mDatabaseType == DbType::PostgreSQL) {
+        // RETURNING gives us exactly the rows that were inserted
+        while (query().next()) {
+            ids.push_back(query().record().value(mIdentificationColumn).toLongLong());
+        }
+        return ids;
+    }
+
+    // With conflict handling some rows may have been skipped, so we can't tell which IDs were used
+    if (mConflictHandling != FailOnConflict) {
+        return ids;
+    }
+
+    const QVariant v = query().lastInsertId();
+    bool ok = false;
+    const qint64 lastInsertId = v.toLongLong(&ok);
+    if (!v.isValid() || !ok) {
+        return ids;
+    }
+
+    // A single multi-row INSERT with a known number of rows allocates its IDs in one go.
+    // MySQL reports the ID of the first inserted row and steps by auto_increment_increment,
+    // which is not 1 in replicated setups. SQLite reports the ID of the last row.
+    const qsizetype rows = insertRowCount();
+    const qint64 step = rows > 1 ? insertIdStep() : 1;
+    if (step <= 0) {
+        return ids;
+    }
+    const qint64 firstId = mDatabaseType == DbType::MySQL ? lastInsertId : lastInsertId - rows + 1;
+    ids.reserve(rows);
+    for (qsizetype i = 0; i < rows; ++i) {
+        ids.push_back(firstId + i * step);
+    }
+    return ids;
+}
+
+bool QueryBuilder::canRetrieveInsertIds()
+{
+    if (mIdentificationColumn.isEmpty()) {
+        return false;
+    }
+    if (mDatabaseType == DbType::PostgreSQL) {
+        return true;
+    }
+    return mConflictHandling == FailOnConflict && insertIdStep() > 0;
+}
+
+qint64 QueryBuilder::insertIdStep()
+{
+#ifndef QUERYBUILDER_UNITTEST
+    if (mDatabaseType == DbType::MySQL) {
+        if (!mInsertIdStep.has_value()) {
+            mInsertIdStep = mysqlAutoIncrementStep(mDataStore);
+        }
+        return *mInsertIdStep;
+    }
+#endif
+    return 1;
+}
+
+qsizetype QueryBuilder::insertRowCount() const
+{
+    if (mColumnMultiValues.empty()) {
+        return mColumnValues.empty() ? 0 : 1;
+    }
+    return mColumnMultiValues.front().second.toList().size();
+}
+
+void QueryBuilder::setConflictHandling(ConflictHandling handling, const QStringList &conflictColumns, const QStringList &updateColumns)
+{
+    Q_ASSERT(mType == Insert);
+    invalidateStatement();
+    mConflictHandling = handling;
+    mConflictColumns = conflictColumns;
+    mConflictUpdateColumns = updateColumns;
+}
+
 void QueryBuilder::setForUpdate(bool forUpdate)
 {
+    invalidateStatement();
     mForUpdate = forUpdate;
 }
 
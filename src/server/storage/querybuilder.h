@@ -68,6 +68,33 @@ public:
         NUM_CONDITIONS
     };
 
+    /**
+     * Defines how an INSERT query handles rows that violate a unique constraint.
+     */
+    enum ConflictHandling {
+        /// the whole query fails (default)
+        FailOnConflict,
+        /// conflicting rows are skipped (INSERT IGNORE, INSERT OR IGNORE, ON CONFLICT DO NOTHING)
+        IgnoreOnConflict,
+        /// conflicting rows are updated with the new values (ON CONFLICT DO UPDATE, ON DUPLICATE KEY UPDATE)
+        UpdateOnConflict,
+    };
+
+    /**
+     * Maximum number of values that should be bound to a single statement. SQLite
+     * is the most restrictive of the supported backends.
+     */
+    static constexpr qsizetype MaxBindValues = 999;
+
+    /**
+     * Returns the maximum number of rows that can be inserted by a single multi-row
+     * INSERT query into @p columnCount columns, see setColumnValues().
+     */
+    static constexpr qsizetype maxInsertRows(qsizetype columnCount)
+    {
+        return columnCount > 0 && columnCount < MaxBindValues ? MaxBindValues / columnCount : 1;
+    }
+
     /**
       Creates a new query builder.
 
@@ -238,6 +265,11 @@ public:
 
       Calling this function resets any values set by setColumnValues().
 
+      Setting a column that already has a value replaces that value. If the
+      query has already been executed, the compiled statement is kept and
+      only the bound value is exchanged, so the builder can be re-executed
+      cheaply in a loop.
+
       @param column Column to change.
       @param value The value @p column should be set to.
     */
@@ -285,6 +317,18 @@ public:
      */
     void setIdentificationColumn(const QString &column);
 
+    /**
+     * Sets how an INSERT query should handle rows conflicting with existing ones.
+     *
+     * @param handling The conflict handling strategy.
+     * @param conflictColumns Columns of the unique constraint that is expected to be violated.
+     *        Required for UpdateOnConflict on PostgreSQL and SQLite, ignored on MySQL.
+     * @param updateColumns Columns to overwrite with the new values for UpdateOnConflict. If
+     *        empty, all inserted columns that are not part of @p conflictColumns are updated.
+     * @note Only valid for INSERT queries.
+     */
+    void setConflictHandling(ConflictHandling handling, const QStringList &conflictColumns = {}, const QStringList &updateColumns = {});
+
     /**
       Returns the query, only valid after exec().
     */
@@ -295,6 +339,9 @@ public:
 
     /**
       Executes the query, returns true on success.
+
+      The SQL statement is compiled on the first call and reused by subsequent
+      calls until the builder is modified again.
     */
     bool exec();
 
@@ -306,6 +353,25 @@ public:
     */
     qint64 insertId();
 
+    /**
+      Returns the IDs of all records created by a (multi-row) INSERT query, in the
+      order of the inserted rows.
+
+      On MySQL and SQLite the IDs are derived from the last insert ID, so they are
+      only available when no conflict handling has been set. An empty list is
+      returned when the IDs cannot be determined.
+    */
+    QList<qint64> insertIds();
+
+    /**
+      Returns whether insertIds() can determine the IDs of a multi-row INSERT query.
+
+      On MySQL this depends on the auto increment settings of the server, which are
+      read when this is called. When it returns @c false, insert the rows one by one
+      and use insertId() instead.
+    */
+    bool canRetrieveInsertIds();
+
     /**
       Indicate to the database to acquire an exclusive lock on the rows already during
       SELECT statement.
@@ -330,11 +396,17 @@ private:
     void setColumnValues(const QString &column, const QVariant &values);
 
     void buildQuery(QString *query);
+    QVariant toBindValue(const QVariant &value) const;
     void bindValue(QString *query, const QVariant &value);
     void buildWhereCondition(QString *query, const Query::Condition &cond);
+    template<typename Container>
+    void buildWhereInIdsCondition(QString *query, const Query::Condition &cond, const Container &ids);
     void buildCaseStatement(QString *query, const Query::Case &caseStmt);
     void buildInsertColumns(QString *query);
     void buildInsertValues(QString *query);
+    void buildInsertConflictClause(QString *query);
+    qsizetype insertRowCount() const;
+    qint64 insertIdStep();
     QString getTableQuery(const QSqlQuery &query, const QString &alias);
 
     /**
@@ -343,6 +415,15 @@ private:
      */
     void sqliteAdaptUpdateJoin(Query::Condition &cond);
 
+    /**
+     * Discards the compiled statement, must be called by every method that
+     * changes the shape of the query.
+     */
+    void invalidateStatement()
+    {
+        mStatement.clear();
+    }
+
 protected:
     DataStore *dataStore() const
     {
@@ -362,8 +443,15 @@ private:
     QList<QPair<QString, Query::SortOrder>> mSortColumns;
     QStringList mGroupColumns;
     QList<QPair<QString, QVariant>> mColumnValues;
+    // index into mBindValues for each entry in mColumnValues, valid while mStatement is not empty
+    QList<qsizetype> mColumnValueBindIndexes;
     QList<QPair<QString, QVariant>> mColumnMultiValues;
     QString mIdentificationColumn;
+    ConflictHandling mConflictHandling = FailOnConflict;
+    // Read by canRetrieveInsertIds() and reused by insertIds(), 0 if the IDs are unknown
+    std::optional<qint64> mInsertIdStep;
+    QStringList mConflictColumns;
+    QStringList mConflictUpdateColumns;
 
     // we must make sure that the tables are joined in the correct order
     // QMap sorts by key which might invalidate the queries
@@ -373,8 +461,9 @@ private:
     int mOffset;
     bool mDistinct;
     bool mForUpdate = false;
-#ifdef QUERYBUILDER_UNITTEST
+    // the compiled statement, empty when the query needs to be rebuilt
     QString mStatement;
+#ifdef QUERYBUILDER_UNITTEST
     friend class ::QueryBuilderTest;
 #endif
 };
@@ -74,7 +74,7 @@ QList&lt;TableDescription&gt; <xsl:value-of select="$className"/>::tables()
 
       <xsl:if test="@type = 'enum'">
       c.enumValueMap = {
-      <xsl:for-each select="../enum">
+      <xsl:for-each select="../enum[@name = current()/@enumType]">
         <xsl:for-each select="value">
         { QStringLiteral("<xsl:value-of select="../@name"/>::<xsl:value-of select="@name"/>"),
             <xsl:choose>
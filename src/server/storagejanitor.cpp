@@ -9,6 +9,7 @@
 #include "akonadi.h"
 #include "akonadiserver_debug.h"
 #include "akranges.h"
+#include "connection.h"
 #include "entities.h"
 #include "resourcemanager.h"
 #include "search/searchmanager.h"
@@ -16,28 +17,112 @@
 #include "storage/collectionstatistics.h"
 #include "storage/datastore.h"
 #include "storage/dbtype.h"
+#include "storage/parttypehelper.h"
 #include "storage/query.h"
 #include "storage/selectquerybuilder.h"
 #include "storage/transaction.h"
 
 #include "private/dbus_p.h"
 #include "private/externalpartstorage_p.h"
+#include "private/partcompression_p.h"
 #include "private/standarddirs_p.h"
 
 #include <QDateTime>
+#include <QDeadlineTimer>
 #include <QDir>
 #include <QDirIterator>
+#include <QElapsedTimer>
+#include <QSettings>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QStringBuilder>
+#include <QThreadPool>
+#include <QTimer>
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
+#include <limits>
+#include <optional>
 #include <qregularexpression.h>
+#include <thread>
 
 using namespace Akonadi;
 using namespace Akonadi::Server;
 using namespace AkRanges;
+using namespace std::chrono_literals;
+
+namespace
+{
+// Unreferenced blobs and packs are kept for a while, as they may still be about to be
+// referenced by a transaction that was not committed yet
+constexpr auto unreferencedDataGracePeriod = std::chrono::hours(24);
+
+// Unreferenced blobs are renamed to this before they are removed, see collectUnreferencedBlobs()
+constexpr QLatin1StringView blobTombstoneSuffix(".collected");
+// Number of blobs whose references are checked again at once
+constexpr qsizetype blobRecheckChunkSize = 500;
+
+// zstd recommends about a hundred samples per dictionary, a thousand is plenty
+constexpr int minDictionarySamples = 100;
+constexpr int maxDictionarySamples = 1000;
+
+// The online check leaves the database to others for at least as long as it
+// used it for the last chunk, and waits a while for busy clients to finish
+constexpr auto minChunkPause = 50ms;
+constexpr auto maxChunkPause = 2s;
+constexpr auto maxBusyWait = 10s;
+constexpr auto busyPollInterval = 100ms;
+// How often to check whether the online check is due
+constexpr auto onlineCheckPollInterval = 1h;
+// Number of free pages released by one incremental vacuum step on SQLite
+constexpr int incrementalVacuumPages = 1024;
+
+constexpr qint64 fullRange = std::numeric_limits<qint64>::max();
+
+QString checkpointFile()
+{
+    return StandardDirs::saveDir("data") + QLatin1StringView("/janitor_checkpoint");
+}
+
+// Puts back a blob that was about to be removed, unless it has been written again since
+void restoreBlob(const QString &path)
+{
+    if (!QFile::rename(path + blobTombstoneSuffix, path)) {
+        QFile::remove(path + blobTombstoneSuffix);
+    }
+}
+
+struct PackedPart {
+    qint64 partId;
+    QByteArray name;
+    qint64 length;
+};
+
+/// Returns the parts that reference a payload in a pack, by pack ID, in a single pass over the parts
+std::optional<QHash<qint64, QList<PackedPart>>> packedParts(DataStore *store)
+{
+    QueryBuilder qb(store, Part::tableName(), QueryBuilder::Select);
+    qb.addColumn(Part::idColumn());
+    qb.addColumn(Part::dataColumn());
+    qb.addValueCondition(Part::storageColumn(), Query::Equals, Part::External);
+    qb.addValueCondition(Part::dataColumn(), Query::Like, QByteArray("%.pack:%"));
+    if (!qb.exec()) {
+        return std::nullopt;
+    }
+
+    QHash<qint64, QList<PackedPart>> parts;
+    while (qb.query().next()) {
+        PackedPart part{qb.query().value(0).toLongLong(), qb.query().value(1).toByteArray(), 0};
+        qint64 packId = -1;
+        if (ExternalPartStorage::parsePackedName(part.name, &packId, nullptr, &part.length)) {
+            parts[packId].push_back(std::move(part));
+        }
+    }
+    qb.query().finish();
+    return parts;
+}
+} // namespace
 
 class StorageJanitorDataStore : public DataStore
 {
@@ -67,6 +152,8 @@ StorageJanitor::StorageJanitor(DbConfig *dbConfig)
 
 StorageJanitor::~StorageJanitor()
 {
+    // Makes a running online check stop after the current chunk
+    m_quitting = true;
     quitThread();
 }
 
@@ -79,6 +166,17 @@ void StorageJanitor::init()
     m_dataStore = std::make_unique<StorageJanitorDataStore>(m_akonadi, m_dbConfig);
     m_dataStore->open();
 
+    const QSettings settings(StandardDirs::serverConfigFile(), QSettings::IniFormat);
+    m_chunkSize = std::max(1, settings.value(QStringLiteral("Janitor/ChunkSize"), m_chunkSize).toInt());
+    m_parallelChecks = std::max(1, settings.value(QStringLiteral("Janitor/ParallelChecks"), m_parallelChecks).toInt());
+    m_onlineCheckInterval = std::chrono::hours(settings.value(QStringLiteral("Janitor/OnlineCheckInterval"), 24).toInt());
+    // Only run the online check periodically as part of a real server
+    if (m_akonadi && m_onlineCheckInterval > 0h) {
+        m_onlineCheckTimer = new QTimer(this);
+        connect(m_onlineCheckTimer, &QTimer::timeout, this, &StorageJanitor::checkOnlineIfDue);
+        m_onlineCheckTimer->start(onlineCheckPollInterval);
+    }
+
     QDBusConnection conn = QDBusConnection::sessionBus();
     conn.registerService(DBus::serviceName(DBus::StorageJanitor));
     conn.registerObject(QStringLiteral(AKONADI_DBUS_STORAGEJANITOR_PATH),
@@ -113,12 +211,42 @@ void StorageJanitor::registerTasks()
                {QStringLiteral("Looking for duplicate tag types..."), &StorageJanitor::findDuplicateTagTypes},
                {QStringLiteral("Looking for overlapping external parts..."), &StorageJanitor::findOverlappingParts},
                {QStringLiteral("Verifying external parts..."), &StorageJanitor::verifyExternalParts},
+               {QStringLiteral("Collecting unreferenced external part blobs..."), &StorageJanitor::collectUnreferencedBlobs},
+               {QStringLiteral("Compacting external part packs..."), &StorageJanitor::compactPacks},
                {QStringLiteral("Checking size threshold changes..."), &StorageJanitor::checkSizeTreshold},
+               {QStringLiteral("Training part compression dictionaries..."), &StorageJanitor::trainCompressionDictionaries},
                {QStringLiteral("Looking for dirty objects..."), &StorageJanitor::findDirtyObjects},
                {QStringLiteral("Looking for rid-duplicates not matching the content mime-type of the parent collection"), &StorageJanitor::findRIDDuplicates},
                {QStringLiteral("Migrating parts to new cache hierarchy..."), &StorageJanitor::migrateToLevelledCacheHierarchy},
                {QStringLiteral("Making sure virtual search resource and collections exist"), &StorageJanitor::ensureSearchCollection}};
 
+    // Independent checks that can process their table in chunks, used by checkOnline()
+    m_onlineTasks = {{QStringLiteral("Looking for items not belonging to a valid collection..."),
+                      QStringLiteral("OrphanedItems"),
+                      PimItem::tableName(),
+                      PimItem::idColumn(),
+                      &StorageJanitor::findOrphanedItemsInRange},
+                     {QStringLiteral("Looking for item parts not belonging to a valid item..."),
+                      QStringLiteral("OrphanedParts"),
+                      Part::tableName(),
+                      Part::idColumn(),
+                      &StorageJanitor::findOrphanedPartsInRange},
+                     {QStringLiteral("Looking for item flags not belonging to a valid item..."),
+                      QStringLiteral("OrphanedPimItemFlags"),
+                      PimItemFlagRelation::tableName(),
+                      PimItemFlagRelation::leftColumn(),
+                      &StorageJanitor::findOrphanedPimItemFlagsInRange},
+                     {QStringLiteral("Looking for missing external part files..."),
+                      QStringLiteral("MissingExternalParts"),
+                      Part::tableName(),
+                      Part::idColumn(),
+                      &StorageJanitor::findMissingExternalPartsInRange},
+                     {QStringLiteral("Looking for rid-duplicates not matching the content mime-type of the parent collection"),
+                      QStringLiteral("RIDDuplicates"),
+                      Collection::tableName(),
+                      Collection::idColumn(),
+                      &StorageJanitor::findRIDDuplicatesInRange}};
+
     // Tasks that require a valid Akonadi instance
     if (m_akonadi) {
         m_tasks += {{QStringLiteral("Looking for resources in the DB not matching a configured resource..."), &StorageJanitor::findOrphanedResources},
@@ -150,23 +278,139 @@ void StorageJanitor::check() // implementation of `akonadictl fsck`
     Q_EMIT done();
 }
 
-qint64 StorageJanitor::lostAndFoundCollection()
+void StorageJanitor::checkOnline()
 {
+    m_lostFoundCollectionId = -1;
+
+    // SQLite only allows a single writer, running checks in parallel would just make them wait
+    const bool sqlite = DbType::type(m_dataStore->database()) == DbType::Sqlite;
+    QThreadPool pool;
+    pool.setObjectName(QStringLiteral("StorageJanitorPool"));
+    pool.setMaxThreadCount(sqlite ? 1 : m_parallelChecks);
+    // Don't compete with the server for CPU
+    pool.setThreadPriority(QThread::IdlePriority);
+    for (const OnlineTask &task : std::as_const(m_onlineTasks)) {
+        pool.start([this, task]() {
+            runOnlineTask(task);
+        });
+    }
+    pool.waitForDone();
+
+    // Blobs and packed payloads are not removed when parts release them
+    if (!m_quitting) {
+        collectUnreferencedBlobs();
+    }
+    if (!m_quitting) {
+        compactPacks();
+    }
+
+    if (!m_quitting) {
+        vacuumIncrementally();
+    }
+
+    if (!m_quitting) {
+        QSettings checkpoint(checkpointFile(), QSettings::IniFormat);
+        checkpoint.setValue(QStringLiteral("General/LastCompleted"), QDateTime::currentDateTimeUtc());
+        inform("Online consistency check done.");
+    } else {
+        inform("Online consistency check interrupted, it will resume next time.");
+    }
+
+    Q_EMIT done();
+}
+
+void StorageJanitor::checkOnlineIfDue()
+{
+    const QSettings checkpoint(checkpointFile(), QSettings::IniFormat);
+    const QDateTime lastCompleted = checkpoint.value(QStringLiteral("General/LastCompleted")).toDateTime();
+    if (!lastCompleted.isValid() || lastCompleted.addSecs(std::chrono::seconds(m_onlineCheckInterval).count()) <= QDateTime::currentDateTimeUtc()) {
+        checkOnline();
+    }
+}
+
+void StorageJanitor::runOnlineTask(const OnlineTask &task)
+{
+    // Each check uses a database connection of its own
+    StorageJanitorDataStore store(m_akonadi, m_dbConfig);
+    store.open();
+
+    QueryBuilder qb(&store, task.table, QueryBuilder::Select);
+    qb.addAggregation(task.idColumn, QStringLiteral("max"));
+    if (!qb.exec() || !qb.query().next()) {
+        inform(QStringLiteral("Failed to query size of table %1, skipping test").arg(task.table));
+        store.close();
+        return;
+    }
+    const qint64 maxId = qb.query().value(0).toLongLong();
+    qb.query().finish();
+
+    qint64 fromId = loadCheckpoint(task.key) + 1;
+    inform(QStringLiteral("%1 (from ID %2 of %3)").arg(task.name).arg(fromId).arg(maxId));
+    while (fromId <= maxId && !m_quitting) {
+        const qint64 toId = fromId + m_chunkSize - 1;
+        QElapsedTimer chunkTimer;
+        chunkTimer.start();
+        std::invoke(task.func, this, &store, fromId, toId);
+        saveCheckpoint(task.key, toId);
+        fromId = toId + 1;
+        throttle(std::chrono::milliseconds(chunkTimer.elapsed()));
+    }
+
+    // Start over the next time once the whole table has been checked
+    if (fromId > maxId) {
+        saveCheckpoint(task.key, 0);
+    }
+
+    store.close();
+}
+
+void StorageJanitor::throttle(std::chrono::milliseconds lastChunkDuration)
+{
+    std::this_thread::sleep_for(std::clamp<std::chrono::milliseconds>(lastChunkDuration, minChunkPause, maxChunkPause));
+
+    // Back off while clients are being served, but don't starve when the server is never idle
+    const QDeadlineTimer deadline(maxBusyWait);
+    while (Connection::activeCommandCount() > 0 && !deadline.hasExpired() && !m_quitting) {
+        std::this_thread::sleep_for(busyPollInterval);
+    }
+}
+
+qint64 StorageJanitor::loadCheckpoint(const QString &key)
+{
+    QMutexLocker locker(&m_checkpointLock);
+    const QSettings checkpoint(checkpointFile(), QSettings::IniFormat);
+    return checkpoint.value(QLatin1StringView("Progress/") + key, 0).toLongLong();
+}
+
+void StorageJanitor::saveCheckpoint(const QString &key, qint64 lastId)
+{
+    QMutexLocker locker(&m_checkpointLock);
+    QSettings checkpoint(checkpointFile(), QSettings::IniFormat);
+    if (lastId > 0) {
+        checkpoint.setValue(QLatin1StringView("Progress/") + key, lastId);
+    } else {
+        checkpoint.remove(QLatin1StringView("Progress/") + key);
+    }
+}
+
+qint64 StorageJanitor::lostAndFoundCollection(DataStore *store)
+{
+    QMutexLocker locker(&m_lostFoundLock);
     if (m_lostFoundCollectionId > 0) {
         return m_lostFoundCollectionId;
     }
 
-    Transaction transaction(m_dataStore.get(), QStringLiteral("JANITOR LOST+FOUND"));
-    Resource lfRes = Resource::retrieveByName(m_dataStore.get(), QStringLiteral("akonadi_lost+found_resource"));
+    Transaction transaction(store, QStringLiteral("JANITOR LOST+FOUND"));
+    Resource lfRes = Resource::retrieveByName(store, QStringLiteral("akonadi_lost+found_resource"));
     if (!lfRes.isValid()) {
         lfRes.setName(QStringLiteral("akonadi_lost+found_resource"));
-        if (!lfRes.insert(m_dataStore.get())) {
+        if (!lfRes.insert(store)) {
             qCCritical(AKONADISERVER_LOG) << "Failed to create lost+found resource!";
         }
     }
 
     Collection lfRoot;
-    SelectQueryBuilder<Collection> qb(m_dataStore.get());
+    SelectQueryBuilder<Collection> qb(store);
     qb.addValueCondition(Collection::resourceIdFullColumnName(), Query::Equals, lfRes.id());
     qb.addValueCondition(Collection::parentIdFullColumnName(), Query::Is, QVariant());
     if (!qb.exec()) {
@@ -184,11 +428,11 @@ qint64 StorageJanitor::lostAndFoundCollection()
         lfRoot.setCachePolicyLocalParts(QStringLiteral("ALL"));
         lfRoot.setCachePolicyCacheTimeout(-1);
         lfRoot.setCachePolicyInherit(false);
-        if (!lfRoot.insert(m_dataStore.get())) {
+        if (!lfRoot.insert(store)) {
             qCCritical(AKONADISERVER_LOG) << "Failed to create lost+found root.";
         }
         if (m_akonadi) {
-            m_dataStore->notificationCollector()->collectionAdded(lfRoot, lfRes.name().toUtf8());
+            store->notificationCollector()->collectionAdded(lfRoot, lfRes.name().toUtf8());
         }
     }
 
@@ -196,17 +440,17 @@ qint64 StorageJanitor::lostAndFoundCollection()
     lfCol.setName(QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd hh:mm:ss")));
     lfCol.setResourceId(lfRes.id());
     lfCol.setParentId(lfRoot.id());
-    if (!lfCol.insert(m_dataStore.get())) {
+    if (!lfCol.insert(store)) {
         qCCritical(AKONADISERVER_LOG) << "Failed to create lost+found collection!";
     }
 
-    const auto retrieveAll = MimeType::retrieveAll(m_dataStore.get());
+    const auto retrieveAll = MimeType::retrieveAll(store);
     for (const MimeType &mt : retrieveAll) {
-        lfCol.addMimeType(m_dataStore.get(), mt);
+        lfCol.addMimeType(store, mt);
     }
 
     if (m_akonadi) {
-        m_dataStore->notificationCollector()->collectionAdded(lfCol, lfRes.name().toUtf8());
+        store->notificationCollector()->collectionAdded(lfCol, lfRes.name().toUtf8());
     }
 
     transaction.commit();
@@ -299,9 +543,16 @@ void StorageJanitor::checkPathToRoot(const Collection &col)
 
 void StorageJanitor::findOrphanedItems()
 {
-    SelectQueryBuilder<PimItem> qb(m_dataStore.get());
+    findOrphanedItemsInRange(m_dataStore.get(), 0, fullRange);
+}
+
+void StorageJanitor::findOrphanedItemsInRange(DataStore *store, qint64 fromId, qint64 toId)
+{
+    SelectQueryBuilder<PimItem> qb(store);
     qb.addJoin(QueryBuilder::LeftJoin, Collection::tableName(), PimItem::collectionIdFullColumnName(), Collection::idFullColumnName());
     qb.addValueCondition(Collection::idFullColumnName(), Query::Is, QVariant());
+    qb.addValueCondition(PimItem::idFullColumnName(), Query::GreaterOrEqual, fromId);
+    qb.addValueCondition(PimItem::idFullColumnName(), Query::LessOrEqual, toId);
     if (!qb.exec()) {
         inform("Failed to query orphaned items, skipping test");
         return;
@@ -310,9 +561,9 @@ void StorageJanitor::findOrphanedItems()
     if (!orphans.isEmpty()) {
         inform(QLatin1StringView("Found ") + QString::number(orphans.size()) + QLatin1StringView(" orphan items."));
         // Attach to lost+found collection
-        Transaction transaction(m_dataStore.get(), QStringLiteral("JANITOR ORPHANS"));
-        QueryBuilder qb(m_dataStore.get(), PimItem::tableName(), QueryBuilder::Update);
-        qint64 col = lostAndFoundCollection();
+        Transaction transaction(store, QStringLiteral("JANITOR ORPHANS"));
+        QueryBuilder qb(store, PimItem::tableName(), QueryBuilder::Update);
+        qint64 col = lostAndFoundCollection(store);
         if (col == -1) {
             return;
         }
@@ -333,9 +584,16 @@ void StorageJanitor::findOrphanedItems()
 
 void StorageJanitor::findOrphanedParts()
 {
-    SelectQueryBuilder<Part> qb(m_dataStore.get());
+    findOrphanedPartsInRange(m_dataStore.get(), 0, fullRange);
+}
+
+void StorageJanitor::findOrphanedPartsInRange(DataStore *store, qint64 fromId, qint64 toId)
+{
+    SelectQueryBuilder<Part> qb(store);
     qb.addJoin(QueryBuilder::LeftJoin, PimItem::tableName(), Part::pimItemIdFullColumnName(), PimItem::idFullColumnName());
     qb.addValueCondition(PimItem::idFullColumnName(), Query::Is, QVariant());
+    qb.addValueCondition(Part::idFullColumnName(), Query::GreaterOrEqual, fromId);
+    qb.addValueCondition(Part::idFullColumnName(), Query::LessOrEqual, toId);
     if (!qb.exec()) {
         inform("Failed to query orphaned parts, skipping test");
         return;
@@ -349,10 +607,17 @@ void StorageJanitor::findOrphanedParts()
 
 void StorageJanitor::findOrphanedPimItemFlags()
 {
-    QueryBuilder sqb(m_dataStore.get(), PimItemFlagRelation::tableName(), QueryBuilder::Select);
+    findOrphanedPimItemFlagsInRange(m_dataStore.get(), 0, fullRange);
+}
+
+void StorageJanitor::findOrphanedPimItemFlagsInRange(DataStore *store, qint64 fromId, qint64 toId)
+{
+    QueryBuilder sqb(store, PimItemFlagRelation::tableName(), QueryBuilder::Select);
     sqb.addColumn(PimItemFlagRelation::leftFullColumnName());
     sqb.addJoin(QueryBuilder::LeftJoin, PimItem::tableName(), PimItemFlagRelation::leftFullColumnName(), PimItem::idFullColumnName());
     sqb.addValueCondition(PimItem::idFullColumnName(), Query::Is, QVariant());
+    sqb.addValueCondition(PimItemFlagRelation::leftFullColumnName(), Query::GreaterOrEqual, fromId);
+    sqb.addValueCondition(PimItemFlagRelation::leftFullColumnName(), Query::LessOrEqual, toId);
     if (!sqb.exec()) {
         inform("Failed to query orphaned item flags, skipping test");
         return;
@@ -364,7 +629,7 @@ void StorageJanitor::findOrphanedPimItemFlags()
     }
     sqb.query().finish();
     if (!ids.empty()) {
-        QueryBuilder qb(m_dataStore.get(), PimItemFlagRelation::tableName(), QueryBuilder::Delete);
+        QueryBuilder qb(store, PimItemFlagRelation::tableName(), QueryBuilder::Delete);
         qb.addValueCondition(PimItemFlagRelation::leftFullColumnName(), Query::In, ids);
         if (!qb.exec()) {
             qCCritical(AKONADISERVER_LOG) << "Error:" << qb.query().lastError().text();
@@ -505,6 +770,11 @@ void StorageJanitor::findOverlappingParts()
 
     int count = 0;
     while (qb.query().next()) {
+        // Blobs and packed payloads are shared by all copies of a part
+        const QByteArray data = qb.query().value(0).toByteArray();
+        if (ExternalPartStorage::isBlobName(data) || ExternalPartStorage::isPackedName(data)) {
+            continue;
+        }
         ++count;
         inform(QLatin1StringView("Found overlapping part data: ") + qb.query().value(0).toString());
         // TODO: uh oh, this is bad, how do we recover from that?
@@ -564,14 +834,21 @@ void StorageJanitor::verifyExternalParts()
             part.setData(QByteArray());
             part.setDatasize(0);
             part.setStorage(Part::Internal);
+            part.setCompression(Part::Uncompressed);
             part.update(m_dataStore.get());
         }
     }
     qb.query().finish();
     inform(QLatin1StringView("Found ") + QString::number(usedFiles.size()) + QLatin1StringView(" external parts."));
 
+    // blobs (and their tombstones) are cleaned up by collectUnreferencedBlobs(), packs by compactPacks()
+    QSet<QString> unreferencedFiles = existingFiles - usedFiles;
+    unreferencedFiles.removeIf([](const QString &file) {
+        const QString fileName = QFileInfo(file).fileName();
+        return ExternalPartStorage::isPackFile(file) || ExternalPartStorage::isBlobName(fileName) || fileName.endsWith(blobTombstoneSuffix);
+    });
+
     // see what's left and move it to lost+found
-    const QSet<QString> unreferencedFiles = existingFiles - usedFiles;
     if (!unreferencedFiles.isEmpty()) {
         const QString lfDir = StandardDirs::saveDir("data", QStringLiteral("file_lost+found"));
         for (const QString &file : unreferencedFiles) {
@@ -585,6 +862,244 @@ void StorageJanitor::verifyExternalParts()
     }
 }
 
+void StorageJanitor::findMissingExternalPartsInRange(DataStore *store, qint64 fromId, qint64 toId)
+{
+    QueryBuilder qb(store, Part::tableName(), QueryBuilder::Select);
+    qb.addColumn(Part::dataColumn());
+    qb.addColumn(Part::pimItemIdColumn());
+    qb.addColumn(Part::idColumn());
+    qb.addValueCondition(Part::storageColumn(), Query::Equals, Part::External);
+    qb.addValueCondition(Part::dataColumn(), Query::IsNot, QVariant());
+    qb.addValueCondition(Part::idColumn(), Query::GreaterOrEqual, fromId);
+    qb.addValueCondition(Part::idColumn(), Query::LessOrEqual, toId);
+    if (!qb.exec()) {
+        inform("Failed to query existing parts, skipping test");
+        return;
+    }
+
+    QList<std::pair<qint64, QByteArray>> missing; // part ID, file name
+    while (qb.query().next()) {
+        bool exists = false;
+        const QByteArray fileName = qb.query().value(0).toByteArray();
+        const QString partPath = ExternalPartStorage::resolveAbsolutePath(fileName, &exists);
+        if (!exists) {
+            inform(QLatin1StringView("Cleaning up missing external file: ") + partPath + QLatin1StringView(" for item: ")
+                   + QString::number(qb.query().value(1).toLongLong()) + QLatin1StringView(" on part: ") + QString::number(qb.query().value(2).toLongLong()));
+            missing.push_back({qb.query().value(2).toLongLong(), fileName});
+        }
+    }
+    qb.query().finish();
+    if (missing.isEmpty()) {
+        return;
+    }
+
+    // The server may have stored a new payload for the part since it was read, only
+    // clear parts that still reference the missing file
+    Transaction transaction(store, QStringLiteral("JANITOR MISSING EXTERNAL PARTS"));
+    for (const auto &[partId, fileName] : std::as_const(missing)) {
+        QueryBuilder update(store, Part::tableName(), QueryBuilder::Update);
+        update.setColumnValue(Part::dataColumn(), QByteArray());
+        update.setColumnValue(Part::datasizeColumn(), 0);
+        update.setColumnValue(Part::storageColumn(), Part::Internal);
+        update.setColumnValue(Part::compressionColumn(), Part::Uncompressed);
+        update.addValueCondition(Part::idColumn(), Query::Equals, partId);
+        update.addValueCondition(Part::dataColumn(), Query::Equals, fileName);
+        if (!update.exec()) {
+            inform(QStringLiteral("Failed to clean up part %1: %2").arg(partId).arg(update.query().lastError().text()));
+            return;
+        }
+    }
+    if (!transaction.commit()) {
+        inform("Failed to commit the clean up of missing external parts");
+    }
+}
+
+void StorageJanitor::collectUnreferencedBlobs()
+{
+    QHash<QString, QString> blobs; // file name -> path
+    const QString dataDir = StandardDirs::saveDir("data", QStringLiteral("file_db_data"));
+    QDirIterator it(dataDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        const QString fileName = it.fileName();
+        if (ExternalPartStorage::isBlobName(fileName)) {
+            blobs.insert(fileName, path);
+        } else if (fileName.endsWith(blobTombstoneSuffix) && ExternalPartStorage::isBlobName(fileName.chopped(blobTombstoneSuffix.size()))) {
+            // Left behind by an interrupted collection, check it again
+            const QString blobPath = path.chopped(blobTombstoneSuffix.size());
+            restoreBlob(blobPath);
+            blobs.insert(fileName.chopped(blobTombstoneSuffix.size()), blobPath);
+        }
+    }
+    if (blobs.isEmpty()) {
+        return;
+    }
+
+    QueryBuilder qb(m_dataStore.get(), Part::tableName(), QueryBuilder::Select);
+    qb.addColumn(Part::dataColumn());
+    qb.addValueCondition(Part::storageColumn(), Query::Equals, Part::External);
+    qb.addValueCondition(Part::dataColumn(), Query::IsNot, QVariant());
+    if (!qb.exec()) {
+        inform("Failed to query external parts, skipping blob collection");
+        return;
+    }
+    while (qb.query().next() && !blobs.isEmpty()) {
+        // Blobs are stored under their name
+        const QByteArray name = qb.query().value(0).toByteArray();
+        if (ExternalPartStorage::isBlobName(name)) {
+            blobs.remove(QString::fromLatin1(name));
+        }
+    }
+    qb.query().finish();
+
+    // Give transactions that might be about to reference them some time to commit. Blobs
+    // that are stored again are touched, so they are not collected while they are reused.
+    // Expired blobs are renamed away first: storing a blob that is gone writes it again,
+    // and a blob touched before it was renamed keeps the new modification time. Only then
+    // the references are checked again, for parts committed in the meantime.
+    const QDateTime blobExpiry = QDateTime::currentDateTime().addSecs(-std::chrono::seconds(unreferencedDataGracePeriod).count());
+    QHash<QString, QString> tombstones; // file name -> path of the blob
+    for (auto it = blobs.cbegin(), end = blobs.cend(); it != end; ++it) {
+        if (QFileInfo(it.value()).lastModified() < blobExpiry && QFile::rename(it.value(), it.value() + blobTombstoneSuffix)) {
+            tombstones.insert(it.key(), it.value());
+        }
+    }
+
+    const QStringList names = tombstones.keys();
+    for (qsizetype i = 0; i < names.size(); i += blobRecheckChunkSize) {
+        QByteArrayList chunk;
+        for (const QString &name : names.mid(i, blobRecheckChunkSize)) {
+            chunk.push_back(name.toLatin1());
+        }
+        QueryBuilder recheckQb(m_dataStore.get(), Part::tableName(), QueryBuilder::Select);
+        recheckQb.addColumn(Part::dataColumn());
+        recheckQb.addValueCondition(Part::storageColumn(), Query::Equals, Part::External);
+        recheckQb.addValueCondition(Part::dataColumn(), Query::In, QVariant::fromValue(chunk));
+        if (!recheckQb.exec()) {
+            inform("Failed to query external parts, keeping the unreferenced blobs");
+            for (const QString &path : std::as_const(tombstones)) {
+                restoreBlob(path);
+            }
+            return;
+        }
+        while (recheckQb.query().next()) {
+            if (const QString path = tombstones.take(QString::fromLatin1(recheckQb.query().value(0).toByteArray())); !path.isEmpty()) {
+                restoreBlob(path);
+            }
+        }
+        recheckQb.query().finish();
+    }
+
+    qint64 collectedBlobs = 0;
+    for (const QString &path : std::as_const(tombstones)) {
+        if (QFileInfo(path + blobTombstoneSuffix).lastModified() >= blobExpiry) {
+            restoreBlob(path);
+        } else if (QFile::remove(path + blobTombstoneSuffix)) {
+            ++collectedBlobs;
+        }
+    }
+    inform(QStringLiteral("Removed %1 unreferenced blobs.").arg(collectedBlobs));
+}
+
+void StorageJanitor::compactPacks()
+{
+    const auto packs = QDir(QFileInfo(ExternalPartStorage::packPath(0)).absolutePath()).entryInfoList({QStringLiteral("*.pack")}, QDir::Files);
+    if (packs.isEmpty()) {
+        inform("No external part packs, skipping compaction");
+        return;
+    }
+
+    // The parts are looked up and updated in the same transaction, so that a part
+    // that is changed meanwhile is not pointed back to the old payload
+    Transaction transaction(m_dataStore.get(), QStringLiteral("JANITOR COMPACT PACKS"));
+    const auto parts = packedParts(m_dataStore.get());
+    if (!parts.has_value()) {
+        inform("Failed to query packed parts, skipping compaction");
+        return;
+    }
+
+    const qint64 activePackId = ExternalPartStorage::self()->activePackId();
+    const QDateTime packExpiry = QDateTime::currentDateTime().addSecs(-std::chrono::seconds(unreferencedDataGracePeriod).count());
+    ExternalPartStorageTransaction storageTrx;
+    QList<QFileInfo> compactedPacks;
+    for (const QFileInfo &pack : packs) {
+        const qint64 packId = pack.completeBaseName().toLongLong();
+        if (packId == activePackId || pack.lastModified() >= packExpiry) {
+            continue;
+        }
+
+        // Identical payloads may be shared by several parts
+        const QList<PackedPart> packParts = parts->value(packId);
+        QHash<QByteArray, QByteArray> movedPayloads;
+        qint64 usedSize = 0;
+        for (const PackedPart &part : packParts) {
+            if (!movedPayloads.contains(part.name)) {
+                movedPayloads.insert(part.name, QByteArray());
+                usedSize += part.length;
+            }
+        }
+
+        // Only rewrite packs that are mostly unused
+        if (usedSize > pack.size() / 2) {
+            continue;
+        }
+
+        // Move the payloads still in use to the active pack
+        for (auto it = movedPayloads.begin(), end = movedPayloads.end(); it != end; ++it) {
+            bool ok = false;
+            const QByteArray data = ExternalPartStorage::readPartFile(it.key(), &ok);
+            if (!ok || !ExternalPartStorage::self()->storePacked(data, it.value())) {
+                inform(QStringLiteral("Failed to move payload %1 out of pack %2, aborting compaction").arg(QString::fromLatin1(it.key())).arg(packId));
+                return;
+            }
+        }
+        for (const PackedPart &part : packParts) {
+            QueryBuilder update(m_dataStore.get(), Part::tableName(), QueryBuilder::Update);
+            update.setColumnValue(Part::dataColumn(), movedPayloads.value(part.name));
+            update.addValueCondition(Part::idColumn(), Query::Equals, part.partId);
+            update.addValueCondition(Part::dataColumn(), Query::Equals, part.name);
+            if (!update.exec()) {
+                inform(QStringLiteral("Failed to update the parts in pack %1, aborting compaction").arg(packId));
+                return;
+            }
+        }
+
+        compactedPacks.push_back(pack);
+        inform(QStringLiteral("Compacting pack %1, %2 of %3 bytes are in use").arg(packId).arg(usedSize).arg(pack.size()));
+    }
+
+    if (compactedPacks.isEmpty()) {
+        inform("No external part packs to compact.");
+        return;
+    }
+
+    // Make sure the moved payloads are on disk before the parts reference them
+    if (!storageTrx.commit() || !transaction.commit()) {
+        inform("Failed to commit the compaction of external part packs");
+        return;
+    }
+
+    // Parts may have been copied from the old payloads until the transaction was committed
+    const auto remainingParts = packedParts(m_dataStore.get());
+    if (!remainingParts.has_value()) {
+        inform("Failed to query packed parts, keeping the compacted packs");
+        return;
+    }
+    int removed = 0;
+    for (const QFileInfo &pack : std::as_const(compactedPacks)) {
+        const qint64 packId = pack.completeBaseName().toLongLong();
+        if (const auto remaining = remainingParts->value(packId); !remaining.isEmpty()) {
+            inform(QStringLiteral("Pack %1 is still referenced by %2 parts, keeping it").arg(packId).arg(remaining.size()));
+            continue;
+        }
+        if (QFile::remove(pack.absoluteFilePath())) {
+            ++removed;
+        }
+    }
+
+    inform(QStringLiteral("Compacted %1 external part packs.").arg(removed));
+}
+
 void StorageJanitor::findDirtyObjects()
 {
     SelectQueryBuilder<Collection> cqb(m_dataStore.get());
@@ -634,9 +1149,16 @@ void StorageJanitor::findDirtyObjects()
 
 void StorageJanitor::findRIDDuplicates()
 {
-    QueryBuilder qb(m_dataStore.get(), Collection::tableName(), QueryBuilder::Select);
+    findRIDDuplicatesInRange(m_dataStore.get(), 0, fullRange);
+}
+
+void StorageJanitor::findRIDDuplicatesInRange(DataStore *store, qint64 fromId, qint64 toId)
+{
+    QueryBuilder qb(store, Collection::tableName(), QueryBuilder::Select);
     qb.addColumn(Collection::idColumn());
     qb.addColumn(Collection::nameColumn());
+    qb.addValueCondition(Collection::idColumn(), Query::GreaterOrEqual, fromId);
+    qb.addValueCondition(Collection::idColumn(), Query::LessOrEqual, toId);
     qb.exec();
 
     while (qb.query().next()) {
@@ -644,7 +1166,7 @@ void StorageJanitor::findRIDDuplicates()
         const QString name = qb.query().value(1).toString();
         inform(QStringLiteral("Checking ") + name);
 
-        QueryBuilder duplicates(m_dataStore.get(), PimItem::tableName(), QueryBuilder::Select);
+        QueryBuilder duplicates(store, PimItem::tableName(), QueryBuilder::Select);
         duplicates.addColumn(PimItem::remoteIdColumn());
         duplicates.addColumn(QStringLiteral("count(") + PimItem::idColumn() + QStringLiteral(") as cnt"));
         duplicates.addValueCondition(PimItem::remoteIdColumn(), Query::IsNot, QVariant());
@@ -653,8 +1175,8 @@ void StorageJanitor::findRIDDuplicates()
         duplicates.addValueCondition(QStringLiteral("count(") + PimItem::idColumn() + QLatin1Char(')'), Query::Greater, 1, QueryBuilder::HavingCondition);
         duplicates.exec();
 
-        Akonadi::Server::Collection col = Akonadi::Server::Collection::retrieveById(m_dataStore.get(), colId);
-        const QList<Akonadi::Server::MimeType> contentMimeTypes = col.mimeTypes(m_dataStore.get());
+        Akonadi::Server::Collection col = Akonadi::Server::Collection::retrieveById(store, colId);
+        const QList<Akonadi::Server::MimeType> contentMimeTypes = col.mimeTypes(store);
         QVariantList contentMimeTypesVariantList;
         contentMimeTypesVariantList.reserve(contentMimeTypes.count());
         for (const Akonadi::Server::MimeType &mimeType : contentMimeTypes) {
@@ -668,7 +1190,7 @@ void StorageJanitor::findRIDDuplicates()
             condition.addValueCondition(PimItem::mimeTypeIdColumn(), Query::NotIn, contentMimeTypesVariantList);
             condition.addValueCondition(PimItem::collectionIdColumn(), Query::Equals, colId);
 
-            QueryBuilder items(m_dataStore.get(), PimItem::tableName(), QueryBuilder::Select);
+            QueryBuilder items(store, PimItem::tableName(), QueryBuilder::Select);
             items.addColumn(PimItem::idColumn());
             items.addCondition(condition);
             if (!items.exec()) {
@@ -688,7 +1210,7 @@ void StorageJanitor::findRIDDuplicates()
 
             inform(QStringLiteral("Found duplicates ") + rid);
 
-            SelectQueryBuilder<Part> parts(m_dataStore.get());
+            SelectQueryBuilder<Part> parts(store);
             parts.addValueCondition(Part::pimItemIdFullColumnName(), Query::In, QVariant::fromValue(itemsIds));
             parts.addValueCondition(Part::storageFullColumnName(), Query::Equals, static_cast<int>(Part::External));
             if (parts.exec()) {
@@ -697,12 +1219,12 @@ void StorageJanitor::findRIDDuplicates()
                     bool exists = false;
                     const auto filename = ExternalPartStorage::resolveAbsolutePath(part.data(), &exists);
                     if (exists) {
-                        QFile::remove(filename);
+                        ExternalPartStorage::self()->releasePartFile(filename);
                     }
                 }
             }
 
-            items = QueryBuilder(m_dataStore.get(), PimItem::tableName(), QueryBuilder::Delete);
+            items = QueryBuilder(store, PimItem::tableName(), QueryBuilder::Delete);
             items.addCondition(condition);
             if (!items.exec()) {
                 inform(QStringLiteral("Error while deleting duplicates ") + items.query().lastError().text());
@@ -736,13 +1258,67 @@ void StorageJanitor::vacuum()
             }
         }
         inform("vacuum done");
+    } else if (dbType == DbType::Sqlite) {
+        inform("vacuuming database, that'll take some time and require a lot of temporary disk space...");
+        // Switching to incremental auto-vacuum only takes effect with a full vacuum, afterwards
+        // the online check can release free pages without rewriting the whole database
+        QSqlQuery q(m_dataStore->database());
+        if (!q.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL")) || !q.exec(QStringLiteral("VACUUM"))) {
+            qCCritical(AKONADISERVER_LOG) << "failed to vacuum database:" << q.lastError().text();
+        }
+        inform("vacuum done");
     } else {
-        inform("Vacuum not supported for this database backend. (Sqlite backend)");
+        inform("Vacuum not supported for this database backend.");
     }
 
     Q_EMIT done();
 }
 
+void StorageJanitor::vacuumIncrementally()
+{
+    const DbType::Type dbType = DbType::type(m_dataStore->database());
+    QSqlQuery q(m_dataStore->database());
+    if (dbType == DbType::Sqlite) {
+        if (!q.exec(QStringLiteral("PRAGMA auto_vacuum")) || !q.next() || q.value(0).toInt() != 2 /* INCREMENTAL */) {
+            inform("Incremental vacuum is not enabled for this database, run a full vacuum once to enable it");
+        } else {
+            inform("Releasing free database pages...");
+            // Free a bounded number of pages at a time so that writers are never blocked for long
+            while (!m_quitting && q.exec(QStringLiteral("PRAGMA freelist_count")) && q.next() && q.value(0).toLongLong() > 0) {
+                QElapsedTimer timer;
+                timer.start();
+                if (!q.exec(QStringLiteral("PRAGMA incremental_vacuum(%1)").arg(incrementalVacuumPages))) {
+                    qCCritical(AKONADISERVER_LOG) << "failed to vacuum database incrementally:" << q.lastError().text();
+                    break;
+                }
+                // The pragma returns no rows, but the statement only completes once it's been stepped through
+                while (q.next()) { }
+                throttle(std::chrono::milliseconds(timer.elapsed()));
+            }
+        }
+        // Passive checkpoints don't wait for readers or writers
+        if (!m_quitting && !q.exec(QStringLiteral("PRAGMA wal_checkpoint(PASSIVE)"))) {
+            qCCritical(AKONADISERVER_LOG) << "failed to checkpoint the write-ahead log:" << q.lastError().text();
+        }
+    } else if (dbType == DbType::MySQL || dbType == DbType::PostgreSQL) {
+        // Unlike the full vacuum(), these don't lock the tables or rewrite them
+        const auto tables = allDatabaseTables();
+        for (const QString &table : tables) {
+            if (m_quitting) {
+                break;
+            }
+            inform(QStringLiteral("analyzing table %1...").arg(table));
+            QElapsedTimer timer;
+            timer.start();
+            const QString queryStr = dbType == DbType::MySQL ? QLatin1StringView("ANALYZE TABLE ") + table : QLatin1StringView("VACUUM ANALYZE ") + table;
+            if (!q.exec(queryStr)) {
+                qCCritical(AKONADISERVER_LOG) << "failed to analyze table" << table << ":" << q.lastError().text();
+            }
+            throttle(std::chrono::milliseconds(timer.elapsed()));
+        }
+    }
+}
+
 void StorageJanitor::checkSizeTreshold()
 {
     {
@@ -773,7 +1349,7 @@ void StorageJanitor::checkSizeTreshold()
                 qCCritical(AKONADISERVER_LOG) << "Failed to open file" << name << "for writing";
                 continue;
             }
-            if (f.write(part.data()) != part.datasize()) {
+            if (f.write(part.data()) != part.data().size()) {
                 qCCritical(AKONADISERVER_LOG) << "Failed to write data to payload file" << name;
                 f.remove();
                 continue;
@@ -808,19 +1384,21 @@ void StorageJanitor::checkSizeTreshold()
             Transaction transaction(m_dataStore.get(), QStringLiteral("JANITOR CHECK SIZE THRESHOLD 2"));
             Part part = Part::retrieveById(m_dataStore.get(), query.value(0).toLongLong());
             const QString partPath = ExternalPartStorage::resolveAbsolutePath(part.data());
-            QFile f(partPath);
-            if (!f.exists()) {
+            if (!QFile::exists(partPath)) {
                 qCCritical(AKONADISERVER_LOG) << "Part file" << part.data() << "does not exist";
                 continue;
             }
-            if (!f.open(QIODevice::ReadOnly)) {
+            bool ok = false;
+            const QByteArray data = ExternalPartStorage::readPartFile(part.data(), &ok);
+            if (!ok) {
                 qCCritical(AKONADISERVER_LOG) << "Failed to open part file" << part.data() << "for reading";
                 continue;
             }
 
             part.setStorage(Part::Internal);
-            part.setData(f.readAll());
-            if (part.data().size() != part.datasize()) {
+            part.setData(data);
+            // Compressed payload is smaller than the part
+            if (part.compression() == Part::Uncompressed && part.data().size() != part.datasize()) {
                 qCCritical(AKONADISERVER_LOG) << "Sizes of" << part.id() << "data don't match";
                 continue;
             }
@@ -829,13 +1407,68 @@ void StorageJanitor::checkSizeTreshold()
                 continue;
             }
 
-            f.close();
-            f.remove();
+            ExternalPartStorage::self()->releasePartFile(partPath);
             inform(QStringLiteral("Moved part %1 from external file into database").arg(part.id()));
         }
     }
 }
 
+void StorageJanitor::trainCompressionDictionaries()
+{
+    if (!m_dbConfig->partCompression()) {
+        inform("Part compression is disabled, skipping test");
+        return;
+    }
+
+    SelectQueryBuilder<PartType> qb(m_dataStore.get());
+    qb.addValueCondition(PartType::dictionaryIdColumn(), Query::Equals, 0);
+    if (!qb.exec()) {
+        inform("Failed to query part types without a compression dictionary, skipping test");
+        return;
+    }
+    const auto partTypes = qb.result();
+
+    int trained = 0;
+    for (PartType partType : partTypes) {
+        // Parts stored without compression so far are the best samples of what's to come
+        QueryBuilder partQb(m_dataStore.get(), Part::tableName(), QueryBuilder::Select);
+        partQb.addColumn(Part::dataColumn());
+        partQb.addValueCondition(Part::partTypeIdColumn(), Query::Equals, partType.id());
+        partQb.addValueCondition(Part::storageColumn(), Query::Equals, Part::Internal);
+        partQb.addValueCondition(Part::compressionColumn(), Query::Equals, Part::Uncompressed);
+        partQb.addValueCondition(Part::datasizeColumn(), Query::Greater, 0);
+        partQb.addSortColumn(Part::idColumn(), Query::Descending);
+        partQb.setLimit(maxDictionarySamples);
+        if (!partQb.exec()) {
+            inform(QStringLiteral("Failed to query samples of part type %1, skipping it").arg(PartTypeHelper::fullName(partType)));
+            continue;
+        }
+        QList<QByteArray> samples;
+        while (partQb.query().next()) {
+            samples.push_back(partQb.query().value(0).toByteArray());
+        }
+        partQb.query().finish();
+        if (samples.size() < minDictionarySamples) {
+            continue;
+        }
+
+        const quint32 dictionaryId = PartCompression::trainDictionary(samples);
+        if (dictionaryId == 0) {
+            inform(QStringLiteral("Failed to train compression dictionary for part type %1").arg(PartTypeHelper::fullName(partType)));
+            continue;
+        }
+        // Only parts stored from now on use the dictionary, existing parts are left as they are
+        partType.setDictionaryId(dictionaryId);
+        if (!partType.update(m_dataStore.get())) {
+            inform(QStringLiteral("Failed to store compression dictionary of part type %1").arg(PartTypeHelper::fullName(partType)));
+            continue;
+        }
+        ++trained;
+    }
+
+    inform(QStringLiteral("Trained %1 part compression dictionaries.").arg(trained));
+}
+
 void StorageJanitor::migrateToLevelledCacheHierarchy()
 {
     /// First, check whether that's still necessary
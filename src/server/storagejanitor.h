@@ -10,6 +10,13 @@
 #include "storage/dbconfig.h"
 
 #include <QDBusConnection>
+#include <QMutex>
+
+#include <atomic>
+#include <chrono>
+
+class QTimer;
+class StorageJanitorTest;
 
 namespace Akonadi
 {
@@ -44,6 +51,16 @@ public:
 public Q_SLOTS:
     /** Triggers a consistency check of the internal storage. */
     Q_SCRIPTABLE Q_NOREPLY void check();
+    /**
+     * Triggers a consistency check that can run while the server is in use.
+     *
+     * Independent checks process their tables in chunks of IDs, in parallel on
+     * connections of their own, and back off while clients are being served.
+     * The progress is stored, so an interrupted check resumes where it stopped.
+     * Unreferenced external payloads are collected and the database is vacuumed
+     * incrementally afterwards.
+     */
+    Q_SCRIPTABLE Q_NOREPLY void checkOnline();
     /** Triggers a vacuuming of the database, that is compacting of unused space. */
     Q_SCRIPTABLE Q_NOREPLY void vacuum();
 
@@ -57,12 +74,24 @@ protected:
     void quit() override;
 
 private:
+    struct OnlineTask;
+
     void registerTasks();
 
+    /** Runs checkOnline() when the last one completed longer ago than the configured interval. */
+    void checkOnlineIfDue();
+    void runOnlineTask(const OnlineTask &task);
+    /** Pauses between two chunks of work, for longer when the server is busy. */
+    void throttle(std::chrono::milliseconds lastChunkDuration);
+    qint64 loadCheckpoint(const QString &key);
+    void saveCheckpoint(const QString &key, qint64 lastId);
+    /** Releases unused space without locking the database for long. */
+    void vacuumIncrementally();
+
     void inform(const char *msg);
     void inform(const QString &msg);
     /** Create a lost+found collection if necessary. */
-    qint64 lostAndFoundCollection();
+    qint64 lostAndFoundCollection(DataStore *store);
 
     /**
      * Look for resources in the DB not existing in reality.
@@ -85,16 +114,19 @@ private:
      * Look for items belonging to non-existing collections.
      */
     void findOrphanedItems();
+    void findOrphanedItemsInRange(DataStore *store, qint64 fromId, qint64 toId);
 
     /**
      * Look for parts belonging to non-existing items.
      */
     void findOrphanedParts();
+    void findOrphanedPartsInRange(DataStore *store, qint64 fromId, qint64 toId);
 
     /**
      * Look for item flags belonging to non-existing items.
      */
     void findOrphanedPimItemFlags();
+    void findOrphanedPimItemFlagsInRange(DataStore *store, qint64 fromId, qint64 toId);
 
     /**
      * Look for duplicate item flags and fix them.
@@ -131,6 +163,23 @@ private:
      */
     void verifyExternalParts();
 
+    /**
+     * Look for external parts whose file is missing, the part of verifyExternalParts()
+     * that can be done in chunks.
+     */
+    void findMissingExternalPartsInRange(DataStore *store, qint64 fromId, qint64 toId);
+
+    /**
+     * Remove the blobs no part references anymore.
+     */
+    void collectUnreferencedBlobs();
+
+    /**
+     * Rewrite external part packs that are mostly unused and remove
+     * packs that are not used at all.
+     */
+    void compactPacks();
+
     /**
      * Look for dirty objects.
      */
@@ -142,6 +191,7 @@ private:
      * ..and remove the one that doesn't match the parent collections content mimetype.
      */
     void findRIDDuplicates();
+    void findRIDDuplicatesInRange(DataStore *store, qint64 fromId, qint64 toId);
 
     /**
      * Check whether part sizes match what's in database.
@@ -151,6 +201,12 @@ private:
      */
     void checkSizeTreshold();
 
+    /**
+     * Train compression dictionaries for part types that don't have one yet
+     * and have enough parts to sample.
+     */
+    void trainCompressionDictionaries();
+
     /**
      * Check if all external payload files are migrated to the levelled folder
      * hierarchy and migrates them if necessary
@@ -187,6 +243,25 @@ private:
         void (StorageJanitor::*func)();
     };
     QList<Task> m_tasks;
+
+    struct OnlineTask {
+        QString name;
+        QString key; // identifies the progress in the checkpoint file
+        QString table;
+        QString idColumn; // the table is processed in chunks of this column
+        void (StorageJanitor::*func)(DataStore *store, qint64 fromId, qint64 toId);
+    };
+    QList<OnlineTask> m_onlineTasks;
+
+    int m_chunkSize = 1000;
+    int m_parallelChecks = 2;
+    std::chrono::hours m_onlineCheckInterval{24};
+    QTimer *m_onlineCheckTimer = nullptr;
+    QMutex m_lostFoundLock;
+    QMutex m_checkpointLock;
+    std::atomic_bool m_quitting = false;
+
+    friend class ::StorageJanitorTest;
 };
 
 } // namespace Server
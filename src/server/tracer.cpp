@@ -11,6 +11,7 @@
 #include "traceradaptor.h"
 
 #include "akonadiserver_debug.h"
+#include "binarytracer.h"
 #include "dbustracer.h"
 #include "filetracer.h"
 
@@ -18,6 +19,7 @@
 
 // #define DEFAULT_TRACER QLatin1StringView( "dbus" )
 #define DEFAULT_TRACER QStringLiteral("null")
+#define DEFAULT_BINARY_TRACE_MAX_SIZE 64 // MiB
 
 using namespace Akonadi;
 using namespace Akonadi::Server;
@@ -27,6 +29,13 @@ Tracer::Tracer()
 {
     activateTracer(currentTracer());
 
+    if (mSettings->value(QStringLiteral("Debug/BinaryTrace"), false).toBool()) {
+        const QString file = mSettings->value(QStringLiteral("Debug/BinaryTraceFile"), StandardDirs::saveDir("data") + QLatin1StringView("/akonadiserver.trace"))
+                                 .toString();
+        const qint64 maxSize = mSettings->value(QStringLiteral("Debug/BinaryTraceMaxSize"), DEFAULT_BINARY_TRACE_MAX_SIZE).toLongLong() * 1024 * 1024;
+        mBinaryTracer = AkThread::create<BinaryTracer>(file, maxSize);
+    }
+
     new TracerAdaptor(this);
 
     QDBusConnection::sessionBus().registerObject(QStringLiteral("/tracing"), this, QDBusConnection::ExportAdaptors);
@@ -155,8 +164,10 @@ void Tracer::activateTracer(const QString &type)
     } else {
         qCCritical(AKONADISERVER_LOG) << "Unknown tracer type" << type;
         mTracerBackend.reset();
+        mEnabled = false;
         return;
     }
+    mEnabled = mTracerBackend != nullptr;
 
     mSettings->setValue(QStringLiteral("Debug/Tracer"), type);
     mSettings->sync();
@@ -14,6 +14,7 @@
 #include "private/protocol_p.h"
 #include "tracerinterface.h"
 
+#include <atomic>
 #include <memory>
 
 class QSettings;
@@ -28,6 +29,8 @@ using CommandPtr = QSharedPointer<Command>;
 
 namespace Server
 {
+class BinaryTracer;
+
 /**
  * The global tracer instance where all akonadi components can
  * send their tracing information to.
@@ -68,6 +71,24 @@ public:
      */
     QString currentTracer() const;
 
+    /**
+     * Returns whether a tracer is activated, i.e. whether the current
+     * tracer is not "null". Cheap enough to be called for each command.
+     */
+    [[nodiscard]] bool isEnabled() const
+    {
+        return mEnabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the binary tracer, if enabled by the Debug/BinaryTrace option.
+     * It is independent of the current tracer.
+     */
+    [[nodiscard]] BinaryTracer *binaryTracer() const
+    {
+        return mBinaryTracer.get();
+    }
+
 public Q_SLOTS:
     /**
      * This method is called whenever a new data (imap) connection to the akonadi server
@@ -149,6 +170,8 @@ private:
     mutable QMutex mMutex;
     std::unique_ptr<TracerInterface> mTracerBackend;
     std::unique_ptr<QSettings> mSettings;
+    std::unique_ptr<BinaryTracer> mBinaryTracer;
+    std::atomic_bool mEnabled = false;
 };
 
 } // namespace Server
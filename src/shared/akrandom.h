@@ -0,0 +1,59 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QList>
+
+#include <algorithm>
+#include <random>
+
+/**
+ * Seeded random numbers for generated test data, e.g. by the database populator
+ * and the benchmark.
+ *
+ * The distributions are implemented on top of std::mt19937_64, whose output is
+ * fully specified. Unlike the std:: distributions, whose results depend on the
+ * standard library, they give the same numbers everywhere, so that a seed always
+ * describes the same data.
+ */
+class AkRandom
+{
+public:
+    explicit AkRandom(quint64 seed)
+        : mRandom(seed)
+    {
+    }
+
+    /// Returns a number in [0, bound)
+    quint64 bounded(quint64 bound)
+    {
+        // The modulo bias is negligible for the bounds used here
+        return mRandom() % bound;
+    }
+
+    bool chance(int percent)
+    {
+        return bounded(100) < quint64(percent);
+    }
+
+    /// Returns an index into @p cumulativeWeights, picked according to the weights
+    qsizetype sample(const QList<double> &cumulativeWeights)
+    {
+        const double value = double(mRandom() >> 11) * 0x1.0p-53 * cumulativeWeights.constLast();
+        const auto it = std::upper_bound(cumulativeWeights.cbegin(), cumulativeWeights.cend(), value);
+        return std::min<qsizetype>(std::distance(cumulativeWeights.cbegin(), it), cumulativeWeights.size() - 1);
+    }
+
+    template<typename T>
+    const T &element(const QList<T> &list)
+    {
+        return list[qsizetype(bounded(list.size()))];
+    }
+
+private:
+    std::mt19937_64 mRandom;
+};
@@ -0,0 +1,397 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchmark.h"
+#include "dataset.h"
+
+#include "collectionfetchjob.h"
+#include "itemcreatejob.h"
+#include "itemdeletejob.h"
+#include "itemfetchjob.h"
+#include "itemfetchscope.h"
+#include "itemmodifyjob.h"
+#include "itemsync.h"
+#include "monitor.h"
+#include "resourceselectjob_p.h"
+#include "session.h"
+#include "tagfetchjob.h"
+
+#include <QDebug>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Akonadi;
+using namespace std::chrono_literals;
+
+namespace
+{
+// Number of items changed by a SyncCollection operation
+constexpr qsizetype SyncBatchSize = 20;
+
+// How long to wait for the outstanding notifications once all clients are done
+constexpr auto NotificationTimeout = 5s;
+
+double percentile(const std::vector<qint64> &sorted, double percent)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto index = std::clamp<qsizetype>(qsizetype(std::ceil(percent / 100.0 * sorted.size())) - 1, 0, sorted.size() - 1);
+    return sorted[index] / 1000.0;
+}
+
+} // namespace
+
+BenchmarkClient::BenchmarkClient(int index, const ClientScript &script, Benchmark *benchmark)
+    : QObject(benchmark)
+    , mBenchmark(benchmark)
+    , mScript(script)
+    , mSession(new Session("benchmark-client-" + QByteArray::number(index), this))
+    , mRandom(benchmark->seed() + index)
+    , mFlag("$BENCHMARK" + QByteArray::number(index))
+{
+}
+
+void BenchmarkClient::start()
+{
+    if (!needsResourceContext(mScript)) {
+        runNextStep();
+        return;
+    }
+
+    // ItemSync identifies the items by their remote ID, like a resource does
+    auto job = new ResourceSelectJob(mBenchmark->dataset().resource(), mSession);
+    connect(job, &KJob::result, this, [this](KJob *job) {
+        if (job->error()) {
+            qWarning() << "Failed to select resource" << mBenchmark->dataset().resource() << ":" << job->errorString();
+        }
+        runNextStep();
+    });
+}
+
+void BenchmarkClient::runNextStep()
+{
+    if (mStep == mScript.size()) {
+        Q_EMIT finished();
+        return;
+    }
+
+    const auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(mScript[mStep].delay);
+    if (delay > 0ms) {
+        QTimer::singleShot(delay, this, &BenchmarkClient::runStep);
+    } else {
+        runStep();
+    }
+}
+
+void BenchmarkClient::runStep()
+{
+    mOperation = mScript[mStep++].operation;
+    mStart = Benchmark::Clock::now();
+    KJob *job = createJob(mOperation);
+    if (!job) {
+        // Nothing to run the operation on, don't recurse through the whole script
+        QMetaObject::invokeMethod(this, &BenchmarkClient::runNextStep, Qt::QueuedConnection);
+        return;
+    }
+    connect(job, &KJob::result, this, &BenchmarkClient::jobFinished);
+}
+
+KJob *BenchmarkClient::createJob(Operation &operation)
+{
+    const auto &dataset = mBenchmark->dataset();
+    if (dataset.collections().isEmpty()) {
+        return nullptr;
+    }
+
+    switch (operation) {
+    case Operation::FetchCollections:
+        return new CollectionFetchJob(Collection::root(), CollectionFetchJob::Recursive, mSession);
+    case Operation::FetchItems:
+        return new ItemFetchJob(mRandom.element(dataset.collections()), mSession);
+    case Operation::FetchItemPayload: {
+        if (dataset.items().isEmpty()) {
+            return nullptr;
+        }
+        auto job = new ItemFetchJob(Item(mRandom.element(dataset.items()).id()), mSession);
+        job->fetchScope().fetchFullPayload();
+        return job;
+    }
+    case Operation::ModifyFlags: {
+        if (dataset.items().isEmpty()) {
+            return nullptr;
+        }
+        Item item(mRandom.element(dataset.items()).id());
+        if (mFlaggedItems.remove(item.id())) {
+            item.clearFlag(mFlag);
+        } else {
+            item.setFlag(mFlag);
+            mFlaggedItems.insert(item.id());
+        }
+        auto job = new ItemModifyJob(item, mSession);
+        job->setIgnorePayload(true);
+        job->disableRevisionCheck();
+        mBenchmark->expectNotification(item.id(), mStart);
+        return job;
+    }
+    case Operation::CreateItem: {
+        Item item(QLatin1StringView(Dataset::MimeType));
+        item.setPayload(Dataset::payload(mRandom, dataset.options().payloadSize));
+        item.setFlag("\\SEEN");
+        return new ItemCreateJob(item, mRandom.element(dataset.collections()), mSession);
+    }
+    case Operation::DeleteItem:
+        // Only delete what the client created itself, so that the other
+        // operations always find the dataset intact
+        if (mCreatedItems.isEmpty()) {
+            operation = Operation::CreateItem;
+            return createJob(operation);
+        }
+        return new ItemDeleteJob(mCreatedItems.takeLast(), mSession);
+    case Operation::FetchTags:
+        return new TagFetchJob(mSession);
+    case Operation::SyncCollection:
+        return createSyncJob();
+    case Operation::Notification:
+        break;
+    }
+    return nullptr;
+}
+
+KJob *BenchmarkClient::createSyncJob()
+{
+    const auto &dataset = mBenchmark->dataset();
+    const Collection collection = mRandom.element(dataset.collections());
+    const Item::List items = mBenchmark->collectionItems(collection.id());
+    if (items.isEmpty()) {
+        return nullptr;
+    }
+
+    // A window of changed items, as a resource would report after new mail
+    // was read elsewhere
+    const qsizetype count = std::min(items.size(), SyncBatchSize);
+    const qsizetype first = qsizetype(mRandom.bounded(items.size() - count + 1));
+    Item::List changedItems;
+    changedItems.reserve(count);
+    for (qsizetype i = first; i < first + count; ++i) {
+        Item item(QLatin1StringView(Dataset::MimeType));
+        item.setRemoteId(items[i].remoteId());
+        item.setPayload(Dataset::payload(mRandom, dataset.options().payloadSize));
+        if (mRandom.chance(50)) {
+            item.setFlag("\\SEEN");
+        }
+        changedItems.push_back(item);
+    }
+
+    auto job = new ItemSync(collection, {}, mSession);
+    job->setIncrementalSyncItems(changedItems, {});
+    return job;
+}
+
+void BenchmarkClient::jobFinished(KJob *job)
+{
+    const bool failed = job->error();
+    if (failed) {
+        qWarning() << operationName(mOperation) << "failed:" << job->errorString();
+    } else if (mOperation == Operation::CreateItem) {
+        mCreatedItems.push_back(static_cast<ItemCreateJob *>(job)->item());
+    }
+    mBenchmark->record(mOperation, Benchmark::Clock::now() - mStart, failed);
+    runNextStep();
+}
+
+Benchmark::Benchmark(const Dataset &dataset, const QList<ClientScript> &scripts, int concurrency, quint32 seed)
+    : mDataset(dataset)
+    , mScripts(scripts)
+    , mConcurrency(std::max(concurrency, 1))
+    , mSeed(seed)
+{
+    for (const auto &item : dataset.items()) {
+        mCollectionItems[item.parentCollection().id()].push_back(item);
+    }
+}
+
+Benchmark::~Benchmark() = default;
+
+void Benchmark::start()
+{
+    mMonitor = new Monitor(this);
+    mMonitor->setTypeMonitored(Monitor::Items);
+    mMonitor->setAllMonitored(true);
+    connect(mMonitor, &Monitor::itemsFlagsChanged, this, &Benchmark::itemsFlagsChanged);
+    // Don't miss the notifications of the first operations
+    connect(mMonitor, &Monitor::monitorReady, this, &Benchmark::startClients, Qt::SingleShotConnection);
+}
+
+void Benchmark::startClients()
+{
+    mStart = Clock::now();
+    if (mScripts.isEmpty()) {
+        finish();
+        return;
+    }
+    for (int i = 0; i < mConcurrency; ++i) {
+        startNextClient();
+    }
+}
+
+void Benchmark::startNextClient()
+{
+    if (mNextClient == mScripts.size()) {
+        return;
+    }
+
+    const int index = int(mNextClient++);
+    auto client = new BenchmarkClient(index, mScripts[index], this);
+    connect(client, &BenchmarkClient::finished, this, &Benchmark::clientFinished);
+    ++mRunningClients;
+    client->start();
+}
+
+void Benchmark::clientFinished()
+{
+    sender()->deleteLater();
+    --mRunningClients;
+    if (mNextClient < mScripts.size()) {
+        startNextClient();
+        return;
+    }
+    if (mRunningClients > 0) {
+        return;
+    }
+
+    mDuration = Clock::now() - mStart;
+    if (mPendingNotifications.isEmpty()) {
+        finish();
+    } else {
+        QTimer::singleShot(NotificationTimeout, this, &Benchmark::finish);
+    }
+}
+
+void Benchmark::record(Operation operation, Clock::duration duration, bool failed)
+{
+    auto &stats = mStats[operation];
+    if (failed) {
+        ++stats.errors;
+    } else {
+        stats.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+}
+
+void Benchmark::expectNotification(Item::Id item, Clock::time_point start)
+{
+    mPendingNotifications.insert(item, start);
+}
+
+void Benchmark::itemsFlagsChanged(const Item::List &items)
+{
+    const auto now = Clock::now();
+    for (const auto &item : items) {
+        const auto it = mPendingNotifications.constFind(item.id());
+        if (it != mPendingNotifications.cend()) {
+            record(Operation::Notification, now - *it, false);
+            mPendingNotifications.erase(it);
+        }
+    }
+
+    if (mPendingNotifications.isEmpty() && mRunningClients == 0 && mNextClient == mScripts.size()) {
+        finish();
+    }
+}
+
+void Benchmark::finish()
+{
+    if (mFinished) {
+        return;
+    }
+    mFinished = true;
+
+    // Changes that were never notified
+    if (!mPendingNotifications.isEmpty()) {
+        mStats[Operation::Notification].errors += mPendingNotifications.size();
+        mPendingNotifications.clear();
+    }
+    Q_EMIT finished();
+}
+
+qint64 Benchmark::errors() const
+{
+    qint64 errors = 0;
+    for (const auto &entry : mStats) {
+        errors += entry.second.errors;
+    }
+    return errors;
+}
+
+void Benchmark::printReport(QTextStream &stream) const
+{
+    const double seconds = std::chrono::duration<double>(mDuration).count();
+    stream << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                  .arg(QStringLiteral("Operation"), -18)
+                  .arg(QStringLiteral("Count"), 8)
+                  .arg(QStringLiteral("Errors"), 7)
+                  .arg(QStringLiteral("Ops/s"), 9)
+                  .arg(QStringLiteral("p50 ms"), 9)
+                  .arg(QStringLiteral("p90 ms"), 9)
+                  .arg(QStringLiteral("p99 ms"), 9)
+                  .arg(QStringLiteral("max ms"), 9);
+
+    qint64 total = 0;
+    for (auto [operation, stats] : mStats) {
+        std::sort(stats.latencies.begin(), stats.latencies.end());
+        const auto count = qint64(stats.latencies.size());
+        if (operation != Operation::Notification) {
+            total += count;
+        }
+        stream << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                      .arg(operationName(operation), -18)
+                      .arg(count, 8)
+                      .arg(stats.errors, 7)
+                      .arg(seconds > 0 ? count / seconds : 0, 9, 'f', 1)
+                      .arg(percentile(stats.latencies, 50), 9, 'f', 2)
+                      .arg(percentile(stats.latencies, 90), 9, 'f', 2)
+                      .arg(percentile(stats.latencies, 99), 9, 'f', 2)
+                      .arg(percentile(stats.latencies, 100), 9, 'f', 2);
+    }
+    stream << QStringLiteral("\n%1 operations by %2 clients in %3 s (%4 ops/s)\n")
+                  .arg(total)
+                  .arg(mScripts.size())
+                  .arg(seconds, 0, 'f', 2)
+                  .arg(seconds > 0 ? total / seconds : 0, 0, 'f', 1);
+}
+
+QJsonObject Benchmark::toJson() const
+{
+    const double seconds = std::chrono::duration<double>(mDuration).count();
+    QJsonObject operations;
+    for (auto [operation, stats] : mStats) {
+        std::sort(stats.latencies.begin(), stats.latencies.end());
+        const auto count = qint64(stats.latencies.size());
+        operations.insert(operationName(operation),
+                          QJsonObject{
+                              {QStringLiteral("count"), count},
+                              {QStringLiteral("errors"), stats.errors},
+                              {QStringLiteral("opsPerSecond"), seconds > 0 ? count / seconds : 0},
+                              {QStringLiteral("p50"), percentile(stats.latencies, 50)},
+                              {QStringLiteral("p90"), percentile(stats.latencies, 90)},
+                              {QStringLiteral("p99"), percentile(stats.latencies, 99)},
+                              {QStringLiteral("max"), percentile(stats.latencies, 100)},
+                          });
+    }
+
+    return QJsonObject{
+        {QStringLiteral("clients"), qint64(mScripts.size())},
+        {QStringLiteral("concurrency"), mConcurrency},
+        {QStringLiteral("duration"), seconds},
+        {QStringLiteral("operations"), operations},
+    };
+}
+
+#include "moc_benchmark.cpp"
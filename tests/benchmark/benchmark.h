@@ -0,0 +1,143 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "akrandom.h"
+#include "workload.h"
+
+#include "item.h"
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+class Dataset;
+class KJob;
+class QJsonObject;
+class QTextStream;
+
+namespace Akonadi
+{
+class Monitor;
+class Session;
+}
+
+class Benchmark;
+
+/**
+ * A client of the benchmark, with its own session to the server.
+ */
+class BenchmarkClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    BenchmarkClient(int index, const ClientScript &script, Benchmark *benchmark);
+
+    void start();
+
+Q_SIGNALS:
+    void finished();
+
+private:
+    void runNextStep();
+    void runStep();
+    KJob *createJob(Operation &operation);
+    KJob *createSyncJob();
+    void jobFinished(KJob *job);
+
+    Benchmark *const mBenchmark;
+    const ClientScript mScript;
+    Akonadi::Session *const mSession;
+    AkRandom mRandom;
+    /// Flag toggled by ModifyFlags, private to the client so that every
+    /// change is an actual change, which the server notifies
+    const QByteArray mFlag;
+    QSet<Akonadi::Item::Id> mFlaggedItems;
+    Akonadi::Item::List mCreatedItems;
+    qsizetype mStep = 0;
+    Operation mOperation = Operation::FetchCollections;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+/**
+ * Runs the client scripts against the dataset, at most @c concurrency clients
+ * at a time, and collects the latency of each operation.
+ *
+ * Flag changes are additionally watched by a Monitor, to measure how long it
+ * takes until they are notified.
+ */
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Benchmark(const Dataset &dataset, const QList<ClientScript> &scripts, int concurrency, quint32 seed);
+    ~Benchmark() override;
+
+    void start();
+
+    const Dataset &dataset() const
+    {
+        return mDataset;
+    }
+
+    quint32 seed() const
+    {
+        return mSeed;
+    }
+
+    /// Items of the dataset in @p collection
+    Akonadi::Item::List collectionItems(Akonadi::Collection::Id collection) const
+    {
+        return mCollectionItems.value(collection);
+    }
+
+    void record(Operation operation, Clock::duration duration, bool failed);
+    void expectNotification(Akonadi::Item::Id item, Clock::time_point start);
+
+    /// Total number of failed operations
+    qint64 errors() const;
+
+    void printReport(QTextStream &stream) const;
+    QJsonObject toJson() const;
+
+Q_SIGNALS:
+    void finished();
+
+private:
+    struct Stats {
+        std::vector<qint64> latencies; // µs
+        qint64 errors = 0;
+    };
+
+    void startClients();
+    void startNextClient();
+    void clientFinished();
+    void itemsFlagsChanged(const Akonadi::Item::List &items);
+    void finish();
+
+    const Dataset &mDataset;
+    const QList<ClientScript> mScripts;
+    const int mConcurrency;
+    const quint32 mSeed;
+    QHash<Akonadi::Collection::Id, Akonadi::Item::List> mCollectionItems;
+    Akonadi::Monitor *mMonitor = nullptr;
+    qsizetype mNextClient = 0;
+    int mRunningClients = 0;
+    QHash<Akonadi::Item::Id, Clock::time_point> mPendingNotifications;
+    std::map<Operation, Stats> mStats;
+    Clock::time_point mStart;
+    Clock::duration mDuration{};
+    bool mFinished = false;
+};
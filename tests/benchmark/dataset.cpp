@@ -0,0 +1,180 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "dataset.h"
+
+#include "collectioncreatejob.h"
+#include "collectionfetchjob.h"
+#include "itemcreatejob.h"
+#include "tagcreatejob.h"
+
+#include <QEventLoop>
+
+#include <algorithm>
+
+using namespace Akonadi;
+
+namespace
+{
+// Number of jobs queued at once while creating the items
+constexpr int ItemBatchSize = 250;
+
+struct FlagFrequency {
+    const char *flag;
+    int percent;
+};
+
+// Roughly what a mail folder looks like
+const FlagFrequency flagFrequencies[] = {
+    {"\\SEEN", 70},
+    {"\\ANSWERED", 20},
+    {"\\FLAGGED", 10},
+    {"$TODO", 5},
+};
+
+} // namespace
+
+Dataset::Dataset(const DatasetOptions &options)
+    : mOptions(options)
+    , mRandom(options.seed)
+{
+}
+
+QByteArray Dataset::payload(AkRandom &random, int size)
+{
+    // Printable, so that the payload compresses like text does
+    QByteArray payload(size, Qt::Uninitialized);
+    for (char &c : payload) {
+        c = char(' ' + random.bounded('~' - ' ' + 1));
+    }
+    return payload;
+}
+
+bool Dataset::runJobs(const QList<KJob *> &jobs, QString *error)
+{
+    QEventLoop loop;
+    qsizetype pending = jobs.size();
+    for (KJob *job : jobs) {
+        QObject::connect(job, &KJob::result, &loop, [&loop, &pending, error](KJob *job) {
+            if (job->error() && error->isEmpty()) {
+                *error = job->errorString();
+            }
+            if (--pending == 0) {
+                loop.quit();
+            }
+        });
+    }
+    if (pending > 0) {
+        loop.exec();
+    }
+    return error->isEmpty();
+}
+
+bool Dataset::populate(const Collection &parent, QString *error)
+{
+    auto fetchJob = new CollectionFetchJob(parent, CollectionFetchJob::Base);
+    if (!fetchJob->exec() || fetchJob->collections().isEmpty()) {
+        *error = QStringLiteral("Failed to fetch the parent collection: %1").arg(fetchJob->errorString());
+        return false;
+    }
+    mResource = fetchJob->collections().constFirst().resource();
+
+    return createCollections(parent, error) && createTags(error) && createItems(error);
+}
+
+bool Dataset::createCollections(const Collection &parent, QString *error)
+{
+    // Shape the tree first, then create it one level at a time
+    QList<int> parents;
+    QList<int> depths;
+    QList<int> candidates = {-1};
+    for (int i = 0; i < mOptions.collections; ++i) {
+        const int parentIndex = mRandom.element(candidates);
+        const int depth = parentIndex < 0 ? 1 : depths[parentIndex] + 1;
+        parents.push_back(parentIndex);
+        depths.push_back(depth);
+        if (depth < mOptions.depth) {
+            candidates.push_back(i);
+        }
+    }
+
+    mCollections.resize(mOptions.collections);
+    for (int depth = 1; depth <= mOptions.depth; ++depth) {
+        QList<KJob *> jobs;
+        for (int i = 0; i < mOptions.collections; ++i) {
+            if (depths[i] != depth) {
+                continue;
+            }
+            Collection collection;
+            collection.setName(QStringLiteral("benchmark-%1").arg(i));
+            collection.setParentCollection(parents[i] < 0 ? parent : mCollections[parents[i]]);
+            collection.setContentMimeTypes({QLatin1StringView(MimeType), Collection::mimeType()});
+            auto job = new CollectionCreateJob(collection);
+            QObject::connect(job, &KJob::result, job, [this, i](KJob *job) {
+                mCollections[i] = static_cast<CollectionCreateJob *>(job)->collection();
+            });
+            jobs.push_back(job);
+        }
+        if (!runJobs(jobs, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Dataset::createTags(QString *error)
+{
+    QList<KJob *> jobs;
+    mTags.resize(mOptions.tags);
+    for (int i = 0; i < mOptions.tags; ++i) {
+        auto job = new TagCreateJob(Tag::genericTag(QStringLiteral("benchmark-tag-%1").arg(i)));
+        job->setMergeIfExisting(true);
+        QObject::connect(job, &KJob::result, job, [this, i](KJob *job) {
+            mTags[i] = static_cast<TagCreateJob *>(job)->tag();
+        });
+        jobs.push_back(job);
+    }
+    return runJobs(jobs, error);
+}
+
+bool Dataset::createItems(QString *error)
+{
+    if (mCollections.isEmpty()) {
+        return true;
+    }
+
+    mItems.reserve(mOptions.items);
+    for (int batchStart = 0; batchStart < mOptions.items; batchStart += ItemBatchSize) {
+        QList<KJob *> jobs;
+        for (int i = batchStart; i < std::min(batchStart + ItemBatchSize, mOptions.items); ++i) {
+            Item item(QLatin1StringView(MimeType));
+            item.setRemoteId(QStringLiteral("benchmark-item-%1").arg(i));
+            item.setGid(QStringLiteral("benchmark-%1@akonadi").arg(i));
+            const bool large = mRandom.chance(mOptions.largePayloadPercent);
+            item.setPayload(payload(mRandom, large ? mOptions.largePayloadSize : mOptions.payloadSize));
+            for (const auto &frequency : flagFrequencies) {
+                if (mRandom.chance(frequency.percent)) {
+                    item.setFlag(frequency.flag);
+                }
+            }
+            if (!mTags.isEmpty() && mRandom.chance(30)) {
+                item.setTag(mRandom.element(mTags));
+            }
+
+            auto job = new ItemCreateJob(item, mRandom.element(mCollections));
+            QObject::connect(job, &KJob::result, job, [this](KJob *job) {
+                if (!job->error()) {
+                    mItems.push_back(static_cast<ItemCreateJob *>(job)->item());
+                }
+            });
+            jobs.push_back(job);
+        }
+        if (!runJobs(jobs, error)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "collection.h"
+#include "item.h"
+#include "tag.h"
+
+#include "akrandom.h"
+
+class KJob;
+
+struct DatasetOptions {
+    int collections = 20;
+    /// Maximum depth of the folder tree below the parent collection
+    int depth = 3;
+    int items = 2000;
+    int payloadSize = 2048;
+    /// Percentage of items with a payload of largePayloadSize, which the
+    /// server stores in external files
+    int largePayloadPercent = 5;
+    int largePayloadSize = 256 * 1024;
+    int tags = 20;
+    quint32 seed = 1;
+};
+
+/**
+ * Synthetic dataset created through the client API.
+ *
+ * The collections, items, flags and tags are derived from the seed only, so
+ * that runs on different backends or builds work on the same data.
+ */
+class Dataset
+{
+public:
+    static constexpr const char *MimeType = "application/octet-stream";
+
+    explicit Dataset(const DatasetOptions &options);
+
+    /**
+     * Creates the dataset below @p parent, returns false and sets @p error on failure.
+     */
+    bool populate(const Akonadi::Collection &parent, QString *error);
+
+    const DatasetOptions &options() const
+    {
+        return mOptions;
+    }
+
+    /// Resource owning the dataset
+    QString resource() const
+    {
+        return mResource;
+    }
+
+    const Akonadi::Collection::List &collections() const
+    {
+        return mCollections;
+    }
+
+    /// Items created by populate(), with their id, remote ID and collection
+    const Akonadi::Item::List &items() const
+    {
+        return mItems;
+    }
+
+    const Akonadi::Tag::List &tags() const
+    {
+        return mTags;
+    }
+
+    static QByteArray payload(AkRandom &random, int size);
+
+    /**
+     * Runs @p jobs, which can run concurrently, and waits for all of them to finish.
+     */
+    static bool runJobs(const QList<KJob *> &jobs, QString *error);
+
+private:
+    bool createCollections(const Akonadi::Collection &parent, QString *error);
+    bool createTags(QString *error);
+    bool createItems(QString *error);
+
+    const DatasetOptions mOptions;
+    AkRandom mRandom;
+    QString mResource;
+    Akonadi::Collection::List mCollections;
+    Akonadi::Item::List mItems;
+    Akonadi::Tag::List mTags;
+};
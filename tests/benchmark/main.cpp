@@ -0,0 +1,202 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "benchmark.h"
+#include "dataset.h"
+#include "workload.h"
+
+#include "agentinstance.h"
+#include "agentmanager.h"
+#include "collectionpathresolver.h"
+
+#include "shared/akapplication.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+
+using namespace Akonadi;
+
+namespace
+{
+int intOption(const QCommandLineParser &args, const QString &name, int defaultValue)
+{
+    bool ok = false;
+    const int value = args.value(name).toInt(&ok);
+    return ok && value >= 0 ? value : defaultValue;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    AkCoreApplication app(argc, argv);
+    app.setDescription(
+        QStringLiteral("Akonadi server benchmark\n"
+                       "Populates a synthetic dataset and runs a multi-client workload against it, then reports the\n"
+                       "throughput and latency of each operation. Must be run in an isolated instance, e.g.\n"
+                       "akonaditest -c autotests/libs/unittestenv/config.xml -b sqlite akonadibenchmark"));
+
+    const DatasetOptions defaults;
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("parent"),
+                                                 QStringLiteral("Path of the collection to create the dataset in"),
+                                                 QStringLiteral("path"),
+                                                 QStringLiteral("res1")));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("collections"),
+                                                 QStringLiteral("Number of collections to create"),
+                                                 QStringLiteral("count"),
+                                                 QString::number(defaults.collections)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("depth"), QStringLiteral("Maximum depth of the collection tree"), QStringLiteral("depth"), QString::number(defaults.depth)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("items"), QStringLiteral("Number of items to create"), QStringLiteral("count"), QString::number(defaults.items)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("payload-size"),
+                                                 QStringLiteral("Payload size of the items, in bytes"),
+                                                 QStringLiteral("size"),
+                                                 QString::number(defaults.payloadSize)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("large-payloads"),
+                                                 QStringLiteral("Percentage of items with a large payload, stored in an external part"),
+                                                 QStringLiteral("percent"),
+                                                 QString::number(defaults.largePayloadPercent)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("large-payload-size"),
+                                                 QStringLiteral("Size of the large payloads, in bytes"),
+                                                 QStringLiteral("size"),
+                                                 QString::number(defaults.largePayloadSize)));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("tags"), QStringLiteral("Number of tags to create"), QStringLiteral("count"), QString::number(defaults.tags)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("seed"),
+                                                 QStringLiteral("Seed of the dataset and of the synthetic workload"),
+                                                 QStringLiteral("seed"),
+                                                 QString::number(defaults.seed)));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("workload"),
+                                                 QStringLiteral("Synthetic workload to run: mail, sync or mixed"),
+                                                 QStringLiteral("kind"),
+                                                 QStringLiteral("mixed")));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("trace"),
+                                                 QStringLiteral("Replay the workload recorded in a binary trace of the server instead"),
+                                                 QStringLiteral("file")));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("speed"),
+                                                 QStringLiteral("Replay the delays between the traced commands at this speed, 0 to not wait"),
+                                                 QStringLiteral("factor"),
+                                                 QStringLiteral("0")));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("clients"), QStringLiteral("Number of synthetic clients"), QStringLiteral("count"), QStringLiteral("8")));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("operations"),
+                                                 QStringLiteral("Number of operations of each synthetic client"),
+                                                 QStringLiteral("count"),
+                                                 QStringLiteral("200")));
+    app.addCommandLineOptions(QCommandLineOption(QStringLiteral("concurrency"),
+                                                 QStringLiteral("Maximum number of clients running at the same time"),
+                                                 QStringLiteral("count"),
+                                                 QStringLiteral("8")));
+    app.addCommandLineOptions(
+        QCommandLineOption(QStringLiteral("json"), QStringLiteral("Also write the results to a JSON file"), QStringLiteral("file")));
+    app.parseCommandLine();
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (qEnvironmentVariableIsEmpty("TESTRUNNER_DB_ENVIRONMENT")) {
+        err << "The benchmark must be run by akonaditest, to not modify your real Akonadi data.\n";
+        return 1;
+    }
+
+    const auto &args = app.commandLineArguments();
+    DatasetOptions options;
+    options.collections = intOption(args, QStringLiteral("collections"), defaults.collections);
+    options.depth = std::max(intOption(args, QStringLiteral("depth"), defaults.depth), 1);
+    options.items = intOption(args, QStringLiteral("items"), defaults.items);
+    options.payloadSize = intOption(args, QStringLiteral("payload-size"), defaults.payloadSize);
+    options.largePayloadPercent = intOption(args, QStringLiteral("large-payloads"), defaults.largePayloadPercent);
+    options.largePayloadSize = intOption(args, QStringLiteral("large-payload-size"), defaults.largePayloadSize);
+    options.tags = intOption(args, QStringLiteral("tags"), defaults.tags);
+    options.seed = args.value(QStringLiteral("seed")).toUInt();
+
+    QList<ClientScript> scripts;
+    if (args.isSet(QStringLiteral("trace"))) {
+        QString error;
+        const auto workload = traceWorkload(args.value(QStringLiteral("trace")), args.value(QStringLiteral("speed")).toDouble(), &error);
+        if (!workload.has_value()) {
+            err << error << "\n";
+            return 1;
+        }
+        scripts = *workload;
+    } else {
+        scripts = syntheticWorkload(args.value(QStringLiteral("workload")),
+                                    intOption(args, QStringLiteral("clients"), 8),
+                                    intOption(args, QStringLiteral("operations"), 200),
+                                    options.seed);
+        if (scripts.isEmpty()) {
+            err << "Unknown workload " << args.value(QStringLiteral("workload")) << "\n";
+            return 1;
+        }
+    }
+
+    // Keep the resources from interfering with the measurements
+    const auto instances = AgentManager::self()->instances();
+    for (AgentInstance instance : instances) {
+        instance.setIsOnline(false);
+    }
+
+    auto resolver = new CollectionPathResolver(args.value(QStringLiteral("parent")));
+    if (!resolver->exec()) {
+        err << "Failed to resolve " << args.value(QStringLiteral("parent")) << ": " << resolver->errorString() << "\n";
+        return 1;
+    }
+
+    Dataset dataset(options);
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    if (!dataset.populate(Collection(resolver->collection()), &error)) {
+        err << "Failed to populate the dataset: " << error << "\n";
+        return 1;
+    }
+    const double populateSeconds = timer.elapsed() / 1000.0;
+    out << QStringLiteral("Created %1 collections, %2 tags and %3 items in %4 s (%5 items/s) on %6\n\n")
+               .arg(dataset.collections().size())
+               .arg(dataset.tags().size())
+               .arg(dataset.items().size())
+               .arg(populateSeconds, 0, 'f', 2)
+               .arg(populateSeconds > 0 ? dataset.items().size() / populateSeconds : 0, 0, 'f', 1)
+               .arg(qEnvironmentVariable("TESTRUNNER_DB_ENVIRONMENT"));
+    out.flush();
+
+    Benchmark benchmark(dataset, scripts, intOption(args, QStringLiteral("concurrency"), 8), options.seed);
+    QObject::connect(&benchmark, &Benchmark::finished, QCoreApplication::instance(), &QCoreApplication::quit);
+    benchmark.start();
+    app.exec();
+
+    benchmark.printReport(out);
+
+    if (args.isSet(QStringLiteral("json"))) {
+        auto json = benchmark.toJson();
+        json.insert(QStringLiteral("backend"), qEnvironmentVariable("TESTRUNNER_DB_ENVIRONMENT"));
+        json.insert(QStringLiteral("dataset"),
+                    QJsonObject{
+                        {QStringLiteral("collections"), options.collections},
+                        {QStringLiteral("items"), options.items},
+                        {QStringLiteral("payloadSize"), options.payloadSize},
+                        {QStringLiteral("largePayloadPercent"), options.largePayloadPercent},
+                        {QStringLiteral("largePayloadSize"), options.largePayloadSize},
+                        {QStringLiteral("tags"), options.tags},
+                        {QStringLiteral("seed"), qint64(options.seed)},
+                        {QStringLiteral("populateDuration"), populateSeconds},
+                    });
+        QFile file(args.value(QStringLiteral("json")));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(QJsonDocument(json).toJson()) < 0) {
+            err << "Failed to write " << file.fileName() << ": " << file.errorString() << "\n";
+            return 1;
+        }
+    }
+
+    return benchmark.errors() > 0 ? 2 : 0;
+}
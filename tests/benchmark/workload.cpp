@@ -0,0 +1,194 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "workload.h"
+#include "akrandom.h"
+
+#include "private/binarytrace_p.h"
+#include "private/protocol_p.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace Akonadi;
+
+namespace
+{
+struct WeightedOperation {
+    Operation operation;
+    int weight;
+};
+
+// Weights in percent
+const QList<WeightedOperation> mailOperations = {
+    {Operation::FetchItems, 20},
+    {Operation::FetchItemPayload, 40},
+    {Operation::ModifyFlags, 30},
+    {Operation::FetchTags, 4},
+    {Operation::CreateItem, 3},
+    {Operation::DeleteItem, 3},
+};
+
+const QList<WeightedOperation> syncOperations = {
+    {Operation::SyncCollection, 60},
+    {Operation::CreateItem, 20},
+    {Operation::DeleteItem, 20},
+};
+
+ClientScript generateScript(const QList<WeightedOperation> &operations, int count, AkRandom &random)
+{
+    QList<double> cumulativeWeights;
+    cumulativeWeights.reserve(operations.size());
+    double total = 0;
+    for (const auto &operation : operations) {
+        total += operation.weight;
+        cumulativeWeights.push_back(total);
+    }
+    ClientScript script;
+    script.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        script.push_back({operations[random.sample(cumulativeWeights)].operation});
+    }
+    return script;
+}
+
+std::optional<Operation> operationForCommand(const BinaryTrace::Event &event)
+{
+    switch (event.command) {
+    case Protocol::Command::FetchCollections:
+        return Operation::FetchCollections;
+    case Protocol::Command::FetchItems:
+        return event.count > 1 ? Operation::FetchItems : Operation::FetchItemPayload;
+    case Protocol::Command::ModifyItems:
+        return Operation::ModifyFlags;
+    case Protocol::Command::CreateItem:
+        return Operation::CreateItem;
+    case Protocol::Command::DeleteItems:
+        return Operation::DeleteItem;
+    case Protocol::Command::FetchTags:
+        return Operation::FetchTags;
+    default:
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+QString operationName(Operation operation)
+{
+    switch (operation) {
+    case Operation::FetchCollections:
+        return QStringLiteral("FetchCollections");
+    case Operation::FetchItems:
+        return QStringLiteral("FetchItems");
+    case Operation::FetchItemPayload:
+        return QStringLiteral("FetchItemPayload");
+    case Operation::ModifyFlags:
+        return QStringLiteral("ModifyFlags");
+    case Operation::CreateItem:
+        return QStringLiteral("CreateItem");
+    case Operation::DeleteItem:
+        return QStringLiteral("DeleteItem");
+    case Operation::FetchTags:
+        return QStringLiteral("FetchTags");
+    case Operation::SyncCollection:
+        return QStringLiteral("SyncCollection");
+    case Operation::Notification:
+        return QStringLiteral("Notification");
+    }
+    Q_UNREACHABLE();
+}
+
+QList<ClientScript> syntheticWorkload(const QString &kind, int clients, int operations, quint32 seed)
+{
+    if (kind != QLatin1StringView("mail") && kind != QLatin1StringView("sync") && kind != QLatin1StringView("mixed")) {
+        return {};
+    }
+
+    operations = std::max(operations, 1);
+    QList<ClientScript> scripts;
+    scripts.reserve(clients);
+    for (int client = 0; client < clients; ++client) {
+        AkRandom random(seed + client);
+        const bool syncClient = kind == QLatin1StringView("sync") || (kind == QLatin1StringView("mixed") && client % 4 == 3);
+        if (syncClient) {
+            scripts.push_back(generateScript(syncOperations, operations, random));
+        } else {
+            auto script = generateScript(mailOperations, operations - 1, random);
+            script.prepend({Operation::FetchCollections});
+            scripts.push_back(script);
+        }
+    }
+    return scripts;
+}
+
+std::optional<QList<ClientScript>> traceWorkload(const QString &fileName, double speed, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QStringLiteral("Failed to open %1: %2").arg(fileName, file.errorString());
+        return std::nullopt;
+    }
+    BinaryTrace::Header header;
+    if (!BinaryTrace::readHeader(&file, &header)) {
+        *error = QStringLiteral("%1 is not a binary trace of a supported version").arg(fileName);
+        return std::nullopt;
+    }
+
+    // Ordered by connection, so that the clients are started in the order the
+    // connections were made
+    std::map<quint32, QList<BinaryTrace::Event>> connections;
+    char buffer[BinaryTrace::EventSize];
+    while (file.read(buffer, sizeof(buffer)) == sizeof(buffer)) {
+        const auto event = BinaryTrace::decodeEvent(buffer);
+        if (event.flags & BinaryTrace::Dropped) {
+            continue;
+        }
+        connections[event.connection].push_back(event);
+    }
+
+    QList<ClientScript> scripts;
+    for (auto &connection : connections) {
+        auto &events = connection.second;
+        std::stable_sort(events.begin(), events.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.timestamp < rhs.timestamp;
+        });
+
+        ClientScript script;
+        quint64 previousEnd = events.first().timestamp;
+        for (const auto &event : std::as_const(events)) {
+            const auto operation = operationForCommand(event);
+            if (!operation.has_value()) {
+                continue;
+            }
+            WorkloadStep step{*operation};
+            if (speed > 0 && event.timestamp > previousEnd) {
+                step.delay = std::chrono::microseconds(qint64((event.timestamp - previousEnd) / speed));
+            }
+            previousEnd = event.timestamp + event.duration;
+            script.push_back(step);
+        }
+        if (!script.isEmpty()) {
+            scripts.push_back(script);
+        }
+    }
+
+    if (scripts.isEmpty()) {
+        *error = QStringLiteral("%1 contains no commands that can be replayed").arg(fileName);
+        return std::nullopt;
+    }
+    return scripts;
+}
+
+bool needsResourceContext(const ClientScript &script)
+{
+    return std::any_of(script.cbegin(), script.cend(), [](const WorkloadStep &step) {
+        return step.operation == Operation::SyncCollection;
+    });
+}
@@ -0,0 +1,68 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QList>
+#include <QString>
+
+#include <chrono>
+#include <optional>
+
+/**
+ * Operations performed by the benchmark clients.
+ *
+ * Each operation maps to the client jobs an application or a resource would
+ * use for it, so that the fetch, sync and notification paths of the server
+ * are measured the way they are exercised in practice.
+ */
+enum class Operation {
+    FetchCollections, ///< Recursive collection listing
+    FetchItems, ///< Listing of a folder, without payload
+    FetchItemPayload, ///< Full payload of a single item
+    ModifyFlags, ///< Adds or removes a flag of an item
+    CreateItem,
+    DeleteItem,
+    FetchTags,
+    SyncCollection, ///< Incremental ItemSync of a folder, as done by resources
+    Notification, ///< Not an operation: delay until a flag change is notified
+};
+
+QString operationName(Operation operation);
+
+struct WorkloadStep {
+    Operation operation;
+    /// Time to wait before running the step
+    std::chrono::microseconds delay{0};
+};
+
+/// Steps run in order by a single client
+using ClientScript = QList<WorkloadStep>;
+
+/**
+ * Generates synthetic workloads.
+ *
+ * @c mail clients behave like a mail application: they list the folders once,
+ * then mostly open folders and items and change flags. @c sync clients behave
+ * like a resource synchronizing changes. @c mixed makes every fourth client a
+ * sync client.
+ *
+ * Returns an empty list when @p kind is unknown.
+ */
+QList<ClientScript> syntheticWorkload(const QString &kind, int clients, int operations, quint32 seed);
+
+/**
+ * Reads the workload recorded in a binary trace of the server.
+ *
+ * Each traced connection becomes a client that replays the commands it sent,
+ * mapped to the nearest operation. Commands without an equivalent, e.g.
+ * Login or Transaction, are skipped. The delays between the commands are
+ * kept, divided by @p speed, or dropped when @p speed is 0.
+ */
+std::optional<QList<ClientScript>> traceWorkload(const QString &fileName, double speed, QString *error);
+
+/// Whether @p script needs a session with a resource context
+bool needsResourceContext(const ClientScript &script);